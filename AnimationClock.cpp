@@ -0,0 +1,198 @@
+﻿#include "AnimationClock.h"
+#include <QCoreApplication>
+#include <QDebug>
+
+AnimationClock* AnimationClock::instance() {
+    static AnimationClock* clockInstance = new AnimationClock(QCoreApplication::instance());
+    return clockInstance;
+}
+
+AnimationClock::AnimationClock(QObject* parent)
+    : QObject(parent)
+    , frameTimer(new QTimer(this))
+    , frameIntervalMs(DEFAULT_FRAME_INTERVAL_MS)
+    , nextId(1)
+{
+    frameTimer->setTimerType(Qt::PreciseTimer);
+    frameTimer->setInterval(frameIntervalMs);
+    connect(frameTimer, &QTimer::timeout, this, &AnimationClock::onFrame);
+    clock.start();
+}
+
+int AnimationClock::addEntry(Entry entry) {
+    int id = nextId++;
+    entry.startMs = clock.elapsed();
+    entries.insert(id, entry);
+    rescheduleSooner();
+    return id;
+}
+
+// Every frame while something is in motion; otherwise until the first
+// repeating entry is due (with the same half-frame slack as onFrame)
+int AnimationClock::nextFrameDelay(qint64 now) const {
+    qint64 delay = -1;
+    for (const Entry& entry : entries) {
+        if (!entry.repeating) {
+            return frameIntervalMs;
+        }
+        qint64 due = entry.startMs + entry.durationMs - frameIntervalMs / 2 - now;
+        if (delay < 0 || due < delay) {
+            delay = due;
+        }
+    }
+    return int(qMax<qint64>(frameIntervalMs, delay));
+}
+
+// An entry was added or shortened: start the timer, or bring it forward
+void AnimationClock::rescheduleSooner() {
+    int delay = nextFrameDelay(clock.elapsed());
+    if (!frameTimer->isActive()) {
+        frameTimer->start(delay);
+        emit started();
+    } else if (delay < frameTimer->remainingTime()) {
+        frameTimer->start(delay);
+    }
+}
+
+int AnimationClock::animate(QObject* owner, int durationMs, StepFunction step,
+                            FinishedFunction finished, const QEasingCurve& easing) {
+    Entry entry;
+    entry.owner = owner;
+    entry.durationMs = qMax(1, durationMs);
+    entry.easing = easing;
+    entry.step = std::move(step);
+    entry.finished = std::move(finished);
+
+    StepFunction firstStep = entry.step;
+    int id = addEntry(entry);
+
+    // First frame at progress 0 so the start state is visible immediately
+    if (firstStep) {
+        firstStep(easing.valueForProgress(0.0));
+    }
+    return id;
+}
+
+int AnimationClock::every(QObject* owner, int periodMs, TickFunction tick) {
+    Entry entry;
+    entry.owner = owner;
+    entry.repeating = true;
+    entry.durationMs = qMax(1, periodMs);
+    entry.tick = std::move(tick);
+    return addEntry(entry);
+}
+
+void AnimationClock::stop(int id) {
+    entries.remove(id);
+    // The timer itself is stopped on the next frame if nothing is left
+}
+
+void AnimationClock::setPeriod(int id, int periodMs) {
+    auto it = entries.find(id);
+    if (it != entries.end() && it->repeating) {
+        it->durationMs = qMax(1, periodMs);
+        rescheduleSooner();
+    }
+}
+
+int AnimationClock::period(int id) const {
+    auto it = entries.constFind(id);
+    return (it != entries.constEnd() && it->repeating) ? it->durationMs : 0;
+}
+
+void AnimationClock::markDirty(QWidget* widget, const QRect& rect) {
+    if (!widget) return;
+
+    QRegion region = rect.isNull() ? QRegion(widget->rect()) : QRegion(rect);
+
+    if (!frameTimer->isActive() || frameTimer->interval() > frameIntervalMs) {
+        // No frame coming soon - nothing to coalesce with
+        widget->update(region);
+        return;
+    }
+
+    for (QPair<QPointer<QWidget>, QRegion>& dirty : dirtyWidgets) {
+        if (dirty.first == widget) {
+            dirty.second += region;
+            return;
+        }
+    }
+    dirtyWidgets.append(qMakePair(QPointer<QWidget>(widget), region));
+}
+
+void AnimationClock::setFrameInterval(int intervalMs) {
+    frameIntervalMs = qMax(1, intervalMs);
+    if (frameTimer->isActive()) {
+        frameTimer->start(nextFrameDelay(clock.elapsed()));
+    }
+}
+
+void AnimationClock::onFrame() {
+    const qint64 now = clock.elapsed();
+
+    // Callbacks may start or stop entries, so walk a snapshot of the ids
+    const QList<int> ids = entries.keys();
+    for (int id : ids) {
+        auto it = entries.find(id);
+        if (it == entries.end()) continue;
+
+        if (it->owner.isNull()) {
+            entries.erase(it);
+            continue;
+        }
+
+        if (it->repeating) {
+            // Half a frame of slack so a period that is a multiple of the
+            // frame interval does not slip a whole frame on timer jitter
+            if (now - it->startMs + frameIntervalMs / 2 >= it->durationMs) {
+                it->startMs = now;
+                TickFunction tick = it->tick;
+                tick();
+            }
+            continue;
+        }
+
+        qreal progress = qMin(1.0, qreal(now - it->startMs) / it->durationMs);
+        StepFunction step = it->step;
+        if (step) {
+            step(it->easing.valueForProgress(progress));
+        }
+
+        if (progress >= 1.0) {
+            FinishedFunction finished;
+            auto done = entries.find(id);
+            if (done != entries.end()) {
+                finished = done->finished;
+                entries.erase(done);
+            }
+            if (finished) {
+                finished();
+            }
+        }
+    }
+
+    flushDirty();
+
+    if (entries.isEmpty()) {
+        frameTimer->stop();
+        emit idle();
+        return;
+    }
+
+    int delay = nextFrameDelay(clock.elapsed());
+    if (delay != frameTimer->interval()) {
+        frameTimer->start(delay);
+    }
+}
+
+void AnimationClock::flushDirty() {
+    // Swap first: update() can't re-enter, but a widget's slot might mark again
+    QVector<QPair<QPointer<QWidget>, QRegion>> dirty;
+    dirty.swap(dirtyWidgets);
+
+    for (const QPair<QPointer<QWidget>, QRegion>& entry : dirty) {
+        if (entry.first) {
+            entry.first->update(entry.second);
+        }
+    }
+}
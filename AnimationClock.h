@@ -0,0 +1,92 @@
+﻿// AnimationClock.h - Single frame clock driving all lane UI animations
+#ifndef ANIMATIONCLOCK_H
+#define ANIMATIONCLOCK_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QWidget>
+#include <QRegion>
+#include <QHash>
+#include <QVector>
+#include <QEasingCurve>
+#include <functional>
+
+// One precise timer ticks once per display frame while anything is
+// animating and stops completely when nothing is. When only repeating
+// entries are left (an idle lane's marquee or call flash) it sleeps until
+// the earliest one is due instead of waking every frame. Every registered
+// animation advances on the same tick, and widgets mark their dirty
+// rectangles with markDirty() so each widget gets a single update() per
+// frame instead of one per animation.
+class AnimationClock : public QObject {
+    Q_OBJECT
+
+public:
+    using StepFunction = std::function<void(qreal progress)>;
+    using TickFunction = std::function<void()>;
+    using FinishedFunction = std::function<void()>;
+
+    static AnimationClock* instance();
+
+    // Run step(eased progress 0..1) every frame for durationMs, then finished().
+    // Entries are dropped automatically if owner is destroyed.
+    int animate(QObject* owner, int durationMs, StepFunction step,
+                FinishedFunction finished = FinishedFunction(),
+                const QEasingCurve& easing = QEasingCurve(QEasingCurve::Linear));
+
+    // Run tick() on the first frame at least periodMs after the previous one
+    int every(QObject* owner, int periodMs, TickFunction tick);
+
+    void stop(int id);
+    bool isActive(int id) const { return entries.contains(id); }
+
+    void setPeriod(int id, int periodMs);
+    int period(int id) const;
+
+    // Coalesced repaint - flushed once at the end of the current frame
+    void markDirty(QWidget* widget, const QRect& rect = QRect());
+
+    void setFrameInterval(int intervalMs);
+    int frameInterval() const { return frameIntervalMs; }
+    int activeCount() const { return entries.size(); }
+
+signals:
+    void started();
+    void idle();
+
+private slots:
+    void onFrame();
+
+private:
+    explicit AnimationClock(QObject* parent = nullptr);
+
+    struct Entry {
+        QPointer<QObject> owner;
+        bool repeating = false;
+        qint64 startMs = 0;
+        int durationMs = 0;         // One-shot length, or repeat period
+        QEasingCurve easing;
+        StepFunction step;
+        TickFunction tick;
+        FinishedFunction finished;
+    };
+
+    int addEntry(Entry entry);
+    void flushDirty();
+    int nextFrameDelay(qint64 now) const;
+    void rescheduleSooner();
+
+    QTimer* frameTimer;
+    QElapsedTimer clock;
+    int frameIntervalMs;
+    int nextId;
+
+    QHash<int, Entry> entries;
+    QVector<QPair<QPointer<QWidget>, QRegion>> dirtyWidgets;
+
+    static const int DEFAULT_FRAME_INTERVAL_MS = 16;    // ~60 Hz display
+};
+
+#endif // ANIMATIONCLOCK_H
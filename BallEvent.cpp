@@ -0,0 +1,58 @@
+﻿#include "BallEvent.h"
+#include "ClockSync.h"
+#include <QJsonArray>
+
+namespace {
+const int PIN_VALUES[BallEvent::PIN_COUNT] = {2, 3, 5, 3, 2};   // L2, L3, C5, R3, R2
+}
+
+int BallEvent::valueOf(const std::array<quint8, PIN_COUNT>& pins) {
+    int total = 0;
+    for (int i = 0; i < PIN_COUNT; ++i) {
+        if (pins[i] == 0) {
+            total += PIN_VALUES[i];
+        }
+    }
+    return total;
+}
+
+BallEvent BallEvent::fromPins(const QVector<int>& pinStates, const BallTiming& timing) {
+    BallEvent event;
+    for (int i = 0; i < PIN_COUNT && i < pinStates.size(); ++i) {
+        event.pins[i] = pinStates[i] ? 1 : 0;
+    }
+    event.value = valueOf(event.pins);
+    event.timing = timing;
+    event.laneTimeUs = ClockSync::monotonicUs();
+    return event;
+}
+
+QJsonObject BallEvent::toJson() const {
+    QJsonArray pinArray;
+    for (quint8 pin : pins) {
+        pinArray.append(int(pin));
+    }
+
+    QJsonObject json;
+    json["type"] = amended ? "ball_amended" : "ball";
+    json["seq"] = qint64(sequence);
+    if (gameNumber > 0) {
+        json["game"] = gameNumber;
+    }
+    json["bowler"] = bowler;
+    if (!bowlerId.isEmpty()) {
+        json["bowler_id"] = bowlerId;
+    }
+    json["frame"] = frame;
+    json["ball"] = ball;
+    json["pins"] = pinArray;
+    json["value"] = value;
+    json["lane_time_us"] = laneTimeUs;
+    if (strike) json["is_strike"] = true;
+    if (spare) json["is_spare"] = true;
+    if (timing.isValid()) {
+        json["speed_mps"] = timing.speedMps;
+        json["dwell_ms"] = timing.dwellMs;
+    }
+    return json;
+}
@@ -0,0 +1,52 @@
+﻿// BallEvent.h - One ball as it moves through the lane's own pipeline
+#ifndef BALLEVENT_H
+#define BALLEVENT_H
+
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+#include <QJsonObject>
+#include <array>
+#include "BallTiming.h"
+
+// MachineInterface -> BowlingMainWindow -> QuickGame -> statistics, 3-6-9 and
+// the server, as a plain value with no JSON on the way. The bowler strings
+// are implicitly shared with QuickGame's Bowler, so copying an event does not
+// copy them; pinVector() does allocate, for the Ball kept in the frame
+// history. JSON is made once, by LaneClient::sendBall, for the wire.
+//
+// Pins follow MachineInterface: index order L2, L3, C5, R3, R2 and
+// 0 = down, 1 = standing.
+struct BallEvent {
+    static constexpr int PIN_COUNT = 5;
+
+    std::array<quint8, PIN_COUNT> pins {{1, 1, 1, 1, 1}};
+    int value = 0;              // Canadian 5-pin value of the pins down
+    BallTiming timing;
+    qint64 laneTimeUs = 0;      // ClockSync::monotonicUs() at detection
+
+    // Filled in by QuickGame once the ball is scored
+    quint32 sequence = 0;       // 1, 2, ... per game; an amendment repeats its ball's
+    int gameNumber = 0;         // The lane's game number, set when it is sent
+    QString bowler;
+    QString bowlerId;
+    int bowlerIndex = -1;
+    int frame = 0;              // 1-based
+    int ball = 0;               // 1-based within the frame
+    bool strike = false;
+    bool spare = false;
+    bool amended = false;       // A late pin changed an already reported ball
+
+    static BallEvent fromPins(const QVector<int>& pinStates, const BallTiming& timing = BallTiming());
+    static int valueOf(const std::array<quint8, PIN_COUNT>& pins);
+
+    bool allDown() const { return value == 15; }
+    QVector<int> pinVector() const { return QVector<int>(pins.begin(), pins.end()); }
+
+    // Wire format: "ball" / "ball_amended" as the server and EventLog expect
+    QJsonObject toJson() const;
+};
+
+Q_DECLARE_METATYPE(BallEvent)
+
+#endif // BALLEVENT_H
@@ -0,0 +1,40 @@
+﻿#ifndef BALLTIMING_H
+#define BALLTIMING_H
+
+#include <QMetaType>
+#include <QJsonObject>
+
+// Ball timing measured from the ball sensor edge timestamps.
+// Computed on the acquisition thread; zero values mean "not measured".
+struct BallTiming {
+    double speedMps = 0.0;     // Ball speed in metres per second
+    double dwellMs = 0.0;      // Time the ball held the GP7 sensor high
+    double sensorGapMs = 0.0;  // GP7 -> GP8 rising edge interval (second sensor only)
+    bool twoSensor = false;    // Speed measured between two sensors rather than from dwell
+
+    bool isValid() const { return speedMps > 0.0; }
+    double speedKph() const { return speedMps * 3.6; }
+
+    QJsonObject toJson() const {
+        QJsonObject json;
+        json["speed_mps"] = speedMps;
+        json["dwell_ms"] = dwellMs;
+        if (twoSensor) {
+            json["sensor_gap_ms"] = sensorGapMs;
+        }
+        return json;
+    }
+
+    static BallTiming fromJson(const QJsonObject& json) {
+        BallTiming timing;
+        timing.speedMps = json["speed_mps"].toDouble();
+        timing.dwellMs = json["dwell_ms"].toDouble();
+        timing.sensorGapMs = json["sensor_gap_ms"].toDouble();
+        timing.twoSensor = json.contains("sensor_gap_ms");
+        return timing;
+    }
+};
+
+Q_DECLARE_METATYPE(BallTiming)
+
+#endif // BALLTIMING_H
@@ -0,0 +1,287 @@
+﻿#include "BowlerDirectory.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDebug>
+#include <algorithm>
+
+QJsonObject BowlerRecord::toJson() const {
+    QJsonObject json;
+    json["id"] = id;
+    json["name"] = name;
+    if (!league.isEmpty()) json["league"] = league;
+    if (average > 0) json["average"] = average;
+    return json;
+}
+
+BowlerRecord BowlerRecord::fromJson(const QJsonObject& json) {
+    BowlerRecord record;
+    record.id = json["id"].toString();
+    record.name = json["name"].toString();
+    record.league = json["league"].toString();
+    record.average = json["average"].toInt();
+    return record;
+}
+
+BowlerDirectory& BowlerDirectory::instance() {
+    static BowlerDirectory directory;
+    static bool loaded = directory.load("bowlers.json");
+    Q_UNUSED(loaded)
+    return directory;
+}
+
+bool BowlerDirectory::load(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    QJsonArray array = doc.isArray() ? doc.array() : doc.object()["bowlers"].toArray();
+
+    QVector<BowlerRecord> records;
+    records.reserve(array.size());
+    for (const QJsonValue& value : array) {
+        BowlerRecord record = BowlerRecord::fromJson(value.toObject());
+        if (!record.id.isEmpty() && !record.name.trimmed().isEmpty()) {
+            records.append(record);
+        }
+    }
+
+    setMembers(records);
+    qDebug() << "Bowler directory:" << members.size() << "members from" << path;
+    return true;
+}
+
+bool BowlerDirectory::save(const QString& path) const {
+    QJsonArray array;
+    for (const BowlerRecord& record : members) {
+        array.append(record.toJson());
+    }
+
+    QJsonObject root;
+    root["bowlers"] = array;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+void BowlerDirectory::setMembers(const QVector<BowlerRecord>& records) {
+    members = records;
+    rebuild();
+}
+
+QByteArray BowlerDirectory::normalize(const QString& text) {
+    const QString decomposed = text.normalized(QString::NormalizationForm_KD);
+
+    QString folded;
+    folded.reserve(decomposed.size());
+    bool gap = false;
+    for (const QChar c : decomposed) {
+        if (c.isMark() || c == '\'' || c == QChar(0x2019)) {
+            continue;       // Accents, and O'Brien = OBrien
+        }
+        if (!c.isLetterOrNumber()) {
+            gap = true;
+            continue;
+        }
+        if (gap && !folded.isEmpty()) {
+            folded += ' ';
+        }
+        gap = false;
+        folded += c.toCaseFolded();
+    }
+    return folded.toUtf8();
+}
+
+void BowlerDirectory::rebuild() {
+    text.clear();
+    normalizedNames.clear();
+    nameKeys.clear();
+    wordKeys.clear();
+    byId.clear();
+    byName.clear();
+
+    normalizedNames.reserve(members.size());
+    nameKeys.reserve(members.size());
+    wordKeys.reserve(members.size());
+
+    for (int i = 0; i < members.size(); ++i) {
+        const QByteArray name = normalize(members[i].name);
+        const quint32 offset = quint32(text.size());
+        text.append(name);
+        normalizedNames.append(name);
+
+        nameKeys.append({offset, quint32(name.size()), i});
+        for (int p = name.indexOf(' '); p >= 0; p = name.indexOf(' ', p + 1)) {
+            wordKeys.append({offset + quint32(p + 1), quint32(name.size() - p - 1), i});
+        }
+
+        byId.insert(members[i].id, i);
+        byName.insert(name, byName.contains(name) ? -1 : i);
+    }
+
+    auto byText = [this](const Key& a, const Key& b) {
+        std::string_view ka = keyText(a), kb = keyText(b);
+        return ka != kb ? ka < kb : a.member < b.member;
+    };
+    std::sort(nameKeys.begin(), nameKeys.end(), byText);
+    std::sort(wordKeys.begin(), wordKeys.end(), byText);
+}
+
+std::string_view BowlerDirectory::keyText(const Key& key) const {
+    return std::string_view(text.constData() + key.offset, key.length);
+}
+
+int BowlerDirectory::findByName(const QString& name) const {
+    return byName.value(normalize(name), -1);
+}
+
+bool BowlerDirectory::matchesAllWords(int member, const QList<QByteArray>& words) const {
+    const QList<QByteArray> nameWords = normalizedNames[member].split(' ');
+    for (const QByteArray& word : words) {
+        bool found = false;
+        for (const QByteArray& nameWord : nameWords) {
+            if (nameWord.startsWith(word)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BowlerDirectory::collectPrefix(const QVector<Key>& index, std::string_view prefix, int limit,
+                                    QVector<int>* out, const QList<QByteArray>* words) const {
+    auto it = std::lower_bound(index.begin(), index.end(), prefix, [this](const Key& key, std::string_view value) {
+        return keyText(key) < value;
+    });
+
+    int scanned = 0;
+    for (; it != index.end() && out->size() < limit && scanned < FUZZY_SCAN_LIMIT; ++it, ++scanned) {
+        std::string_view key = keyText(*it);
+        if (key.substr(0, prefix.size()) != prefix) {
+            break;
+        }
+        if (out->contains(it->member) || (words && !matchesAllWords(it->member, *words))) {
+            continue;
+        }
+        out->append(it->member);
+    }
+}
+
+namespace {
+
+// Edit distance from query to the closest prefix of key, or maxDistance + 1
+int prefixDistance(std::string_view query, std::string_view key, int maxDistance) {
+    const int m = int(query.size());
+    int prev[64];
+    int cur[64];
+    for (int i = 0; i <= m; ++i) {
+        prev[i] = i;
+    }
+
+    int best = prev[m];
+    const int columns = std::min<int>(int(key.size()), m + maxDistance);
+    for (int j = 1; j <= columns; ++j) {
+        cur[0] = j;
+        int rowBest = cur[0];
+        for (int i = 1; i <= m; ++i) {
+            int substitution = prev[i - 1] + (query[i - 1] != key[j - 1] ? 1 : 0);
+            cur[i] = std::min({prev[i] + 1, cur[i - 1] + 1, substitution});
+            rowBest = std::min(rowBest, cur[i]);
+        }
+        best = std::min(best, cur[m]);
+        if (rowBest > maxDistance) {
+            break;
+        }
+        std::copy(cur, cur + m + 1, prev);
+    }
+    return best;
+}
+
+} // namespace
+
+void BowlerDirectory::collectFuzzy(const QVector<Key>& index, std::string_view query, int limit,
+                                   QVector<int>* out) const {
+    if (query.size() >= 60) {
+        return;
+    }
+    const int maxDistance = query.size() >= 6 ? 2 : 1;
+
+    // Only names sharing the first letter - a typo there is rare, and this
+    // keeps the scan to a slice of the index
+    auto it = std::lower_bound(index.begin(), index.end(), query.substr(0, 1),
+                               [this](const Key& key, std::string_view value) { return keyText(key) < value; });
+
+    QVector<int> close[2];
+    int scanned = 0;
+    for (; it != index.end() && scanned < FUZZY_SCAN_LIMIT; ++it, ++scanned) {
+        std::string_view key = keyText(*it);
+        if (key.empty() || key[0] != query[0]) {
+            break;
+        }
+        int distance = prefixDistance(query, key, maxDistance);
+        if (distance <= maxDistance && !out->contains(it->member)) {
+            QVector<int>& bucket = close[distance > 1 ? 1 : 0];
+            if (bucket.size() < limit && !bucket.contains(it->member)) {
+                bucket.append(it->member);
+            }
+        }
+    }
+
+    for (const QVector<int>& bucket : close) {
+        for (int member : bucket) {
+            if (out->size() >= limit) {
+                return;
+            }
+            if (!out->contains(member)) {
+                out->append(member);
+            }
+        }
+    }
+}
+
+QVector<int> BowlerDirectory::complete(const QString& typed, int limit) const {
+    QVector<int> result;
+    const QByteArray query = normalize(typed);
+    if (query.isEmpty() || members.isEmpty()) {
+        return result;
+    }
+
+    const std::string_view prefix(query.constData(), size_t(query.size()));
+
+    // First names, then surnames and later words
+    collectPrefix(nameKeys, prefix, limit, &result);
+
+    const QList<QByteArray> words = query.split(' ');
+    if (words.size() == 1) {
+        if (result.size() < limit) {
+            collectPrefix(wordKeys, prefix, limit, &result);
+        }
+    } else if (result.size() < limit) {
+        // "smith jo" - every word a prefix of some word of the name
+        QByteArray longest = *std::max_element(words.begin(), words.end(),
+            [](const QByteArray& a, const QByteArray& b) { return a.size() < b.size(); });
+        std::string_view anchor(longest.constData(), size_t(longest.size()));
+        collectPrefix(nameKeys, anchor, limit, &result, &words);
+        collectPrefix(wordKeys, anchor, limit, &result, &words);
+    }
+
+    if (result.size() < limit && query.size() >= 3) {
+        collectFuzzy(nameKeys, prefix, limit, &result);
+        if (words.size() == 1) {
+            collectFuzzy(wordKeys, prefix, limit, &result);
+        }
+    }
+
+    return result;
+}
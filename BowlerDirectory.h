@@ -0,0 +1,76 @@
+﻿// BowlerDirectory.h - League members with a prefix index for name entry
+#ifndef BOWLERDIRECTORY_H
+#define BOWLERDIRECTORY_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QJsonObject>
+#include <QByteArray>
+#include <string_view>
+
+struct BowlerRecord {
+    QString id;             // Stable identity used by statistics
+    QString name;
+    QString league;
+    int average = 0;
+
+    QJsonObject toJson() const;
+    static BowlerRecord fromJson(const QJsonObject& json);
+};
+
+// Every member in one sorted, compact index: each member contributes its
+// whole name and each later word of it (so "smi" finds "John Smith") as
+// slices of a single normalised text buffer. A keystroke is a binary search
+// plus a short scan; when exact prefixes run out, names within one or two
+// typos of what was typed fill the list. Names are compared case-folded,
+// accent-free and with punctuation collapsed.
+//
+//   bowlers.json: { "bowlers": [ { "id": "B1042", "name": "Anne Dubé", "league": "Tuesday", "average": 182 } ] }
+class BowlerDirectory {
+public:
+    // Loaded from bowlers.json on first use
+    static BowlerDirectory& instance();
+
+    bool load(const QString& path);
+    bool save(const QString& path) const;
+    void setMembers(const QVector<BowlerRecord>& records);
+
+    int size() const { return members.size(); }
+    const BowlerRecord& member(int index) const { return members[index]; }
+    int indexOf(const QString& id) const { return byId.value(id, -1); }
+
+    // The one member with exactly this name, or -1 if none or ambiguous
+    int findByName(const QString& name) const;
+
+    // Best matches for what has been typed so far, as member indices
+    QVector<int> complete(const QString& text, int limit = 8) const;
+
+    static QByteArray normalize(const QString& text);
+
+private:
+    struct Key {
+        quint32 offset;
+        quint32 length;
+        qint32 member;
+    };
+
+    void rebuild();
+    std::string_view keyText(const Key& key) const;
+    void collectPrefix(const QVector<Key>& index, std::string_view prefix, int limit, QVector<int>* out,
+                       const QList<QByteArray>* words = nullptr) const;
+    void collectFuzzy(const QVector<Key>& index, std::string_view query, int limit, QVector<int>* out) const;
+    bool matchesAllWords(int member, const QList<QByteArray>& words) const;
+
+    QVector<BowlerRecord> members;
+    QVector<QByteArray> normalizedNames;
+    QByteArray text;            // Every key, back to back
+    QVector<Key> nameKeys;      // Whole names, sorted
+    QVector<Key> wordKeys;      // Second and later words, sorted
+    QHash<QString, int> byId;
+    QHash<QByteArray, int> byName;  // -1 where two members share a name
+
+    static constexpr int FUZZY_SCAN_LIMIT = 20000;
+};
+
+#endif // BOWLERDIRECTORY_H
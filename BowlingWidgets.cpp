@@ -1,10 +1,13 @@
 ﻿#include "BowlingWidgets.h"
+#include "LaneTheme.h"
+#include "AnimationClock.h"
 
 #include <QMouseEvent>
 #include <QKeyEvent>
 #include <QResizeEvent>
 #include <QPaintEvent>
 #include <QDebug>
+#include <QPointer>
 #include <QEasingCurve>
 #include <QFontMetrics>
 
@@ -23,7 +26,7 @@ const QVector<int> PinDisplayWidget::pinValues = {2, 3, 5, 3, 2};
 // PinDisplayWidget implementation
 PinDisplayWidget::PinDisplayWidget(QWidget* parent) 
     : QWidget(parent), displayMode("large"), upColor("#87CEEB"), downColor("#2F4F4F"), 
-      pinAnimation(nullptr), isAnimating(false), m_animationProgress(0.0) {
+      pinAnimationId(0), isAnimating(false), m_animationProgress(0.0) {
     
     pinStates.resize(5);
     resetPins();
@@ -58,17 +61,17 @@ void PinDisplayWidget::animatePinFall(const QVector<int>& beforeStates, const QV
     animationStartStates = beforeStates;
     animationEndStates = afterStates;
     
-    if (!pinAnimation) {
-        pinAnimation = new QPropertyAnimation(this, "animationProgress");
-        connect(pinAnimation, &QPropertyAnimation::finished, this, &PinDisplayWidget::onAnimationFinished);
-    }
+    AnimationClock* clock = AnimationClock::instance();
+    clock->stop(pinAnimationId);
     
     isAnimating = true;
-    pinAnimation->setDuration(1200);
-    pinAnimation->setEasingCurve(QEasingCurve::OutBounce);
-    pinAnimation->setStartValue(0.0);
-    pinAnimation->setEndValue(1.0);
-    pinAnimation->start();
+    pinAnimationId = clock->animate(this, 1200,
+        [this, clock](qreal progress) {
+            m_animationProgress = progress;
+            clock->markDirty(this);
+        },
+        [this]() { onAnimationFinished(); },
+        QEasingCurve(QEasingCurve::OutBounce));
 }
 
 void PinDisplayWidget::setDisplayMode(const QString& mode) {
@@ -174,6 +177,7 @@ void PinDisplayWidget::resizeEvent(QResizeEvent* event) {
 }
 
 void PinDisplayWidget::onAnimationFinished() {
+    pinAnimationId = 0;
     isAnimating = false;
     pinStates = animationEndStates;
     update();
@@ -291,11 +295,8 @@ void EnhancedBowlerWidget::updateBowler(const Bowler& bowler, bool isCurrentPlay
 void EnhancedBowlerWidget::updateHighlight(bool isCurrentPlayer) {
     this->isCurrentPlayer = isCurrentPlayer;
     
-    if (isCurrentPlayer) {
-        setStyleSheet("QFrame { background-color: yellow; border: 3px solid red; }");
-    } else {
-        setStyleSheet("QFrame { background-color: lightblue; border: 1px solid black; }");
-    }
+    LaneTheme::instance().apply(this, isCurrentPlayer ?
+        LaneTheme::Role::CurrentPlayer : LaneTheme::Role::OtherPlayer);
 }
 
 void EnhancedBowlerWidget::setDisplayOptions(const QJsonObject& options) {
@@ -325,7 +326,8 @@ void EnhancedBowlerWidget::setupEnhancedUI() {
     nameLabel = new QLabel(bowlerData.name, this);
     nameLabel->setFont(QFont("Arial", 18, QFont::Bold));
     nameLabel->setAlignment(Qt::AlignCenter);
-    nameLabel->setStyleSheet("QLabel { border: 1px solid black; padding: 10px; }");
+    nameLabel->setMargin(10);
+    LaneTheme::instance().apply(nameLabel, LaneTheme::Role::BowlerName);
     mainLayout->addWidget(nameLabel, 0, 0, 2, 1);  // Spans 2 rows
         
     // FRAMES AREA (Center columns)
@@ -382,7 +384,7 @@ void EnhancedBowlerWidget::createFrameDisplay() {
             ballLabel->setAlignment(Qt::AlignCenter);
             ballLabel->setFont(QFont("Arial", 10));
             ballLabel->setMinimumSize(20, 20);
-            ballLabel->setStyleSheet("QLabel { border: 1px solid gray; }");
+            LaneTheme::instance().apply(ballLabel, LaneTheme::Role::BallCell);
             ballLabels.append(ballLabel);
             ballsLayout->addWidget(ballLabel);
         }
@@ -392,7 +394,7 @@ void EnhancedBowlerWidget::createFrameDisplay() {
         frameTotal->setAlignment(Qt::AlignCenter);
         frameTotal->setFont(QFont("Arial", 12, QFont::Bold));
         frameTotal->setMinimumHeight(25);
-        frameTotal->setStyleSheet("QLabel { border: 1px solid black; background-color: lightgray; }");
+        LaneTheme::instance().apply(frameTotal, LaneTheme::Role::FrameTotal);
             
         frameLayout->addWidget(frameHeader);
         frameLayout->addLayout(ballsLayout);
@@ -464,7 +466,6 @@ void EnhancedBowlerWidget::createTotalScoreDisplay() {
     scratchScoreLabel = new QLabel(QString::number(bowlerData.totalScore), totalFrame);
     scratchScoreLabel->setAlignment(Qt::AlignCenter);
     scratchScoreLabel->setFont(QFont("Arial", 16, QFont::Bold));
-    scratchScoreLabel->setStyleSheet("QLabel { color: black; }");
         
     totalLayout->addWidget(scratchScoreLabel);
         
@@ -479,7 +480,7 @@ void EnhancedBowlerWidget::createTotalScoreDisplay() {
         withHandicapLabel = new QLabel(QString("(%1)").arg(withHandicap), totalFrame);
         withHandicapLabel->setAlignment(Qt::AlignCenter);
         withHandicapLabel->setFont(QFont("Arial", 12));
-        withHandicapLabel->setStyleSheet("QLabel { color: blue; }");
+        LaneTheme::instance().apply(withHandicapLabel, LaneTheme::Role::HandicapText);
             
         totalLayout->addWidget(withHandicapLabel);
     }
@@ -491,7 +492,7 @@ void EnhancedBowlerWidget::createTotalScoreDisplay() {
             threeSixNineLabel = new QLabel(status, totalFrame);
             threeSixNineLabel->setAlignment(Qt::AlignCenter);
             threeSixNineLabel->setFont(QFont("Arial", 10));
-            threeSixNineLabel->setStyleSheet("QLabel { color: green; }");
+            LaneTheme::instance().apply(threeSixNineLabel, LaneTheme::Role::ThreeSixNineText);
             totalLayout->addWidget(threeSixNineLabel);
         }
     }
@@ -560,7 +561,7 @@ QString EnhancedBowlerWidget::formatBallResult(const Ball& ball, int ballIndex,
 // GameStatusWidget implementation
 GameStatusWidget::GameStatusWidget(QWidget* parent) 
     : QFrame(parent), statusLabel(nullptr), frameLabel(nullptr), ballLabel(nullptr), 
-      pinDisplay(nullptr), mainLayout(nullptr) {
+      speedLabel(nullptr), pinDisplay(nullptr), mainLayout(nullptr) {
     setupUI();
     setFrameStyle(QFrame::Box);
     setLineWidth(2);
@@ -589,6 +590,12 @@ void GameStatusWidget::setupUI() {
     ballLabel->setAlignment(Qt::AlignCenter);
     ballLabel->setMinimumWidth(70);
     
+    // Last ball speed
+    speedLabel = new QLabel("Speed: -", this);
+    speedLabel->setFont(QFont("Arial", 14, QFont::Bold));
+    speedLabel->setAlignment(Qt::AlignCenter);
+    speedLabel->setMinimumWidth(130);
+    
     // Pin display
     pinDisplay = new PinDisplayWidget(this);
     pinDisplay->setDisplayMode("mini");
@@ -599,11 +606,12 @@ void GameStatusWidget::setupUI() {
     mainLayout->addWidget(statusLabel, 1);
     mainLayout->addWidget(frameLabel, 0);
     mainLayout->addWidget(ballLabel, 0);
+    mainLayout->addWidget(speedLabel, 0);
     mainLayout->addWidget(pinDisplay, 0);
     mainLayout->addStretch();
     
-    // Default styling
-    QFrame::setStyleSheet("QFrame { background-color: #3c3c3c; color: white; }");
+    // Default colours until a game scheme is applied
+    LaneTheme::instance().apply(this, LaneTheme::Role::StatusBar);
 }
 
 void GameStatusWidget::updateStatus(const QString& bowlerName, int frame, int ball) {
@@ -632,6 +640,16 @@ void GameStatusWidget::updateFrameNumber(int frameNumber) {
     }
 }
 
+void GameStatusWidget::updateBallSpeed(const BallTiming& timing) {
+    if (!speedLabel) return;
+    
+    if (timing.isValid()) {
+        speedLabel->setText(QString("Speed: %1 km/h").arg(timing.speedKph(), 0, 'f', 1));
+    } else {
+        speedLabel->setText("Speed: -");
+    }
+}
+
 void GameStatusWidget::resetStatus() {
     if (statusLabel) {
         statusLabel->setText("Waiting for game...");
@@ -645,37 +663,24 @@ void GameStatusWidget::resetStatus() {
         ballLabel->setText("Ball: -");
     }
     
+    if (speedLabel) {
+        speedLabel->setText("Speed: -");
+    }
+    
     if (pinDisplay) {
         pinDisplay->resetPins();
     }
 }
 
-void GameStatusWidget::setStyleSheet(const QString& background, const QString& foreground) {
-    QString style = QString(R"(
-        QFrame {
-            background-color: %1;
-            color: %2;
-            border: 2px solid %2;
-            border-radius: 5px;
-        }
-        QLabel {
-            background-color: transparent;
-            color: %2;
-        }
-    )").arg(background, foreground);
-    
-    QFrame::setStyleSheet(style);
-}
-
-void GameStatusWidget::setGameStyleSheet(const QString& background, const QString& foreground) {
-    setStyleSheet(background, foreground);
+void GameStatusWidget::setGameScheme(int schemeIndex) {
+    LaneTheme::instance().apply(this, LaneTheme::Role::StatusBar, schemeIndex);
 }
 
 // BowlerWidget implementation
 BowlerWidget::BowlerWidget(const Bowler& bowler, bool isCurrentPlayer, QWidget* parent)
     : QFrame(parent), bowlerData(bowler), isCurrentPlayer(isCurrentPlayer), 
-      compactMode(false), showDetails(true), scoreAnimation(nullptr), 
-      playerChangeAnimation(nullptr), opacityEffect(nullptr),
+      compactMode(false), showDetails(true), scoreAnimationId(0), 
+      playerChangeAnimationId(0), opacityEffect(nullptr),
       nameLabel(nullptr), grandTotalLabel(nullptr), mainLayout(nullptr) {
     
     setupUI(isCurrentPlayer);
@@ -692,11 +697,8 @@ void BowlerWidget::updateBowler(const Bowler& bowler, bool isCurrentPlayer) {
 void BowlerWidget::updateHighlight(bool isCurrentPlayer) {
     this->isCurrentPlayer = isCurrentPlayer;
     
-    if (isCurrentPlayer) {
-        setStyleSheet("QFrame { background-color: yellow; border: 3px solid red; }");
-    } else {
-        setStyleSheet("QFrame { background-color: lightblue; border: 1px solid black; }");
-    }
+    LaneTheme::instance().apply(this, isCurrentPlayer ?
+        LaneTheme::Role::CurrentPlayer : LaneTheme::Role::OtherPlayer);
 }
 
 void BowlerWidget::setColorScheme(const QString& background, const QString& foreground, 
@@ -711,17 +713,20 @@ void BowlerWidget::setColorScheme(const QString& background, const QString& fore
 
 void BowlerWidget::animateScoreUpdate(int frameIndex) {
     if (frameIndex >= 0 && frameIndex < totalLabels.size()) {
-        QLabel* label = totalLabels[frameIndex];
+        QPointer<QLabel> label = totalLabels[frameIndex];
+        AnimationClock* clock = AnimationClock::instance();
+        clock->stop(scoreAnimationId);
         
-        if (!scoreAnimation) {
-            scoreAnimation = new QPropertyAnimation(label, "styleSheet");
-            connect(scoreAnimation, &QPropertyAnimation::finished, this, &BowlerWidget::onAnimationFinished);
-        }
-        
-        scoreAnimation->setDuration(500);
-        scoreAnimation->setStartValue("QLabel { background-color: white; }");
-        scoreAnimation->setEndValue("QLabel { background-color: yellow; }");
-        scoreAnimation->start();
+        // Stylesheets don't interpolate, so this is a two-state flash:
+        // white for the duration, then the yellow highlight
+        label->setStyleSheet("QLabel { background-color: white; }");
+        scoreAnimationId = clock->animate(this, 500, AnimationClock::StepFunction(),
+            [this, label]() {
+                scoreAnimationId = 0;
+                if (label) {
+                    label->setStyleSheet("QLabel { background-color: yellow; }");
+                }
+            });
     }
 }
 
@@ -731,20 +736,17 @@ void BowlerWidget::animatePlayerChange(bool isBecomingCurrent) {
         setGraphicsEffect(opacityEffect);
     }
     
-    if (!playerChangeAnimation) {
-        playerChangeAnimation = new QPropertyAnimation(opacityEffect, "opacity");
-        connect(playerChangeAnimation, &QPropertyAnimation::finished, this, &BowlerWidget::onAnimationFinished);
-    }
+    qreal startOpacity = isBecomingCurrent ? 0.7 : 1.0;
+    qreal endOpacity = isBecomingCurrent ? 1.0 : 0.8;
     
-    playerChangeAnimation->setDuration(300);
-    if (isBecomingCurrent) {
-        playerChangeAnimation->setStartValue(0.7);
-        playerChangeAnimation->setEndValue(1.0);
-    } else {
-        playerChangeAnimation->setStartValue(1.0);
-        playerChangeAnimation->setEndValue(0.8);
-    }
-    playerChangeAnimation->start();
+    // The opacity effect schedules its own repaint
+    AnimationClock* clock = AnimationClock::instance();
+    clock->stop(playerChangeAnimationId);
+    playerChangeAnimationId = clock->animate(opacityEffect, 300,
+        [this, startOpacity, endOpacity](qreal progress) {
+            opacityEffect->setOpacity(startOpacity + (endOpacity - startOpacity) * progress);
+        },
+        [this]() { playerChangeAnimationId = 0; });
 }
 
 void BowlerWidget::setCompactMode(bool compact) {
@@ -770,15 +772,6 @@ void BowlerWidget::paintEvent(QPaintEvent* event) {
     // Additional custom painting if needed
 }
 
-void BowlerWidget::onAnimationFinished() {
-    // Reset styles after animation
-    if (sender() == scoreAnimation) {
-        // Reset score label style
-    } else if (sender() == playerChangeAnimation) {
-        // Animation complete
-    }
-}
-
 void BowlerWidget::setupUI(bool isCurrentPlayer) {
     setFrameStyle(QFrame::Box);
     updateHighlight(isCurrentPlayer);
@@ -875,7 +868,7 @@ void BowlerWidget::updateFrameDisplay(int frameIndex) {
 // BowlerListWidget implementation
 BowlerListWidget::BowlerListWidget(QWidget* parent) 
     : QScrollArea(parent), currentBowlerIndex(0), maxVisibleBowlers(6), 
-      animationEnabled(true), compactMode(false), rotationAnimation(nullptr),
+      animationEnabled(true), compactMode(false), rotationAnimationId(0),
       contentWidget(nullptr), contentLayout(nullptr) {
     setupUI();
 }
@@ -923,9 +916,20 @@ void BowlerListWidget::animatePlayerRotation(int fromIndex, int toIndex) {
         return;
     }
     
-    // Simple fade animation would need QGraphicsOpacityEffect
-    // For now, just emit finished immediately
-    emit rotationAnimationFinished();
+    // Fade the rebuilt list in; the effect is removed again when done
+    QGraphicsOpacityEffect* fade = new QGraphicsOpacityEffect(contentWidget);
+    contentWidget->setGraphicsEffect(fade);
+    
+    AnimationClock* clock = AnimationClock::instance();
+    clock->stop(rotationAnimationId);
+    rotationAnimationId = clock->animate(fade, 250,
+        [fade](qreal progress) { fade->setOpacity(0.3 + 0.7 * progress); },
+        [this]() {
+            rotationAnimationId = 0;
+            contentWidget->setGraphicsEffect(nullptr);
+            onRotationAnimationFinished();
+        },
+        QEasingCurve(QEasingCurve::OutCubic));
 }
 
 void BowlerListWidget::setColorScheme(const QJsonObject& colors) {
@@ -1134,83 +1138,106 @@ void GameControlWidget::updateButtonStates() {
 }
 
 // ScrollTextWidget implementation
+// The message is rendered once into textPixmap; the position follows
+// elapsed time and each tick scrolls the existing pixels so only the
+// newly exposed strip is repainted.
 ScrollTextWidget::ScrollTextWidget(QWidget* parent) 
-    : QLabel(parent), scrollSpeed(50), scrollDirection("left"), 
-      scrollPosition(0), textWidth(0), isScrolling(false),
-      scrollTimer(nullptr) {
-    
-    scrollTimer = new QTimer(this);
-    connect(scrollTimer, &QTimer::timeout, this, &ScrollTextWidget::onScrollTimer);
+    : QLabel(parent), scrollSpeed(50), scrollStep(1), scrollDirection("left"), 
+      scrollPosition(0), scrollOrigin(0), textWidth(0), isScrolling(false),
+      scrollTickId(0) {
     
     scrollFont = QFont("Arial", 16);
     setFont(scrollFont);
     setAlignment(Qt::AlignVCenter);
-    setStyleSheet("QLabel { background-color: black; color: yellow; }");
+    LaneTheme::instance().apply(this, LaneTheme::Role::Marquee);
+    
+    // paintEvent fills its own background, which lets scroll() blit
+    setAttribute(Qt::WA_OpaquePaintEvent);
 }
 
 void ScrollTextWidget::setText(const QString& text) {
     scrollText = text;
     calculateScrollParameters();
     scrollPosition = 0;
+    scrollOrigin = 0;
+    scrollClock.restart();
     update();
 }
 
 void ScrollTextWidget::setScrollSpeed(int pixelsPerSecond) {
+    // Rebase so the text does not jump when the speed changes
+    scrollOrigin = scrollPosition;
+    scrollClock.restart();
     scrollSpeed = pixelsPerSecond;
     
-    if (isScrolling) {
-        int interval = 1000 / scrollSpeed; // Update interval in ms
-        scrollTimer->setInterval(qMax(10, interval)); // Minimum 10ms
-    }
+    AnimationClock::instance()->setPeriod(scrollTickId, scrollInterval());
+}
+
+void ScrollTextWidget::setReducedFrameRate(bool reduced) {
+    // Same scroll speed, a quarter of the repaints
+    scrollStep = reduced ? 4 : 1;
+    
+    AnimationClock::instance()->setPeriod(scrollTickId, scrollInterval());
+}
+
+int ScrollTextWidget::scrollInterval() const {
+    int interval = 1000 * scrollStep / qMax(1, scrollSpeed); // Update interval in ms
+    return qMax(10, interval); // Minimum 10ms
 }
 
 void ScrollTextWidget::setScrollDirection(const QString& direction) {
     scrollDirection = direction;
     scrollPosition = 0;
+    scrollOrigin = 0;
+    scrollClock.restart();
     update();
 }
 
 void ScrollTextWidget::startScrolling() {
     if (!isScrolling && !scrollText.isEmpty()) {
         isScrolling = true;
-        int interval = 1000 / scrollSpeed;
-        scrollTimer->start(qMax(10, interval));
+        scrollOrigin = scrollPosition;
+        scrollClock.restart();
+        scrollTickId = AnimationClock::instance()->every(this, scrollInterval(),
+                                                         [this]() { onScrollTick(); });
+        update();
     }
 }
 
 void ScrollTextWidget::stopScrolling() {
     isScrolling = false;
-    scrollTimer->stop();
+    AnimationClock::instance()->stop(scrollTickId);
+    scrollTickId = 0;
+    update();
 }
 
 void ScrollTextWidget::pauseScrolling() {
-    scrollTimer->stop();
+    AnimationClock::instance()->stop(scrollTickId);
+    scrollTickId = 0;
 }
 
 void ScrollTextWidget::paintEvent(QPaintEvent* event) {
     QPainter painter(this);
-    painter.setFont(scrollFont);
-    painter.setPen(QColor("yellow"));
+    painter.fillRect(event->rect(), palette().color(QPalette::Window));
     
-    QRect textRect = rect();
+    if (textPixmap.isNull()) {
+        return;
+    }
     
     if (isScrolling && textWidth > width()) {
-        // Draw scrolling text
-        int x = scrollDirection == "left" ? 
-            width() - scrollPosition : 
-            scrollPosition - textWidth;
-        
-        painter.drawText(x, textRect.center().y() + fontMetrics().height()/4, scrollText);
+        // Blit the cached text; Qt clips to the exposed region
+        int x = textX();
+        painter.drawPixmap(x, 0, textPixmap);
         
         // Draw wrapped text if needed
         if (scrollDirection == "left" && x + textWidth < width()) {
-            painter.drawText(x + textWidth + 50, textRect.center().y() + fontMetrics().height()/4, scrollText);
+            painter.drawPixmap(x + textWidth + WRAP_GAP, 0, textPixmap);
         } else if (scrollDirection == "right" && x > 0) {
-            painter.drawText(x - textWidth - 50, textRect.center().y() + fontMetrics().height()/4, scrollText);
+            painter.drawPixmap(x - textWidth - WRAP_GAP, 0, textPixmap);
         }
     } else {
         // Draw static text
-        painter.drawText(textRect, Qt::AlignCenter, scrollText);
+        painter.drawPixmap((width() - textWidth) / 2, 0, textPixmap);
     }
 }
 
@@ -1219,21 +1246,34 @@ void ScrollTextWidget::resizeEvent(QResizeEvent* event) {
     calculateScrollParameters();
 }
 
-void ScrollTextWidget::onScrollTimer() {
-    scrollPosition += 1;
+void ScrollTextWidget::onScrollTick() {
+    // Position from elapsed time, so a busy GUI thread skips pixels instead of slowing down
+    int cycle = textWidth + width() + WRAP_GAP;
+    if (cycle <= 0) return;
     
-    // Reset position when text has scrolled completely
-    if (scrollDirection == "left") {
-        if (scrollPosition > textWidth + width() + 50) {
-            scrollPosition = 0;
-        }
-    } else {
-        if (scrollPosition > textWidth + width() + 50) {
-            scrollPosition = 0;
-        }
+    qint64 travelled = scrollClock.elapsed() * scrollSpeed / 1000;
+    int newPosition = static_cast<int>((scrollOrigin + travelled) % cycle);
+    int delta = newPosition - scrollPosition;
+    if (delta == 0) return;
+    
+    scrollPosition = newPosition;
+    
+    if (textWidth <= width() || !isVisible()) {
+        return;
     }
     
-    update();
+    if (delta < 0 || delta >= width()) {
+        // Wrapped around - repaint everything once
+        AnimationClock::instance()->markDirty(this);
+    } else {
+        scroll(scrollDirection == "left" ? -delta : delta, 0);
+    }
+}
+
+int ScrollTextWidget::textX() const {
+    return scrollDirection == "left" ? 
+        width() - scrollPosition : 
+        scrollPosition - textWidth;
 }
 
 void ScrollTextWidget::calculateScrollParameters() {
@@ -1243,4 +1283,20 @@ void ScrollTextWidget::calculateScrollParameters() {
 #else
     textWidth = fm.width(scrollText);
 #endif
+    
+    // Render the message once; paintEvent only blits it
+    if (scrollText.isEmpty() || textWidth <= 0 || height() <= 0) {
+        textPixmap = QPixmap();
+        return;
+    }
+    
+    qreal dpr = devicePixelRatioF();
+    textPixmap = QPixmap(QSize(textWidth, height()) * dpr);
+    textPixmap.setDevicePixelRatio(dpr);
+    textPixmap.fill(palette().color(QPalette::Window));
+    
+    QPainter painter(&textPixmap);
+    painter.setFont(scrollFont);
+    painter.setPen(palette().color(QPalette::WindowText));
+    painter.drawText(0, height() / 2 + fontMetrics().height() / 4, scrollText);
 }
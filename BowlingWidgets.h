@@ -31,6 +31,8 @@
 #include <QPen>
 #include <QRect>
 #include <QSize>
+#include <QPixmap>
+#include <QElapsedTimer>
 #include "QuickGame.h"
 
 // Forward declarations
@@ -78,8 +80,8 @@ private:
     QString upColor;
     QString downColor;
     
-    // Animation
-    QPropertyAnimation* pinAnimation;
+    // Animation (AnimationClock entry, 0 when idle)
+    int pinAnimationId;
     QVector<int> animationStartStates;
     QVector<int> animationEndStates;
     bool isAnimating;
@@ -101,10 +103,10 @@ public:
     void updateStatus(const QString& bowlerName, int frame, int ball);
     void updateBallNumber(int ballNumber);
     void updateFrameNumber(int frameNumber);
+    void updateBallSpeed(const BallTiming& timing);
     void resetStatus();
     
-    void setStyleSheet(const QString& background, const QString& foreground);
-    void setGameStyleSheet(const QString& background, const QString& foreground); // For main.cpp compatibility
+    void setGameScheme(int schemeIndex);  // LaneTheme game colour scheme
 
 private:
     void setupUI();
@@ -112,6 +114,7 @@ private:
     QLabel* statusLabel;
     QLabel* frameLabel;
     QLabel* ballLabel;
+    QLabel* speedLabel;
     PinDisplayWidget* pinDisplay;
     QHBoxLayout* mainLayout;
 };
@@ -144,9 +147,6 @@ protected:
     void mousePressEvent(QMouseEvent* event) override;
     void paintEvent(QPaintEvent* event) override;
 
-private slots:
-    void onAnimationFinished();
-
 private:
     void setupUI(bool isCurrentPlayer);
     void updateDisplay();
@@ -173,9 +173,9 @@ private:
     QString highlightColor;
     QString currentPlayerColor;
     
-    // Animation
-    QPropertyAnimation* scoreAnimation;
-    QPropertyAnimation* playerChangeAnimation;
+    // Animation (AnimationClock entries, 0 when idle)
+    int scoreAnimationId;
+    int playerChangeAnimationId;
     QGraphicsOpacityEffect* opacityEffect;
 };
 
@@ -223,8 +223,8 @@ private:
     bool animationEnabled;
     bool compactMode;
     
-    // Animation
-    QPropertyAnimation* rotationAnimation;
+    // Animation (AnimationClock entry, 0 when idle)
+    int rotationAnimationId;
     
     // Color scheme
     QJsonObject colorScheme;
@@ -279,26 +279,33 @@ public:
     void startScrolling();
     void stopScrolling();
     void pauseScrolling();
+    void setReducedFrameRate(bool reduced);  // Low-power idle: fewer, larger steps
 
 protected:
     void paintEvent(QPaintEvent* event) override;
     void resizeEvent(QResizeEvent* event) override;
 
-private slots:
-    void onScrollTimer();
-
 private:
+    void onScrollTick();
     void calculateScrollParameters();
+    int scrollInterval() const;
+    int textX() const;
     
     QString scrollText;
     int scrollSpeed;
+    int scrollStep;         // Tick period is scaled by this in low-power mode
     QString scrollDirection;
     int scrollPosition;
+    qint64 scrollOrigin;    // Position when scrollClock was last restarted
     int textWidth;
     bool isScrolling;
     
-    QTimer* scrollTimer;
+    int scrollTickId;       // AnimationClock entry while scrolling
+    QElapsedTimer scrollClock;
     QFont scrollFont;
+    QPixmap textPixmap;     // Message rendered once per setText/resize
+    
+    static const int WRAP_GAP = 50;
 };
 
 // Enhanced BowlerWidget for advanced frame layout
@@ -313,6 +320,9 @@ public:
     void updateBowler(const Bowler& bowler, bool isCurrentPlayer = false);
     void updateHighlight(bool isCurrentPlayer);
     void setDisplayOptions(const QJsonObject& options);
+    
+    // "X", "/" or the ball value - shared with ScoreboardPresenter
+    static QString formatBallResult(const Ball& ball, int ballIndex, const Frame& frame);
 
 signals:
     void bowlerClicked(const QString& bowlerName);
@@ -334,7 +344,6 @@ private:
     void createTotalScoreDisplay();
     void updateDisplay();
     void updateFrameWidget(const FrameWidgetSet& frameSet);
-    QString formatBallResult(const Ball& ball, int ballIndex, const Frame& frame);
     
     Bowler bowlerData;
     bool isCurrentPlayer;
@@ -0,0 +1,193 @@
+﻿#include "BroadcastEngine.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+
+QSet<int> BroadcastReport::missing() const {
+    QSet<int> result;
+    for (int lane : lanes) {
+        if (!acknowledged.contains(lane) && !failed.contains(lane) && !unreachable.contains(lane)) {
+            result.insert(lane);
+        }
+    }
+    return result;
+}
+
+BroadcastEngine::BroadcastEngine(TimingWheel* wheel, QObject* parent)
+    : QObject(parent)
+    , timers(wheel)
+    , nextBroadcastId(1)
+{
+}
+
+void BroadcastEngine::setGroup(const QString& name, const QVector<int>& lanes) {
+    groups.insert(name, lanes);
+}
+
+void BroadcastEngine::removeGroup(const QString& name) {
+    groups.remove(name);
+}
+
+void BroadcastEngine::loadSettings(const QJsonObject& settings) {
+    QJsonObject groupSettings = settings["Groups"].toObject();
+    for (auto it = groupSettings.constBegin(); it != groupSettings.constEnd(); ++it) {
+        QVector<int> lanes;
+        for (const QJsonValue& lane : it.value().toArray()) {
+            lanes.append(lane.toInt());
+        }
+        setGroup(it.key(), lanes);
+    }
+    qDebug() << "Broadcast groups:" << groups.keys();
+}
+
+QVector<int> BroadcastEngine::resolve(const QString& target, const QList<int>& connectedLanes) const {
+    QSet<int> lanes;
+
+    for (QString part : target.split(',', Qt::SkipEmptyParts)) {
+        part = part.trimmed();
+
+        if (part == "all") {
+            for (int lane : connectedLanes) lanes.insert(lane);
+        } else if (part.startsWith("lane:")) {
+            lanes.insert(part.mid(5).toInt());
+        } else if (part.startsWith("lanes:")) {
+            QStringList range = part.mid(6).split('-');
+            int first = range.value(0).toInt();
+            int last = range.value(1, range.value(0)).toInt();
+            for (int lane = first; lane <= last; ++lane) lanes.insert(lane);
+        } else if (part.startsWith("pair:")) {
+            int pair = part.mid(5).toInt();
+            lanes.insert(pair * 2 - 1);
+            lanes.insert(pair * 2);
+        } else if (groups.contains(part)) {
+            for (int lane : groups.value(part)) lanes.insert(lane);
+        } else {
+            qWarning() << "Unknown broadcast target" << part;
+        }
+    }
+
+    QVector<int> result(lanes.begin(), lanes.end());
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+quint64 BroadcastEngine::broadcast(const QMap<int, QTcpSocket*>& sockets, const QString& target,
+                                   const QString& command, const QJsonObject& data,
+                                   int ackTimeoutMs, Callback done) {
+    const quint64 broadcastId = nextBroadcastId++;
+
+    Pending entry;
+    entry.report.broadcastId = broadcastId;
+    entry.report.command = command;
+    entry.report.target = target;
+    entry.report.lanes = resolve(target, sockets.keys());
+    entry.done = std::move(done);
+    entry.clock.start();
+
+    // Serialise once; every socket gets the same implicitly shared bytes
+    QElapsedTimer cost;
+    cost.start();
+
+    QJsonObject message;
+    message["type"] = command;
+    message["data"] = data;
+    message["broadcast_id"] = static_cast<qint64>(broadcastId);
+    message["target"] = target;
+    message["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    const QByteArray encoded = QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n";
+
+    entry.report.encodeUs = cost.nsecsElapsed() / 1000;
+    cost.restart();
+
+    for (int lane : entry.report.lanes) {
+        QTcpSocket* socket = sockets.value(lane, nullptr);
+        if (!socket || socket->state() != QAbstractSocket::ConnectedState) {
+            entry.report.unreachable.insert(lane);
+            continue;
+        }
+        socket->write(encoded);
+        entry.waiting.insert(lane);
+    }
+
+    entry.report.writeUs = cost.nsecsElapsed() / 1000;
+
+    if (!entry.report.unreachable.isEmpty()) {
+        qWarning() << "Broadcast" << command << "to" << target << "- not connected:" << entry.report.unreachable.values();
+    }
+
+    bool complete = entry.waiting.isEmpty();
+    if (!complete) {
+        entry.deadline = timers->arm(ackTimeoutMs, [this, broadcastId]() { finish(broadcastId, true); });
+    }
+    pending.insert(broadcastId, std::move(entry));
+
+    if (complete) {
+        finish(broadcastId, false);
+    }
+    return broadcastId;
+}
+
+bool BroadcastEngine::handleAck(int laneId, const QJsonObject& message) {
+    if (message["type"].toString() != "broadcast_ack") return false;
+
+    quint64 broadcastId = static_cast<quint64>(message["broadcast_id"].toDouble());
+    auto it = pending.find(broadcastId);
+    if (it == pending.end()) return true;    // Late ack after the deadline
+
+    Pending& entry = it.value();
+    if (!entry.waiting.remove(laneId)) return true;
+
+    if (message["ok"].toBool(true)) {
+        entry.report.acknowledged.insert(laneId);
+    } else {
+        entry.report.failed.insert(laneId, message["error"].toString());
+    }
+
+    if (entry.waiting.isEmpty()) {
+        finish(broadcastId, false);
+    }
+    return true;
+}
+
+void BroadcastEngine::laneDisconnected(int laneId) {
+    QList<quint64> completed;
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+        if (it.value().waiting.remove(laneId)) {
+            it.value().report.unreachable.insert(laneId);
+            if (it.value().waiting.isEmpty()) {
+                completed.append(it.key());
+            }
+        }
+    }
+    for (quint64 broadcastId : completed) {
+        finish(broadcastId, false);
+    }
+}
+
+void BroadcastEngine::finish(quint64 broadcastId, bool timedOut) {
+    auto it = pending.find(broadcastId);
+    if (it == pending.end()) return;
+
+    Pending entry = std::move(it.value());
+    pending.erase(it);
+    timers->cancel(entry.deadline);
+
+    entry.report.timedOut = timedOut;
+    entry.report.completeMs = entry.clock.elapsed();
+
+    if (timedOut) {
+        qWarning() << "Broadcast" << entry.report.command << "to" << entry.report.target
+                   << "- no ack from lanes" << entry.report.missing().values();
+    } else {
+        qDebug() << "Broadcast" << entry.report.command << "to" << entry.report.target << "-"
+                 << entry.report.acknowledged.size() << "of" << entry.report.lanes.size()
+                 << "lanes acknowledged in" << entry.report.completeMs << "ms";
+    }
+
+    if (entry.done) {
+        entry.done(entry.report);
+    }
+    emit broadcastCompleted(entry.report);
+}
@@ -0,0 +1,95 @@
+﻿// BroadcastEngine.h - Encode-once fan-out of house-wide lane commands
+#ifndef BROADCASTENGINE_H
+#define BROADCASTENGINE_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QJsonObject>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+#include <QElapsedTimer>
+#include <functional>
+#include "TimingWheel.h"
+
+// Result of one broadcast once every target acknowledged or the deadline passed
+struct BroadcastReport {
+    quint64 broadcastId = 0;
+    QString command;
+    QString target;
+    QVector<int> lanes;             // Resolved targets
+    QSet<int> acknowledged;
+    QMap<int, QString> failed;      // Lane -> error reported by the lane
+    QSet<int> unreachable;          // Not connected when sent
+    qint64 encodeUs = 0;
+    qint64 writeUs = 0;             // The single pass over all sockets
+    qint64 completeMs = 0;          // Send to last ack (or deadline)
+    bool timedOut = false;
+
+    QSet<int> missing() const;
+};
+
+// A house-wide message is serialised once into one immutable QByteArray
+// and that same buffer is written to every target socket in one pass.
+// Lanes echo the broadcast_id in a "broadcast_ack", so delivery is known
+// per lane:
+//
+//   { "type": "scroll_message", "data": {...}, "broadcast_id": 9, "target": "league:Tuesday" }
+//   { "type": "broadcast_ack", "broadcast_id": 9, "lane_id": 4, "ok": true }
+//
+// Targets: "all", "lane:N", "lanes:A-B", "pair:N" (lanes 2N-1 and 2N),
+// or any named group such as "league:<name>" or "section:<name>" set
+// with setGroup(). Several targets can be joined with commas.
+class BroadcastEngine : public QObject {
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(const BroadcastReport&)>;
+
+    explicit BroadcastEngine(TimingWheel* timers, QObject* parent = nullptr);
+
+    void setGroup(const QString& name, const QVector<int>& lanes);
+    void removeGroup(const QString& name);
+    QVector<int> groupLanes(const QString& name) const { return groups.value(name); }
+
+    // Configuration from settings.json "Broadcast" { "Groups": { "section:north": [1,2,...] } }
+    void loadSettings(const QJsonObject& settings);
+
+    QVector<int> resolve(const QString& target, const QList<int>& connectedLanes) const;
+
+    quint64 broadcast(const QMap<int, QTcpSocket*>& sockets, const QString& target,
+                      const QString& command, const QJsonObject& data,
+                      int ackTimeoutMs = DEFAULT_ACK_TIMEOUT_MS, Callback done = Callback());
+
+    // Returns true if the message was a broadcast_ack
+    bool handleAck(int laneId, const QJsonObject& message);
+
+    // A lane dropped: it will not ack anything still in flight
+    void laneDisconnected(int laneId);
+
+    int inFlight() const { return pending.size(); }
+
+    static constexpr int DEFAULT_ACK_TIMEOUT_MS = 3000;
+
+signals:
+    void broadcastCompleted(const BroadcastReport& report);
+
+private:
+    struct Pending {
+        BroadcastReport report;
+        QSet<int> waiting;
+        QElapsedTimer clock;
+        TimingWheel::TimerId deadline = 0;
+        Callback done;
+    };
+
+    void finish(quint64 broadcastId, bool timedOut);
+
+    TimingWheel* timers;
+    QHash<QString, QVector<int>> groups;
+    QHash<quint64, Pending> pending;
+    quint64 nextBroadcastId;
+};
+
+#endif // BROADCASTENGINE_H
@@ -0,0 +1,108 @@
+﻿#include "ClockSync.h"
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+
+ClockSync::ClockSync()
+    : drift(0.0)
+    , driftFitted(false)
+{
+}
+
+void ClockSync::reset() {
+    recent.clear();
+    accepted.clear();
+    reference = Sample();
+    drift = 0.0;
+    driftFitted = false;
+}
+
+void ClockSync::addSample(qint64 t0, qint64 t1, qint64 t2, qint64 t3) {
+    Sample sample;
+    sample.laneUs = t0 + (t3 - t0) / 2;
+    sample.offsetUs = ((t1 - t0) + (t2 - t3)) / 2;
+    sample.delayUs = std::max<qint64>(0, (t3 - t0) - (t2 - t1));
+
+    recent.append(sample);
+    if (recent.size() > FILTER_SIZE) {
+        recent.removeFirst();
+    }
+
+    // Clock filter: of the recent exchanges, trust the one that queued least
+    auto best = std::min_element(recent.begin(), recent.end(), [](const Sample& a, const Sample& b) {
+        return a.delayUs < b.delayUs;
+    });
+
+    if (!accepted.isEmpty() && accepted.last().laneUs == best->laneUs) {
+        return;     // Same winner as last time - nothing new
+    }
+
+    accepted.append(*best);
+    if (accepted.size() > HISTORY_SIZE) {
+        accepted.removeFirst();
+    }
+    reference = *best;
+    fitDrift();
+}
+
+void ClockSync::fitDrift() {
+    if (accepted.size() < MIN_SYNC_SAMPLES ||
+        accepted.last().laneUs - accepted.first().laneUs < MIN_DRIFT_SPAN_US) {
+        return;
+    }
+
+    // Least squares of offset against lane time, relative to the first sample
+    const qint64 x0 = accepted.first().laneUs;
+    const qint64 y0 = accepted.first().offsetUs;
+    double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+    for (const Sample& sample : accepted) {
+        double x = double(sample.laneUs - x0);
+        double y = double(sample.offsetUs - y0);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+
+    const double n = accepted.size();
+    const double denominator = n * sumXX - sumX * sumX;
+    if (denominator <= 0.0) {
+        return;
+    }
+
+    drift = qBound(-MAX_DRIFT, (n * sumXY - sumX * sumY) / denominator, MAX_DRIFT);
+    driftFitted = true;
+}
+
+qint64 ClockSync::offsetUs(qint64 laneUs) const {
+    if (accepted.isEmpty()) {
+        return 0;
+    }
+    return reference.offsetUs + qint64(std::llround(drift * double(laneUs - reference.laneUs)));
+}
+
+qint64 ClockSync::errorUs(qint64 laneUs) const {
+    if (accepted.isEmpty()) {
+        return -1;  // Unknown
+    }
+
+    // Until drift is fitted it can be anything within the crystal tolerance
+    double driftUncertainty = driftFitted ? FITTED_DRIFT_ERROR : MAX_DRIFT;
+    qint64 age = std::llabs(laneUs - reference.laneUs);
+    return reference.delayUs / 2 + qint64(driftUncertainty * double(age));
+}
+
+void ClockSync::stamp(QJsonObject& message) const {
+    qint64 laneUs = message.contains("lane_time_us")
+        ? static_cast<qint64>(message["lane_time_us"].toDouble())
+        : monotonicUs();
+
+    message["lane_time_us"] = laneUs;
+    if (accepted.isEmpty()) {
+        return;     // No estimate yet - the server falls back to receive time
+    }
+
+    message["server_time_us"] = toServerUs(laneUs);
+    message["clock_offset_us"] = offsetUs(laneUs);
+    message["clock_error_us"] = errorUs(laneUs);
+}
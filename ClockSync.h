@@ -0,0 +1,75 @@
+﻿// ClockSync.h - Lane-to-server clock offset and drift estimate
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <QJsonObject>
+#include <QVector>
+#include <chrono>
+
+// NTP-style exchange carried on the heartbeat. The lane sends its monotonic
+// time t0; the server stamps receive (t1) and send (t2) on its own clock;
+// the lane notes t3 when the response arrives:
+//
+//   offset = ((t1 - t0) + (t2 - t3)) / 2      server time = lane time + offset
+//   delay  = (t3 - t0) - (t2 - t1)
+//
+// The sample with the smallest delay out of the last FILTER_SIZE is the
+// best one (least queueing), and the drift between the lane oscillator and
+// the server clock is fitted over the accepted samples, so the estimate
+// stays good between heartbeats.
+//
+// All times are integer microseconds. Lane time is steady_clock, the same
+// base as MachineInterface::monotonicNs(), so sensor edge times convert
+// directly; server time is microseconds since the Unix epoch.
+class ClockSync {
+public:
+    ClockSync();
+
+    static qint64 monotonicUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    static qint64 wallUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    void addSample(qint64 t0, qint64 t1, qint64 t2, qint64 t3);
+    void reset();
+
+    bool isSynced() const { return accepted.size() >= MIN_SYNC_SAMPLES; }
+    qint64 offsetUs(qint64 laneUs = monotonicUs()) const;
+    qint64 toServerUs(qint64 laneUs) const { return laneUs + offsetUs(laneUs); }
+    double driftPpm() const { return drift * 1e6; }
+
+    // Half the best round trip plus what drift can have added since
+    qint64 errorUs(qint64 laneUs = monotonicUs()) const;
+
+    // Adds lane_time_us (if the event has none), server_time_us,
+    // clock_offset_us and clock_error_us
+    void stamp(QJsonObject& message) const;
+
+    static constexpr int FILTER_SIZE = 8;
+    static constexpr int MIN_SYNC_SAMPLES = 4;
+    static constexpr int HISTORY_SIZE = 32;
+    static constexpr qint64 MIN_DRIFT_SPAN_US = 60 * 1000000LL;   // Fit drift over at least a minute
+    static constexpr double MAX_DRIFT = 500e-6;                    // Crystal tolerance, 500 ppm
+    static constexpr double FITTED_DRIFT_ERROR = 20e-6;            // Residual once fitted
+
+private:
+    struct Sample {
+        qint64 laneUs = 0;      // Midpoint of the exchange on the lane clock
+        qint64 offsetUs = 0;
+        qint64 delayUs = 0;
+    };
+
+    void fitDrift();
+
+    QVector<Sample> recent;     // Raw samples for the min-delay filter
+    QVector<Sample> accepted;   // Filter output, for the drift fit
+    Sample reference;
+    double drift;               // Seconds of offset change per lane second
+    bool driftFitted;
+};
+
+#endif // CLOCKSYNC_H
@@ -0,0 +1,306 @@
+﻿#include "EndOfDayReport.h"
+#include "EventLog.h"
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTextStream>
+#include <QDebug>
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+void keepTop(QVector<EndOfDayReport::HighScore>& scores) {
+    std::sort(scores.begin(), scores.end(), [](const EndOfDayReport::HighScore& a, const EndOfDayReport::HighScore& b) {
+        if (a.score != b.score) return a.score > b.score;
+        if (a.timeUs != b.timeUs) return a.timeUs < b.timeUs;
+        return a.laneId < b.laneId;
+    });
+    if (scores.size() > EndOfDayReport::TOP_SCORES) {
+        scores.resize(EndOfDayReport::TOP_SCORES);
+    }
+}
+
+} // namespace
+
+void LaneDayTotals::merge(const LaneDayTotals& other) {
+    sessions += other.sessions;
+    gamesPlayed += other.gamesPlayed;
+    gamesSold += other.gamesSold;
+    minutesSold += other.minutesSold;
+    secondsBowled += other.secondsBowled;
+    bowlers += other.bowlers;
+    shoes += other.shoes;
+    youth += other.youth;
+    balls += other.balls;
+    amendedBalls += other.amendedBalls;
+    faults += other.faults;
+    for (auto it = other.faultKinds.constBegin(); it != other.faultKinds.constEnd(); ++it) {
+        faultKinds[it.key()] += it.value();
+    }
+}
+
+QJsonObject LaneDayTotals::toJson() const {
+    QJsonObject kinds;
+    for (auto it = faultKinds.constBegin(); it != faultKinds.constEnd(); ++it) {
+        kinds[it.key()] = it.value();
+    }
+
+    QJsonObject json;
+    json["sessions"] = sessions;
+    json["games_played"] = gamesPlayed;
+    json["games_sold"] = gamesSold;
+    json["minutes_sold"] = minutesSold;
+    json["minutes_bowled"] = int(secondsBowled / 60);
+    json["bowlers"] = bowlers;
+    json["shoes"] = shoes;
+    json["youth"] = youth;
+    json["balls"] = balls;
+    json["amended_balls"] = amendedBalls;
+    json["faults"] = faults;
+    json["fault_kinds"] = kinds;
+    return json;
+}
+
+void EndOfDayReport::Totals::merge(const Totals& other) {
+    for (auto it = other.lanes.constBegin(); it != other.lanes.constEnd(); ++it) {
+        lanes[it.key()].merge(it.value());
+    }
+    highScores += other.highScores;
+    keepTop(highScores);
+    lines += other.lines;
+    malformed += other.malformed;
+}
+
+LaneDayTotals EndOfDayReport::Totals::house() const {
+    LaneDayTotals total;
+    for (const LaneDayTotals& lane : lanes) {
+        total.merge(lane);
+    }
+    return total;
+}
+
+void EndOfDayReport::addLine(Totals& totals, const QByteArray& line) {
+    QJsonParseError error;
+    QJsonObject entry = QJsonDocument::fromJson(line, &error).object();
+    if (error.error != QJsonParseError::NoError) {
+        totals.malformed++;     // Typically the last line of a log still being written
+        return;
+    }
+
+    totals.lines++;
+    const int laneId = entry["lane"].toInt();
+    const QString type = entry["type"].toString();
+    const QJsonObject message = entry["message"].toObject();
+    LaneDayTotals& lane = totals.lanes[laneId];
+
+    if (type == "ball") {
+        lane.balls++;
+    } else if (type == "ball_amended") {
+        lane.amendedBalls++;
+    } else if (type == "machine_fault") {
+        lane.faults++;
+        lane.faultKinds[message["error"].toString("unknown")]++;
+    } else if (type == "game_complete") {
+        const QJsonObject data = message["data"].toObject();
+        const QJsonObject setup = data["setup"].toObject();
+        const QJsonArray finalScores = data["final_scores"].toArray();
+
+        lane.sessions++;
+        lane.gamesPlayed += data["games_played"].toInt(1);
+        lane.secondsBowled += static_cast<qint64>(data["total_time"].toDouble());
+
+        // As sold at the desk (QuickGameDialog::getGameData)
+        if (!setup["time"].isNull() && setup["time"].toInt() > 0) {
+            lane.minutesSold += setup["time"].toInt();
+        } else {
+            lane.gamesSold += setup["games"].toInt(1);
+        }
+
+        const QJsonArray bowlers = setup["bowlers"].toArray();
+        if (bowlers.isEmpty()) {
+            lane.bowlers += finalScores.size();
+        }
+        for (const QJsonValue& value : bowlers) {
+            QJsonObject bowler = value.toObject();
+            lane.bowlers++;
+            lane.shoes += bowler["shoes"].toBool() ? 1 : 0;
+            lane.youth += bowler["youth"].toBool() ? 1 : 0;
+        }
+
+        const qint64 timeUs = static_cast<qint64>(entry["time_us"].toDouble());
+        for (const QJsonValue& value : finalScores) {
+            QJsonObject result = value.toObject();
+            totals.highScores.append({laneId, result["name"].toString(), result["final_score"].toInt(), timeUs});
+        }
+        if (totals.highScores.size() > 4 * TOP_SCORES) {
+            keepTop(totals.highScores);
+        }
+    }
+}
+
+EndOfDayReport::Totals EndOfDayReport::aggregateRange(const QString& logPath, qint64 begin, qint64 end) {
+    Totals totals;
+    QFile file(logPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return totals;
+    }
+
+    // A line belongs to the range its first byte is in; the previous range
+    // finishes the line we start inside of
+    if (begin > 0) {
+        file.seek(begin - 1);
+        file.readLine();
+    }
+
+    while (file.pos() < end && !file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (!line.trimmed().isEmpty()) {
+            addLine(totals, line);
+        }
+    }
+
+    keepTop(totals.highScores);
+    return totals;
+}
+
+EndOfDayReport::Totals EndOfDayReport::aggregate(const QString& logPath, int workers) {
+    const qint64 size = QFileInfo(logPath).size();
+    if (workers <= 0) {
+        workers = qMax(1, QThread::idealThreadCount());
+    }
+    // Not worth a thread for less than a megabyte each
+    workers = int(qBound<qint64>(1, size / (1024 * 1024), workers));
+
+    QVector<Totals> partial(workers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; ++i) {
+        qint64 begin = size * i / workers;
+        qint64 end = size * (i + 1) / workers;
+        threads.emplace_back([&partial, &logPath, i, begin, end]() {
+            partial[i] = aggregateRange(logPath, begin, end);
+        });
+    }
+
+    Totals totals;
+    for (int i = 0; i < workers; ++i) {
+        threads[i].join();
+        totals.merge(partial[i]);
+    }
+    return totals;
+}
+
+QJsonObject EndOfDayReport::toJson(const Totals& totals, const QDate& date) {
+    QJsonObject lanes;
+    for (auto it = totals.lanes.constBegin(); it != totals.lanes.constEnd(); ++it) {
+        lanes[QString::number(it.key())] = it.value().toJson();
+    }
+
+    QJsonArray highScores;
+    for (const HighScore& score : totals.highScores) {
+        QJsonObject entry;
+        entry["lane"] = score.laneId;
+        entry["name"] = score.name;
+        entry["score"] = score.score;
+        highScores.append(entry);
+    }
+
+    QJsonObject report;
+    report["date"] = date.toString(Qt::ISODate);
+    report["generated"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    report["events"] = totals.lines;
+    report["malformed_events"] = totals.malformed;
+    report["house"] = totals.house().toJson();
+    report["lanes"] = lanes;
+    report["high_scores"] = highScores;
+    return report;
+}
+
+QString EndOfDayReport::toText(const QJsonObject& report) {
+    QString text;
+    QTextStream out(&text);
+
+    const QJsonObject house = report["house"].toObject();
+    out << "End of day " << report["date"].toString() << "\n\n";
+    out << "Sessions        " << house["sessions"].toInt() << "\n";
+    out << "Games played    " << house["games_played"].toInt() << "\n";
+    out << "Games sold      " << house["games_sold"].toInt() << "\n";
+    out << "Minutes sold    " << house["minutes_sold"].toInt() << "\n";
+    out << "Minutes bowled  " << house["minutes_bowled"].toInt() << "\n";
+    out << "Bowlers         " << house["bowlers"].toInt() << "\n";
+    out << "Shoes           " << house["shoes"].toInt() << "\n";
+    out << "Youth           " << house["youth"].toInt() << "\n";
+    out << "Machine faults  " << house["faults"].toInt() << "\n\n";
+
+    out << "Lane  Sessions  Games  Min bowled  Bowlers  Shoes  Faults\n";
+    const QJsonObject lanes = report["lanes"].toObject();
+    QList<int> laneIds;
+    for (const QString& key : lanes.keys()) {
+        laneIds.append(key.toInt());
+    }
+    std::sort(laneIds.begin(), laneIds.end());
+    for (int laneId : laneIds) {
+        QJsonObject lane = lanes[QString::number(laneId)].toObject();
+        out << QString("%1  %2  %3  %4  %5  %6  %7\n")
+                   .arg(laneId, 4)
+                   .arg(lane["sessions"].toInt(), 8)
+                   .arg(lane["games_played"].toInt(), 5)
+                   .arg(lane["minutes_bowled"].toInt(), 10)
+                   .arg(lane["bowlers"].toInt(), 7)
+                   .arg(lane["shoes"].toInt(), 5)
+                   .arg(lane["faults"].toInt(), 6);
+    }
+
+    out << "\nHigh scores\n";
+    for (const QJsonValue& value : report["high_scores"].toArray()) {
+        QJsonObject score = value.toObject();
+        out << QString("%1  %2  lane %3\n").arg(score["score"].toInt(), 4).arg(score["name"].toString(), -20)
+                   .arg(score["lane"].toInt());
+    }
+
+    out.flush();
+    return text;
+}
+
+EndOfDayReport::Outcome EndOfDayReport::generate(const QString& logDirectory, const QDate& date,
+                                                 const QString& outputDirectory, QJsonObject* report) {
+    QString logPath = EventLog::pathFor(logDirectory, date);
+    if (!QFile::exists(logPath)) {
+        qWarning() << "No event log for" << date.toString(Qt::ISODate) << "at" << logPath;
+        return Outcome::NoActivity;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QJsonObject result = toJson(aggregate(logPath), date);
+
+    QDir().mkpath(outputDirectory);
+    QString base = QDir(outputDirectory).filePath(date.toString(Qt::ISODate));
+
+    QSaveFile json(base + ".json");
+    QSaveFile text(base + ".txt");
+    bool ok = json.open(QIODevice::WriteOnly) && text.open(QIODevice::WriteOnly);
+    if (ok) {
+        json.write(QJsonDocument(result).toJson());
+        text.write(toText(result).toUtf8());
+        ok = json.commit() && text.commit();
+    }
+    if (!ok) {
+        qWarning() << "Cannot write end of day report to" << outputDirectory;
+        return Outcome::WriteFailed;
+    }
+
+    qDebug() << "End of day report for" << date.toString(Qt::ISODate) << "-" << result["events"].toInt()
+             << "events in" << timer.elapsed() << "ms";
+
+    if (report) {
+        *report = result;
+    }
+    return Outcome::Written;
+}
@@ -0,0 +1,80 @@
+﻿// EndOfDayReport.h - Front desk day totals from the server event log
+#ifndef ENDOFDAYREPORT_H
+#define ENDOFDAYREPORT_H
+
+#include <QString>
+#include <QMap>
+#include <QVector>
+#include <QDate>
+#include <QJsonObject>
+
+// What one lane did over the day. A game_complete closes a session (the
+// games or time bought at the desk), so shoes and youth are counted once
+// per session, not per game.
+struct LaneDayTotals {
+    int sessions = 0;
+    int gamesPlayed = 0;
+    int gamesSold = 0;          // Sessions sold by the game
+    int minutesSold = 0;        // Sessions sold by the clock
+    qint64 secondsBowled = 0;
+    int bowlers = 0;
+    int shoes = 0;
+    int youth = 0;
+    int balls = 0;
+    int amendedBalls = 0;
+    int faults = 0;
+    QMap<QString, int> faultKinds;
+
+    void merge(const LaneDayTotals& other);
+    QJsonObject toJson() const;
+};
+
+// Streams one day's EventLog file and totals it per lane. The file is cut
+// into byte ranges on line boundaries, each worker thread reads its range
+// line by line into its own per-lane totals (map), and the partial totals
+// are merged at the end (reduce). Memory is bounded by the number of lanes,
+// not the size of the log.
+class EndOfDayReport {
+public:
+    struct HighScore {
+        int laneId = 0;
+        QString name;
+        int score = 0;
+        qint64 timeUs = 0;
+    };
+
+    struct Totals {
+        QMap<int, LaneDayTotals> lanes;
+        QVector<HighScore> highScores;      // Best TOP_SCORES, highest first
+        qint64 lines = 0;
+        qint64 malformed = 0;
+
+        void merge(const Totals& other);
+        LaneDayTotals house() const;
+    };
+
+    // workers <= 0 uses one per core
+    static Totals aggregate(const QString& logPath, int workers = 0);
+
+    static QJsonObject toJson(const Totals& totals, const QDate& date);
+    static QString toText(const QJsonObject& report);
+
+    enum class Outcome {
+        Written,
+        NoActivity,         // No event log for that date
+        WriteFailed
+    };
+
+    // Aggregate <logDirectory>/<date>.jsonl and write <outputDirectory>/<date>.json
+    // and a printable <date>.txt next to it
+    static Outcome generate(const QString& logDirectory, const QDate& date,
+                            const QString& outputDirectory, QJsonObject* report = nullptr);
+
+    static constexpr int TOP_SCORES = 10;
+
+private:
+    static Totals aggregateRange(const QString& logPath, qint64 begin, qint64 end);
+    static void addLine(Totals& totals, const QByteArray& line);
+};
+
+#endif // ENDOFDAYREPORT_H
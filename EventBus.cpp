@@ -0,0 +1,181 @@
+﻿#include "EventBus.h"
+#include "MpscQueue.h"
+#include <QMutexLocker>
+#include <QDebug>
+
+std::atomic<int> EventBus::nextTopic{0};
+
+// Per-thread inbox. Producers push from any thread; the first push after
+// a drain schedules one queued drain on the owning thread's event loop.
+class EventBus::Mailbox : public QObject {
+public:
+    struct Delivery {
+        std::shared_ptr<const SubscriberList> subscribers;
+        std::shared_ptr<const void> payload;
+    };
+
+    explicit Mailbox(QThread* thread)
+        : scheduled(false)
+        , calls(0)
+    {
+        moveToThread(thread);
+    }
+
+    void post(Delivery delivery) {
+        queue.push(std::move(delivery));
+        if (!scheduled.exchange(true, std::memory_order_acq_rel)) {
+            QMetaObject::invokeMethod(this, [this]() { drain(); }, Qt::QueuedConnection);
+        }
+    }
+
+    quint64 callCount() const { return calls.load(std::memory_order_relaxed); }
+
+private:
+    void drain() {
+        // Clear first: anything pushed from here on schedules another drain
+        scheduled.store(false, std::memory_order_release);
+
+        Delivery delivery;
+        while (queue.pop(delivery)) {
+            for (const std::shared_ptr<Subscriber>& subscriber : *delivery.subscribers) {
+                if (subscriber->mailbox != this) continue;
+                if (!subscriber->active.load(std::memory_order_relaxed) || !subscriber->receiver) continue;
+
+                subscriber->invoke(delivery.payload.get());
+                calls.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        delivery = Delivery();
+    }
+
+    MpscQueue<Delivery> queue;
+    std::atomic<bool> scheduled;
+    std::atomic<quint64> calls;
+};
+
+EventBus::EventBus(QObject* parent)
+    : QObject(parent)
+    , topics(std::make_shared<const TopicTable>())
+    , nextId(1)
+    , publishedCount(0)
+    , directCount(0)
+    , queuedPostCount(0)
+{
+}
+
+EventBus::~EventBus() {
+    QMutexLocker locker(&writeMutex);
+    std::atomic_store(&topics, std::make_shared<const TopicTable>());
+
+    // Mailboxes live on their subscribers' threads; let those threads delete them
+    for (Mailbox* mailbox : mailboxes) {
+        mailbox->deleteLater();
+    }
+    mailboxes.clear();
+}
+
+EventBus::Mailbox* EventBus::mailboxFor(QThread* thread) {
+    Mailbox* mailbox = mailboxes.value(thread);
+    if (!mailbox) {
+        mailbox = new Mailbox(thread);
+        mailboxes.insert(thread, mailbox);
+    }
+    return mailbox;
+}
+
+EventBus::SubscriptionId EventBus::addSubscriber(int topic, QObject* receiver, std::function<void(const void*)> invoke) {
+    if (!receiver) {
+        qWarning() << "EventBus: subscribe without a receiver ignored";
+        return 0;
+    }
+
+    QMutexLocker locker(&writeMutex);
+
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->id = nextId++;
+    subscriber->receiver = receiver;
+    subscriber->owner = receiver;
+    subscriber->thread = receiver->thread();
+    subscriber->mailbox = mailboxFor(subscriber->thread);
+    subscriber->invoke = std::move(invoke);
+
+    // Copy-on-write: publishers keep using the snapshot they already hold
+    TopicTable table = *std::atomic_load(&topics);
+    if (topic >= table.size()) {
+        table.resize(topic + 1);
+    }
+    SubscriberList list = table[topic] ? *table[topic] : SubscriberList();
+    list.append(subscriber);
+    table[topic] = std::make_shared<const SubscriberList>(std::move(list));
+    std::atomic_store(&topics, std::make_shared<const TopicTable>(std::move(table)));
+
+    if (!watchedReceivers.contains(receiver)) {
+        watchedReceivers.insert(receiver);
+        connect(receiver, &QObject::destroyed, this, [this](QObject* object) {
+            unsubscribeAll(object);
+        }, Qt::DirectConnection);
+    }
+
+    return subscriber->id;
+}
+
+void EventBus::removeSubscribers(const std::function<bool(const Subscriber&)>& match) {
+    QMutexLocker locker(&writeMutex);
+
+    TopicTable table = *std::atomic_load(&topics);
+    bool changed = false;
+
+    for (std::shared_ptr<const SubscriberList>& entry : table) {
+        if (!entry) continue;
+
+        SubscriberList kept;
+        kept.reserve(entry->size());
+        for (const std::shared_ptr<Subscriber>& subscriber : *entry) {
+            if (match(*subscriber)) {
+                // Entries already queued for it are skipped at drain time
+                subscriber->active.store(false, std::memory_order_relaxed);
+            } else {
+                kept.append(subscriber);
+            }
+        }
+
+        if (kept.size() != entry->size()) {
+            entry = kept.isEmpty() ? nullptr : std::make_shared<const SubscriberList>(std::move(kept));
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        std::atomic_store(&topics, std::make_shared<const TopicTable>(std::move(table)));
+    }
+}
+
+void EventBus::unsubscribe(SubscriptionId id) {
+    removeSubscribers([id](const Subscriber& subscriber) { return subscriber.id == id; });
+}
+
+void EventBus::unsubscribeAll(QObject* receiver) {
+    removeSubscribers([receiver](const Subscriber& subscriber) { return subscriber.owner == receiver; });
+
+    QMutexLocker locker(&writeMutex);
+    watchedReceivers.remove(receiver);
+}
+
+void EventBus::post(Mailbox* mailbox, const std::shared_ptr<const SubscriberList>& list,
+                    std::shared_ptr<const void> payload) {
+    mailbox->post(Mailbox::Delivery{list, std::move(payload)});
+    queuedPostCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+EventBus::Stats EventBus::stats() const {
+    Stats result;
+    result.published = publishedCount.load(std::memory_order_relaxed);
+    result.directCalls = directCount.load(std::memory_order_relaxed);
+    result.queuedPosts = queuedPostCount.load(std::memory_order_relaxed);
+
+    QMutexLocker locker(&writeMutex);
+    for (const Mailbox* mailbox : mailboxes) {
+        result.queuedCalls += mailbox->callCount();
+    }
+    return result;
+}
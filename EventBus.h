@@ -0,0 +1,140 @@
+﻿// EventBus.h - Typed publish/subscribe core for the lane server
+#ifndef EVENTBUS_H
+#define EVENTBUS_H
+
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QVarLengthArray>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Every event type is its own topic with its own subscriber list:
+//
+//   bus->subscribe<LaneMessageEvent>(dashboard, [](const LaneMessageEvent& e) { ... });
+//   bus->publish(LaneMessageEvent{laneId, type, message});
+//
+// Subscribers living on the publishing thread are called directly with a
+// const reference - no copy, no QVariant, no event loop. For subscribers
+// on other threads the event is moved once into a shared payload and one
+// entry per destination thread goes onto that thread's lock-free MPSC
+// mailbox, which drains on its event loop.
+//
+// Subscriber lists are copy-on-write snapshots, so publish() takes no
+// lock; subscribe/unsubscribe are the rare, locked path. Subscriptions
+// end automatically when the receiver is destroyed. The receiver's
+// thread is taken at subscribe time.
+class EventBus : public QObject {
+    Q_OBJECT
+
+public:
+    using SubscriptionId = quint64;
+
+    explicit EventBus(QObject* parent = nullptr);
+    ~EventBus();
+
+    template<typename Event>
+    SubscriptionId subscribe(QObject* receiver, std::function<void(const Event&)> handler) {
+        return addSubscriber(topicOf<Event>(), receiver, [handler](const void* event) {
+            handler(*static_cast<const Event*>(event));
+        });
+    }
+
+    void unsubscribe(SubscriptionId id);
+    void unsubscribeAll(QObject* receiver);
+
+    template<typename Event>
+    void publish(Event event) {
+        publishedCount.fetch_add(1, std::memory_order_relaxed);
+
+        std::shared_ptr<const TopicTable> table = std::atomic_load(&topics);
+        const int topic = topicOf<Event>();
+        if (topic >= table->size() || !table->at(topic)) return;
+        std::shared_ptr<const SubscriberList> list = table->at(topic);
+
+        QThread* current = QThread::currentThread();
+        const Event* payload = &event;
+        std::shared_ptr<const Event> shared;
+        QVarLengthArray<Mailbox*, 4> posted;
+
+        for (const std::shared_ptr<Subscriber>& subscriber : *list) {
+            if (!subscriber->active.load(std::memory_order_relaxed)) continue;
+
+            if (subscriber->thread == current) {
+                if (subscriber->receiver) {
+                    subscriber->invoke(payload);
+                    directCount.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else if (!posted.contains(subscriber->mailbox)) {
+                if (!shared) {
+                    // Moved once; later direct subscribers read the shared copy
+                    shared = std::make_shared<const Event>(std::move(event));
+                    payload = shared.get();
+                }
+                post(subscriber->mailbox, list, shared);
+                posted.append(subscriber->mailbox);
+            }
+        }
+    }
+
+    template<typename Event>
+    int subscriberCount() const {
+        std::shared_ptr<const TopicTable> table = std::atomic_load(&topics);
+        const int topic = topicOf<Event>();
+        return (topic < table->size() && table->at(topic)) ? table->at(topic)->size() : 0;
+    }
+
+    struct Stats {
+        quint64 published = 0;
+        quint64 directCalls = 0;
+        quint64 queuedPosts = 0;        // One per event per destination thread
+        quint64 queuedCalls = 0;
+    };
+    Stats stats() const;
+
+private:
+    class Mailbox;
+
+    struct Subscriber {
+        SubscriptionId id = 0;
+        QPointer<QObject> receiver;
+        const QObject* owner = nullptr;     // For unsubscribeAll after destruction
+        QThread* thread = nullptr;
+        Mailbox* mailbox = nullptr;
+        std::function<void(const void*)> invoke;
+        std::atomic<bool> active{true};
+    };
+    using SubscriberList = QVector<std::shared_ptr<Subscriber>>;
+    using TopicTable = QVector<std::shared_ptr<const SubscriberList>>;
+
+    template<typename Event>
+    static int topicOf() {
+        static const int topic = nextTopic.fetch_add(1);
+        return topic;
+    }
+
+    SubscriptionId addSubscriber(int topic, QObject* receiver, std::function<void(const void*)> invoke);
+    void removeSubscribers(const std::function<bool(const Subscriber&)>& match);
+    Mailbox* mailboxFor(QThread* thread);
+    void post(Mailbox* mailbox, const std::shared_ptr<const SubscriberList>& list,
+              std::shared_ptr<const void> payload);
+
+    static std::atomic<int> nextTopic;
+
+    std::shared_ptr<const TopicTable> topics;       // Read with std::atomic_load
+    mutable QMutex writeMutex;                      // Serialises subscribe/unsubscribe
+    QHash<QThread*, Mailbox*> mailboxes;
+    QSet<const QObject*> watchedReceivers;
+    SubscriptionId nextId;
+
+    std::atomic<quint64> publishedCount;
+    std::atomic<quint64> directCount;
+    std::atomic<quint64> queuedPostCount;
+};
+
+#endif // EVENTBUS_H
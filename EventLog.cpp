@@ -0,0 +1,85 @@
+﻿#include "EventLog.h"
+#include "EventBus.h"
+#include "LaneServer.h"
+#include <QDir>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QDebug>
+
+EventLog::EventLog(EventBus* bus, const QString& directory, QObject* parent)
+    : QObject(parent)
+    , logDirectory(directory)
+    , flushTimer(new QTimer(this))
+    , linesWritten(0)
+{
+    QDir().mkpath(logDirectory);
+
+    connect(flushTimer, &QTimer::timeout, this, &EventLog::flush);
+    flushTimer->start(1000);
+
+    if (bus) {
+        bus->subscribe<LaneMessageEvent>(this, [this](const LaneMessageEvent& event) {
+            if (loggedTypes().contains(event.type)) {
+                append(event.laneId, event.type, event.eventTimeUs, event.message);
+            }
+        });
+    }
+}
+
+EventLog::~EventLog() {
+    flush();
+}
+
+const QStringList& EventLog::loggedTypes() {
+    static const QStringList types = {
+        "game_complete", "ball", "ball_amended", "machine_fault", "status_update"
+    };
+    return types;
+}
+
+QString EventLog::pathFor(const QString& directory, const QDate& date) {
+    return QDir(directory).filePath(date.toString(Qt::ISODate) + ".jsonl");
+}
+
+bool EventLog::openFor(const QDate& date) {
+    if (file.isOpen() && fileDate == date) {
+        return true;
+    }
+
+    if (file.isOpen()) {
+        file.close();
+        qDebug() << "Event log closed for" << fileDate.toString(Qt::ISODate) << "-" << linesWritten << "events";
+    }
+
+    file.setFileName(pathFor(logDirectory, date));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Cannot open event log" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+    fileDate = date;
+    linesWritten = 0;
+    return true;
+}
+
+void EventLog::append(int laneId, const QString& type, qint64 timeUs, const QJsonObject& message) {
+    if (!openFor(QDate::currentDate())) {
+        return;
+    }
+
+    QJsonObject line;
+    line["lane"] = laneId;
+    line["type"] = type;
+    line["time_us"] = timeUs;
+    line["message"] = message;
+
+    file.write(QJsonDocument(line).toJson(QJsonDocument::Compact));
+    file.write("\n");
+    linesWritten++;
+}
+
+void EventLog::flush() {
+    if (file.isOpen()) {
+        file.flush();
+    }
+}
@@ -0,0 +1,51 @@
+﻿// EventLog.h - Append-only day log of lane events on the server
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <QObject>
+#include <QFile>
+#include <QDate>
+#include <QTimer>
+#include <QStringList>
+
+class EventBus;
+struct LaneMessageEvent;
+
+// Subscribes to LaneMessageEvent and appends the ones worth keeping to
+// <directory>/YYYY-MM-DD.jsonl, one compact JSON object per line:
+//
+//   { "lane": 4, "type": "game_complete", "time_us": 1712..., "message": {...} }
+//
+// time_us is the event's server-clock time (eventTimeUs). A new file is
+// started when the date changes. Lines are buffered and flushed every
+// second, so the cost on the server thread is one toJson() per event.
+// EndOfDayReport reads these files back.
+class EventLog : public QObject {
+    Q_OBJECT
+
+public:
+    EventLog(EventBus* bus, const QString& directory, QObject* parent = nullptr);
+    ~EventLog();
+
+    QString directory() const { return logDirectory; }
+    static QString defaultDirectory() { return "eventlog"; }
+    static QString pathFor(const QString& directory, const QDate& date);
+
+    // Appended as-is; used by replay tools and the benchmark
+    void append(int laneId, const QString& type, qint64 timeUs, const QJsonObject& message);
+    void flush();
+
+    // Message types written to the log
+    static const QStringList& loggedTypes();
+
+private:
+    bool openFor(const QDate& date);
+
+    QString logDirectory;
+    QFile file;
+    QDate fileDate;
+    QTimer* flushTimer;
+    qint64 linesWritten;
+};
+
+#endif // EVENTLOG_H
@@ -0,0 +1,153 @@
+﻿#include "GameMirror.h"
+#include <QJsonArray>
+#include <QDebug>
+
+GameMirror::GameMirror(QObject* parent)
+    : QObject(parent)
+{
+}
+
+QJsonObject GameMirror::makeDelta(const QJsonObject& previous, const QJsonObject& current) {
+    QJsonObject fields;
+    for (auto it = current.constBegin(); it != current.constEnd(); ++it) {
+        if (it.key() == "bowlers") continue;
+        if (previous.value(it.key()) != it.value()) {
+            fields[it.key()] = it.value();
+        }
+    }
+
+    QJsonArray removed;
+    for (auto it = previous.constBegin(); it != previous.constEnd(); ++it) {
+        if (!current.contains(it.key())) {
+            removed.append(it.key());
+        }
+    }
+
+    QJsonArray previousBowlers = previous["bowlers"].toArray();
+    QJsonArray currentBowlers = current["bowlers"].toArray();
+    QJsonObject bowlers;
+    for (int i = 0; i < currentBowlers.size(); ++i) {
+        if (i >= previousBowlers.size() || previousBowlers[i] != currentBowlers[i]) {
+            bowlers[QString::number(i)] = currentBowlers[i];
+        }
+    }
+
+    QJsonObject delta;
+    if (!fields.isEmpty()) delta["fields"] = fields;
+    if (!removed.isEmpty()) delta["removed"] = removed;
+    if (!bowlers.isEmpty()) delta["bowlers"] = bowlers;
+    if (currentBowlers.size() != previousBowlers.size()) delta["bowler_count"] = currentBowlers.size();
+    return delta;
+}
+
+void GameMirror::applyDelta(QJsonObject& state, const QJsonObject& delta) {
+    QJsonObject fields = delta["fields"].toObject();
+    for (auto it = fields.constBegin(); it != fields.constEnd(); ++it) {
+        state[it.key()] = it.value();
+    }
+
+    QJsonArray bowlerArray = state["bowlers"].toArray();
+    if (delta.contains("bowler_count")) {
+        int count = delta["bowler_count"].toInt();
+        while (bowlerArray.size() > count) bowlerArray.removeLast();
+        while (bowlerArray.size() < count) bowlerArray.append(QJsonObject());
+    }
+
+    QJsonObject bowlers = delta["bowlers"].toObject();
+    for (auto it = bowlers.constBegin(); it != bowlers.constEnd(); ++it) {
+        int index = it.key().toInt();
+        if (index >= 0 && index < bowlerArray.size()) {
+            bowlerArray[index] = it.value();
+        }
+    }
+    state["bowlers"] = bowlerArray;
+
+    for (const QJsonValue& key : delta["removed"].toArray()) {
+        state.remove(key.toString());
+    }
+}
+
+GameMirror::ApplyResult GameMirror::apply(int laneId, const QJsonObject& message) {
+    qint64 seq = static_cast<qint64>(message["seq"].toDouble());
+
+    if (message.contains("game_active") && !message["game_active"].toBool()) {
+        clearLane(laneId);
+        return ApplyResult::Ended;
+    }
+
+    if (message["snapshot"].toBool()) {
+        LaneGame& game = lanes[laneId];
+        game.state = message["state"].toObject();
+        game.seq = seq;
+        game.gameNumber = message["game_number"].toInt();
+        game.gameType = message["game_type"].toString();
+        game.updated = QDateTime::currentDateTime();
+
+        emit laneUpdated(laneId, game.state);
+        return ApplyResult::Applied;
+    }
+
+    auto it = lanes.find(laneId);
+    if (it == lanes.end() || seq != it->seq + 1) {
+        qDebug() << "Lane" << laneId << "mirror gap at seq" << seq
+                 << "(have" << (it == lanes.end() ? -1 : it->seq) << ") - requesting snapshot";
+        return ApplyResult::NeedsResync;
+    }
+
+    applyDelta(it->state, message);
+    it->seq = seq;
+    it->updated = QDateTime::currentDateTime();
+
+    emit laneUpdated(laneId, it->state);
+    return ApplyResult::Applied;
+}
+
+QJsonObject GameMirror::restorePayload(int laneId) const {
+    auto it = lanes.constFind(laneId);
+    if (it == lanes.constEnd()) return QJsonObject();
+
+    QJsonObject payload;
+    payload["seq"] = it->seq;
+    payload["game_number"] = it->gameNumber;
+    payload["game_type"] = it->gameType;
+    payload["game_state"] = it->state;
+    payload["updated"] = it->updated.toString(Qt::ISODate);
+    return payload;
+}
+
+void GameMirror::setLane(int laneId, const QJsonObject& payload) {
+    if (payload.isEmpty()) {
+        clearLane(laneId);
+        return;
+    }
+
+    LaneGame& game = lanes[laneId];
+    game.state = payload["game_state"].toObject();
+    game.seq = static_cast<qint64>(payload["seq"].toDouble());
+    game.gameNumber = payload["game_number"].toInt();
+    game.gameType = payload["game_type"].toString();
+    game.updated = QDateTime::fromString(payload["updated"].toString(), Qt::ISODate);
+
+    emit laneUpdated(laneId, game.state);
+}
+
+QJsonObject GameMirror::toJson() const {
+    QJsonObject json;
+    for (auto it = lanes.constBegin(); it != lanes.constEnd(); ++it) {
+        json[QString::number(it.key())] = restorePayload(it.key());
+    }
+    return json;
+}
+
+void GameMirror::loadJson(const QJsonObject& json) {
+    lanes.clear();
+    for (auto it = json.constBegin(); it != json.constEnd(); ++it) {
+        setLane(it.key().toInt(), it.value().toObject());
+    }
+}
+
+void GameMirror::clearLane(int laneId) {
+    if (lanes.remove(laneId) > 0) {
+        emit laneEnded(laneId);
+    }
+}
@@ -0,0 +1,74 @@
+﻿// GameMirror.h - Server-side live copy of every lane's game state
+#ifndef GAMEMIRROR_H
+#define GAMEMIRROR_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QHash>
+#include <QDateTime>
+
+// Lanes publish their QuickGame::getGameState() as "mirror_update"
+// messages. The first one of a game (or after a resync) carries the whole
+// state; after that only the top-level fields and the bowlers that
+// changed are sent, so a ball costs one bowler object on the wire:
+//
+//   { "type": "mirror_update", "seq": 12, "snapshot": true,
+//     "game_number": 1, "game_type": "quick_game", "state": {...} }
+//   { "type": "mirror_update", "seq": 13,
+//     "fields": { "current_bowler_index": 2 }, "bowlers": { "1": {...} },
+//     "removed": [ "tenth_frame_bonus" ] }
+//
+// Updates replace whole bowlers, so applying one twice is harmless, but a
+// missing sequence number means the mirror cannot be trusted: apply()
+// reports it and the server asks the lane for a snapshot
+// ("mirror_resync"). A rebooted lane gets restorePayload() in its
+// registration_response and resumes from it.
+class GameMirror : public QObject {
+    Q_OBJECT
+
+public:
+    enum class ApplyResult {
+        Applied,
+        Ended,          // Game finished; mirror dropped
+        NeedsResync     // Gap or delta without a base - request a snapshot
+    };
+
+    explicit GameMirror(QObject* parent = nullptr);
+
+    ApplyResult apply(int laneId, const QJsonObject& message);
+
+    bool hasGame(int laneId) const { return lanes.contains(laneId); }
+    QJsonObject gameState(int laneId) const { return lanes.value(laneId).state; }
+    QList<int> laneIds() const { return lanes.keys(); }
+
+    // For registration_response "mirror"; empty when the lane has no game
+    QJsonObject restorePayload(int laneId) const;
+
+    // Replication (hot standby) - full contents and single-lane replace
+    QJsonObject toJson() const;
+    void loadJson(const QJsonObject& json);
+    void setLane(int laneId, const QJsonObject& restorePayload);
+
+    void clearLane(int laneId);
+
+    // Shared with the lane side
+    static QJsonObject makeDelta(const QJsonObject& previous, const QJsonObject& current);
+    static void applyDelta(QJsonObject& state, const QJsonObject& delta);
+
+signals:
+    void laneUpdated(int laneId, const QJsonObject& state);
+    void laneEnded(int laneId);
+
+private:
+    struct LaneGame {
+        QJsonObject state;
+        qint64 seq = 0;
+        int gameNumber = 0;
+        QString gameType;
+        QDateTime updated;
+    };
+
+    QHash<int, LaneGame> lanes;
+};
+
+#endif // GAMEMIRROR_H
@@ -1,6 +1,7 @@
 ﻿// GameRecoveryManager.cpp
 
 #include "GameRecoveryManager.h"
+#include "TaskScheduler.h"
 
 #include <QStandardPaths>
 #include <QDir>
@@ -154,12 +155,8 @@ void GameRecoveryManager::showRecoveryDialog(QWidget* parent) {
 }
 
 void GameRecoveryManager::saveRecoveryState() {
-    QFile file(recoveryFilePath);
-    if (file.open(QIODevice::WriteOnly)) {
-        QJsonDocument doc(currentRecoveryData);
-        file.write(doc.toJson());
-        file.close();
-    }
+    // Once per ball - serialized and written on a Disk worker, never in the ball's way
+    TaskScheduler::instance()->saveJson(recoveryFilePath, QJsonDocument(currentRecoveryData));
 }
 
 void GameRecoveryManager::loadRecoveryState() {
@@ -1,6 +1,7 @@
 ﻿// GameStatistics.cpp
 
 #include "GameStatistics.h"
+#include "TaskScheduler.h"
 
 #include <QStandardPaths>
 #include <QDir>
@@ -30,6 +31,7 @@ void GameStatistics::recordGameCompletion(const QVector<Bowler>& bowlers, const
         if (isNewHighScore(bowler.totalScore)) {
             HighScoreRecord record;
             record.bowlerName = bowler.name;
+            record.bowlerId = bowler.id;
             record.score = bowler.totalScore;
             record.gameType = gameType;
             record.dateTime = now;
@@ -80,6 +82,7 @@ void GameStatistics::recordGameCompletion(const QVector<Bowler>& bowlers, const
             if (isNewStrikeRecord(maxConsecutive)) {
                 StrikeRecord record;
                 record.bowlerName = bowler.name;
+                record.bowlerId = bowler.id;
                 record.consecutiveStrikes = maxConsecutive;
                 record.frames = strikeFrames;
                 record.gameType = gameType;
@@ -111,26 +114,42 @@ void GameStatistics::recordGameCompletion(const QVector<Bowler>& bowlers, const
     saveStatistics();
 }
 
-void GameStatistics::recordBallThrown(const QString& bowlerName, int frame, const Ball& ball, bool isStrike, bool isSpare) {
-    Q_UNUSED(ball)
+void GameStatistics::recordBallThrown(const QString& bowlerName, int frame, const Ball& ball, bool isStrike, bool isSpare,
+                                      const QString& bowlerId) {
     Q_UNUSED(isSpare)
+    const QString key = bowlerKey(bowlerName, bowlerId);
+    
+    // Ball speed from the sensor edge timing
+    if (ball.timing.isValid()) {
+        SpeedRecord& speed = speedRecords[key];
+        speed.bowlerName = bowlerName;
+        speed.bowlerId = bowlerId;
+        speed.measuredBalls++;
+        speed.totalSpeedMps += ball.timing.speedMps;
+        speed.totalDwellMs += ball.timing.dwellMs;
+        speed.topSpeedMps = qMax(speed.topSpeedMps, ball.timing.speedMps);
+    }
     
     if (isStrike) {
-        if (!currentStrikeSequences.contains(bowlerName)) {
-            currentStrikeSequences[bowlerName] = QVector<int>();
+        if (!currentStrikeSequences.contains(key)) {
+            currentStrikeSequences[key] = QVector<int>();
         }
-        currentStrikeSequences[bowlerName].append(frame);
+        currentStrikeSequences[key].append(frame);
         
         qDebug() << bowlerName << "strike in frame" << frame 
-                 << "- sequence length:" << currentStrikeSequences[bowlerName].size();
+                 << "- sequence length:" << currentStrikeSequences[key].size();
     } else {
         // End any current strike sequence
-        if (currentStrikeSequences.contains(bowlerName)) {
-            qDebug() << bowlerName << "strike sequence ended at" << currentStrikeSequences[bowlerName].size();
+        if (currentStrikeSequences.contains(key)) {
+            qDebug() << bowlerName << "strike sequence ended at" << currentStrikeSequences[key].size();
         }
     }
 }
 
+GameStatistics::SpeedRecord GameStatistics::getSpeedRecord(const QString& bowlerKey) const {
+    return speedRecords.value(bowlerKey);
+}
+
 bool GameStatistics::isNewHighScore(int score) const {
     if (highScores.isEmpty()) return true;
     
@@ -157,6 +176,7 @@ void GameStatistics::saveStatistics() {
     for (const HighScoreRecord& record : highScores) {
         QJsonObject scoreObj;
         scoreObj["bowler_name"] = record.bowlerName;
+        if (!record.bowlerId.isEmpty()) scoreObj["bowler_id"] = record.bowlerId;
         scoreObj["score"] = record.score;
         scoreObj["game_type"] = record.gameType;
         scoreObj["date_time"] = record.dateTime.toString(Qt::ISODate);
@@ -170,6 +190,7 @@ void GameStatistics::saveStatistics() {
     for (const StrikeRecord& record : strikeRecords) {
         QJsonObject strikeObj;
         strikeObj["bowler_name"] = record.bowlerName;
+        if (!record.bowlerId.isEmpty()) strikeObj["bowler_id"] = record.bowlerId;
         strikeObj["consecutive_strikes"] = record.consecutiveStrikes;
         
         QJsonArray framesArray;
@@ -184,14 +205,23 @@ void GameStatistics::saveStatistics() {
     }
     data["strike_records"] = strikesArray;
     
-    // Write to file
-    QFile file(statisticsFilePath);
-    if (file.open(QIODevice::WriteOnly)) {
-        QJsonDocument doc(data);
-        file.write(doc.toJson());
-        file.close();
-        qDebug() << "Statistics saved to" << statisticsFilePath;
+    // Save ball speed totals
+    QJsonArray speedsArray;
+    for (const SpeedRecord& record : speedRecords) {
+        QJsonObject speedObj;
+        speedObj["bowler_name"] = record.bowlerName;
+        if (!record.bowlerId.isEmpty()) speedObj["bowler_id"] = record.bowlerId;
+        speedObj["measured_balls"] = record.measuredBalls;
+        speedObj["total_speed_mps"] = record.totalSpeedMps;
+        speedObj["top_speed_mps"] = record.topSpeedMps;
+        speedObj["total_dwell_ms"] = record.totalDwellMs;
+        speedsArray.append(speedObj);
     }
+    data["ball_speeds"] = speedsArray;
+    
+    // Serialized and written on a Disk worker
+    TaskScheduler::instance()->saveJson(statisticsFilePath, QJsonDocument(data));
+    qDebug() << "Statistics queued for" << statisticsFilePath;
 }
 
 void GameStatistics::loadStatistics() {
@@ -212,6 +242,7 @@ void GameStatistics::loadStatistics() {
         QJsonObject scoreObj = value.toObject();
         HighScoreRecord record;
         record.bowlerName = scoreObj["bowler_name"].toString();
+        record.bowlerId = scoreObj["bowler_id"].toString();
         record.score = scoreObj["score"].toInt();
         record.gameType = scoreObj["game_type"].toString();
         record.dateTime = QDateTime::fromString(scoreObj["date_time"].toString(), Qt::ISODate);
@@ -226,6 +257,7 @@ void GameStatistics::loadStatistics() {
         QJsonObject strikeObj = value.toObject();
         StrikeRecord record;
         record.bowlerName = strikeObj["bowler_name"].toString();
+        record.bowlerId = strikeObj["bowler_id"].toString();
         record.consecutiveStrikes = strikeObj["consecutive_strikes"].toInt();
         
         QJsonArray framesArray = strikeObj["frames"].toArray();
@@ -238,6 +270,21 @@ void GameStatistics::loadStatistics() {
         strikeRecords.append(record);
     }
     
+    // Load ball speed totals
+    speedRecords.clear();
+    QJsonArray speedsArray = root["ball_speeds"].toArray();
+    for (const QJsonValue& value : speedsArray) {
+        QJsonObject speedObj = value.toObject();
+        SpeedRecord record;
+        record.bowlerName = speedObj["bowler_name"].toString();
+        record.bowlerId = speedObj["bowler_id"].toString();
+        record.measuredBalls = speedObj["measured_balls"].toInt();
+        record.totalSpeedMps = speedObj["total_speed_mps"].toDouble();
+        record.topSpeedMps = speedObj["top_speed_mps"].toDouble();
+        record.totalDwellMs = speedObj["total_dwell_ms"].toDouble();
+        speedRecords[bowlerKey(record.bowlerName, record.bowlerId)] = record;
+    }
+    
     qDebug() << "Statistics loaded:" << highScores.size() << "high scores," << strikeRecords.size() << "strike records";
 }
 
@@ -15,14 +15,27 @@ class GameStatistics : public QObject {
 public:
     struct HighScoreRecord {
         QString bowlerName;
+        QString bowlerId;       // BowlerDirectory member, empty for walk-ins
         int score;
         QString gameType;
         QDateTime dateTime;
         int gameNumber;
     };
     
+    struct SpeedRecord {
+        QString bowlerName;
+        QString bowlerId;
+        int measuredBalls = 0;
+        double totalSpeedMps = 0.0;
+        double topSpeedMps = 0.0;
+        double totalDwellMs = 0.0;
+        
+        double averageSpeedMps() const { return measuredBalls > 0 ? totalSpeedMps / measuredBalls : 0.0; }
+    };
+    
     struct StrikeRecord {
         QString bowlerName;
+        QString bowlerId;
         int consecutiveStrikes;
         QVector<int> frames;  // Which frames had strikes
         QString gameType;
@@ -34,12 +47,18 @@ public:
     
     // Record tracking
     void recordGameCompletion(const QVector<Bowler>& bowlers, const QString& gameType, int gameNumber);
-    void recordBallThrown(const QString& bowlerName, int frame, const Ball& ball, bool isStrike, bool isSpare);
+    void recordBallThrown(const QString& bowlerName, int frame, const Ball& ball, bool isStrike, bool isSpare,
+                          const QString& bowlerId = QString());
     
     // Statistics queries
     QVector<HighScoreRecord> getTopScores(int limit = 10) const;
     QVector<StrikeRecord> getTopStrikeRecords(int limit = 10) const;
     QVector<HighScoreRecord> getRecentHighScores(int days = 30) const;
+    // By directory ID when the bowler has one, so renames and retyped names stay one person
+    SpeedRecord getSpeedRecord(const QString& bowlerKey) const;
+    static QString bowlerKey(const QString& bowlerName, const QString& bowlerId) {
+        return bowlerId.isEmpty() ? bowlerName : bowlerId;
+    }
     
     // Save/load
     void saveStatistics();
@@ -56,7 +75,8 @@ private:
     
     QVector<HighScoreRecord> highScores;
     QVector<StrikeRecord> strikeRecords;
-    QMap<QString, QVector<int>> currentStrikeSequences; // bowlerName -> frame numbers with strikes
+    QMap<QString, QVector<int>> currentStrikeSequences; // bowlerKey -> frame numbers with strikes
+    QMap<QString, SpeedRecord> speedRecords;             // bowlerKey -> ball speed totals
     QString statisticsFilePath;
 };
 
@@ -1,42 +1,75 @@
-﻿#ifndef LANECLIENT_H
+#ifndef LANECLIENT_H
 #define LANECLIENT_H
 
 #include <QObject>
-#include <QTcpSocket>
-#include <QTimer>
+#include <QThread>
 #include <QJsonObject>
-#include <QJsonDocument>
-#include <QDateTime>
-#include <QHostAddress>
-#include <QUdpSocket>
-#include <QNetworkInterface>
-
-enum class ClientConnectionState {
-    Disconnected,
-    Connecting,
-    Connected,
-    Reconnecting
-};
+#include <QFuture>
+#include <functional>
+#include "LaneLink.h"
+#include "RpcChannel.h"
+#include "ClockSync.h"
+#include "BallEvent.h"
 
+// The lane's view of the server connection. The socket, discovery, timers
+// and JSON work all run in a LaneLink on a dedicated I/O thread, so a slow
+// or flapping network never holds up ball handling or repaint.
+//
+// The two threads only talk through lock-free MPSC mailboxes (MpscQueue):
+// calls here are queued to the I/O thread and return at once, and
+// everything the link hears comes back as queued events, emitted from this
+// object's own thread. gameCommandReceived handlers therefore run on the
+// UI thread and may call rejectCommand() as before; the command is
+// acknowledged to the server once they return.
 class LaneClient : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit LaneClient(int laneId, QObject *parent = nullptr);
+    enum class Threading {
+        IoThread,       // Network work on LaneClient's own thread (normal)
+        Inline          // On the caller's thread, as before; for comparison
+    };
+
+    explicit LaneClient(int laneId, QObject *parent = nullptr, Threading threading = Threading::IoThread);
     ~LaneClient();
-    
+
     void setServerAddress(const QString &host, quint16 port = 50005);
+
+    // Drop the current connection and register with another server now,
+    // e.g. a standby that announced it has taken over
+    void switchServer(const QString &host, quint16 port);
     void start();
     void stop();
-    
+
     bool isConnected() const;
     int getLaneId() const { return m_laneId; }
-    
+
+    // Offset to the server clock as of the last heartbeat
+    const ClockSync &clock() const { return m_clock; }
+
+    // Heartbeats are more frequent during a game than in attract mode
+    void setGameActive(bool active);
+
     // Game interface
     void sendGameComplete(const QJsonObject &gameData);
     void sendFrameUpdate(const QJsonObject &frameData);
     void sendStatusUpdate(const QString &status);
+    void sendBall(const BallEvent &ball);       // The only place a ball becomes JSON
+
+    // Request/response to the server; the future and callback complete on
+    // this object's thread on reply, timeout or disconnect
+    QFuture<RpcResult> call(const QString &method, const QJsonObject &data,
+                            int timeoutMs = RpcChannel::DEFAULT_TIMEOUT_MS,
+                            RpcChannel::Callback callback = RpcChannel::Callback());
+
+    // Called from a gameCommandReceived handler to nack the command
+    void rejectCommand(const QString &reason);
+
+    // Keep the server's mirror of this lane's game current (see GameMirror);
+    // only what changed since the last call goes on the wire
+    void publishGameState(int gameNumber, const QString &gameType, const QJsonObject &state);
+    void endGameState();
 
 signals:
     void connected();
@@ -45,56 +78,31 @@ signals:
     void serverMessageReceived(const QJsonObject &message);
     void connectionStateChanged(ClientConnectionState state);
 
+    // First registration after start: the server's copy of the game this
+    // lane was running, or an empty object if it has none
+    void restoreStateReceived(const QJsonObject &mirror);
+
 public slots:
     void connectToServer();
     void sendMessage(const QJsonObject &message);
 
-private slots:
-    void onConnected();
-    void onDisconnected();
-    void onReadyRead();
-    void onError(QAbstractSocket::SocketError error);
-    void sendHeartbeat();
-    void attemptReconnection();
-    void onServerDiscoveryResponse();
-
 private:
-    void setupHeartbeat();
-    void processMessage(const QJsonObject &message);
-    void handleRegistrationResponse(const QJsonObject &message);
-    void handleGameCommand(const QJsonObject &message);
-    void handleHeartbeatResponse(const QJsonObject &message);
-    void handleTeamMove(const QJsonObject &message);
-    
-    void setConnectionState(ClientConnectionState state);
-    void startServerDiscovery();
-    void sendRegistration();
-    QString getLocalIpAddress();
-    bool validateConnection();
-    
-    // Connection management
+    class Mailbox;
+
+    void toLink(std::function<void()> command);
+    void toClient(std::function<void()> event);
+    void dispatchGameCommand(const QJsonObject &message);
+
     int m_laneId;
-    QString m_serverHost;
-    quint16 m_serverPort;
-    QTcpSocket *m_socket;
-    ClientConnectionState m_connectionState;
-    
-    // Heartbeat and reconnection
-    QTimer *m_heartbeatTimer;
-    QTimer *m_reconnectTimer;
-    QTimer *m_discoveryTimer;
-    QUdpSocket *m_discoverySocket;
-    
-    bool m_registered;
-    QDateTime m_lastHeartbeat;
-    int m_reconnectAttempts;
-    int m_maxReconnectAttempts;
-    
-    // Constants
-    static const int HEARTBEAT_INTERVAL = 10000;     // 10 seconds
-    static const int RECONNECT_INTERVAL = 5000;      // 5 seconds  
-    static const int DISCOVERY_INTERVAL = 30000;     // 30 seconds
-    static const int MAX_RECONNECT_ATTEMPTS = 10;
+    LaneLink *m_link;
+    QThread *m_ioThread;        // Null when Inline
+    Mailbox *m_linkMailbox;     // Drained on the link's thread
+    Mailbox *m_clientMailbox;   // Drained on this object's thread
+
+    ClockSync m_clock;          // Copy of the link's, updated per heartbeat
+    QString m_commandError;
+
+    static constexpr int STOP_WAIT_MS = 1000;
 };
 
 #endif // LANECLIENT_H
\ No newline at end of file
@@ -0,0 +1,781 @@
+﻿#include "LaneLink.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include "GameMirror.h"
+#include <QDebug>
+#include <QNetworkInterface>
+#include <QHostAddress>
+#include <algorithm>
+
+LaneLink::LaneLink(int laneId, QObject *parent)
+    : QObject(parent)
+    , m_laneId(laneId)
+    , m_serverHost("192.168.2.243") // Default server
+    , m_serverPort(50005)
+    , m_socket(new QTcpSocket(this))
+    , m_connectionState(ClientConnectionState::Disconnected)
+    , m_timers(new TimingWheel(TIMER_TICK, this))
+    , m_heartbeatTimerId(0)
+    , m_serverTimeoutId(0)
+    , m_reconnectTimerId(0)
+    , m_rpc(nullptr)
+    , m_mirrorSeq(0)
+    , m_mirrorGameNumber(0)
+    , m_mirrorSynced(false)
+    , m_restoreOffered(false)
+    , m_serverEpoch(0)
+    , m_discoveryTimer(new QTimer(this))
+    , m_discoverySocket(new QUdpSocket(this))
+    , m_registered(false)
+    , m_gameActive(false)
+    , m_lastInboundUs(0)
+    , m_lastOutboundUs(0)
+    , m_lastHeartbeatUs(0)
+    , m_reconnectAttempts(0)
+    , m_maxReconnectAttempts(MAX_RECONNECT_ATTEMPTS)
+{
+    m_rpc = new RpcChannel([this](const QJsonObject &message) { sendMessage(message); }, m_timers, this);
+    
+    // Setup socket connections
+    connect(m_socket, &QTcpSocket::connected, this, &LaneLink::onConnected);
+    connect(m_socket, &QTcpSocket::disconnected, this, &LaneLink::onDisconnected);
+    connect(m_socket, &QTcpSocket::readyRead, this, &LaneLink::onReadyRead);
+    connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
+            this, &LaneLink::onError);
+    
+    // Setup timers
+    connect(m_discoveryTimer, &QTimer::timeout, this, &LaneLink::startServerDiscovery);
+    
+    // Setup discovery socket
+    connect(m_discoverySocket, &QUdpSocket::readyRead, this, &LaneLink::onServerDiscoveryResponse);
+    
+    // Configure timers
+    m_discoveryTimer->setInterval(DISCOVERY_INTERVAL);
+    
+    qDebug() << "LaneLink initialized for lane" << m_laneId;
+}
+
+LaneLink::~LaneLink()
+{
+    stop();
+}
+
+void LaneLink::setServerAddress(const QString &host, quint16 port)
+{
+    m_serverHost = host;
+    m_serverPort = port;
+    qDebug() << "Server address set to" << host << ":" << port;
+}
+
+void LaneLink::start()
+{
+    qDebug() << "Starting lane client for lane" << m_laneId;
+    
+    // Start server discovery
+    // startServerDiscovery();
+    // m_discoveryTimer->start();
+    
+    // A standby taking over announces itself on the discovery group
+    listenForAnnouncements();
+    
+    // Attempt initial connection
+    connectToServer();
+}
+
+void LaneLink::switchServer(const QString &host, quint16 port)
+{
+    qDebug() << "Switching to server at" << host << ":" << port;
+    setServerAddress(host, port);
+    
+    if (m_socket->state() != QAbstractSocket::UnconnectedState) {
+        m_socket->abort();
+    }
+    
+    // A different server has a different clock
+    m_clock.reset();
+    
+    // No backoff - the new server is known to be up
+    m_timers->cancel(m_reconnectTimerId);
+    m_reconnectAttempts = 0;
+    setConnectionState(ClientConnectionState::Reconnecting);
+    connectToServer();
+}
+
+void LaneLink::stop()
+{
+    qDebug() << "Stopping lane client";
+    
+    // Stop all timers
+    m_timers->cancel(m_heartbeatTimerId);
+    m_timers->cancel(m_serverTimeoutId);
+    m_timers->cancel(m_reconnectTimerId);
+    m_discoveryTimer->stop();
+    
+    // Disconnected first, so onDisconnected() does not schedule a reconnect;
+    // abort() rather than a graceful close, which would block shutdown
+    setConnectionState(ClientConnectionState::Disconnected);
+    m_registered = false;
+    m_socket->abort();
+}
+
+bool LaneLink::isConnected() const
+{
+    return m_connectionState == ClientConnectionState::Connected && m_registered;
+}
+
+void LaneLink::connectToServer()
+{
+    if (m_connectionState == ClientConnectionState::Connecting || 
+        m_connectionState == ClientConnectionState::Connected) {
+        return;
+    }
+    
+    setConnectionState(ClientConnectionState::Connecting);
+    m_registered = false;
+    
+    qDebug() << "Connecting to server at" << m_serverHost << ":" << m_serverPort;
+    m_socket->connectToHost(m_serverHost, m_serverPort);
+}
+
+void LaneLink::onConnected()
+{
+    qDebug() << "Successfully connected to server at" << m_serverHost << ":" << m_serverPort;
+    
+    setConnectionState(ClientConnectionState::Connected);
+    m_reconnectAttempts = 0;
+    
+    // A dead server host or cable is found by TCP in seconds, heartbeat or not
+    m_keepAlive.apply(m_socket);
+    
+    // Send registration immediately
+    sendRegistration();
+    emit connected();
+}
+
+void LaneLink::onDisconnected()
+{
+    qDebug() << "Disconnected from server";
+    
+    bool wasRegistered = m_registered;
+    m_registered = false;
+    m_mirrorSynced = false;
+    m_timers->cancel(m_heartbeatTimerId);
+    m_timers->cancel(m_serverTimeoutId);
+    m_rpc->failAll("Disconnected from server");
+    
+    if (m_connectionState != ClientConnectionState::Disconnected) {
+        setConnectionState(ClientConnectionState::Reconnecting);
+        
+        // Start reconnection attempts (keeps an earlier backoff from onError)
+        if (!m_timers->isArmed(m_reconnectTimerId)) {
+            scheduleReconnect(RECONNECT_INTERVAL);
+        }
+    }
+    
+    if (wasRegistered) {
+        emit disconnected();
+    }
+}
+
+void LaneLink::onError(QAbstractSocket::SocketError error)
+{
+    qWarning() << "Socket error:" << error << m_socket->errorString();
+    
+    if (m_connectionState == ClientConnectionState::Connected || 
+        m_connectionState == ClientConnectionState::Connecting) {
+        m_connectionState = ClientConnectionState::Reconnecting;
+        m_registered = false;
+        m_timers->cancel(m_heartbeatTimerId);
+        m_timers->cancel(m_serverTimeoutId);
+        
+        // Start reconnection with backoff
+        int delay = std::min(1000 * (1 << m_reconnectAttempts), 30000);
+        scheduleReconnect(delay);
+        m_reconnectAttempts++;
+    }
+}
+
+void LaneLink::onReadyRead()
+{
+    while (m_socket->canReadLine()) {
+        QByteArray data = m_socket->readLine();
+        
+        QJsonParseError error;
+        QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+        
+        if (error.error != QJsonParseError::NoError) {
+            qWarning() << "JSON parse error:" << error.errorString();
+            qWarning() << "Failed to parse data:" << data;
+            continue;
+        }
+        
+        if (doc.isObject()) {
+            QJsonObject message = doc.object();
+            processMessage(message);
+        } else {
+            qWarning() << "Received JSON is not an object:" << doc;
+        }
+    }
+}
+
+void LaneLink::processMessage(const QJsonObject &message)
+{
+    // Any traffic proves the server is alive
+    m_lastInboundUs = ClockSync::monotonicUs();
+    m_timers->reset(m_serverTimeoutId, serverTimeout());
+    
+    if (m_rpc->handleMessage(message)) {
+        return;
+    }
+    
+    QString type = message["type"].toString();
+    if (type == "registration_response") {
+        qDebug() << "Processing registration_response";
+        handleRegistrationResponse(message);
+    } else if (type == "heartbeat_response") {
+        handleHeartbeatResponse(message);
+    } else if (type == "quick_game" || type == "league_game" || type == "pre_bowl" ||
+               type == "close_game" || type == "display_mode_change" ||
+               type == "scroll_message" || type == "three_six_nine_toggle") {
+        qDebug() << "Processing game command:" << type;
+        
+        // Acknowledged (and broadcast-acked) by completeCommand() once the
+        // lane's own thread has acted on it
+        emit gameCommandReceived(message);
+        return;
+    } else if (type == "team_move") {
+        qDebug() << "Processing team_move";
+        handleTeamMove(message);
+    } else if (type == "ball_ack") {
+        handleBallAck(message);
+    } else if (type == "mirror_resync") {
+        qDebug() << "Server mirror out of step - sending snapshot";
+        sendMirrorSnapshot();
+    } else if (type == "ping") {
+        // Respond to server ping
+        QJsonObject response;
+        response["type"] = "pong";
+        sendMessage(response);
+    } else {
+        qDebug() << "Forwarding unknown message type:" << type;
+        // Forward other messages
+        emit serverMessageReceived(message);
+    }
+    
+    // House-wide broadcasts are acknowledged per lane
+    if (message.contains("broadcast_id")) {
+        sendBroadcastAck(message, QString());
+    }
+}
+
+void LaneLink::sendBroadcastAck(const QJsonObject &message, const QString &error)
+{
+    QJsonObject ack;
+    ack["type"] = "broadcast_ack";
+    ack["broadcast_id"] = message["broadcast_id"];
+    ack["lane_id"] = m_laneId;
+    ack["ok"] = error.isEmpty();
+    if (!error.isEmpty()) {
+        ack["error"] = error;
+    }
+    sendMessage(ack);
+}
+
+void LaneLink::handleRegistrationResponse(const QJsonObject &message)
+{
+    QString status = message["status"].toString();
+    
+    if (status == "success") {
+        m_registered = true;
+        setupHeartbeat();
+        qDebug() << "Successfully registered with server";
+        
+        // After a reboot the server's copy is the fastest way back into the game;
+        // after a reconnect ours is newer and replaces it
+        if (!m_restoreOffered) {
+            m_restoreOffered = true;
+            emit restoreStateReceived(message["mirror"].toObject());
+        }
+        if (!m_mirrorState.isEmpty()) {
+            sendMirrorSnapshot();
+        }
+        
+        // Older than anything queued while we were away, so they go first
+        if (!m_unackedBalls.isEmpty()) {
+            qDebug() << "Resending" << m_unackedBalls.size() << "unacknowledged balls";
+            QList<QJsonObject> unacked;
+            unacked.swap(m_unackedBalls);
+            for (const QJsonObject &ball : unacked) {
+                sendMessage(ball);
+            }
+        }
+        flushQueuedMessages();
+    } else {
+        qWarning() << "Registration failed:" << message["message"].toString();
+        // Try to reconnect
+        setConnectionState(ClientConnectionState::Reconnecting);
+        scheduleReconnect(RECONNECT_INTERVAL);
+    }
+}
+
+void LaneLink::publishGameState(int gameNumber, const QString &gameType, const QJsonObject &state)
+{
+    if (gameNumber != m_mirrorGameNumber || gameType != m_mirrorGameType) {
+        m_mirrorSynced = false;
+    }
+    
+    QJsonObject previous = m_mirrorState;
+    m_mirrorState = state;
+    m_mirrorGameNumber = gameNumber;
+    m_mirrorGameType = gameType;
+    
+    if (!m_registered) {
+        return;     // Sent as a snapshot once registered
+    }
+    
+    if (!m_mirrorSynced || previous.isEmpty()) {
+        sendMirrorSnapshot();
+        return;
+    }
+    
+    QJsonObject delta = GameMirror::makeDelta(previous, state);
+    if (delta.isEmpty()) {
+        return;
+    }
+    
+    delta["type"] = "mirror_update";
+    delta["seq"] = ++m_mirrorSeq;
+    sendMessage(delta);
+}
+
+void LaneLink::endGameState()
+{
+    if (m_mirrorState.isEmpty()) {
+        return;
+    }
+    
+    m_mirrorState = QJsonObject();
+    m_mirrorSynced = false;
+    
+    QJsonObject message;
+    message["type"] = "mirror_update";
+    message["seq"] = ++m_mirrorSeq;
+    message["game_active"] = false;
+    sendMessage(message);
+}
+
+void LaneLink::sendMirrorSnapshot()
+{
+    if (m_mirrorState.isEmpty() || !m_registered) {
+        return;
+    }
+    
+    QJsonObject message;
+    message["type"] = "mirror_update";
+    message["seq"] = ++m_mirrorSeq;
+    message["snapshot"] = true;
+    message["game_number"] = m_mirrorGameNumber;
+    message["game_type"] = m_mirrorGameType;
+    message["state"] = m_mirrorState;
+    sendMessage(message);
+    
+    m_mirrorSynced = true;
+}
+
+void LaneLink::completeCommand(const QJsonObject &message, const QString &error)
+{
+    qDebug() << "Command" << message["type"].toString()
+             << (error.isEmpty() ? QString("accepted") : "rejected: " + error);
+    
+    qint64 requestId = RpcChannel::requestIdOf(message);
+    if (requestId > 0) {
+        if (error.isEmpty()) {
+            QJsonObject result;
+            result["lane_id"] = m_laneId;
+            result["accepted"] = true;
+            m_rpc->respond(requestId, result);
+        } else {
+            m_rpc->respondError(requestId, error);
+        }
+    }
+    
+    if (message.contains("broadcast_id")) {
+        sendBroadcastAck(message, error);
+    }
+}
+
+void LaneLink::handleHeartbeatResponse(const QJsonObject &message)
+{
+    m_lastHeartbeat = QDateTime::currentDateTime();
+    // Heartbeat acknowledged - connection is healthy
+    
+    // Older servers do not echo the clock fields
+    if (!message.contains("t0_us") || !message.contains("t1_us")) {
+        return;
+    }
+    
+    qint64 t3 = ClockSync::monotonicUs();
+    bool wasSynced = m_clock.isSynced();
+    m_clock.addSample(static_cast<qint64>(message["t0_us"].toDouble()),
+                      static_cast<qint64>(message["t1_us"].toDouble()),
+                      static_cast<qint64>(message["t2_us"].toDouble()), t3);
+    
+    if (!wasSynced && m_clock.isSynced()) {
+        qDebug() << "Clock synced to server: offset" << m_clock.offsetUs() << "us, error"
+                 << m_clock.errorUs() << "us";
+    }
+    emit clockSampled(m_clock);
+}
+
+void LaneLink::handleTeamMove(const QJsonObject &message)
+{
+    qDebug() << "Received team move request";
+    emit serverMessageReceived(message);
+}
+
+void LaneLink::handleBallAck(const QJsonObject &message)
+{
+    // Acks come back in send order, so every ball up to this one has landed
+    for (int i = 0; i < m_unackedBalls.size(); ++i) {
+        const QJsonObject &ball = m_unackedBalls[i];
+        if (ball["game"] == message["game"] && ball["seq"] == message["seq"]) {
+            m_unackedBalls.erase(m_unackedBalls.begin(), m_unackedBalls.begin() + i + 1);
+            return;
+        }
+    }
+}
+
+void LaneLink::sendRegistration()
+{
+    QJsonObject registration;
+    registration["type"] = "registration";
+    registration["lane_id"] = m_laneId;
+    registration["client_ip"] = getLocalIpAddress();
+    registration["heartbeat_interval_ms"] = heartbeatInterval();
+    
+    sendMessage(registration);
+    qDebug() << "Sent registration for lane" << m_laneId;
+}
+
+void LaneLink::setupHeartbeat()
+{
+    m_lastHeartbeat = QDateTime::currentDateTime();
+    m_lastInboundUs = m_lastOutboundUs = m_lastHeartbeatUs = ClockSync::monotonicUs();
+    scheduleHeartbeat(heartbeatInterval());
+    
+    m_timers->cancel(m_serverTimeoutId);
+    m_serverTimeoutId = m_timers->arm(serverTimeout(), [this]() { onServerTimeout(); });
+}
+
+int LaneLink::heartbeatInterval() const
+{
+    // Quick exchanges first so the clock estimate settles within seconds
+    if (!m_clock.isSynced()) {
+        return CLOCK_SYNC_INTERVAL;
+    }
+    return m_gameActive ? ACTIVE_HEARTBEAT_INTERVAL : IDLE_HEARTBEAT_INTERVAL;
+}
+
+int LaneLink::serverTimeout() const
+{
+    return SERVER_TIMEOUT_BEATS * std::max(heartbeatInterval(), ACTIVE_HEARTBEAT_INTERVAL);
+}
+
+void LaneLink::setGameActive(bool active)
+{
+    if (m_gameActive == active) {
+        return;
+    }
+    m_gameActive = active;
+    
+    // The server sizes our liveness timeout from the interval we last told it
+    if (m_registered) {
+        beat();
+    }
+}
+
+void LaneLink::scheduleHeartbeat(int delayMs)
+{
+    delayMs = std::max(delayMs, TIMER_TICK);
+    if (!m_timers->reset(m_heartbeatTimerId, delayMs)) {
+        m_heartbeatTimerId = m_timers->arm(delayMs, [this]() { sendHeartbeat(); });
+    }
+}
+
+void LaneLink::scheduleReconnect(int delayMs)
+{
+    if (!m_timers->reset(m_reconnectTimerId, delayMs)) {
+        m_reconnectTimerId = m_timers->arm(delayMs, [this]() { attemptReconnection(); });
+    }
+}
+
+void LaneLink::onServerTimeout()
+{
+    // The socket can stay "connected" through a dead switch port; heartbeats
+    // without any reply mean the server is gone
+    qWarning() << "No traffic from server for" << serverTimeout() / 1000 << "seconds - reconnecting";
+    m_socket->abort();
+}
+
+void LaneLink::sendHeartbeat()
+{
+    if (!m_registered) {
+        return;
+    }
+    
+    // Due when the server has not heard from us for an interval, when we
+    // have not heard from it for two (its reply then lands well inside our
+    // timeout), or when the clock estimate wants a fresh sample
+    const qint64 now = ClockSync::monotonicUs();
+    const qint64 interval = heartbeatInterval() * 1000LL;
+    qint64 due = std::min(m_lastOutboundUs + interval, m_lastInboundUs + 2 * interval);
+    due = std::min(due, m_lastHeartbeatUs + CLOCK_REFRESH_INTERVAL * 1000LL);
+    
+    if (now < due) {
+        // Other traffic covered it - look again when it would next be due
+        scheduleHeartbeat(int((due - now) / 1000));
+        return;
+    }
+    
+    beat();
+}
+
+void LaneLink::beat()
+{
+    // Next check first, so an early return below does not stop the heartbeat
+    scheduleHeartbeat(heartbeatInterval());
+
+    if (!validateConnection()) {
+        qWarning() << "Connection validation failed during heartbeat";
+        return;
+    }
+    
+    QJsonObject heartbeat;
+    heartbeat["type"] = "heartbeat";
+    heartbeat["lane_id"] = m_laneId;
+    heartbeat["t0_us"] = ClockSync::monotonicUs();
+    heartbeat["heartbeat_interval_ms"] = heartbeatInterval();
+    
+    m_lastHeartbeatUs = ClockSync::monotonicUs();
+    sendMessage(heartbeat);
+}
+
+void LaneLink::sendMessage(const QJsonObject &event)
+{
+    // Event time is when it happened, not when it finally goes out
+    QJsonObject message = event;
+    if (!message.contains("lane_time_us")) {
+        message["lane_time_us"] = ClockSync::monotonicUs();
+    }
+    
+    // The server ignores everything but registration until we are registered
+    if (m_socket->state() != QAbstractSocket::ConnectedState ||
+        (!m_registered && message["type"].toString() != "registration")) {
+        if (isTransient(message)) {
+            qWarning() << "Cannot send message - not connected";
+            return;
+        }
+        
+        m_outbound.append(message);
+        if (m_outbound.size() > MAX_QUEUED_MESSAGES) {
+            m_outbound.removeFirst();
+            qWarning() << "Outbound queue full - oldest message dropped";
+        }
+        return;
+    }
+    
+    // Offset applied at send time, with the freshest estimate
+    m_clock.stamp(message);
+    
+    QJsonDocument doc(message);
+    QByteArray data = doc.toJson(QJsonDocument::Compact) + "\n";
+    
+    m_socket->write(data);
+    m_lastOutboundUs = ClockSync::monotonicUs();
+    
+    if (message["type"].toString() == "ball" && message.contains("seq")) {
+        m_unackedBalls.append(message);
+        if (m_unackedBalls.size() > MAX_QUEUED_MESSAGES) {
+            m_unackedBalls.removeFirst();
+        }
+    }
+}
+
+bool LaneLink::isTransient(const QJsonObject &message) const
+{
+    // Stale once the connection is gone, or rebuilt on reconnect (the mirror
+    // gets a fresh snapshot); a request would already have failed its caller
+    static const QStringList transientTypes = {
+        "registration", "heartbeat", "pong", "rpc_response", "broadcast_ack",
+        "lane_thumbnail", "mirror_update"
+    };
+    return transientTypes.contains(message["type"].toString()) || message.contains("request_id");
+}
+
+void LaneLink::flushQueuedMessages()
+{
+    if (m_outbound.isEmpty()) {
+        return;
+    }
+    
+    qDebug() << "Sending" << m_outbound.size() << "messages held while disconnected";
+    QList<QJsonObject> queued;
+    queued.swap(m_outbound);
+    for (const QJsonObject &message : queued) {
+        sendMessage(message);
+    }
+}
+
+void LaneLink::attemptReconnection()
+{
+    if (m_reconnectAttempts >= m_maxReconnectAttempts) {
+        qWarning() << "Max reconnection attempts reached, starting server discovery";
+        startServerDiscovery();
+        m_reconnectAttempts = 0;
+        return;
+    }
+    
+    m_reconnectAttempts++;
+    qDebug() << "Reconnection attempt" << m_reconnectAttempts << "of" << m_maxReconnectAttempts;
+    
+    connectToServer();
+}
+
+void LaneLink::startServerDiscovery()
+{
+    qDebug() << "Starting server discovery";
+
+    listenForAnnouncements();
+    if (m_discoverySocket->state() != QAbstractSocket::BoundState) {
+        return;
+    }
+    
+    // Send discovery request
+    QHostAddress multicastAddress("224.3.29.71");
+    QByteArray request = "LANE_DISCOVERY_REQUEST";
+    m_discoverySocket->writeDatagram(request, multicastAddress, 50005);
+}
+
+void LaneLink::listenForAnnouncements()
+{
+    if (m_discoverySocket->state() == QAbstractSocket::BoundState) {
+        return;
+    }
+    
+    // Bind to discovery port
+    if (!m_discoverySocket->bind(QHostAddress::AnyIPv4, 50005,
+                                 QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
+        qWarning() << "Failed to bind discovery socket";
+        return;
+    }
+    
+    // Join multicast group
+    if (!m_discoverySocket->joinMulticastGroup(QHostAddress("224.3.29.71"))) {
+        qWarning() << "Failed to join multicast group";
+    }
+}
+
+void LaneLink::handleServerAnnouncement(const QJsonObject &serverInfo)
+{
+    QString host = serverInfo["host"].toString();
+    quint16 port = serverInfo["port"].toInt();
+    quint32 epoch = static_cast<quint32>(serverInfo["epoch"].toDouble());
+    
+    // An older epoch is a primary that has since been replaced
+    if (host.isEmpty() || port == 0 || epoch < m_serverEpoch) {
+        return;
+    }
+    m_serverEpoch = epoch;
+    
+    if (host == m_serverHost && port == m_serverPort && m_registered) {
+        return;
+    }
+    
+    qDebug() << "Server takeover announced: epoch" << epoch << "at" << host << ":" << port;
+    switchServer(host, port);
+}
+
+void LaneLink::onServerDiscoveryResponse()
+{
+    while (m_discoverySocket->hasPendingDatagrams()) {
+        QByteArray datagram;
+        datagram.resize(m_discoverySocket->pendingDatagramSize());
+        QHostAddress sender;
+        quint16 senderPort;
+        
+        m_discoverySocket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+        
+        if (datagram.startsWith("LANE_SERVER_ANNOUNCE")) {
+            QJsonDocument doc = QJsonDocument::fromJson(datagram.mid(21)); // Skip "LANE_SERVER_ANNOUNCE "
+            if (doc.isObject()) {
+                handleServerAnnouncement(doc.object());
+            }
+        } else if (datagram.startsWith("LANE_DISCOVERY_RESPONSE")) {
+            // Extract server info
+            QByteArray jsonData = datagram.mid(24); // Skip "LANE_DISCOVERY_RESPONSE"
+            
+            QJsonParseError error;
+            QJsonDocument doc = QJsonDocument::fromJson(jsonData, &error);
+            
+            if (error.error == QJsonParseError::NoError && doc.isObject()) {
+                QJsonObject serverInfo = doc.object();
+                QString host = serverInfo["host"].toString();
+                int port = serverInfo["port"].toInt();
+                quint32 epoch = static_cast<quint32>(serverInfo["epoch"].toDouble());
+                
+                // A server older than one we have seen has been replaced
+                if (epoch < m_serverEpoch) {
+                    qDebug() << "Ignoring stale server at" << host << ":" << port
+                             << "epoch" << epoch << "(newest" << m_serverEpoch << ")";
+                    continue;
+                }
+                
+                if (!host.isEmpty() && port > 0) {
+                    m_serverEpoch = epoch;
+                    qDebug() << "Server discovered at" << host << ":" << port;
+                    setServerAddress(host, port);
+                    
+                    // Attempt connection; the socket stays open for takeover announcements
+                    connectToServer();
+                }
+            }
+        }
+    }
+}
+
+void LaneLink::setConnectionState(ClientConnectionState state)
+{
+    if (m_connectionState != state) {
+        m_connectionState = state;
+        emit connectionStateChanged(state);
+    }
+}
+
+QString LaneLink::getLocalIpAddress()
+{
+    // Get the first non-loopback IPv4 address
+    const QHostAddress &localhost = QHostAddress(QHostAddress::LocalHost);
+    for (const QHostAddress &address : QNetworkInterface::allAddresses()) {
+        if (address.protocol() == QAbstractSocket::IPv4Protocol && address != localhost) {
+            return address.toString();
+        }
+    }
+    return QHostAddress(QHostAddress::LocalHost).toString();
+}
+
+QFuture<RpcResult> LaneLink::call(const QString &method, const QJsonObject &data,
+                                    int timeoutMs, RpcChannel::Callback callback)
+{
+    return m_rpc->call(method, data, timeoutMs, std::move(callback));
+}
+
+bool LaneLink::validateConnection()
+{
+    if (!m_socket || m_socket->state() != QTcpSocket::ConnectedState) {
+        return false;
+    }
+    
+    // No probe message of its own: the heartbeat that follows is the probe,
+    // and TCP keepalive covers a silent link
+    return true;
+}
@@ -0,0 +1,189 @@
+﻿// LaneLink.h - The lane's connection to the server, run on LaneClient's I/O thread
+#ifndef LANELINK_H
+#define LANELINK_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QHostAddress>
+#include <QUdpSocket>
+#include <QNetworkInterface>
+#include <atomic>
+#include "TimingWheel.h"
+#include "RpcChannel.h"
+#include "ClockSync.h"
+#include "TcpKeepAlive.h"
+
+enum class ClientConnectionState {
+    Disconnected,
+    Connecting,
+    Connected,
+    Reconnecting
+};
+
+// Socket, discovery, heartbeat, RPC and the offline queue. Everything here
+// runs on the thread the link lives on and is driven only through
+// LaneClient, which owns that thread; isConnected() is the one call that is
+// safe from any thread.
+class LaneLink : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LaneLink(int laneId, QObject *parent = nullptr);
+    ~LaneLink();
+
+    void setServerAddress(const QString &host, quint16 port = 50005);
+
+    // Drop the current connection and register with another server now,
+    // e.g. a standby that announced it has taken over
+    void switchServer(const QString &host, quint16 port);
+    void start();
+    void stop();
+
+    bool isConnected() const;
+    int getLaneId() const { return m_laneId; }
+
+    // Offset to the server clock, refreshed by every heartbeat
+    const ClockSync &clock() const { return m_clock; }
+
+    // Heartbeats are more frequent during a game than in attract mode
+    void setGameActive(bool active);
+
+    // Request/response to the server; completes on reply, timeout or disconnect
+    QFuture<RpcResult> call(const QString &method, const QJsonObject &data,
+                            int timeoutMs = RpcChannel::DEFAULT_TIMEOUT_MS,
+                            RpcChannel::Callback callback = RpcChannel::Callback());
+
+    // Acknowledge a gameCommandReceived message once the lane has acted on
+    // it; an empty error accepts it
+    void completeCommand(const QJsonObject &message, const QString &error);
+
+    // Keep the server's mirror of this lane's game current (see GameMirror);
+    // only what changed since the last call goes on the wire
+    void publishGameState(int gameNumber, const QString &gameType, const QJsonObject &state);
+    void endGameState();
+
+signals:
+    void connected();
+    void disconnected();
+    void gameCommandReceived(const QJsonObject &message);
+    void serverMessageReceived(const QJsonObject &message);
+    void connectionStateChanged(ClientConnectionState state);
+    void clockSampled(const ClockSync &clock);
+
+    // First registration after start: the server's copy of the game this
+    // lane was running, or an empty object if it has none
+    void restoreStateReceived(const QJsonObject &mirror);
+
+public slots:
+    void connectToServer();
+    void sendMessage(const QJsonObject &message);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onReadyRead();
+    void onError(QAbstractSocket::SocketError error);
+    void sendHeartbeat();
+    void attemptReconnection();
+    void onServerDiscoveryResponse();
+
+private:
+    void setupHeartbeat();
+    void scheduleHeartbeat(int delayMs);
+    void beat();
+    int heartbeatInterval() const;
+    int serverTimeout() const;
+    void scheduleReconnect(int delayMs);
+    void onServerTimeout();
+    void processMessage(const QJsonObject &message);
+    void handleRegistrationResponse(const QJsonObject &message);
+    void handleHeartbeatResponse(const QJsonObject &message);
+    void handleTeamMove(const QJsonObject &message);
+    void handleBallAck(const QJsonObject &message);
+    void sendBroadcastAck(const QJsonObject &message, const QString &error);
+    void sendMirrorSnapshot();
+    void listenForAnnouncements();
+    void handleServerAnnouncement(const QJsonObject &serverInfo);
+    bool isTransient(const QJsonObject &message) const;
+    void flushQueuedMessages();
+
+    void setConnectionState(ClientConnectionState state);
+    void startServerDiscovery();
+    void sendRegistration();
+    QString getLocalIpAddress();
+    bool validateConnection();
+
+    // Connection management
+    int m_laneId;
+    QString m_serverHost;
+    quint16 m_serverPort;
+    QTcpSocket *m_socket;
+    std::atomic<ClientConnectionState> m_connectionState;
+
+    // Heartbeat, server liveness and reconnection share one timing wheel
+    TimingWheel *m_timers;
+    TimingWheel::TimerId m_heartbeatTimerId;
+    TimingWheel::TimerId m_serverTimeoutId;
+    TimingWheel::TimerId m_reconnectTimerId;
+
+    // Requests in both directions; game commands are acknowledged through it
+    RpcChannel *m_rpc;
+
+    // Last game state sent to the server's mirror; a delta is only valid
+    // on top of it, so a reconnect or resync starts over with a snapshot
+    QJsonObject m_mirrorState;
+    qint64 m_mirrorSeq;
+    int m_mirrorGameNumber;
+    QString m_mirrorGameType;
+    bool m_mirrorSynced;
+    bool m_restoreOffered;
+
+    // Game traffic sent while not registered waits here instead of being
+    // dropped, so balls bowled during a server failover still arrive
+    QList<QJsonObject> m_outbound;
+    quint32 m_serverEpoch;      // Highest server epoch seen
+
+    // Balls written to the socket but not yet acknowledged (ball_ack). A
+    // server that dies takes whatever was in flight with it, so these go
+    // again after the next registration; the server drops any it counted.
+    QList<QJsonObject> m_unackedBalls;
+
+    // Every outgoing message carries lane_time_us and, once synced, the
+    // matching server time (see ClockSync)
+    ClockSync m_clock;
+
+    QTimer *m_discoveryTimer;
+    QUdpSocket *m_discoverySocket;
+
+    std::atomic<bool> m_registered;
+    QDateTime m_lastHeartbeat;
+
+    // Liveness: any message proves its sender alive, so heartbeats only go
+    // out after silence (monotonic us, see ClockSync)
+    bool m_gameActive;
+    qint64 m_lastInboundUs;
+    qint64 m_lastOutboundUs;
+    qint64 m_lastHeartbeatUs;
+    TcpKeepAlive m_keepAlive;
+    int m_reconnectAttempts;
+    int m_maxReconnectAttempts;
+
+    // Constants
+    static constexpr int ACTIVE_HEARTBEAT_INTERVAL = 15000;  // Outbound silence during a game
+    static const int IDLE_HEARTBEAT_INTERVAL = 60000;    // Outbound silence in attract mode
+    static const int CLOCK_SYNC_INTERVAL = 1000;     // Heartbeat rate until the clock estimate settles
+    static const int CLOCK_REFRESH_INTERVAL = 300000;    // Fresh clock sample at least every 5 minutes
+    static const int RECONNECT_INTERVAL = 5000;      // 5 seconds
+    static const int SERVER_TIMEOUT_BEATS = 3;       // Inbound silence, in heartbeat intervals, before giving up
+    static constexpr int TIMER_TICK = 100;
+    static const int DISCOVERY_INTERVAL = 30000;     // 30 seconds
+    static const int MAX_RECONNECT_ATTEMPTS = 10;
+    static const int MAX_QUEUED_MESSAGES = 1000;
+};
+
+#endif // LANELINK_H
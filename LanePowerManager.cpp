@@ -0,0 +1,217 @@
+﻿#include "LanePowerManager.h"
+#include "BowlingWidgets.h"
+#include "MachineInterface.h"
+#include <QCoreApplication>
+#include <QEvent>
+#include <QFile>
+#include <chrono>
+
+static const char* CPU_GOVERNOR_PATH = "/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor";
+
+LanePowerManager::LanePowerManager(QObject* parent)
+    : QObject(parent)
+    , powerState(PowerState::Active)
+    , gameActive(false)
+    , enabled(true)
+    , idleTimer(new QTimer(this))
+    , idleTimeoutMs(120000)
+    , idleGovernor("powersave")
+    , activeGovernor("ondemand")
+    , governorWritable(true)
+{
+    idleTimer->setSingleShot(true);
+    connect(idleTimer, &QTimer::timeout, this, &LanePowerManager::onIdleTimeout);
+
+    // Touch or key input wakes the lane before the widget sees it
+    QCoreApplication::instance()->installEventFilter(this);
+}
+
+void LanePowerManager::loadSettings(const QJsonObject& settings) {
+    enabled = settings["Enabled"].toBool(true);
+    idleTimeoutMs = settings["IdleTimeoutSeconds"].toInt(idleTimeoutMs / 1000) * 1000;
+    idleGovernor = settings["IdleCpuGovernor"].toString(idleGovernor);
+    activeGovernor = settings["ActiveCpuGovernor"].toString(activeGovernor);
+
+    qDebug() << "Power manager:" << (enabled ? "enabled" : "disabled")
+             << "idle after" << idleTimeoutMs / 1000 << "s";
+
+    if (!enabled) {
+        idleTimer->stop();
+        wake("power management disabled");
+    } else if (!gameActive) {
+        idleTimer->start(idleTimeoutMs);
+    }
+}
+
+qint64 LanePowerManager::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LanePowerManager::manageTimer(QTimer* timer, int idleIntervalMs) {
+    if (!timer) return;
+
+    ManagedTimer managed;
+    managed.timer = timer;
+    managed.activeIntervalMs = timer->interval();
+    managed.idleIntervalMs = idleIntervalMs;
+    managed.wasActive = false;
+    managedTimers.append(managed);
+}
+
+void LanePowerManager::manageScrollText(ScrollTextWidget* widget) {
+    if (widget) {
+        scrollWidgets.append(widget);
+    }
+}
+
+void LanePowerManager::manageMachine(MachineInterface* machineInterface) {
+    machine = machineInterface;
+    if (machine) {
+        connect(machine, &MachineInterface::sensorActivity, this, &LanePowerManager::onSensorActivity);
+    }
+}
+
+void LanePowerManager::setGameActive(bool active) {
+    gameActive = active;
+
+    if (active) {
+        idleTimer->stop();
+        wake("game started");
+    } else if (enabled) {
+        idleTimer->start(idleTimeoutMs);
+    }
+}
+
+void LanePowerManager::noteActivity() {
+    if (powerState == PowerState::Idle) {
+        wake("activity");
+        return;
+    }
+
+    if (!gameActive && enabled) {
+        idleTimer->start(idleTimeoutMs);
+    }
+}
+
+void LanePowerManager::onIdleTimeout() {
+    if (!gameActive && enabled) {
+        enterIdle();
+    }
+}
+
+void LanePowerManager::onSensorActivity(qint64 edgeNs) {
+    wake("ball sensor", edgeNs);
+}
+
+bool LanePowerManager::eventFilter(QObject* watched, QEvent* event) {
+    switch (event->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::TouchBegin:
+    case QEvent::KeyPress:
+        noteActivity();
+        break;
+    default:
+        break;
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void LanePowerManager::enterIdle() {
+    if (powerState == PowerState::Idle) return;
+
+    qDebug() << "Lane entering low-power idle";
+    powerState = PowerState::Idle;
+
+    // Stop or coarsen the managed timers, remembering which were running
+    for (ManagedTimer& managed : managedTimers) {
+        if (!managed.timer) continue;
+
+        managed.wasActive = managed.timer->isActive();
+        managed.activeIntervalMs = managed.timer->interval();
+
+        if (managed.idleIntervalMs > 0) {
+            managed.timer->setInterval(managed.idleIntervalMs);
+        } else {
+            managed.timer->stop();
+        }
+    }
+
+    // Attract content repaints at a lower rate
+    for (const QPointer<ScrollTextWidget>& widget : scrollWidgets) {
+        if (widget) {
+            widget->setReducedFrameRate(true);
+        }
+    }
+
+    if (machine) {
+        machine->setLowPower(true);
+    }
+
+    setCpuGovernor(idleGovernor);
+    emit enteredIdle();
+}
+
+void LanePowerManager::wake(const QString& reason, qint64 triggerNs) {
+    if (!gameActive && enabled) {
+        idleTimer->start(idleTimeoutMs);
+    }
+
+    if (powerState == PowerState::Active) return;
+
+    if (triggerNs == 0) {
+        triggerNs = nowNs();
+    }
+
+    powerState = PowerState::Active;
+
+    // Governor first so the rest of the wake runs at full clock
+    setCpuGovernor(activeGovernor);
+
+    if (machine) {
+        machine->setLowPower(false);
+    }
+
+    for (ManagedTimer& managed : managedTimers) {
+        if (!managed.timer) continue;
+
+        managed.timer->setInterval(managed.activeIntervalMs);
+        if (managed.wasActive && !managed.timer->isActive()) {
+            managed.timer->start();
+        }
+    }
+
+    for (const QPointer<ScrollTextWidget>& widget : scrollWidgets) {
+        if (widget) {
+            widget->setReducedFrameRate(false);
+        }
+    }
+
+    // Ready once the event loop gets back to us
+    QTimer::singleShot(0, this, [this, reason, triggerNs]() {
+        qint64 latencyUs = (nowNs() - triggerNs) / 1000;
+        if (latencyUs > WAKE_LATENCY_BUDGET_US) {
+            qWarning() << "Lane wake from" << reason << "took" << latencyUs / 1000 << "ms (budget 100 ms)";
+        } else {
+            qDebug() << "Lane woke from" << reason << "in" << latencyUs << "us";
+        }
+        emit wokeUp(reason, latencyUs);
+    });
+}
+
+void LanePowerManager::setCpuGovernor(const QString& governor) {
+#ifdef ARM_TARGET
+    if (!governorWritable || governor.isEmpty()) return;
+
+    QFile file(CPU_GOVERNOR_PATH);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "CPU governor not writable, leaving frequency scaling alone";
+        governorWritable = false;
+        return;
+    }
+    file.write(governor.toLatin1());
+#else
+    Q_UNUSED(governor);
+    Q_UNUSED(CPU_GOVERNOR_PATH);
+#endif
+}
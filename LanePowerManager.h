@@ -0,0 +1,89 @@
+﻿// LanePowerManager.h - Low-power idle mode for lanes with no active game
+#ifndef LANEPOWERMANAGER_H
+#define LANEPOWERMANAGER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QPointer>
+#include <QVector>
+#include <QJsonObject>
+#include <QDebug>
+
+class ScrollTextWidget;
+class MachineInterface;
+
+class LanePowerManager : public QObject {
+    Q_OBJECT
+
+public:
+    enum class PowerState {
+        Active,     // Game running or recent activity
+        Idle        // Timers stopped/coarsened, CPU governor lowered
+    };
+
+    explicit LanePowerManager(QObject* parent = nullptr);
+
+    // Configuration from settings.json "PowerSettings"
+    void loadSettings(const QJsonObject& settings);
+
+    // Managed resources
+    void manageTimer(QTimer* timer, int idleIntervalMs = 0);  // 0 = stop while idle
+    void manageScrollText(ScrollTextWidget* widget);
+    void manageMachine(MachineInterface* machine);
+
+    // Game state - idle countdown only runs while no game is active
+    void setGameActive(bool active);
+
+    PowerState state() const { return powerState; }
+    bool isIdle() const { return powerState == PowerState::Idle; }
+
+    // Monotonic clock used for wake latency (same clock as the sensor edges)
+    static qint64 nowNs();
+
+public slots:
+    void wake(const QString& reason, qint64 triggerNs = 0);
+    void noteActivity();
+
+signals:
+    void enteredIdle();
+    void wokeUp(const QString& reason, qint64 latencyUs);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private slots:
+    void onIdleTimeout();
+    void onSensorActivity(qint64 edgeNs);
+
+private:
+    friend struct LanePowerManagerBench;
+
+    void enterIdle();
+    void setCpuGovernor(const QString& governor);
+
+    struct ManagedTimer {
+        QPointer<QTimer> timer;
+        int activeIntervalMs;
+        int idleIntervalMs;
+        bool wasActive;
+    };
+
+    PowerState powerState;
+    bool gameActive;
+    bool enabled;
+
+    QTimer* idleTimer;
+    int idleTimeoutMs;
+
+    QVector<ManagedTimer> managedTimers;
+    QVector<QPointer<ScrollTextWidget>> scrollWidgets;
+    QPointer<MachineInterface> machine;
+
+    QString idleGovernor;
+    QString activeGovernor;
+    bool governorWritable;
+
+    static const qint64 WAKE_LATENCY_BUDGET_US = 100000;  // 100 ms wake-to-ready
+};
+
+#endif // LANEPOWERMANAGER_H
@@ -0,0 +1,709 @@
+﻿#include "LaneServer.h"
+#include "EventLog.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QDebug>
+
+LaneServer::LaneServer(EventBus *eventBus, QObject *parent)
+    : QObject(parent)
+    , m_server(new QTcpServer(this))
+    , m_eventBus(eventBus)
+    , m_eventLog(eventBus ? new EventLog(eventBus, EventLog::defaultDirectory(), this) : nullptr)
+    , m_timers(new TimingWheel(100, this))
+    , m_broadcast(new BroadcastEngine(m_timers, this))
+    , m_mirror(new GameMirror(this))
+    , m_running(false)
+{
+    connect(m_server, &QTcpServer::newConnection, this, &LaneServer::onNewConnection);
+
+    // Commands from the front desk arrive on the bus, typed, on this thread
+    if (m_eventBus) {
+        m_eventBus->subscribe<LaneCommandEvent>(this, [this](const LaneCommandEvent &command) {
+            onLaneCommand(command);
+        });
+        m_eventBus->subscribe<LaneBroadcastEvent>(this, [this](const LaneBroadcastEvent &event) {
+            broadcast(event.target, event.command, event.data);
+        });
+        connect(m_broadcast, &BroadcastEngine::broadcastCompleted, this, [this](const BroadcastReport &report) {
+            m_eventBus->publish(report);
+        });
+    }
+}
+
+LaneServer::~LaneServer()
+{
+    stop();
+}
+
+void LaneServer::start(quint16 port)
+{
+    if (m_running) {
+        return;
+    }
+
+    if (!m_server->listen(QHostAddress::Any, port)) {
+        qCritical() << "Lane server failed to listen on port" << port << ":" << m_server->errorString();
+        return;
+    }
+
+    m_running = true;
+    qDebug() << "Lane server listening on port" << port;
+}
+
+void LaneServer::stop()
+{
+    if (!m_running) {
+        return;
+    }
+
+    m_running = false;
+    m_server->close();
+
+    const QList<QTcpSocket*> sockets = m_connections.keys();
+    for (QTcpSocket *socket : sockets) {
+        socket->disconnectFromHost();
+    }
+
+    qDebug() << "Lane server stopped";
+}
+
+void LaneServer::onNewConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket *socket = m_server->nextPendingConnection();
+
+        m_keepAlive.apply(socket);
+
+        LaneConnection connection;
+        connection.socket = socket;
+        connection.lastSeen = QDateTime::currentDateTime();
+        connection.livenessTimer = m_timers->arm(HEARTBEAT_TIMEOUT, [this, socket]() {
+            onConnectionTimeout(socket);
+        });
+        connection.rpc = new RpcChannel([this, socket](const QJsonObject &message) {
+            sendMessage(socket, message);
+        }, m_timers, socket);
+        for (auto it = m_requestHandlers.constBegin(); it != m_requestHandlers.constEnd(); ++it) {
+            installRequestHandler(socket, connection.rpc, it.key());
+        }
+        m_connections.insert(socket, connection);
+
+        connect(socket, &QTcpSocket::readyRead, this, &LaneServer::onClientDataReady);
+        connect(socket, &QTcpSocket::disconnected, this, &LaneServer::onClientDisconnected);
+
+        qDebug() << "Lane connection from" << socket->peerAddress().toString();
+    }
+}
+
+void LaneServer::onClientDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+
+    LaneConnection connection = m_connections.take(socket);
+    m_timers->cancel(connection.livenessTimer);
+    if (connection.rpc) {
+        connection.rpc->failAll(QString("Lane %1 disconnected").arg(connection.laneId));
+    }
+    if (connection.laneId >= 0 && m_laneToSocket.value(connection.laneId) == socket) {
+        m_laneToSocket.remove(connection.laneId);
+        m_broadcast->laneDisconnected(connection.laneId);
+        qDebug() << "Lane" << connection.laneId << "disconnected";
+
+        updateLaneStatus(connection.laneId, LaneStatus::Error);
+        if (m_eventBus) {
+            m_eventBus->publish(LaneConnectionEvent{connection.laneId, false});
+        }
+    }
+
+    socket->deleteLater();
+}
+
+void LaneServer::onClientDataReady()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+
+    while (socket->canReadLine()) {
+        QByteArray data = socket->readLine();
+
+        QJsonParseError error;
+        QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+
+        if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+            qWarning() << "Invalid message from" << socket->peerAddress().toString() << ":" << error.errorString();
+            continue;
+        }
+
+        processMessage(socket, doc.object());
+    }
+}
+
+LaneConnection *LaneServer::connectionFor(QTcpSocket *socket)
+{
+    auto it = m_connections.find(socket);
+    return it == m_connections.end() ? nullptr : &it.value();
+}
+
+void LaneServer::registerRequestHandler(const QString &method, RequestHandler handler)
+{
+    m_requestHandlers.insert(method, handler);
+    
+    // Lanes already connected get it too
+    for (auto it = m_connections.begin(); it != m_connections.end(); ++it) {
+        if (it->rpc) {
+            installRequestHandler(it.key(), it->rpc, method);
+        }
+    }
+}
+
+void LaneServer::installRequestHandler(QTcpSocket *socket, RpcChannel *rpc, const QString &method)
+{
+    rpc->registerHandler(method, [this, socket, rpc, method](qint64 requestId, const QJsonObject &data) {
+        LaneConnection *connection = connectionFor(socket);
+        if (!connection || connection->laneId < 0) {
+            rpc->respondError(requestId, "Lane not registered");
+            return;
+        }
+        
+        QString error;
+        QJsonObject result = m_requestHandlers.value(method)(connection->laneId, data, &error);
+        if (error.isEmpty()) {
+            rpc->respond(requestId, result);
+        } else {
+            rpc->respondError(requestId, error);
+        }
+    });
+}
+
+void LaneServer::processMessage(QTcpSocket *socket, const QJsonObject &message)
+{
+    const qint64 receivedUs = ClockSync::wallUs();
+
+    LaneConnection *connection = connectionFor(socket);
+    if (!connection) {
+        return;
+    }
+
+    connection->lastSeen = QDateTime::currentDateTime();
+    // Lanes heartbeat only after silence, at a rate that depends on whether
+    // a game is on; they tell us the rate so the timeout can follow it
+    if (message.contains("heartbeat_interval_ms")) {
+        int timeout = HEARTBEAT_TIMEOUT_BEATS * message["heartbeat_interval_ms"].toInt();
+        connection->livenessTimeoutMs = timeout > HEARTBEAT_TIMEOUT ? timeout : int(HEARTBEAT_TIMEOUT);
+    }
+    m_timers->reset(connection->livenessTimer, connection->livenessTimeoutMs);
+
+    if (connection->rpc->handleMessage(message)) {
+        return;
+    }
+
+    QString type = message["type"].toString();
+
+    if (type == "registration") {
+        handleRegistration(socket, message);
+        return;
+    }
+
+    if (connection->laneId < 0) {
+        qWarning() << "Message" << type << "from unregistered connection ignored";
+        return;
+    }
+
+    if (m_broadcast->handleAck(connection->laneId, message)) {
+        return;
+    }
+
+    if (type == "heartbeat") {
+        handleHeartbeat(socket, message, receivedUs);
+    } else if (type == "game_complete" || type == "frame_update" || type == "status_update") {
+        handleGameData(socket, message);
+    } else if (type == "mirror_update") {
+        handleMirrorUpdate(socket, message);
+        return;
+    } else if (type == "ball" && message.contains("seq")) {
+        // A ball resent after a reconnect must not be counted twice. Acked
+        // either way, once the standby has been sent it, so the lane can
+        // stop holding it
+        bool counted = acceptBall(connection->laneId, message);
+
+        QJsonObject ack;
+        ack["type"] = "ball_ack";
+        ack["game"] = message["game"];
+        ack["seq"] = message["seq"];
+        sendMessage(socket, ack);
+
+        if (!counted) {
+            return;
+        }
+    }
+
+    // Everything a lane sends is available to subscribers, including
+    // types this server does not interpret itself
+    if (m_eventBus && type != "ping" && type != "pong") {
+        qint64 eventTimeUs = message.contains("server_time_us")
+            ? static_cast<qint64>(message["server_time_us"].toDouble()) : receivedUs;
+        m_eventBus->publish(LaneMessageEvent{connection->laneId, type, message, eventTimeUs, receivedUs});
+    }
+
+    // A lane that sent this as a request gets a receipt
+    connection = connectionFor(socket);
+    qint64 requestId = RpcChannel::requestIdOf(message);
+    if (connection && requestId > 0) {
+        connection->rpc->respond(requestId);
+    }
+}
+
+void LaneServer::handleRegistration(QTcpSocket *socket, const QJsonObject &message)
+{
+    int laneId = message["lane_id"].toInt(-1);
+
+    QJsonObject response;
+    response["type"] = "registration_response";
+
+    if (laneId < 0) {
+        response["status"] = "error";
+        response["message"] = "Missing lane_id";
+        sendMessage(socket, response);
+        return;
+    }
+
+    // A lane that reconnects before its old socket timed out replaces it
+    QTcpSocket *previous = m_laneToSocket.value(laneId, nullptr);
+    if (previous && previous != socket) {
+        qDebug() << "Lane" << laneId << "re-registered, closing previous connection";
+        LaneConnection replaced = m_connections.take(previous);
+        m_timers->cancel(replaced.livenessTimer);
+        replaced.rpc->failAll("Lane re-registered");
+        previous->disconnect(this);
+        previous->abort();
+        previous->deleteLater();
+    }
+
+    m_connections[socket].laneId = laneId;
+    m_laneToSocket.insert(laneId, socket);
+
+    response["status"] = "success";
+    response["lane_id"] = laneId;
+
+    // A lane coming back from a reboot resumes from our copy of its game.
+    // Without one it starts its next game afresh, and its game numbers may
+    // start over too, so the last ball counted no longer applies.
+    QJsonObject mirror = m_mirror->restorePayload(laneId);
+    if (!mirror.isEmpty()) {
+        response["mirror"] = mirror;
+    } else if (m_lastBalls.remove(laneId) > 0) {
+        replicateBall(laneId);
+    }
+    sendMessage(socket, response);
+
+    qDebug() << "Lane" << laneId << "registered from" << message["client_ip"].toString();
+
+    QJsonObject info;
+    info["client_ip"] = message["client_ip"].toString();
+    info["registered"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    recordLane(laneId, info);
+    flushQueue(laneId);
+
+    updateLaneStatus(laneId, LaneStatus::Idle);
+    if (m_eventBus) {
+        m_eventBus->publish(LaneConnectionEvent{laneId, true});
+    }
+}
+
+void LaneServer::handleMirrorUpdate(QTcpSocket *socket, const QJsonObject &message)
+{
+    LaneConnection *connection = connectionFor(socket);
+    if (!connection) {
+        return;
+    }
+
+    if (m_mirror->apply(connection->laneId, message) == GameMirror::ApplyResult::NeedsResync) {
+        QJsonObject resync;
+        resync["type"] = "mirror_resync";
+        sendMessage(socket, resync);
+        return;
+    }
+
+    // The standby applies the same sequence of updates to its own mirror
+    QJsonObject event;
+    event["kind"] = "mirror";
+    event["lane_id"] = connection->laneId;
+    event["message"] = message;
+    emit replicationEvent(event);
+}
+
+void LaneServer::handleHeartbeat(QTcpSocket *socket, const QJsonObject &message, qint64 receivedUs)
+{
+    // Clock exchange for the lane's ClockSync: echo its t0, add our receive
+    // and send times
+    QJsonObject response;
+    response["type"] = "heartbeat_response";
+    if (message.contains("t0_us")) {
+        response["t0_us"] = message["t0_us"];
+        response["t1_us"] = receivedUs;
+    }
+    response["t2_us"] = ClockSync::wallUs();
+    sendMessage(socket, response);
+}
+
+void LaneServer::handleGameData(QTcpSocket *socket, const QJsonObject &message)
+{
+    LaneConnection *connection = connectionFor(socket);
+    if (!connection) {
+        return;
+    }
+
+    QString type = message["type"].toString();
+    int laneId = connection->laneId;
+
+    if (type == "status_update") {
+        QString status = message["status"].toString();
+        if (status == "maintenance") {
+            updateLaneStatus(laneId, LaneStatus::Maintenance);
+        } else if (status == "error") {
+            updateLaneStatus(laneId, LaneStatus::Error);
+        } else if (status == "game_active" || status == "active") {
+            updateLaneStatus(laneId, LaneStatus::Active);
+        } else {
+            updateLaneStatus(laneId, LaneStatus::Idle);
+        }
+        return;
+    }
+
+    connection->gameData = message["data"].toObject();
+    updateLaneStatus(laneId, type == "game_complete" ? LaneStatus::Idle : LaneStatus::Active);
+
+    emit gameDataReceived(laneId, connection->gameData);
+}
+
+void LaneServer::updateLaneStatus(int laneId, LaneStatus status)
+{
+    QTcpSocket *socket = m_laneToSocket.value(laneId, nullptr);
+    LaneConnection *connection = socket ? connectionFor(socket) : nullptr;
+
+    if (connection) {
+        if (connection->status == status) {
+            return;
+        }
+        connection->status = status;
+    }
+
+    QJsonObject info;
+    info["status"] = static_cast<int>(status);
+    recordLane(laneId, info);
+
+    emit laneStatusChanged(laneId, status);
+    if (m_eventBus) {
+        m_eventBus->publish(LaneStatusEvent{laneId, status});
+    }
+}
+
+void LaneServer::sendMessage(QTcpSocket *socket, const QJsonObject &message)
+{
+    if (!socket || socket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n");
+}
+
+void LaneServer::sendToLane(int laneId, const QString &command, const QJsonObject &data)
+{
+    QJsonObject message;
+    message["type"] = command;
+    message["data"] = data;
+    message["server_time_us"] = ClockSync::wallUs();
+
+    QTcpSocket *socket = m_laneToSocket.value(laneId, nullptr);
+    if (!socket) {
+        qWarning() << "Lane" << laneId << "is not connected - holding" << command << "until it registers";
+        queueForLane(laneId, message);
+        return;
+    }
+
+    sendMessage(socket, message);
+}
+
+void LaneServer::queueForLane(int laneId, const QJsonObject &message)
+{
+    QList<QJsonObject> &queue = m_outbound[laneId];
+    queue.append(message);
+    while (queue.size() > MAX_QUEUED_PER_LANE) {
+        queue.removeFirst();
+    }
+    replicateQueue(laneId);
+}
+
+void LaneServer::flushQueue(int laneId)
+{
+    QList<QJsonObject> queue = m_outbound.take(laneId);
+    if (queue.isEmpty()) {
+        return;
+    }
+
+    QTcpSocket *socket = m_laneToSocket.value(laneId, nullptr);
+    qDebug() << "Sending" << queue.size() << "held messages to lane" << laneId;
+    for (const QJsonObject &message : queue) {
+        sendMessage(socket, message);
+    }
+    replicateQueue(laneId);
+}
+
+void LaneServer::replicateQueue(int laneId)
+{
+    QJsonArray queue;
+    for (const QJsonObject &message : m_outbound.value(laneId)) {
+        queue.append(message);
+    }
+
+    QJsonObject event;
+    event["kind"] = "outbound";
+    event["lane_id"] = laneId;
+    event["queue"] = queue;
+    emit replicationEvent(event);
+}
+
+bool LaneServer::acceptBall(int laneId, const QJsonObject &message)
+{
+    int game = message["game"].toInt();
+    quint32 seq = quint32(message["seq"].toDouble());
+
+    BallMark &mark = m_lastBalls[laneId];
+    if (mark.game == game && seq <= mark.seq) {
+        qDebug() << "Lane" << laneId << "game" << game << "ball" << seq << "already received";
+        return false;
+    }
+
+    mark.game = game;
+    mark.seq = seq;
+    replicateBall(laneId);
+    return true;
+}
+
+void LaneServer::replicateBall(int laneId)
+{
+    // seq 0 clears the lane's mark on the standby
+    BallMark mark = m_lastBalls.value(laneId);
+
+    QJsonObject event;
+    event["kind"] = "ball";
+    event["lane_id"] = laneId;
+    event["game"] = mark.game;
+    event["seq"] = qint64(mark.seq);
+    emit replicationEvent(event);
+}
+
+void LaneServer::recordLane(int laneId, const QJsonObject &info)
+{
+    QJsonObject &entry = m_registry[laneId];
+    entry["lane_id"] = laneId;
+    for (auto it = info.constBegin(); it != info.constEnd(); ++it) {
+        entry[it.key()] = it.value();
+    }
+
+    QJsonObject event;
+    event["kind"] = "lane";
+    event["lane_id"] = laneId;
+    event["info"] = entry;
+    emit replicationEvent(event);
+}
+
+QJsonObject LaneServer::replicationSnapshot() const
+{
+    QJsonArray registry;
+    for (const QJsonObject &lane : m_registry) {
+        registry.append(lane);
+    }
+
+    QJsonObject outbound;
+    for (auto it = m_outbound.constBegin(); it != m_outbound.constEnd(); ++it) {
+        QJsonArray queue;
+        for (const QJsonObject &message : it.value()) {
+            queue.append(message);
+        }
+        outbound[QString::number(it.key())] = queue;
+    }
+
+    QJsonObject balls;
+    for (auto it = m_lastBalls.constBegin(); it != m_lastBalls.constEnd(); ++it) {
+        QJsonObject mark;
+        mark["game"] = it.value().game;
+        mark["seq"] = qint64(it.value().seq);
+        balls[QString::number(it.key())] = mark;
+    }
+
+    QJsonObject snapshot;
+    snapshot["kind"] = "snapshot";
+    snapshot["registry"] = registry;
+    snapshot["mirrors"] = m_mirror->toJson();
+    snapshot["outbound"] = outbound;
+    snapshot["balls"] = balls;
+    return snapshot;
+}
+
+void LaneServer::applyReplication(const QJsonObject &event)
+{
+    QString kind = event["kind"].toString();
+    int laneId = event["lane_id"].toInt(-1);
+
+    if (kind == "snapshot") {
+        m_registry.clear();
+        for (const QJsonValue &lane : event["registry"].toArray()) {
+            m_registry.insert(lane.toObject()["lane_id"].toInt(), lane.toObject());
+        }
+
+        m_mirror->loadJson(event["mirrors"].toObject());
+
+        m_outbound.clear();
+        QJsonObject outbound = event["outbound"].toObject();
+        for (auto it = outbound.constBegin(); it != outbound.constEnd(); ++it) {
+            QList<QJsonObject> &queue = m_outbound[it.key().toInt()];
+            for (const QJsonValue &message : it.value().toArray()) {
+                queue.append(message.toObject());
+            }
+        }
+
+        m_lastBalls.clear();
+        QJsonObject balls = event["balls"].toObject();
+        for (auto it = balls.constBegin(); it != balls.constEnd(); ++it) {
+            QJsonObject mark = it.value().toObject();
+            BallMark &entry = m_lastBalls[it.key().toInt()];
+            entry.game = mark["game"].toInt();
+            entry.seq = quint32(mark["seq"].toDouble());
+        }
+    } else if (kind == "lane") {
+        m_registry.insert(laneId, event["info"].toObject());
+    } else if (kind == "mirror") {
+        m_mirror->apply(laneId, event["message"].toObject());
+    } else if (kind == "ball") {
+        quint32 seq = quint32(event["seq"].toDouble());
+        if (seq == 0) {
+            m_lastBalls.remove(laneId);
+        } else {
+            m_lastBalls[laneId] = BallMark{event["game"].toInt(), seq};
+        }
+    } else if (kind == "outbound") {
+        QList<QJsonObject> queue;
+        for (const QJsonValue &message : event["queue"].toArray()) {
+            queue.append(message.toObject());
+        }
+        if (queue.isEmpty()) {
+            m_outbound.remove(laneId);
+        } else {
+            m_outbound.insert(laneId, queue);
+        }
+    }
+}
+
+QFuture<RpcResult> LaneServer::callLane(int laneId, const QString &command, const QJsonObject &data,
+                                        int timeoutMs, RpcChannel::Callback callback)
+{
+    QTcpSocket *socket = m_laneToSocket.value(laneId, nullptr);
+    LaneConnection *connection = socket ? connectionFor(socket) : nullptr;
+
+    if (!connection) {
+        RpcResult result;
+        result.error = QString("Lane %1 is not connected").arg(laneId);
+
+        QFutureInterface<RpcResult> future;
+        future.reportStarted();
+        future.reportResult(result);
+        future.reportFinished();
+        if (callback) {
+            callback(result);
+        }
+        return future.future();
+    }
+
+    return connection->rpc->call(command, data, timeoutMs, std::move(callback));
+}
+
+void LaneServer::callLanes(const QVector<int> &laneIds, const QString &command, const QJsonObject &data,
+                           int timeoutMs, BurstCallback done)
+{
+    if (laneIds.isEmpty()) {
+        if (done) {
+            done(QMap<int, RpcResult>());
+        }
+        return;
+    }
+
+    struct Burst {
+        QMap<int, RpcResult> results;
+        int remaining = 0;
+        QElapsedTimer clock;
+    };
+    auto burst = std::make_shared<Burst>();
+    burst->remaining = laneIds.size();
+    burst->clock.start();
+
+    // Every request is written before any reply is read
+    for (int laneId : laneIds) {
+        callLane(laneId, command, data, timeoutMs, [this, burst, laneId, command, done](const RpcResult &result) {
+            burst->results.insert(laneId, result);
+            if (--burst->remaining > 0) {
+                return;
+            }
+
+            int acknowledged = 0;
+            for (const RpcResult &laneResult : burst->results) {
+                if (laneResult.ok) acknowledged++;
+            }
+            qDebug() << command << "burst:" << acknowledged << "of" << burst->results.size()
+                     << "lanes acknowledged in" << burst->clock.elapsed() << "ms";
+
+            if (done) {
+                done(burst->results);
+            }
+        });
+    }
+}
+
+quint64 LaneServer::broadcast(const QString &target, const QString &command, const QJsonObject &data,
+                              int ackTimeoutMs, BroadcastEngine::Callback done)
+{
+    return m_broadcast->broadcast(m_laneToSocket, target, command, data, ackTimeoutMs, std::move(done));
+}
+
+void LaneServer::onLaneCommand(const LaneCommandEvent &command)
+{
+    qDebug() << "Lane command" << command.command << "for lane" << command.laneId;
+
+    int laneId = command.laneId;
+    QString name = command.command;
+    callLane(laneId, name, command.data, RpcChannel::DEFAULT_TIMEOUT_MS, [this, laneId, name](const RpcResult &result) {
+        if (m_eventBus) {
+            m_eventBus->publish(LaneCommandResultEvent{laneId, name, result});
+        }
+    });
+}
+
+void LaneServer::handleTeamMove(int fromLane, int toLane, const QString &teamData)
+{
+    QJsonObject data;
+    data["from_lane"] = fromLane;
+    data["to_lane"] = toLane;
+    data["team"] = teamData;
+
+    sendToLane(fromLane, "team_move", data);
+    sendToLane(toLane, "team_move", data);
+}
+
+void LaneServer::onConnectionTimeout(QTcpSocket *socket)
+{
+    // Fired by the wheel only when this connection's own deadline passes -
+    // no scan over every connection
+    if (!m_connections.contains(socket)) {
+        return;
+    }
+
+    qWarning() << "Lane" << m_connections.value(socket).laneId << "heartbeat timed out";
+    socket->abort();    // Emits disconnected -> onClientDisconnected
+}
@@ -9,6 +9,15 @@
 #include <QDateTime>
 #include <QMap>
 #include "EventBus.h"
+#include "TimingWheel.h"
+#include "RpcChannel.h"
+#include "BroadcastEngine.h"
+#include "GameMirror.h"
+#include "ClockSync.h"
+#include "TcpKeepAlive.h"
+#include <functional>
+
+class EventLog;
 
 enum class LaneStatus {
     Idle,
@@ -23,6 +32,58 @@ struct LaneConnection {
     QDateTime lastSeen;
     LaneStatus status = LaneStatus::Idle;
     QJsonObject gameData;
+    TimingWheel::TimerId livenessTimer = 0;
+    int livenessTimeoutMs = 30000;      // Three of the lane's announced heartbeat intervals
+    RpcChannel *rpc = nullptr;
+};
+
+// Events published on the EventBus - dashboards, statistics and storage
+// subscribe to these instead of to the server directly
+
+// Every message from a registered lane, as received. Times are server
+// clock microseconds; eventTimeUs is when it happened on the lane (the
+// lane's synced server_time_us), or receivedUs if the lane is not synced.
+// Ordering events across lanes uses eventTimeUs.
+struct LaneMessageEvent {
+    int laneId;
+    QString type;
+    QJsonObject message;
+    qint64 eventTimeUs = 0;
+    qint64 receivedUs = 0;
+
+    qint64 latencyUs() const { return receivedUs - eventTimeUs; }
+};
+
+struct LaneConnectionEvent {
+    int laneId;
+    bool connected;
+};
+
+struct LaneStatusEvent {
+    int laneId;
+    LaneStatus status;
+};
+
+// Published by the front desk to send a command to a lane
+struct LaneCommandEvent {
+    int laneId;
+    QString command;        // Message type on the wire, e.g. "quick_game"
+    QJsonObject data;
+};
+
+// Published by the front desk to send one command to a group of lanes;
+// the outcome is published as a BroadcastReport
+struct LaneBroadcastEvent {
+    QString target;         // "all", "pair:3", "league:<name>", ... (see BroadcastEngine)
+    QString command;
+    QJsonObject data;
+};
+
+// Acknowledgement (or failure/timeout) of a LaneCommandEvent
+struct LaneCommandResultEvent {
+    int laneId;
+    QString command;
+    RpcResult result;
 };
 
 class LaneServer : public QObject
@@ -34,35 +95,101 @@ public:
     ~LaneServer();
     void start(quint16 port = 50005);
     void stop();
+    bool isRunning() const { return m_running; }
     void handleTeamMove(int fromLane, int toLane, const QString &teamData);
+    
+    // Acknowledged command to one lane; requests to a lane are pipelined
+    QFuture<RpcResult> callLane(int laneId, const QString &command, const QJsonObject &data,
+                                int timeoutMs = RpcChannel::DEFAULT_TIMEOUT_MS,
+                                RpcChannel::Callback callback = RpcChannel::Callback());
+    
+    // Encode once and write to every targeted lane in one pass
+    quint64 broadcast(const QString &target, const QString &command, const QJsonObject &data,
+                      int ackTimeoutMs = BroadcastEngine::DEFAULT_ACK_TIMEOUT_MS,
+                      BroadcastEngine::Callback done = BroadcastEngine::Callback());
+    BroadcastEngine *broadcastEngine() const { return m_broadcast; }
+    
+    // Live copy of every lane's game, handed back to a lane when it re-registers
+    GameMirror *gameMirror() const { return m_mirror; }
+    
+    // Day log of lane events in EventLog::defaultDirectory(), read back by
+    // the End Day report; null without an event bus
+    EventLog *eventLog() const { return m_eventLog; }
+    
+    // Requests a lane makes of the server (see RpcChannel). The handler runs
+    // on the server thread; setting *error answers with respondError
+    using RequestHandler = std::function<QJsonObject(int laneId, const QJsonObject &data, QString *error)>;
+    void registerRequestHandler(const QString &method, RequestHandler handler);
+    
+    // The same command to many lanes in one burst; done() gets every lane's
+    // result once the last one has answered or timed out
+    using BurstCallback = std::function<void(const QMap<int, RpcResult> &results)>;
+    void callLanes(const QVector<int> &laneIds, const QString &command, const QJsonObject &data,
+                   int timeoutMs = RpcChannel::DEFAULT_TIMEOUT_MS, BurstCallback done = BurstCallback());
+    
+    // Hot standby (see ServerReplication): everything a standby needs to take
+    // over - lane registry, game mirrors and messages queued for lanes that
+    // are offline - as one snapshot, then as replicationEvent()s
+    QJsonObject replicationSnapshot() const;
+    void applyReplication(const QJsonObject &event);
+    QList<int> knownLanes() const { return m_registry.keys(); }
 
 signals:
     void laneStatusChanged(int laneId, LaneStatus status);
     void gameDataReceived(int laneId, const QJsonObject &gameData);
+    void replicationEvent(const QJsonObject &event);
 
 private slots:
     void onNewConnection();
     void onClientDisconnected();
     void onClientDataReady();
-    void checkConnections();
 
 private:
     void processMessage(QTcpSocket *socket, const QJsonObject &message);
     void handleRegistration(QTcpSocket *socket, const QJsonObject &message);
-    void handleHeartbeat(QTcpSocket *socket, const QJsonObject &message);
+    void handleHeartbeat(QTcpSocket *socket, const QJsonObject &message, qint64 receivedUs);
     void handleGameData(QTcpSocket *socket, const QJsonObject &message);
+    void handleMirrorUpdate(QTcpSocket *socket, const QJsonObject &message);
     void updateLaneStatus(int laneId, LaneStatus status);
     void sendToLane(int laneId, const QString &command, const QJsonObject &data);
-    void onLaneCommand(const QJsonObject &data);
+    void onLaneCommand(const LaneCommandEvent &command);
+    LaneConnection *connectionFor(QTcpSocket *socket);
+    void installRequestHandler(QTcpSocket *socket, RpcChannel *rpc, const QString &method);
+    void sendMessage(QTcpSocket *socket, const QJsonObject &message);
+    void onConnectionTimeout(QTcpSocket *socket);
+    void recordLane(int laneId, const QJsonObject &info);
+    void queueForLane(int laneId, const QJsonObject &message);
+    void flushQueue(int laneId);
+    void replicateQueue(int laneId);
+    bool acceptBall(int laneId, const QJsonObject &message);
+    void replicateBall(int laneId);
 
     QTcpServer *m_server;
     EventBus *m_eventBus;
-    QTimer *m_connectionTimer;
+    EventLog *m_eventLog;
+    TimingWheel *m_timers;
+    BroadcastEngine *m_broadcast;
+    GameMirror *m_mirror;
     QMap<QTcpSocket*, LaneConnection> m_connections;
     QMap<int, QTcpSocket*> m_laneToSocket;
+    TcpKeepAlive m_keepAlive;
+    QMap<int, QJsonObject> m_registry;              // Every lane seen, connected or not
+    QMap<int, QList<QJsonObject>> m_outbound;       // Held until the lane registers again
+    
+    // Last ball counted per lane, by game number and BallEvent::sequence
+    // (which restarts at 1 each game). Kept across reconnects and replicated,
+    // so a ball resent to this server or a promoted standby is dropped.
+    struct BallMark {
+        int game = 0;
+        quint32 seq = 0;
+    };
+    QMap<int, BallMark> m_lastBalls;
+    QMap<QString, RequestHandler> m_requestHandlers;
     bool m_running;
     
-    static const int HEARTBEAT_TIMEOUT = 30000; // 30 seconds
+    static const int HEARTBEAT_TIMEOUT = 30000; // 30 seconds, and never less
+    static const int HEARTBEAT_TIMEOUT_BEATS = 3;
+    static const int MAX_QUEUED_PER_LANE = 100;
 };
 
 #endif // LANESERVER_H
\ No newline at end of file
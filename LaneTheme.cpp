@@ -0,0 +1,206 @@
+﻿#include "LaneTheme.h"
+#include <QFrame>
+#include <QPainter>
+#include <QStyleOption>
+#include <QVariant>
+#include <QDebug>
+
+static const char* ROLE_PROPERTY = "laneThemeRole";
+
+LaneTheme& LaneTheme::instance() {
+    static LaneTheme theme;
+    return theme;
+}
+
+LaneTheme::LaneTheme() {
+    borders.resize(static_cast<int>(Role::RoleCount));
+
+    auto setBorder = [this](Role role, int width, const QColor& color = QColor()) {
+        borders[static_cast<int>(role)].width = width;
+        borders[static_cast<int>(role)].color = color;
+    };
+    setBorder(Role::StatusBar, 2);
+    setBorder(Role::CurrentPlayer, 3, Qt::red);
+    setBorder(Role::OtherPlayer, 1, QColor("lightblue"));
+    setBorder(Role::Winner, 3, QColor("#ffd700"));
+    setBorder(Role::BowlerName, 1, Qt::black);
+    setBorder(Role::BallCell, 1, Qt::gray);
+    setBorder(Role::FrameTotal, 1, Qt::black);
+
+    // Default scheme only until the GameColors settings are loaded
+    setGameSchemes({});
+}
+
+QPalette LaneTheme::makePalette(const QColor& window, const QColor& text) {
+    // Only the roles given are set; the rest resolve from the parent widget
+    QPalette palette;
+    if (window.isValid()) {
+        palette.setColor(QPalette::Window, window);
+    }
+    if (text.isValid()) {
+        palette.setColor(QPalette::WindowText, text);
+        palette.setColor(QPalette::Text, text);
+    }
+    return palette;
+}
+
+QPalette LaneTheme::makeButtonPalette(const QColor& button, const QColor& text) {
+    QPalette palette;
+    palette.setColor(QPalette::Button, button);
+    palette.setColor(QPalette::ButtonText, text);
+    palette.setColor(QPalette::Disabled, QPalette::Button, QColor("#666666"));
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, QColor("#999999"));
+    return palette;
+}
+
+QVector<QPalette> LaneTheme::buildScheme(const QColor& background, const QColor& foreground) const {
+    QVector<QPalette> scheme(static_cast<int>(Role::RoleCount));
+    auto set = [&scheme](Role role, const QPalette& palette) {
+        scheme[static_cast<int>(role)] = palette;
+    };
+
+    // Dark theme for the window and anything without a role of its own
+    QPalette window = makePalette(QColor("#2b2b2b"), Qt::white);
+    window.setColor(QPalette::Base, QColor("#3c3c3c"));
+    window.setColor(QPalette::Button, QColor("#4a4a4a"));
+    window.setColor(QPalette::ButtonText, Qt::white);
+    window.setColor(QPalette::Disabled, QPalette::Button, QColor("#666666"));
+    window.setColor(QPalette::Disabled, QPalette::ButtonText, QColor("#999999"));
+    window.setColor(QPalette::Disabled, QPalette::WindowText, QColor("#999999"));
+    set(Role::Window, window);
+
+    set(Role::GameArea, makePalette(background, foreground));
+    set(Role::StatusBar, makePalette(background, foreground));
+    set(Role::BottomBar, makePalette(Qt::black, Qt::white));
+    set(Role::Marquee, makePalette(Qt::black, Qt::yellow));
+    set(Role::LaneLabel, makePalette(Qt::black, Qt::white));
+    set(Role::LaneCall, makePalette(Qt::yellow, Qt::red));
+
+    set(Role::CurrentPlayer, makePalette(Qt::black, Qt::red));
+    set(Role::OtherPlayer, makePalette(Qt::black, QColor("lightblue")));
+    set(Role::Winner, makePalette(Qt::black, QColor("#ffd700")));
+    set(Role::BowlerName, QPalette());
+    set(Role::BallCell, QPalette());
+    set(Role::FrameTotal, makePalette(QColor("lightgray"), Qt::black));
+    set(Role::HandicapText, makePalette(QColor(), Qt::blue));
+    set(Role::ThreeSixNineText, makePalette(QColor(), Qt::green));
+
+    set(Role::ButtonCall, makeButtonPalette(QColor("orange"), Qt::black));
+    set(Role::ButtonCallActive, makeButtonPalette(Qt::red, Qt::white));
+    set(Role::ButtonHold, makeButtonPalette(Qt::blue, Qt::white));
+    set(Role::ButtonResume, makeButtonPalette(Qt::green, Qt::white));
+    set(Role::ButtonSkip, makeButtonPalette(QColor("orange"), Qt::black));
+    set(Role::ButtonReset, makeButtonPalette(QColor("darkred"), Qt::white));
+
+    return scheme;
+}
+
+void LaneTheme::setGameSchemes(const QVector<QPair<QColor, QColor>>& schemes) {
+    palettes.clear();
+    palettes.reserve(schemes.size() + 1);
+    palettes.append(buildScheme(QColor("#3c3c3c"), Qt::white));
+
+    for (const QPair<QColor, QColor>& scheme : schemes) {
+        if (!scheme.first.isValid() || !scheme.second.isValid()) {
+            qWarning() << "Invalid game colour scheme" << scheme.first << scheme.second << "- using default";
+            palettes.append(palettes.first());
+            continue;
+        }
+        palettes.append(buildScheme(scheme.first, scheme.second));
+    }
+
+    qDebug() << "Lane theme built for" << schemes.size() << "game colour schemes";
+}
+
+const QPalette& LaneTheme::palette(Role role, int scheme) const {
+    int index = scheme + 1;
+    if (index < 0 || index >= palettes.size()) {
+        index = 0;
+    }
+    return palettes[index][static_cast<int>(role)];
+}
+
+void LaneTheme::apply(QWidget* widget, Role role, int scheme) const {
+    if (!widget) return;
+
+    const int roleValue = static_cast<int>(role);
+    if (widget->property(ROLE_PROPERTY) != QVariant(roleValue)) {
+        widget->setProperty(ROLE_PROPERTY, roleValue);
+    }
+
+    // setPalette is a no-op when the palette is unchanged
+    const QPalette& rolePalette = palette(role, scheme);
+    widget->setPalette(rolePalette);
+    widget->setAutoFillBackground(rolePalette.isBrushSet(QPalette::Active, QPalette::Window));
+
+    if (QFrame* frame = qobject_cast<QFrame*>(widget)) {
+        const Border& border = borders[roleValue];
+        if (border.width > 0) {
+            frame->setFrameShape(QFrame::Box);
+            frame->setLineWidth(border.width);
+        } else {
+            frame->setFrameShape(QFrame::NoFrame);
+        }
+    }
+}
+
+bool LaneTheme::hasRole(const QWidget* widget) {
+    return widget && widget->property(ROLE_PROPERTY).isValid();
+}
+
+LaneTheme::Role LaneTheme::roleOf(const QWidget* widget) {
+    return static_cast<Role>(widget->property(ROLE_PROPERTY).toInt());
+}
+
+// LaneStyle implementation
+LaneStyle::LaneStyle(QStyle* baseStyle)
+    : QProxyStyle(baseStyle) {
+}
+
+void LaneStyle::drawBorder(QPainter* painter, const QRect& rect, int width, const QColor& color) {
+    painter->fillRect(QRect(rect.left(), rect.top(), rect.width(), width), color);
+    painter->fillRect(QRect(rect.left(), rect.bottom() - width + 1, rect.width(), width), color);
+    painter->fillRect(QRect(rect.left(), rect.top() + width, width, rect.height() - 2 * width), color);
+    painter->fillRect(QRect(rect.right() - width + 1, rect.top() + width, width, rect.height() - 2 * width), color);
+}
+
+void LaneStyle::drawPrimitive(PrimitiveElement element, const QStyleOption* option,
+                              QPainter* painter, const QWidget* widget) const {
+    if (LaneTheme::hasRole(widget)) {
+        if (element == PE_PanelButtonCommand) {
+            // Flat panel in the palette's button colour, darker while pressed
+            QColor fill = option->palette.color(QPalette::Button);
+            if (option->state & State_Sunken) {
+                fill = fill.darker(130);
+            }
+            painter->fillRect(option->rect, fill);
+
+            LaneTheme::Border border = LaneTheme::instance().border(LaneTheme::roleOf(widget));
+            if (border.width > 0) {
+                drawBorder(painter, option->rect, border.width,
+                           border.color.isValid() ? border.color : option->palette.color(QPalette::ButtonText));
+            }
+            return;
+        }
+
+        if (element == PE_FrameFocusRect) {
+            return;  // Touch screen - no focus rings on lane controls
+        }
+    }
+
+    QProxyStyle::drawPrimitive(element, option, painter, widget);
+}
+
+void LaneStyle::drawControl(ControlElement element, const QStyleOption* option,
+                            QPainter* painter, const QWidget* widget) const {
+    if (element == CE_ShapedFrame && LaneTheme::hasRole(widget)) {
+        LaneTheme::Border border = LaneTheme::instance().border(LaneTheme::roleOf(widget));
+        if (border.width > 0) {
+            drawBorder(painter, option->rect, border.width,
+                       border.color.isValid() ? border.color : option->palette.color(QPalette::WindowText));
+        }
+        return;
+    }
+
+    QProxyStyle::drawControl(element, option, painter, widget);
+}
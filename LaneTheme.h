@@ -0,0 +1,95 @@
+﻿// LaneTheme.h - Precomputed palettes and proxy style for the lane UI
+#ifndef LANETHEME_H
+#define LANETHEME_H
+
+#include <QProxyStyle>
+#include <QPalette>
+#include <QColor>
+#include <QVector>
+#include <QPair>
+#include <QWidget>
+
+// All lane UI colouring goes through QPalette instead of stylesheets.
+// Every (game colour scheme, role) palette is built once when the
+// GameColors settings are loaded, so restyling a widget is a lookup and
+// a palette assignment - no CSS parsing and no re-polish of the subtree.
+class LaneTheme {
+public:
+    enum class Role {
+        Window,             // Main window / dialogs (dark theme)
+        GameArea,           // Game interface background, follows the game colour scheme
+        StatusBar,          // GameStatusWidget, follows the game colour scheme
+        BottomBar,
+        Marquee,
+        LaneLabel,
+        LaneCall,           // Call flash "on" phase
+        CurrentPlayer,
+        OtherPlayer,
+        Winner,             // 3-6-9 winner
+        BowlerName,
+        BallCell,
+        FrameTotal,
+        HandicapText,
+        ThreeSixNineText,
+        ButtonCall,
+        ButtonCallActive,
+        ButtonHold,
+        ButtonResume,
+        ButtonSkip,
+        ButtonReset,
+        RoleCount
+    };
+
+    struct Border {
+        int width = 0;
+        QColor color;       // Invalid = use the palette's WindowText
+    };
+
+    static const int DEFAULT_SCHEME = -1;   // Dark theme, used before a game colour is chosen
+
+    static LaneTheme& instance();
+
+    // Rebuild all palettes for the GameColors schemes (background, foreground)
+    void setGameSchemes(const QVector<QPair<QColor, QColor>>& schemes);
+    int gameSchemeCount() const { return palettes.size() - 1; }
+
+    const QPalette& palette(Role role, int scheme = DEFAULT_SCHEME) const;
+    Border border(Role role) const { return borders[static_cast<int>(role)]; }
+
+    // Assign the role's palette, border and fill to a widget
+    void apply(QWidget* widget, Role role, int scheme = DEFAULT_SCHEME) const;
+
+    // Used by LaneStyle to find widgets it should draw
+    static bool hasRole(const QWidget* widget);
+    static Role roleOf(const QWidget* widget);
+
+private:
+    LaneTheme();
+
+    QVector<QPalette> buildScheme(const QColor& background, const QColor& foreground) const;
+    static QPalette makePalette(const QColor& window, const QColor& text);
+    static QPalette makeButtonPalette(const QColor& button, const QColor& text);
+
+    QVector<QVector<QPalette>> palettes;    // [scheme + 1][role]
+    QVector<Border> borders;                // [role]
+};
+
+// Draws frame borders and push button panels for widgets themed by
+// LaneTheme straight from their palette; everything else goes to the
+// base style.
+class LaneStyle : public QProxyStyle {
+    Q_OBJECT
+
+public:
+    explicit LaneStyle(QStyle* baseStyle = nullptr);
+
+    void drawPrimitive(PrimitiveElement element, const QStyleOption* option,
+                       QPainter* painter, const QWidget* widget = nullptr) const override;
+    void drawControl(ControlElement element, const QStyleOption* option,
+                     QPainter* painter, const QWidget* widget = nullptr) const override;
+
+private:
+    static void drawBorder(QPainter* painter, const QRect& rect, int width, const QColor& color);
+};
+
+#endif // LANETHEME_H
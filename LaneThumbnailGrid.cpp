@@ -0,0 +1,218 @@
+﻿#include "LaneThumbnailGrid.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QJsonArray>
+#include <QtMath>
+#include <QDebug>
+#include <algorithm>
+
+LaneThumbnailGrid::LaneThumbnailGrid(QWidget* parent)
+    : QWidget(parent)
+    , staleTimer(new QTimer(this))
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(320, 180);
+    clock.start();
+
+    connect(staleTimer, &QTimer::timeout, this, &LaneThumbnailGrid::checkStale);
+    staleTimer->start(STALE_MS / 3);
+}
+
+void LaneThumbnailGrid::setLanes(const QVector<int>& laneIds) {
+    laneOrder = laneIds;
+    std::sort(laneOrder.begin(), laneOrder.end());
+    for (int laneId : laneOrder) {
+        if (!lanes.contains(laneId)) {
+            lanes.insert(laneId, LaneView());
+        }
+    }
+    layoutCells();
+    update();
+}
+
+void LaneThumbnailGrid::removeLane(int laneId) {
+    lanes.remove(laneId);
+    laneOrder.removeAll(laneId);
+    layoutCells();
+    update();
+}
+
+void LaneThumbnailGrid::ensureLane(int laneId) {
+    if (lanes.contains(laneId)) return;
+
+    // A lane that registered after setLanes() still gets a cell
+    laneOrder.append(laneId);
+    std::sort(laneOrder.begin(), laneOrder.end());
+    lanes.insert(laneId, LaneView());
+    layoutCells();
+    update();
+}
+
+bool LaneThumbnailGrid::applyUpdate(const QJsonObject& message) {
+    int laneId = message["lane_id"].toInt(-1);
+    int width = message["width"].toInt();
+    int height = message["height"].toInt();
+    int tileSize = message["tile_size"].toInt();
+    quint32 sequence = static_cast<quint32>(message["sequence"].toDouble());
+    bool keyframe = message["keyframe"].toBool();
+
+    if (laneId < 0 || width <= 0 || height <= 0 || tileSize <= 0) {
+        qWarning() << "Malformed lane thumbnail from lane" << laneId;
+        return false;
+    }
+
+    ensureLane(laneId);
+    LaneView& view = lanes[laneId];
+
+    bool sizeChanged = view.image.size() != QSize(width, height);
+    if (sizeChanged) {
+        view.image = QImage(width, height, QImage::Format_RGB32);
+        view.image.fill(Qt::black);
+    }
+
+    // Deltas only make sense on top of the frame they were diffed against
+    if (!keyframe && (sizeChanged || sequence != view.lastSequence + 1)) {
+        qDebug() << "Lane" << laneId << "thumbnail gap at sequence" << sequence << "- requesting keyframe";
+        emit keyframeNeeded(laneId);
+    }
+
+    QRect changed;
+    {
+        QPainter painter(&view.image);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+        const QJsonArray tiles = message["tiles"].toArray();
+        for (const QJsonValue& value : tiles) {
+            QJsonObject tile = value.toObject();
+            QImage image = QImage::fromData(QByteArray::fromBase64(tile["data"].toString().toLatin1()), "PNG");
+            if (image.isNull()) continue;
+
+            QPoint origin(tile["x"].toInt() * tileSize, tile["y"].toInt() * tileSize);
+            painter.drawImage(origin, image);
+            changed |= QRect(origin, image.size());
+        }
+    }
+
+    view.lastSequence = sequence;
+    view.lastUpdateMs = clock.elapsed();
+
+    QRect cell = cellRect(laneId);
+    if (view.stale || sizeChanged) {
+        view.stale = false;
+        update(cell);
+    } else if (!changed.isEmpty()) {
+        // Map the changed tiles into the scaled cell image and repaint only that
+        QRect target = imageRect(cell, view.image.size());
+        qreal sx = qreal(target.width()) / view.image.width();
+        qreal sy = qreal(target.height()) / view.image.height();
+        QRect dirty(target.left() + qFloor(changed.left() * sx), target.top() + qFloor(changed.top() * sy),
+                    qCeil(changed.width() * sx) + 2, qCeil(changed.height() * sy) + 2);
+        update(dirty.intersected(cell));
+    }
+
+    return true;
+}
+
+void LaneThumbnailGrid::checkStale() {
+    qint64 now = clock.elapsed();
+    for (auto it = lanes.begin(); it != lanes.end(); ++it) {
+        LaneView& view = it.value();
+        bool stale = view.lastUpdateMs < 0 || now - view.lastUpdateMs > STALE_MS;
+        if (stale && !view.stale) {
+            view.stale = true;
+            update(cellRect(it.key()));
+        }
+    }
+}
+
+void LaneThumbnailGrid::layoutCells() {
+    cells.clear();
+    int count = laneOrder.size();
+    if (count == 0) return;
+
+    // Pick the column count that gives the largest 16:9 cells
+    int bestColumns = 1;
+    qreal bestScale = 0;
+    for (int columns = 1; columns <= count; ++columns) {
+        int rows = (count + columns - 1) / columns;
+        qreal cellWidth = qreal(width()) / columns;
+        qreal cellHeight = qreal(height()) / rows - LABEL_HEIGHT;
+        qreal scale = qMin(cellWidth / 16.0, cellHeight / 9.0);
+        if (scale > bestScale) {
+            bestScale = scale;
+            bestColumns = columns;
+        }
+    }
+
+    int rows = (count + bestColumns - 1) / bestColumns;
+    int cellWidth = width() / bestColumns;
+    int cellHeight = height() / rows;
+    for (int i = 0; i < count; ++i) {
+        cells.insert(laneOrder[i], QRect((i % bestColumns) * cellWidth, (i / bestColumns) * cellHeight,
+                                         cellWidth, cellHeight));
+    }
+}
+
+QRect LaneThumbnailGrid::cellRect(int laneId) const {
+    return cells.value(laneId);
+}
+
+QRect LaneThumbnailGrid::imageRect(const QRect& cell, const QSize& imageSize) const {
+    QRect area = cell.adjusted(CELL_MARGIN, LABEL_HEIGHT, -CELL_MARGIN, -CELL_MARGIN);
+    if (imageSize.isEmpty() || area.isEmpty()) return area;
+
+    QSize scaled = imageSize.scaled(area.size(), Qt::KeepAspectRatio);
+    return QRect(area.left() + (area.width() - scaled.width()) / 2,
+                 area.top() + (area.height() - scaled.height()) / 2,
+                 scaled.width(), scaled.height());
+}
+
+void LaneThumbnailGrid::paintEvent(QPaintEvent* event) {
+    QPainter painter(this);
+    painter.fillRect(event->rect(), palette().window());
+
+    QFont labelFont = font();
+    labelFont.setBold(true);
+    painter.setFont(labelFont);
+
+    for (auto it = cells.constBegin(); it != cells.constEnd(); ++it) {
+        const QRect& cell = it.value();
+        if (!event->region().intersects(cell)) continue;
+
+        const LaneView& view = lanes[it.key()];
+        QRect target = imageRect(cell, view.image.size());
+
+        if (view.image.isNull()) {
+            painter.fillRect(target, Qt::black);
+        } else {
+            // Fast scaling: small thumbnails, many lanes
+            painter.drawImage(target, view.image);
+        }
+
+        QRect label(cell.left() + CELL_MARGIN, cell.top(), cell.width() - 2 * CELL_MARGIN, LABEL_HEIGHT);
+        painter.setPen(view.stale ? Qt::gray : palette().windowText().color());
+        painter.drawText(label, Qt::AlignLeft | Qt::AlignVCenter,
+                         view.stale ? QString("Lane %1 (no signal)").arg(it.key())
+                                    : QString("Lane %1").arg(it.key()));
+
+        if (view.stale && !view.image.isNull()) {
+            painter.fillRect(target, QColor(0, 0, 0, 150));
+        }
+    }
+}
+
+void LaneThumbnailGrid::resizeEvent(QResizeEvent* event) {
+    QWidget::resizeEvent(event);
+    layoutCells();
+}
+
+void LaneThumbnailGrid::mousePressEvent(QMouseEvent* event) {
+    for (auto it = cells.constBegin(); it != cells.constEnd(); ++it) {
+        if (it.value().contains(event->pos())) {
+            emit laneSelected(it.key());
+            return;
+        }
+    }
+    QWidget::mousePressEvent(event);
+}
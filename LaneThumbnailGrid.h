@@ -0,0 +1,67 @@
+﻿// LaneThumbnailGrid.h - Front desk live grid of lane thumbnails
+#ifndef LANETHUMBNAILGRID_H
+#define LANETHUMBNAILGRID_H
+
+#include <QWidget>
+#include <QImage>
+#include <QMap>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+
+// Server side of LaneThumbnailer. Each lane keeps its own thumbnail image
+// that incoming tiles are decoded into, and only the screen area covered
+// by those tiles is repainted, so 40+ lanes cost little more than the
+// lanes that are actually changing. A gap in a lane's sequence numbers
+// emits keyframeNeeded() so the server can send "thumbnail_keyframe".
+class LaneThumbnailGrid : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit LaneThumbnailGrid(QWidget* parent = nullptr);
+
+    void setLanes(const QVector<int>& laneIds);
+    void removeLane(int laneId);
+
+    // Apply a "lane_thumbnail" message; returns false if it was malformed
+    bool applyUpdate(const QJsonObject& message);
+
+signals:
+    void keyframeNeeded(int laneId);
+    void laneSelected(int laneId);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+
+private slots:
+    void checkStale();
+
+private:
+    struct LaneView {
+        QImage image;
+        quint32 lastSequence = 0;
+        qint64 lastUpdateMs = -1;
+        bool stale = true;
+    };
+
+    void ensureLane(int laneId);
+    void layoutCells();
+    QRect cellRect(int laneId) const;
+    QRect imageRect(const QRect& cell, const QSize& imageSize) const;
+
+    QMap<int, LaneView> lanes;
+    QVector<int> laneOrder;
+    QMap<int, QRect> cells;
+
+    QTimer* staleTimer;
+    QElapsedTimer clock;
+
+    static const int LABEL_HEIGHT = 20;
+    static const int CELL_MARGIN = 4;
+    static const int STALE_MS = 15000;
+};
+
+#endif // LANETHUMBNAILGRID_H
@@ -0,0 +1,207 @@
+﻿#include "LaneThumbnailer.h"
+#include "LaneClient.h"
+#include <QPainter>
+#include <QBuffer>
+#include <QHash>
+#include <QDebug>
+
+LaneThumbnailer::LaneThumbnailer(QWidget* sourceWidget, LaneClient* laneClient, QObject* parent)
+    : QObject(parent)
+    , source(sourceWidget)
+    , client(laneClient)
+    , captureTimer(new QTimer(this))
+    , enabled(true)
+    , thumbnailSize(320, 180)
+    , tileSize(32)
+    , minIntervalMs(1000)
+    , maxIntervalMs(10000)
+    , cpuBudgetPercent(2.0)
+    , maxBytesPerSecond(8192)
+    , keyframeIntervalMs(60000)
+    , keyframePending(true)
+    , sequence(0)
+{
+    captureTimer->setSingleShot(true);
+    connect(captureTimer, &QTimer::timeout, this, &LaneThumbnailer::onCaptureTimer);
+
+    if (client) {
+        // Only stream while the server can receive it; a fresh connection gets a full frame
+        connect(client, &LaneClient::connected, this, [this]() {
+            requestKeyframe();
+            start();
+        });
+        connect(client, &LaneClient::disconnected, this, &LaneThumbnailer::stop);
+        connect(client, &LaneClient::serverMessageReceived, this, &LaneThumbnailer::onServerMessage);
+    }
+}
+
+void LaneThumbnailer::loadSettings(const QJsonObject& settings) {
+    enabled = settings["Enabled"].toBool(enabled);
+    thumbnailSize = QSize(settings["Width"].toInt(thumbnailSize.width()),
+                          settings["Height"].toInt(thumbnailSize.height()));
+    tileSize = qMax(8, settings["TileSize"].toInt(tileSize));
+    minIntervalMs = qMax(100, settings["MinIntervalMs"].toInt(minIntervalMs));
+    maxIntervalMs = qMax(minIntervalMs, settings["MaxIntervalMs"].toInt(maxIntervalMs));
+    cpuBudgetPercent = qMax(0.1, settings["CpuBudgetPercent"].toDouble(cpuBudgetPercent));
+    maxBytesPerSecond = qMax(256, settings["MaxBytesPerSecond"].toInt(maxBytesPerSecond));
+    keyframeIntervalMs = settings["KeyframeIntervalSeconds"].toInt(keyframeIntervalMs / 1000) * 1000;
+
+    tileHashes.clear();
+    keyframePending = true;
+
+    qDebug() << "Lane thumbnail:" << (enabled ? "enabled" : "disabled") << thumbnailSize
+             << "tiles" << tileSize << "budget" << cpuBudgetPercent << "% CPU,"
+             << maxBytesPerSecond << "B/s";
+
+    if (!enabled) {
+        stop();
+    } else if (client && client->isConnected()) {
+        start();
+    }
+}
+
+void LaneThumbnailer::start() {
+    if (!enabled || captureTimer->isActive()) return;
+
+    currentStats.intervalMs = minIntervalMs;
+    captureTimer->start(minIntervalMs);
+}
+
+void LaneThumbnailer::stop() {
+    captureTimer->stop();
+}
+
+void LaneThumbnailer::requestKeyframe() {
+    keyframePending = true;
+}
+
+void LaneThumbnailer::onServerMessage(const QJsonObject& message) {
+    if (message["type"].toString() == "thumbnail_keyframe") {
+        qDebug() << "Server requested a thumbnail keyframe";
+        requestKeyframe();
+        if (enabled) {
+            captureTimer->start(0);
+        }
+    }
+}
+
+QImage LaneThumbnailer::captureFrame() const {
+    QImage frame(thumbnailSize, QImage::Format_RGB32);
+    frame.fill(Qt::black);
+
+    if (!source || source->width() <= 0 || source->height() <= 0) {
+        return frame;
+    }
+
+    // Render straight into the small image - no full-size grab first
+    QPainter painter(&frame);
+    painter.scale(qreal(thumbnailSize.width()) / source->width(),
+                  qreal(thumbnailSize.height()) / source->height());
+    source->render(&painter, QPoint(), QRegion(), QWidget::DrawWindowBackground | QWidget::DrawChildren);
+    return frame;
+}
+
+QJsonArray LaneThumbnailer::encodeChangedTiles(const QImage& frame, bool keyframe, int* bytes) {
+    const int columns = (frame.width() + tileSize - 1) / tileSize;
+    const int rows = (frame.height() + tileSize - 1) / tileSize;
+
+    if (tileHashes.size() != columns * rows) {
+        tileHashes = QVector<uint>(columns * rows, 0);
+        keyframe = true;
+    }
+
+    QJsonArray tiles;
+    *bytes = 0;
+
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            const QRect tileRect = QRect(column * tileSize, row * tileSize, tileSize, tileSize)
+                                       .intersected(frame.rect());
+
+            // Hash the tile's scanlines; RGB32 is 4 bytes per pixel
+            uint hash = 0;
+            for (int y = tileRect.top(); y <= tileRect.bottom(); ++y) {
+                const uchar* line = frame.constScanLine(y) + tileRect.left() * 4;
+                hash = qHashBits(line, tileRect.width() * 4, hash);
+            }
+
+            uint& previous = tileHashes[row * columns + column];
+            if (!keyframe && hash == previous) continue;
+            previous = hash;
+
+            QByteArray png;
+            QBuffer buffer(&png);
+            buffer.open(QIODevice::WriteOnly);
+            frame.copy(tileRect).save(&buffer, "PNG");
+
+            QJsonObject tile;
+            tile["x"] = column;
+            tile["y"] = row;
+            tile["data"] = QString::fromLatin1(png.toBase64());
+            tiles.append(tile);
+            *bytes += png.size();
+        }
+    }
+
+    return tiles;
+}
+
+void LaneThumbnailer::onCaptureTimer() {
+    if (!enabled || !client || !client->isConnected()) return;
+
+    QElapsedTimer cost;
+    cost.start();
+
+    bool keyframe = keyframePending ||
+                    (keyframeIntervalMs > 0 && (!sinceKeyframe.isValid() || sinceKeyframe.elapsed() >= keyframeIntervalMs));
+
+    QImage frame = captureFrame();
+    int bytes = 0;
+    QJsonArray tiles = encodeChangedTiles(frame, keyframe, &bytes);
+
+    if (!tiles.isEmpty()) {
+        QJsonObject message;
+        message["type"] = "lane_thumbnail";
+        message["lane_id"] = client->getLaneId();
+        message["sequence"] = static_cast<qint64>(++sequence);
+        message["width"] = frame.width();
+        message["height"] = frame.height();
+        message["tile_size"] = tileSize;
+        message["keyframe"] = keyframe;
+        message["tiles"] = tiles;
+        client->sendMessage(message);
+
+        if (keyframe) {
+            keyframePending = false;
+            sinceKeyframe.restart();
+        }
+        emit thumbnailSent(tiles.size(), bytes);
+    }
+
+    currentStats.lastTiles = tiles.size();
+    currentStats.lastBytes = bytes;
+    adaptInterval(!tiles.isEmpty(), cost.nsecsElapsed() / 1000, bytes);
+
+    captureTimer->start(currentStats.intervalMs);
+}
+
+void LaneThumbnailer::adaptInterval(bool changed, qint64 costUs, int bytes) {
+    int interval = currentStats.intervalMs > 0 ? currentStats.intervalMs : minIntervalMs;
+
+    // Follow activity: faster while the screen changes, back off while static
+    interval = changed ? qMax(minIntervalMs, interval / 2) : qMin(maxIntervalMs, interval * 2);
+
+    // Hard limits win over the activity heuristic
+    int cpuFloorMs = static_cast<int>(costUs / (cpuBudgetPercent * 10.0));
+    int bandwidthFloorMs = static_cast<int>(qint64(bytes) * 1000 / maxBytesPerSecond);
+    interval = qMax(interval, qMax(cpuFloorMs, bandwidthFloorMs));
+
+    if (cpuFloorMs > maxIntervalMs) {
+        qWarning() << "Lane thumbnail capture took" << costUs << "us - over the"
+                   << cpuBudgetPercent << "% CPU budget even at the slowest rate";
+    }
+
+    currentStats.lastCostUs = costUs;
+    currentStats.intervalMs = interval;
+    currentStats.cpuPercent = costUs / (interval * 10.0);
+}
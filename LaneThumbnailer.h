@@ -0,0 +1,86 @@
+﻿// LaneThumbnailer.h - Stream a small live view of the lane screen to the front desk
+#ifndef LANETHUMBNAILER_H
+#define LANETHUMBNAILER_H
+
+#include <QObject>
+#include <QWidget>
+#include <QPointer>
+#include <QTimer>
+#include <QImage>
+#include <QVector>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QElapsedTimer>
+
+class LaneClient;
+
+// Periodically renders the lane UI offscreen into a small image, compares
+// it tile by tile with the previous capture and sends only the changed
+// tiles (PNG, base64) to the server as a "lane_thumbnail" message:
+//
+//   { "type": "lane_thumbnail", "lane_id": 3, "sequence": 41,
+//     "width": 320, "height": 180, "tile_size": 32, "keyframe": false,
+//     "tiles": [ { "x": 2, "y": 1, "data": "<base64 png>" }, ... ] }
+//
+// The capture interval adapts: it shortens while the screen is changing,
+// backs off while it is static, and never drops below what keeps the
+// measured capture cost under CpuBudgetPercent or the payload under
+// MaxBytesPerSecond. The server can ask for a full frame by sending
+// { "type": "thumbnail_keyframe" }.
+class LaneThumbnailer : public QObject {
+    Q_OBJECT
+
+public:
+    LaneThumbnailer(QWidget* source, LaneClient* client, QObject* parent = nullptr);
+
+    // Configuration from settings.json "Thumbnail"
+    void loadSettings(const QJsonObject& settings);
+
+    void start();
+    void stop();
+    void requestKeyframe();
+
+    // Offscreen render of the source widget at thumbnail size
+    QImage captureFrame() const;
+
+    struct Stats {
+        qint64 lastCostUs = 0;      // Capture + diff + encode, on the GUI thread
+        double cpuPercent = 0.0;    // lastCostUs relative to the current interval
+        int lastTiles = 0;
+        int lastBytes = 0;
+        int intervalMs = 0;
+    };
+    Stats stats() const { return currentStats; }
+
+signals:
+    void thumbnailSent(int tiles, int bytes);
+
+private slots:
+    void onCaptureTimer();
+    void onServerMessage(const QJsonObject& message);
+
+private:
+    QJsonArray encodeChangedTiles(const QImage& frame, bool keyframe, int* bytes);
+    void adaptInterval(bool changed, qint64 costUs, int bytes);
+
+    QPointer<QWidget> source;
+    LaneClient* client;
+    QTimer* captureTimer;
+
+    bool enabled;
+    QSize thumbnailSize;
+    int tileSize;
+    int minIntervalMs;
+    int maxIntervalMs;
+    double cpuBudgetPercent;
+    int maxBytesPerSecond;
+    int keyframeIntervalMs;
+
+    QVector<uint> tileHashes;       // Per tile, from the last capture sent
+    QElapsedTimer sinceKeyframe;
+    bool keyframePending;
+    quint32 sequence;
+    Stats currentStats;
+};
+
+#endif // LANETHUMBNAILER_H
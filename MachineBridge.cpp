@@ -0,0 +1,441 @@
+﻿#include "MachineBridge.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QCoreApplication>
+#include <cstring>
+#include <new>
+#include <cerrno>
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define SHM_TRANSPORT_AVAILABLE
+#endif
+
+static const char* PIN_NAMES[5] = {"lTwo", "lThree", "cFive", "rThree", "rTwo"};
+
+MachineBridge::MachineBridge(QObject* parent)
+    : QObject(parent)
+    , currentTransport(Transport::Stdio)
+    , process(nullptr)
+    , shmFd(-1)
+    , shared(nullptr)
+    , hostEventFd(-1)
+    , bridgeEventFd(-1)
+    , hostNotifier(nullptr)
+    , commandSequence(0)
+{
+    latencyClock.start();
+}
+
+MachineBridge::~MachineBridge() {
+    stop();
+}
+
+bool MachineBridge::start(Transport transport, const QString& scriptPath, const QString& pythonPath) {
+    if (isRunning()) {
+        qWarning() << "Machine bridge already running";
+        return true;
+    }
+
+    currentTransport = transport;
+    QStringList arguments;
+    arguments << scriptPath;
+
+    if (transport == Transport::SharedMemory) {
+        if (!openSharedMemory()) {
+            qWarning() << "Shared memory transport unavailable - falling back to stdio";
+            currentTransport = Transport::Stdio;
+        } else {
+            arguments << "--shm" << shmName
+                      << "--event-fd" << QString::number(hostEventFd)
+                      << "--command-fd" << QString::number(bridgeEventFd);
+        }
+    }
+
+    process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    connect(process, &QProcess::readyReadStandardOutput, this, &MachineBridge::onProcessOutput);
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &MachineBridge::onProcessFinished);
+
+    // The eventfds are created without CLOEXEC so the child inherits them
+    process->start(pythonPath, arguments);
+    if (!process->waitForStarted(3000)) {
+        QString error = QString("Failed to start machine bridge: %1").arg(process->errorString());
+        qCritical() << error;
+        process->deleteLater();
+        process = nullptr;
+        closeSharedMemory();
+        emit bridgeError(error);
+        return false;
+    }
+
+    qDebug() << "Machine bridge started with"
+             << (currentTransport == Transport::SharedMemory ? "shared memory" : "stdio") << "transport";
+    return true;
+}
+
+void MachineBridge::stop() {
+    if (process) {
+        process->disconnect(this);
+        if (process->state() != QProcess::NotRunning) {
+            process->terminate();
+            if (!process->waitForFinished(2000)) {
+                process->kill();
+                process->waitForFinished(1000);
+            }
+        }
+        process->deleteLater();
+        process = nullptr;
+    }
+
+    closeSharedMemory();
+    pendingPings.clear();
+}
+
+bool MachineBridge::isRunning() const {
+    return process && process->state() == QProcess::Running;
+}
+
+void MachineBridge::sendCommand(BridgeCommand command, int arg) {
+    dispatchCommand(command, arg, QVector<int>());
+}
+
+void MachineBridge::sendPinCommand(BridgeCommand command, const QVector<int>& pinStates) {
+    dispatchCommand(command, 0, pinStates);
+}
+
+void MachineBridge::dispatchCommand(BridgeCommand command, int arg, const QVector<int>& pinStates) {
+    if (!isRunning()) {
+        qWarning() << "Machine bridge not running - dropping command" << static_cast<uint32_t>(command);
+        return;
+    }
+
+    if (currentTransport == Transport::SharedMemory) {
+        BridgeRecord record;
+        memset(&record, 0, sizeof(record));
+        record.type = static_cast<uint32_t>(command);
+        record.sequence = ++commandSequence;
+        for (int i = 0; i < 5; ++i) {
+            record.pins[i] = (i < pinStates.size()) ? pinStates[i] : 1;
+        }
+        record.arg = arg;
+        record.timestamp = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+        pushCommand(record);
+    } else {
+        writeJsonCommand(command, arg, pinStates);
+    }
+}
+
+void MachineBridge::ping() {
+    if (!isRunning()) {
+        return;
+    }
+
+    // A pong that never came would otherwise stay pending for good
+    qint64 nowUs = latencyClock.nsecsElapsed() / 1000;
+    for (auto it = pendingPings.begin(); it != pendingPings.end();) {
+        if (nowUs - it.value() > PING_TIMEOUT_US) {
+            it = pendingPings.erase(it);
+            latency.lost++;
+        } else {
+            ++it;
+        }
+    }
+
+    int sequence = static_cast<int>(commandSequence + 1);
+    pendingPings[sequence] = nowUs;
+
+    if (currentTransport == Transport::SharedMemory) {
+        BridgeRecord record;
+        memset(&record, 0, sizeof(record));
+        record.type = static_cast<uint32_t>(BridgeCommand::Ping);
+        record.sequence = ++commandSequence;
+        record.arg = sequence;
+        record.timestamp = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+        pushCommand(record);
+    } else {
+        ++commandSequence;
+        writeJsonCommand(BridgeCommand::Ping, sequence, QVector<int>());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Shared memory transport
+// ---------------------------------------------------------------------------
+
+bool MachineBridge::openSharedMemory() {
+#ifdef SHM_TRANSPORT_AVAILABLE
+    shmName = QString("/bowling_lane_bridge_%1").arg(QCoreApplication::applicationPid());
+    QByteArray name = shmName.toLocal8Bit();
+
+    shm_unlink(name.constData());
+    shmFd = shm_open(name.constData(), O_CREAT | O_RDWR, 0600);
+    if (shmFd < 0) {
+        qWarning() << "shm_open failed:" << strerror(errno);
+        return false;
+    }
+
+    if (ftruncate(shmFd, sizeof(BridgeSharedLayout)) != 0) {
+        qWarning() << "ftruncate failed:" << strerror(errno);
+        closeSharedMemory();
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, sizeof(BridgeSharedLayout), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    if (mapped == MAP_FAILED) {
+        qWarning() << "mmap failed:" << strerror(errno);
+        closeSharedMemory();
+        return false;
+    }
+
+    shared = new (mapped) BridgeSharedLayout;
+    memset(static_cast<void*>(shared), 0, sizeof(BridgeSharedLayout));
+    shared->magic = BRIDGE_SHM_MAGIC;
+    shared->version = BRIDGE_SHM_VERSION;
+    shared->capacity = BRIDGE_RING_CAPACITY;
+    shared->recordSize = sizeof(BridgeRecord);
+
+    hostEventFd = eventfd(0, EFD_NONBLOCK);
+    bridgeEventFd = eventfd(0, EFD_NONBLOCK);
+    if (hostEventFd < 0 || bridgeEventFd < 0) {
+        qWarning() << "eventfd failed:" << strerror(errno);
+        closeSharedMemory();
+        return false;
+    }
+
+    hostNotifier = new QSocketNotifier(hostEventFd, QSocketNotifier::Read, this);
+    connect(hostNotifier, SIGNAL(activated(int)), this, SLOT(onHostEventReady()));
+
+    qDebug() << "Machine bridge shared memory ready:" << shmName << sizeof(BridgeSharedLayout) << "bytes";
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MachineBridge::closeSharedMemory() {
+#ifdef SHM_TRANSPORT_AVAILABLE
+    if (hostNotifier) {
+        hostNotifier->setEnabled(false);
+        hostNotifier->deleteLater();
+        hostNotifier = nullptr;
+    }
+    if (hostEventFd >= 0) {
+        ::close(hostEventFd);
+        hostEventFd = -1;
+    }
+    if (bridgeEventFd >= 0) {
+        ::close(bridgeEventFd);
+        bridgeEventFd = -1;
+    }
+    if (shared) {
+        munmap(shared, sizeof(BridgeSharedLayout));
+        shared = nullptr;
+    }
+    if (shmFd >= 0) {
+        ::close(shmFd);
+        shmFd = -1;
+        shm_unlink(shmName.toLocal8Bit().constData());
+    }
+#endif
+}
+
+bool MachineBridge::pushCommand(const BridgeRecord& record) {
+#ifdef SHM_TRANSPORT_AVAILABLE
+    if (!shared) {
+        return false;
+    }
+
+    BridgeRingIndex& ring = shared->toBridge;
+    uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+    uint32_t head = ring.head.load(std::memory_order_acquire);
+
+    if (tail - head >= BRIDGE_RING_CAPACITY) {
+        qWarning() << "Machine bridge command ring full - dropping command" << record.type;
+        return false;
+    }
+
+    shared->toBridgeRecords[tail & (BRIDGE_RING_CAPACITY - 1)] = record;
+    ring.tail.store(tail + 1, std::memory_order_release);
+
+    // Wake the Python side; the write syscall also orders the record stores
+    uint64_t one = 1;
+    if (::write(bridgeEventFd, &one, sizeof(one)) != sizeof(one)) {
+        qWarning() << "Machine bridge wakeup failed:" << strerror(errno);
+    }
+    return true;
+#else
+    Q_UNUSED(record);
+    return false;
+#endif
+}
+
+void MachineBridge::onHostEventReady() {
+#ifdef SHM_TRANSPORT_AVAILABLE
+    uint64_t count = 0;
+    if (::read(hostEventFd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        qWarning() << "Machine bridge eventfd read failed:" << strerror(errno);
+    }
+#endif
+    drainHostRing();
+}
+
+void MachineBridge::drainHostRing() {
+    if (!shared) {
+        return;
+    }
+
+    BridgeRingIndex& ring = shared->toHost;
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+    uint32_t tail = ring.tail.load(std::memory_order_acquire);
+
+    while (head != tail) {
+        BridgeRecord record = shared->toHostRecords[head & (BRIDGE_RING_CAPACITY - 1)];
+        ++head;
+        ring.head.store(head, std::memory_order_release);
+        handleRecord(record);
+    }
+}
+
+void MachineBridge::handleRecord(const BridgeRecord& record) {
+    switch (static_cast<BridgeMessage>(record.type)) {
+    case BridgeMessage::BallDetected: {
+        QVector<int> pins(5);
+        for (int i = 0; i < 5; ++i) {
+            pins[i] = record.pins[i];
+        }
+        emit ballDetected(pins, record.value);
+        break;
+    }
+    case BridgeMessage::MachineReady:
+        emit bridgeReady();
+        break;
+    case BridgeMessage::Pong:
+        recordPong(record.arg);
+        break;
+    case BridgeMessage::Error:
+        emit bridgeError(QString("Machine bridge reported error code %1").arg(record.arg));
+        break;
+    case BridgeMessage::Shutdown:
+        emit bridgeStopped();
+        break;
+    default:
+        break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Stdio transport
+// ---------------------------------------------------------------------------
+
+void MachineBridge::writeJsonCommand(BridgeCommand command, int arg, const QVector<int>& pinStates) {
+    QJsonObject message;
+    QJsonObject data;
+
+    switch (command) {
+    case BridgeCommand::StartDetection: message["type"] = "start_detection"; break;
+    case BridgeCommand::StopDetection:  message["type"] = "stop_detection"; break;
+    case BridgeCommand::MachineReset:
+        message["type"] = "machine_reset";
+        data["immediate"] = arg != 0;
+        break;
+    case BridgeCommand::Hold:
+        message["type"] = "hold";
+        data["held"] = arg != 0;
+        break;
+    case BridgeCommand::Status:         message["type"] = "status"; break;
+    case BridgeCommand::Ping:
+        message["type"] = "ping";
+        data["sequence"] = arg;
+        break;
+    case BridgeCommand::PinSet:
+    case BridgeCommand::PinRestore: {
+        message["type"] = (command == BridgeCommand::PinSet) ? "pin_set" : "pin_restore";
+        QJsonObject pins;
+        for (int i = 0; i < 5 && i < pinStates.size(); ++i) {
+            pins[PIN_NAMES[i]] = pinStates[i];
+        }
+        data["pins"] = pins;
+        break;
+    }
+    default:
+        return;
+    }
+
+    message["data"] = data;
+    QByteArray line = QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n";
+    process->write(line);
+}
+
+void MachineBridge::onProcessOutput() {
+    while (process && process->canReadLine()) {
+        QByteArray line = process->readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+            qDebug() << "Machine bridge:" << line;
+            continue;
+        }
+        handleJsonMessage(doc.object());
+    }
+}
+
+void MachineBridge::handleJsonMessage(const QJsonObject& message) {
+    QString type = message["type"].toString();
+
+    if (type == "ball_detected") {
+        QJsonArray pinsArray = message["pins"].toArray();
+        QVector<int> pins;
+        for (const QJsonValue& value : pinsArray) {
+            pins.append(value.toInt());
+        }
+        emit ballDetected(pins, message["value"].toInt());
+    } else if (type == "machine_ready") {
+        emit bridgeReady();
+    } else if (type == "pong") {
+        recordPong(message["sequence"].toInt());
+    } else if (type == "error" || type == "fatal_error") {
+        emit bridgeError(message["message"].toString());
+    } else if (type == "shutdown") {
+        emit bridgeStopped();
+    }
+}
+
+void MachineBridge::onProcessFinished(int exitCode, QProcess::ExitStatus status) {
+    qWarning() << "Machine bridge exited with code" << exitCode
+               << (status == QProcess::CrashExit ? "(crashed)" : "");
+    closeSharedMemory();
+    emit bridgeStopped();
+}
+
+void MachineBridge::recordPong(int sequence) {
+    auto it = pendingPings.find(sequence);
+    if (it == pendingPings.end()) {
+        return;
+    }
+
+    qint64 roundTripUs = latencyClock.nsecsElapsed() / 1000 - it.value();
+    pendingPings.erase(it);
+
+    if (latency.samples == 0 || roundTripUs < latency.minUs) {
+        latency.minUs = roundTripUs;
+    }
+    if (roundTripUs > latency.maxUs) {
+        latency.maxUs = roundTripUs;
+    }
+    latency.totalUs += roundTripUs;
+    latency.samples++;
+
+    emit pongReceived(roundTripUs);
+}
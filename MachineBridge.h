@@ -0,0 +1,175 @@
+﻿#ifndef MACHINE_BRIDGE_H
+#define MACHINE_BRIDGE_H
+
+#include <QObject>
+#include <QProcess>
+#include <QSocketNotifier>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+#include <QJsonObject>
+#include <QDebug>
+#include <atomic>
+#include <cstdint>
+
+// Bridge to the legacy machine_interface.py process (MachineInterfaceBridge).
+//
+// Two transports are supported so they can be compared on the same lane:
+//   Stdio        - the original JSON-lines protocol over stdin/stdout
+//   SharedMemory - a POSIX shared-memory region holding two SPSC rings of
+//                  fixed-layout records, with an eventfd per direction for
+//                  wakeups. No JSON is encoded or parsed on either side.
+//
+// The record layout below is mirrored by the struct format strings in
+// machine_interface.py - keep them in sync.
+
+// Messages from the Python bridge to the lane client
+enum class BridgeMessage : uint32_t {
+    None            = 0,
+    BallDetected    = 1,
+    MachineReady    = 2,
+    DetectionStarted = 3,
+    DetectionStopped = 4,
+    Error           = 5,
+    Pong            = 6,
+    Heartbeat       = 7,
+    Status          = 8,
+    CommandComplete = 9,
+    Shutdown        = 10
+};
+
+// Commands from the lane client to the Python bridge
+enum class BridgeCommand : uint32_t {
+    None            = 0,
+    StartDetection  = 1,
+    StopDetection   = 2,
+    MachineReset    = 3,
+    Hold            = 4,
+    Status          = 5,
+    Ping            = 6,
+    PinSet          = 7,
+    PinRestore      = 8
+};
+
+#pragma pack(push, 1)
+struct BridgeRecord {
+    uint32_t type;          // BridgeMessage or BridgeCommand
+    uint32_t sequence;      // Producer sequence number
+    int32_t  pins[5];       // [lTwo, lThree, cFive, rThree, rTwo] 1=up, 0=down
+    int32_t  rawResult[5];  // Machine result as reported by MachineFunctions (1=down)
+    int32_t  value;         // Canadian 5-pin value of the ball
+    int32_t  arg;           // Command/message specific argument
+    double   timestamp;     // Seconds since epoch (time.time() on the Python side)
+};
+#pragma pack(pop)
+static_assert(sizeof(BridgeRecord) == 64, "BridgeRecord must match the Python struct layout");
+
+// One direction of the shared region. head is owned by the consumer,
+// tail by the producer; both only ever increase and wrap at 2^32.
+struct BridgeRingIndex {
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    uint32_t reserved[14];
+};
+static_assert(sizeof(BridgeRingIndex) == 64, "BridgeRingIndex must be one cache line");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Ring indices must be lock free to live in shared memory");
+
+static const uint32_t BRIDGE_SHM_MAGIC = 0x424C4E31;   // "BLN1"
+static const uint32_t BRIDGE_SHM_VERSION = 1;
+static const uint32_t BRIDGE_RING_CAPACITY = 64;      // Records per direction (power of two)
+
+struct BridgeSharedLayout {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t recordSize;
+    uint32_t reserved[12];
+    BridgeRingIndex toHost;                             // Python -> C++
+    BridgeRingIndex toBridge;                           // C++ -> Python
+    BridgeRecord toHostRecords[BRIDGE_RING_CAPACITY];
+    BridgeRecord toBridgeRecords[BRIDGE_RING_CAPACITY];
+};
+
+class MachineBridge : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Transport {
+        Stdio,
+        SharedMemory
+    };
+
+    explicit MachineBridge(QObject* parent = nullptr);
+    ~MachineBridge();
+
+    // Launch the Python bridge with the given transport
+    bool start(Transport transport, const QString& scriptPath, const QString& pythonPath = "python3");
+    void stop();
+
+    bool isRunning() const;
+    Transport transport() const { return currentTransport; }
+
+    // Commands
+    void sendCommand(BridgeCommand command, int arg = 0);
+    void sendPinCommand(BridgeCommand command, const QVector<int>& pinStates);
+    void ping();
+
+    // Round-trip latency of ping/pong, in microseconds
+    struct LatencyStats {
+        int samples = 0;
+        qint64 minUs = 0;
+        qint64 maxUs = 0;
+        qint64 totalUs = 0;
+        int lost = 0;           // No pong within PING_TIMEOUT_US
+        qint64 averageUs() const { return samples > 0 ? totalUs / samples : 0; }
+    };
+    LatencyStats latencyStats() const { return latency; }
+    void resetLatencyStats() { latency = LatencyStats(); }
+
+signals:
+    void ballDetected(const QVector<int>& pinStates, int value);
+    void bridgeReady();
+    void bridgeError(const QString& error);
+    void bridgeStopped();
+    void pongReceived(qint64 roundTripUs);
+
+private slots:
+    void onHostEventReady();
+    void onProcessOutput();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus status);
+
+private:
+    void dispatchCommand(BridgeCommand command, int arg, const QVector<int>& pinStates);
+
+    // Shared memory transport
+    bool openSharedMemory();
+    void closeSharedMemory();
+    bool pushCommand(const BridgeRecord& record);
+    void drainHostRing();
+    void handleRecord(const BridgeRecord& record);
+
+    // Stdio transport
+    void writeJsonCommand(BridgeCommand command, int arg, const QVector<int>& pinStates);
+    void handleJsonMessage(const QJsonObject& message);
+
+    void recordPong(int sequence);
+
+    Transport currentTransport;
+    QProcess* process;
+
+    QString shmName;
+    int shmFd;
+    BridgeSharedLayout* shared;
+    int hostEventFd;      // Signalled by Python when toHost has records
+    int bridgeEventFd;    // Signalled by us when toBridge has records
+    QSocketNotifier* hostNotifier;
+
+    uint32_t commandSequence;
+    QElapsedTimer latencyClock;
+    QHash<int, qint64> pendingPings;   // sequence -> send time (us), dropped after PING_TIMEOUT_US
+    LatencyStats latency;
+
+    static constexpr qint64 PING_TIMEOUT_US = 5000000;
+};
+
+#endif // MACHINE_BRIDGE_H
@@ -1,11 +1,16 @@
 ﻿#include "MachineInterface.h"
 #include <QDateTime>
+#include "TaskScheduler.h"
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QRandomGenerator>
+#include <QElapsedTimer>
+#include <chrono>
 
 // Initialize static members PROPERLY
+MachineInterface* MachineInterface::edgeInstance = nullptr;
+
 #ifdef GPIO_AVAILABLE
 int MachineInterface::ads1_handle = -1;
 int MachineInterface::ads2_handle = -1;
@@ -16,25 +21,53 @@ MachineInterface::MachineInterface(QObject* parent)
     : QObject(parent)
     , currentState(IDLE)
     , gameActive(false)
-    , ballDetectionTimer(new QTimer(this))
+    , acquisitionThread(nullptr)
+    , acquisitionRunning(false)
     , machineTimer(new QTimer(this))
     , detectionActive(false)
     , detectionSuspended(false)
     , ballDetectionCounter(0)
     , detectionThreshold(10)
+    , acquisitionRealTime(false)
     , debounceTimeMs(500)
+    , ballRiseNs(0)
+    , ballFallNs(0)
+    , secondRiseNs(0)
+    , edgeCaptureActive(false)
+    , lowPower(false)
+    , secondSensorEnabled(false)
+    , sensorSpacingMm(300.0)
+    , ballDiameterMm(127.0)
+    , timingWaitMs(50)
+    , settleWindowMs(600)
+    , settleSamples(3)
+    , settleSampleIntervalMs(0)
+    , settleOpen(false)
+    , settleWindowId(0)
+    , deliveredWindowId(0)
+    , settleStableCount(0)
+    , settleResultPending(false)
+    , settleResultWindowId(0)
     , currentPinStates({1,1,1,1,1}) 
     , targetPinStates({1,1,1,1,1})
     , machineInOperation(false)
+    , machineCycleId(0)
     , machineCycleTimeSeconds(8.5)
     , laneId(1)
+    , bridge(nullptr)
+    , bridgeEnabled(false)
+    , bridgeTransport(MachineBridge::Transport::SharedMemory)
+    , bridgeScript("machine_interface.py")
+    , bridgeProbeTimer(new QTimer(this))
+    , bridgeProbeIntervalMs(0)
 {
-    // Setup timers
-    ballDetectionTimer->setInterval(1); // 1ms for fast ball detection
+    // Setup timers - ball detection runs on its own acquisition thread
     machineTimer->setInterval(50);      // 50ms for machine operations
     
-    connect(ballDetectionTimer, &QTimer::timeout, this, &MachineInterface::onBallDetectionTimer);
+    qRegisterMetaType<BallTiming>("BallTiming");
+    
     connect(machineTimer, &QTimer::timeout, this, &MachineInterface::onMachineTimer);
+    connect(bridgeProbeTimer, &QTimer::timeout, this, &MachineInterface::onBridgeProbeTimer);
     
     qDebug() << "MachineInterface created";
 }
@@ -52,6 +85,10 @@ bool MachineInterface::initialize() {
     // Load settings first
     loadSettings();
     
+    if (bridgeEnabled) {
+        return startBridge();
+    }
+    
 #ifdef GPIO_AVAILABLE
     // Initialize wiringPi
     if (wiringPiSetupGpio() < 0) {
@@ -67,6 +104,11 @@ bool MachineInterface::initialize() {
         return false;
     }
     
+    // Edge timestamps for ball speed - optional, detection works without it
+    if (!setupEdgeCapture()) {
+        qWarning() << "Ball sensor edge capture unavailable - ball speed will not be measured";
+    }
+    
     // Setup ADS converters
     if (!setupADS()) {
         qWarning() << "Failed to setup ADS converters - pin detection may not work";
@@ -102,6 +144,29 @@ void MachineInterface::loadSettings() {
     laneId = settings["Lane"].toInt(1);
     QString laneKey = QString::number(laneId);
     
+    // Post-detection settle window
+    QJsonObject detectionSettings = settings["BallDetection"].toObject();
+    settleWindowMs = detectionSettings["SettleWindowMs"].toInt(settleWindowMs);
+    settleSamples = qMax(1, detectionSettings["SettleSamples"].toInt(settleSamples));
+    settleSampleIntervalMs = detectionSettings["SettleSampleIntervalMs"].toInt(settleSampleIntervalMs);
+    realTime = RealTimeSettings::fromJson(detectionSettings["RealTime"].toObject());
+    
+    // Ball speed measurement
+    QJsonObject timingSettings = settings["BallTiming"].toObject();
+    secondSensorEnabled = timingSettings["SecondSensor"].toBool(false);
+    sensorSpacingMm = timingSettings["SensorSpacingMm"].toDouble(sensorSpacingMm);
+    ballDiameterMm = timingSettings["BallDiameterMm"].toDouble(ballDiameterMm);
+    timingWaitMs = timingSettings["TimingWaitMs"].toInt(timingWaitMs);
+    
+    // Optional Python bridge
+    QJsonObject bridgeSettings = settings["MachineBridge"].toObject();
+    bridgeEnabled = bridgeSettings["Enabled"].toBool(false);
+    bridgeTransport = bridgeSettings["Transport"].toString("shm") == "stdio"
+                      ? MachineBridge::Transport::Stdio
+                      : MachineBridge::Transport::SharedMemory;
+    bridgeScript = bridgeSettings["Script"].toString("machine_interface.py");
+    bridgeProbeIntervalMs = bridgeSettings["LatencyProbeIntervalMs"].toInt(0);
+    
     if (settings.contains(laneKey)) {
         laneSettings = settings[laneKey].toObject();
         
@@ -192,37 +257,215 @@ bool MachineInterface::setupADS() {
     return true; // Simulation mode
 }
 
+// Monotonic timestamp shared by the ISR and acquisition threads
+qint64 MachineInterface::monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Register edge interrupts on the ball sensor (and GP8 if used as a second sensor)
+bool MachineInterface::setupEdgeCapture() {
+#ifdef GPIO_AVAILABLE
+    edgeInstance = this;
+    
+    if (wiringPiISR(gp7, INT_EDGE_BOTH, &MachineInterface::onBallSensorEdge) < 0) {
+        qWarning() << "Failed to register GP7 edge interrupt";
+        return false;
+    }
+    
+    if (secondSensorEnabled && wiringPiISR(gp8, INT_EDGE_RISING, &MachineInterface::onSecondSensorEdge) < 0) {
+        qWarning() << "Failed to register GP8 edge interrupt - using dwell-based speed";
+        secondSensorEnabled = false;
+    }
+    
+    edgeCaptureActive = true;
+    qDebug() << "Ball sensor edge capture enabled" << (secondSensorEnabled ? "(two sensors)" : "(dwell)");
+    return true;
+#else
+    return false;
+#endif
+}
+
+// GP7 edge - timestamp first, then find out which edge it was
+void MachineInterface::onBallSensorEdge() {
+    qint64 now = monotonicNs();
+    MachineInterface* instance = edgeInstance;
+    if (!instance) return;
+    
+#ifdef GPIO_AVAILABLE
+    if (digitalRead(instance->gp7) == HIGH) {
+        instance->ballRiseNs.store(now, std::memory_order_release);
+    } else {
+        instance->ballFallNs.store(now, std::memory_order_release);
+    }
+    
+    // Wake an idle lane on the first edge
+    if (instance->lowPower.exchange(false)) {
+        emit instance->sensorActivity(now);
+    }
+#else
+    Q_UNUSED(now);
+#endif
+}
+
+// GP8 rising edge - second ball sensor
+void MachineInterface::onSecondSensorEdge() {
+    qint64 now = monotonicNs();
+    MachineInterface* instance = edgeInstance;
+    if (instance) {
+        instance->secondRiseNs.store(now, std::memory_order_release);
+    }
+}
+
+// Compute speed and dwell from the latest edges (acquisition thread)
+BallTiming MachineInterface::measureBallTiming() {
+    BallTiming timing;
+    
+#ifdef GPIO_AVAILABLE
+    if (!edgeCaptureActive) return timing;
+    
+    const qint64 MAX_GAP_NS = 1000000000LL; // Edges further apart belong to different balls
+    qint64 rise = ballRiseNs.load(std::memory_order_acquire);
+    if (rise == 0) return timing;
+    
+    // The pin read normally outlasts the ball; only wait if the trailing edge is still pending
+    QElapsedTimer wait;
+    wait.start();
+    qint64 fall = ballFallNs.load(std::memory_order_acquire);
+    qint64 second = secondRiseNs.load(std::memory_order_acquire);
+    
+    auto secondPending = [&]() {
+        return secondSensorEnabled && qAbs(second - rise) > MAX_GAP_NS;
+    };
+    
+    while ((fall <= rise || secondPending()) && wait.elapsed() < timingWaitMs) {
+        QThread::usleep(200);
+        fall = ballFallNs.load(std::memory_order_acquire);
+        second = secondRiseNs.load(std::memory_order_acquire);
+    }
+    
+    if (fall > rise && fall - rise < MAX_GAP_NS) {
+        timing.dwellMs = (fall - rise) / 1e6;
+    }
+    
+    if (secondSensorEnabled && !secondPending() && second != rise) {
+        // Sensor order depends on the install, so use the interval either way
+        timing.twoSensor = true;
+        timing.sensorGapMs = qAbs(second - rise) / 1e6;
+        timing.speedMps = (sensorSpacingMm / 1000.0) / (timing.sensorGapMs / 1000.0);
+    } else if (timing.dwellMs > 0.0) {
+        // Single sensor - the ball blocks the beam for about one diameter
+        timing.speedMps = (ballDiameterMm / 1000.0) / (timing.dwellMs / 1000.0);
+    }
+#else
+    // Simulation - typical 5-pin ball speeds
+    timing.speedMps = 5.5 + QRandomGenerator::global()->bounded(3.0);
+    timing.dwellMs = (ballDiameterMm / 1000.0) / timing.speedMps * 1000.0;
+#endif
+    
+    return timing;
+}
+
 // Start ball detection
 void MachineInterface::startBallDetection() {
     qDebug() << "Starting ball detection for lane" << laneId;
     detectionActive = true;
     detectionSuspended = false;
-    ballDetectionCounter = 0;
-    lastDetectionTime = 0;
-    ballDetectionTimer->start();
+    
+    if (bridge) {
+        bridge->sendCommand(BridgeCommand::StartDetection);
+        return;
+    }
+    
+    if (!acquisitionThread) {
+        ballDetectionCounter = 0;
+        lastDetectionTime = 0;
+        startAcquisitionThread();
+    }
 }
 
 // Stop ball detection
 void MachineInterface::stopBallDetection() {
     qDebug() << "Stopping ball detection for lane" << laneId;
     detectionActive = false;
-    ballDetectionTimer->stop();
+    stopAcquisitionThread();
+    
+    if (bridge) {
+        bridge->sendCommand(BridgeCommand::StopDetection);
+    }
 }
 
 // Suspend/resume ball detection
 void MachineInterface::setDetectionSuspended(bool suspended) {
     detectionSuspended = suspended;
+    if (bridge) {
+        bridge->sendCommand(BridgeCommand::Hold, suspended ? 1 : 0);
+    }
     qDebug() << "Ball detection" << (suspended ? "suspended" : "resumed") << "for lane" << laneId;
 }
 
-// Ball detection timer callback
-void MachineInterface::onBallDetectionTimer() {
-    if (!detectionActive || detectionSuspended) return;
+// Start the acquisition thread that polls the ball sensor
+void MachineInterface::startAcquisitionThread() {
+    if (acquisitionThread) return;
+    
+    acquisitionRunning = true;
+    acquisitionThread = QThread::create([this]() { acquisitionLoop(); });
+    acquisitionThread->setObjectName(QString("Lane%1Acquisition").arg(laneId));
+    acquisitionThread->start(QThread::TimeCriticalPriority);
+}
+
+// Stop the acquisition thread and wait for it to exit
+void MachineInterface::stopAcquisitionThread() {
+    if (!acquisitionThread) return;
+    
+    acquisitionRunning = false;
+    acquisitionThread->wait();
+    delete acquisitionThread;
+    acquisitionThread = nullptr;
+}
+
+// Acquisition thread body - 1ms ball sensor polling
+void MachineInterface::acquisitionLoop() {
+    qDebug() << "Acquisition thread started for lane" << laneId;
+    
+    bool realTimeApplied = false;
+    if (realTime.enabled) {
+        QString error;
+        realTimeApplied = RealTimeMode::applyToCurrentThread(realTime, &error);
+        if (realTimeApplied) {
+            qDebug() << "Acquisition thread in real-time mode: SCHED_FIFO" << realTime.priority
+                     << "on CPU" << realTime.cpu;
+        } else {
+            qWarning() << "Real-time mode not applied for lane" << laneId << "-" << error;
+        }
+    }
+    // Even a partly applied request may have left the thread SCHED_FIFO
+    acquisitionRealTime = realTime.enabled;
     
-    checkBallSensor();
+    if (realTimeApplied) {
+        // Absolute 1 ms deadlines; after a settle window, skip the ticks it covered
+        const qint64 intervalNs = 1000000;
+        qint64 next = RealTimeMode::monotonicNs() + intervalNs;
+        while (acquisitionRunning) {
+            checkBallSensor();
+            const qint64 now = RealTimeMode::monotonicNs();
+            if (next < now) {
+                next = now + intervalNs;
+            }
+            RealTimeMode::sleepUntilNs(next);
+            next += intervalNs;
+        }
+    } else {
+        while (acquisitionRunning) {
+            checkBallSensor();
+            QThread::msleep(1);
+        }
+    }
+    
+    qDebug() << "Acquisition thread stopped for lane" << laneId;
 }
 
-// Check ball sensor and process detection
+// Check ball sensor and process detection (acquisition thread)
 void MachineInterface::checkBallSensor() {
     // CRITICAL: Only detect balls when machine is idle and game is active
     if (!detectionActive || detectionSuspended || !gameActive || currentState != IDLE) {
@@ -241,10 +484,16 @@ void MachineInterface::checkBallSensor() {
                 lastDetectionTime = currentTime;
                 
                 QVector<int> detectedStates = readPinSensors();
-                currentPinStates = detectedStates;
+                BallTiming timing = measureBallTiming();
                 
-                emit ballDetected(detectedStates);
-                emit pinStatesChanged(detectedStates);
+                // Report the first reading immediately, then keep watching for late pins
+                openSettleWindow(detectedStates);
+                int windowId = settleWindowId;
+                QMetaObject::invokeMethod(this, [this, detectedStates, timing, windowId]() {
+                    handleDetectedBall(detectedStates, timing, windowId);
+                }, Qt::QueuedConnection);
+                
+                runSettleWindow();
             }
             ballDetectionCounter = 0;
         }
@@ -288,22 +537,177 @@ void MachineInterface::checkBallSensor() {
             }
         }
         
-        currentPinStates = simResults;
+        // Occasionally let a standing pin fall late to exercise the settle window
+        simulatedSettleStates = simResults;
+        if (simResults.contains(1) && QRandomGenerator::global()->bounded(0, 5) == 0) {
+            int pin = simResults.indexOf(1);
+            simulatedSettleStates[pin] = 0;
+        }
         
         qDebug() << "SIMULATED BALL DETECTED on lane" << laneId << "- Pin states:" << simResults;
-        emit ballDetected(simResults);
-        emit pinStatesChanged(simResults);
+        BallTiming timing = measureBallTiming();
+        openSettleWindow(simResults);
+        int windowId = settleWindowId;
+        QMetaObject::invokeMethod(this, [this, simResults, timing, windowId]() {
+            handleDetectedBall(simResults, timing, windowId);
+        }, Qt::QueuedConnection);
+        
+        runSettleWindow();
     }
 #endif
 }
 
+// Begin watching for late-falling pins after a detection (acquisition thread)
+void MachineInterface::openSettleWindow(const QVector<int>& reportedStates) {
+    QMutexLocker locker(&settleMutex);
+    
+    settleWindowId++;
+    settleReported = reportedStates;
+    settleCandidate = reportedStates;
+    settleStable = reportedStates;
+    settleStableCount = 1;
+    
+    // Nothing can fall late if every pin is already down
+    settleOpen = settleWindowMs > 0 && reportedStates.contains(1);
+}
+
+// Sample the pin sensors until the window expires or is flushed (acquisition thread)
+void MachineInterface::runSettleWindow() {
+    {
+        QMutexLocker locker(&settleMutex);
+        if (!settleOpen) return;
+    }
+    
+    QElapsedTimer window;
+    window.start();
+    
+    // A SCHED_FIFO thread sampling back to back would starve its core for
+    // the whole window, so in real-time mode samples keep the 1 ms cadence
+    const qint64 pacingNs = qMax(1, settleSampleIntervalMs) * 1000000LL;
+    qint64 nextSampleNs = RealTimeMode::monotonicNs();
+    
+    while (acquisitionRunning && window.elapsed() < settleWindowMs) {
+        QVector<int> sample = readPinSensors(true);
+        
+        QMutexLocker locker(&settleMutex);
+        if (!settleOpen) {
+            return; // Flushed by a machine cycle
+        }
+        
+        // Pins only fall - anything already down stays down
+        for (int i = 0; i < 5 && i < sample.size(); ++i) {
+            if (settleReported[i] == 0) {
+                sample[i] = 0;
+            }
+        }
+        
+        if (sample == settleCandidate) {
+            settleStableCount++;
+        } else {
+            settleCandidate = sample;
+            settleStableCount = 1;
+        }
+        
+        if (settleStableCount >= settleSamples) {
+            settleStable = settleCandidate;
+        }
+        
+        if (!settleStable.contains(1)) {
+            break; // Everything is down
+        }
+        
+        locker.unlock();
+        if (acquisitionRealTime) {
+            nextSampleNs += pacingNs;
+            RealTimeMode::sleepUntilNs(nextSampleNs);
+        } else if (settleSampleIntervalMs > 0) {
+            QThread::msleep(settleSampleIntervalMs);
+        }
+    }
+    
+    {
+        QMutexLocker locker(&settleMutex);
+        if (!settleOpen) return;
+        closeSettleWindowLocked();
+    }
+    
+    QMetaObject::invokeMethod(this, [this]() { deliverSettleResult(); }, Qt::QueuedConnection);
+}
+
+// Close the window and record a late change if the settled mask differs (settleMutex held)
+void MachineInterface::closeSettleWindowLocked() {
+    settleOpen = false;
+    
+    if (settleStable != settleReported) {
+        settleResultPending = true;
+        settleResultWindowId = settleWindowId;
+        settleResultReported = settleReported;
+        settleResultFinal = settleStable;
+    }
+}
+
+// Finalize the settle window now - called before any machine cycle
+void MachineInterface::flushSettleWindow() {
+    {
+        QMutexLocker locker(&settleMutex);
+        if (settleOpen) {
+            closeSettleWindowLocked();
+        }
+    }
+    
+    deliverSettleResult();
+}
+
+// Ball detection result delivered on the GUI thread
+void MachineInterface::handleDetectedBall(const QVector<int>& states, const BallTiming& timing, int windowId) {
+    currentPinStates = states;
+    
+    if (timing.isValid()) {
+        qDebug() << "Ball speed" << timing.speedMps << "m/s, dwell" << timing.dwellMs << "ms";
+    }
+    emit ballDetected(states, timing);
+    emit pinStatesChanged(states);
+    
+    {
+        QMutexLocker locker(&settleMutex);
+        deliveredWindowId = windowId;
+    }
+    
+    // A flush may have closed the window before the ball got here
+    deliverSettleResult();
+}
+
+// Emit a pending late change (GUI thread)
+void MachineInterface::deliverSettleResult() {
+    QVector<int> reported;
+    QVector<int> settled;
+    
+    {
+        QMutexLocker locker(&settleMutex);
+        if (!settleResultPending || settleResultWindowId > deliveredWindowId) {
+            return;
+        }
+        settleResultPending = false;
+        reported = settleResultReported;
+        settled = settleResultFinal;
+    }
+    
+    qDebug() << "LATE PIN CHANGE on lane" << laneId << ":" << reported << "->" << settled;
+    currentPinStates = settled;
+    
+    emit lateChange(reported, settled);
+    emit pinStatesChanged(settled);
+}
+
 // Read pin sensors from ADS converters
-QVector<int> MachineInterface::readPinSensors() {
+// settleSample: fast single-attempt read used by the settle window
+QVector<int> MachineInterface::readPinSensors(bool settleSample) {
     QVector<int> pinStates = {1, 1, 1, 1, 1}; // Default: all pins up
     
 #ifdef GPIO_AVAILABLE
     const float VOLTAGE_THRESHOLD = 4.0f; // 4V threshold for pin down detection
-    const int MAX_RETRY_ATTEMPTS = 5;     // Maximum retry attempts per sensor
+    const int MAX_RETRY_ATTEMPTS = settleSample ? 1 : 5; // Maximum retry attempts per sensor
+    const uint16_t DATA_RATE = settleSample ? ADS1115_CONFIG_DR_860SPS : ADS1115_CONFIG_DR_128SPS;
     const int RETRY_DELAY_MS = 10;        // Delay between retries
     const int CONVERSION_TIMEOUT_MS = 100; // Timeout for each conversion
     
@@ -343,15 +747,15 @@ QVector<int> MachineInterface::readPinSensors() {
             attempts++;
             
             try {
-                float voltage = readADS1115Channel(sensor.adsHandle, sensor.channel, CONVERSION_TIMEOUT_MS);
+                float voltage = readADS1115Channel(sensor.adsHandle, sensor.channel, CONVERSION_TIMEOUT_MS, DATA_RATE);
                 
                 if (voltage >= 0.0f) { // Valid reading
                     if (voltage >= VOLTAGE_THRESHOLD) {
                         pinStates[sensor.pinIndex] = 0; // Pin down
-                        qDebug() << "Sensor" << sensor.name << "voltage:" << voltage << "V (PIN DOWN)";
+                        if (!settleSample) qDebug() << "Sensor" << sensor.name << "voltage:" << voltage << "V (PIN DOWN)";
                     } else {
                         pinStates[sensor.pinIndex] = 1; // Pin up  
-                        qDebug() << "Sensor" << sensor.name << "voltage:" << voltage << "V (PIN UP)";
+                        if (!settleSample) qDebug() << "Sensor" << sensor.name << "voltage:" << voltage << "V (PIN UP)";
                     }
                     sensorReadSuccessfully = true;
                 } else {
@@ -374,14 +778,22 @@ QVector<int> MachineInterface::readPinSensors() {
             }
         }
         
-        if (!sensorReadSuccessfully) {
+        if (!sensorReadSuccessfully && settleSample) {
+            pinStates[sensor.pinIndex] = 1; // Retried on the next settle sample
+        } else if (!sensorReadSuccessfully) {
             qCritical() << "FAILED to read sensor" << sensor.name << "after" << attempts << "attempts, using default PIN UP";
             pinStates[sensor.pinIndex] = 1; // Default to pin up on failure
         }
     }
     
-    qDebug() << "Final pin states:" << pinStates;
+    if (!settleSample) {
+        qDebug() << "Final pin states:" << pinStates;
+    }
     
+#else
+    if (settleSample && !simulatedSettleStates.isEmpty()) {
+        pinStates = simulatedSettleStates;
+    }
 #endif
     
     return pinStates;
@@ -389,7 +801,7 @@ QVector<int> MachineInterface::readPinSensors() {
 
 #ifdef GPIO_AVAILABLE
 // Helper method to read from specific ADS1115 channel with timeout
-float MachineInterface::readADS1115Channel(int adsHandle, int channel, int timeoutMs) {
+float MachineInterface::readADS1115Channel(int adsHandle, int channel, int timeoutMs, uint16_t dataRate) {
     if (adsHandle < 0) {
         throw std::runtime_error("Invalid ADS handle");
     }
@@ -398,7 +810,7 @@ float MachineInterface::readADS1115Channel(int adsHandle, int channel, int timeo
     uint16_t config = ADS1115_CONFIG_OS_SINGLE |      // Start conversion
                      ADS1115_CONFIG_PGA_6_144V |       // +/-6.144V range  
                      ADS1115_CONFIG_MODE_SINGLE |      // Single-shot mode
-                     ADS1115_CONFIG_DR_128SPS |        // 128 SPS
+                     dataRate |                        // 128 SPS, or 860 SPS while settling
                      ADS1115_CONFIG_CMODE_TRAD |       // Traditional comparator
                      ADS1115_CONFIG_CPOL_ACTVLOW |     // Active low
                      ADS1115_CONFIG_CLAT_NONLAT |      // Non-latching
@@ -471,38 +883,69 @@ void MachineInterface::onMachineTimer() {
     
     // Wait for machine cycle timing
     if (elapsed >= (machineCycleTimeSeconds * 1000)) {
-        // Execute the target pin configuration
-        executePinConfiguration(targetPinStates);
-        
-        currentPinStates = targetPinStates;
         machineInOperation = false;
         
-        // CRITICAL: Return to idle state after operation completes
-        currentState = IDLE;
-        
-        emit pinStatesChanged(currentPinStates);
-        qDebug() << "Machine cycle complete, pin states:" << currentPinStates;
+        // Solenoid pulses and the B21 wait take seconds; they run on the
+        // Hardware worker and the cycle completes back on this thread
+        QVector<int> target = targetPinStates;
+        quint64 cycleId = machineCycleId;
+        TaskScheduler::instance()->run(TaskScheduler::Hardware, this,
+            [this, target]() { executePinConfiguration(target); return target; },
+            [this, cycleId](const QVector<int>& applied) { completeMachineCycle(cycleId, applied); });
+    }
+}
+
+void MachineInterface::completeMachineCycle(quint64 cycleId, const QVector<int>& appliedStates) {
+    // A newer reset or configuration started while this one ran: its pins
+    // are the ones that count, and detection stays off until it completes
+    if (cycleId != machineCycleId) {
+        qDebug() << "Machine cycle" << cycleId << "superseded by" << machineCycleId;
+        return;
     }
+    
+    currentPinStates = appliedStates;
+    
+    // CRITICAL: Return to idle state after operation completes
+    currentState = IDLE;
+    
+    emit pinStatesChanged(currentPinStates);
+    qDebug() << "Machine cycle complete, pin states:" << currentPinStates;
 }
 
 // Reset all pins to UP position
 void MachineInterface::resetPins(bool immediate) {
     qDebug() << "Resetting pins to UP position, immediate:" << immediate << "on lane" << laneId;
     
+    // Late pin changes must reach the game before the deck is swept
+    flushSettleWindow();
+    
     // Set machine state to prevent ball detection during reset
     currentState = RESETTING;
+    quint64 cycleId = ++machineCycleId;
     
     targetPinStates = {1, 1, 1, 1, 1}; // All pins up
     
-    if (immediate) {
-        executePinReset();
+    if (bridge) {
+        // The Python side runs its own machine cycle
+        bridge->sendCommand(BridgeCommand::MachineReset, immediate ? 1 : 0);
         currentPinStates = targetPinStates;
-        currentState = IDLE; // Return to idle state
+        currentState = IDLE;
         emit pinStatesChanged(currentPinStates);
+        return;
+    }
+    
+    if (immediate) {
+        // Replaces any timer-driven cycle still waiting out its cycle time
+        machineInOperation = false;
+        QVector<int> target = targetPinStates;
+        TaskScheduler::instance()->run(TaskScheduler::Hardware, this,
+            [this, target]() { executePinReset(); return target; },
+            [this, cycleId](const QVector<int>& applied) { completeMachineCycle(cycleId, applied); });
     } else {
         // Start machine cycle
         machineInOperation = true;
         resetStartTime = QDateTime::currentMSecsSinceEpoch();
+        if (!machineTimer->isActive()) machineTimer->start();
         qDebug() << "Machine cycle started for pin reset";
     }
 }
@@ -516,14 +959,26 @@ void MachineInterface::setPinConfiguration(const QVector<int>& pinStates) {
         return;
     }
     
+    flushSettleWindow();
+    
     // Set machine state to prevent ball detection during pin setting
     currentState = SETTING_PINS;
+    ++machineCycleId;
     
     targetPinStates = pinStates;
     
+    if (bridge) {
+        bridge->sendPinCommand(BridgeCommand::PinSet, pinStates);
+        currentPinStates = targetPinStates;
+        currentState = IDLE;
+        emit pinStatesChanged(currentPinStates);
+        return;
+    }
+    
     // Start machine cycle
     machineInOperation = true;
     resetStartTime = QDateTime::currentMSecsSinceEpoch();
+    if (!machineTimer->isActive()) machineTimer->start();
     qDebug() << "Machine cycle started for pin configuration";
 }
 
@@ -604,12 +1059,25 @@ bool MachineInterface::waitForB21Sensor(int timeoutMs) {
     delay(5500); // Standard machine timing
     return true;
 #else
-    // Simulate timing
-    QTimer::singleShot(100, [](){}); // Brief simulated wait
+    // Simulate timing; runs on a TaskScheduler worker, which has no event loop
+    QThread::msleep(100);
     return true;
 #endif
 }
 
+// Idle lane - the machine timer only needs to run during a machine cycle
+void MachineInterface::setLowPower(bool enabled) {
+    lowPower = enabled;
+    
+    if (enabled) {
+        if (!machineInOperation) {
+            machineTimer->stop();
+        }
+    } else if (!bridge && !machineTimer->isActive()) {
+        machineTimer->start();
+    }
+}
+
 // Set Machine control state
 void MachineInterface::setGameActive(bool active) {
     gameActive = active;
@@ -619,14 +1087,70 @@ void MachineInterface::setGameActive(bool active) {
     qDebug() << "Machine interface game state:" << (active ? "active" : "inactive");
 }
 
+// Start the Python bridge instead of driving GPIO directly
+bool MachineInterface::startBridge() {
+    bridge = new MachineBridge(this);
+    
+    connect(bridge, &MachineBridge::ballDetected, this, &MachineInterface::onBridgeBallDetected);
+    connect(bridge, &MachineBridge::bridgeReady, this, &MachineInterface::machineReady);
+    connect(bridge, &MachineBridge::bridgeError, this, &MachineInterface::machineError);
+    connect(bridge, &MachineBridge::bridgeStopped, this, [this]() {
+        emit machineError("Machine bridge stopped");
+    });
+    
+    if (!bridge->start(bridgeTransport, bridgeScript)) {
+        emit machineError("Machine bridge failed to start");
+        return false;
+    }
+    
+    if (bridgeProbeIntervalMs > 0) {
+        bridgeProbeTimer->start(bridgeProbeIntervalMs);
+    }
+    
+    qDebug() << "Machine interface running through Python bridge for lane" << laneId;
+    return true;
+}
+
+// Ball reported by the Python bridge
+void MachineInterface::onBridgeBallDetected(const QVector<int>& pinStates, int value) {
+    if (!detectionActive || detectionSuspended || !gameActive || currentState != IDLE) {
+        qDebug() << "Ignoring bridge ball detection while machine busy";
+        return;
+    }
+    
+    qDebug() << "BRIDGE BALL DETECTED on lane" << laneId << "- Pin states:" << pinStates << "value" << value;
+    currentPinStates = pinStates;
+    emit ballDetected(pinStates, BallTiming());
+    emit pinStatesChanged(pinStates);
+}
+
+// Periodic ping to measure bridge round-trip latency
+void MachineInterface::onBridgeProbeTimer() {
+    if (!bridge) return;
+    
+    bridge->ping();
+    
+    MachineBridge::LatencyStats stats = bridge->latencyStats();
+    if (stats.samples > 0 && stats.samples % 60 == 0) {
+        qDebug() << "Bridge round trip (" << (bridge->transport() == MachineBridge::Transport::SharedMemory ? "shm" : "stdio")
+                 << "):" << stats.samples << "samples, min" << stats.minUs << "us, avg" << stats.averageUs()
+                 << "us, max" << stats.maxUs << "us," << stats.lost << "lost";
+    }
+}
+
 // Shutdown the machine interface
 void MachineInterface::shutdown() {
+    if (bridgeProbeTimer) bridgeProbeTimer->stop();
+    if (bridge) {
+        bridge->stop();
+    }
+    
 #ifdef GPIO_AVAILABLE
     try {
         qDebug() << "Shutting down machine interface for lane" << laneId;
         
-        // Stop all timers
-        if (ballDetectionTimer) ballDetectionTimer->stop();
+        // Stop acquisition and timers
+        stopAcquisitionThread();
         if (machineTimer) machineTimer->stop();
         
         // Set all outputs to safe state
@@ -644,7 +1168,11 @@ void MachineInterface::shutdown() {
     }
 #else
     qDebug() << "Simulated machine interface shutdown for lane" << laneId;
-    if (ballDetectionTimer) ballDetectionTimer->stop();
+    stopAcquisitionThread();
     if (machineTimer) machineTimer->stop();
 #endif
+    
+    if (edgeInstance == this) {
+        edgeInstance = nullptr;
+    }
 }
\ No newline at end of file
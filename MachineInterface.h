@@ -3,9 +3,15 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QThread>
+#include <QMutex>
 #include <QJsonObject>
 #include <QVector>
 #include <QDebug>
+#include <atomic>
+#include "MachineBridge.h"
+#include "BallTiming.h"
+#include "RealTimeMode.h"
 
 // Raspberry Pi GPIO access
 #ifdef __arm__
@@ -34,23 +40,36 @@ public:
     void resetPins(bool immediate = false);
     void setPinConfiguration(const QVector<int>& pinStates);
     void setGameActive(bool active);
+    void flushSettleWindow();  // Finalize late pin changes before a machine cycle
+    void setLowPower(bool lowPower);  // Idle lane - stop the machine timer, report sensor edges
     
     // State queries
     QVector<int> getCurrentPinStates() const { return currentPinStates; }
     bool isDetectionActive() const { return detectionActive; }
     bool isDetectionSuspended() const { return detectionSuspended; }
+    bool isBridgeMode() const { return bridgeEnabled; }
+    MachineBridge* getBridge() const { return bridge; }
 
 public slots:
-    void onBallDetectionTimer();
     void onMachineTimer();
 
+private slots:
+    void onBridgeBallDetected(const QVector<int>& pinStates, int value);
+    void onBridgeProbeTimer();
+
 signals:
-    // Main signal - emits [#,#,#,#,#] format
-    void ballDetected(const QVector<int>& pinStates);
+    // Main signal - emits [#,#,#,#,#] format plus speed/dwell from the sensor edges
+    void ballDetected(const QVector<int>& pinStates, const BallTiming& timing);
     
     void machineReady();
     void machineError(const QString& error);
     void pinStatesChanged(const QVector<int>& states);
+    
+    // A pin fell after ballDetected was emitted - settledStates is the final mask
+    void lateChange(const QVector<int>& reportedStates, const QVector<int>& settledStates);
+    
+    // Ball sensor edge while in low power (emitted from the ISR thread, once per idle period)
+    void sensorActivity(qint64 edgeNs);
 
 private:
     // Hardware setup
@@ -58,13 +77,32 @@ private:
     bool setupADS();
     void loadSettings();
     
-    // Ball detection
+    // Ball detection (acquisition thread)
+    void startAcquisitionThread();
+    void stopAcquisitionThread();
+    void acquisitionLoop();
     void checkBallSensor();
-    QVector<int> readPinSensors();
+    QVector<int> readPinSensors(bool settleSample = false);
+    
+    // Post-detection settle window
+    void openSettleWindow(const QVector<int>& reportedStates);
+    void runSettleWindow();
+    void closeSettleWindowLocked();
+    void handleDetectedBall(const QVector<int>& states, const BallTiming& timing, int windowId);
+    
+    // Sensor edge timing - wiringPi ISR callbacks run on their own threads
+    bool setupEdgeCapture();
+    BallTiming measureBallTiming();
+    static qint64 monotonicNs();
+    static void onBallSensorEdge();
+    static void onSecondSensorEdge();
+    static MachineInterface* edgeInstance;
+    void deliverSettleResult();
     
     // Machine operations
     void executePinReset();
     void executePinConfiguration(const QVector<int>& states);
+    void completeMachineCycle(quint64 cycleId, const QVector<int>& appliedStates);   // GUI thread, after the Hardware task
     bool waitForB21Sensor(int timeoutMs = 8000);
 
     enum MachineState {
@@ -74,8 +112,8 @@ private:
         WAITING_B21     // Waiting for machine timing sensor
     };
     
-    MachineState currentState;
-    bool gameActive;
+    std::atomic<MachineState> currentState;
+    std::atomic<bool> gameActive;
     
     // GPIO pin assignments (from settings.json)
     int gp1, gp2, gp3, gp4, gp5, gp6, gp7, gp8;
@@ -86,28 +124,64 @@ private:
         static int ads2_handle;
         
         // ADS1115 sensor reading methods
-        float readADS1115Channel(int adsHandle, int channel, int timeoutMs);
+        float readADS1115Channel(int adsHandle, int channel, int timeoutMs, uint16_t dataRate);
         int getPinIndexFromName(const QString& pinName);
     #endif
     
     // Timers
-    QTimer* ballDetectionTimer;
+    QThread* acquisitionThread;
+    std::atomic<bool> acquisitionRunning;
     QTimer* machineTimer;
     
     // Detection state
-    bool detectionActive;
-    bool detectionSuspended;
+    std::atomic<bool> detectionActive;
+    std::atomic<bool> detectionSuspended;
     int ballDetectionCounter;
     int detectionThreshold;
     qint64 lastDetectionTime;
+    RealTimeSettings realTime;    // Optional SCHED_FIFO for the acquisition thread
+    bool acquisitionRealTime;     // Real-time was requested; settle samples are paced (acquisition thread)
     int debounceTimeMs;
     
+    // Edge timestamps (monotonic ns) written by the ISR threads
+    std::atomic<qint64> ballRiseNs;
+    std::atomic<qint64> ballFallNs;
+    std::atomic<qint64> secondRiseNs;
+    bool edgeCaptureActive;
+    std::atomic<bool> lowPower;
+    bool secondSensorEnabled;     // GP8 used as a second ball sensor
+    double sensorSpacingMm;       // Distance between GP7 and GP8 sensors
+    double ballDiameterMm;        // Used for dwell-based speed
+    int timingWaitMs;             // Max wait for the trailing edge after pin read
+    
+    // Settle window - pins are sampled continuously after detection so a
+    // pin that wobbles and falls late is still counted
+    int settleWindowMs;
+    int settleSamples;            // Consecutive identical samples to accept a mask
+    int settleSampleIntervalMs;   // 0 = sample back to back
+    QMutex settleMutex;
+    bool settleOpen;
+    int settleWindowId;
+    int deliveredWindowId;        // Last window whose ball reached the GUI thread
+    QVector<int> settleReported;
+    QVector<int> settleCandidate;
+    QVector<int> settleStable;
+    int settleStableCount;
+    bool settleResultPending;
+    int settleResultWindowId;
+    QVector<int> settleResultReported;
+    QVector<int> settleResultFinal;
+#ifndef GPIO_AVAILABLE
+    QVector<int> simulatedSettleStates;
+#endif
+    
     // Pin states - Canadian 5-pin format: [lTwo, lThree, cFive, rThree, rTwo]
     QVector<int> currentPinStates;  // Current detected states (1=up, 0=down)
     QVector<int> targetPinStates;   // Target states for machine to set
     
     // Machine operation state
     bool machineInOperation;
+    quint64 machineCycleId;         // Bumped by every reset/configuration; only the latest may complete
     qint64 resetStartTime;
     double machineCycleTimeSeconds;
     
@@ -115,6 +189,15 @@ private:
     int laneId;
     QJsonObject laneSettings;
     QString pb10, pb11, pb12, pb13, pb20; // Pin sensor mappings
+    
+    // Python bridge mode (machine_interface.py drives the hardware)
+    bool startBridge();
+    MachineBridge* bridge;
+    bool bridgeEnabled;
+    MachineBridge::Transport bridgeTransport;
+    QString bridgeScript;
+    QTimer* bridgeProbeTimer;
+    int bridgeProbeIntervalMs;
 
     #ifdef GPIO_AVAILABLE
     // ADS1115 register definitions
@@ -132,6 +215,7 @@ private:
     #define ADS1115_CONFIG_PGA_6_144V   (0x00 << 9)   // +/-6.144V range
     #define ADS1115_CONFIG_MODE_SINGLE  (1 << 8)      // Single-shot mode
     #define ADS1115_CONFIG_DR_128SPS    (0x00 << 5)   // 128 samples per second
+    #define ADS1115_CONFIG_DR_860SPS    (0x07 << 5)   // 860 samples per second
     #define ADS1115_CONFIG_CMODE_TRAD   (0 << 4)      // Traditional comparator
     #define ADS1115_CONFIG_CPOL_ACTVLOW (0 << 3)      // Alert/Ready pin low
     #define ADS1115_CONFIG_CLAT_NONLAT  (0 << 2)      // Non-latching comparator
@@ -0,0 +1,183 @@
+﻿#include "MediaManifest.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDebug>
+#include <algorithm>
+
+QJsonObject MediaFileEntry::toJson() const {
+    QJsonArray chunkArray;
+    for (const QByteArray& chunk : chunks) {
+        chunkArray.append(QString::fromLatin1(chunk));
+    }
+
+    QJsonObject json;
+    json["path"] = path;
+    json["size"] = size;
+    json["modified"] = modified;
+    json["hash"] = QString::fromLatin1(hash);
+    json["chunks"] = chunkArray;
+    return json;
+}
+
+MediaFileEntry MediaFileEntry::fromJson(const QJsonObject& json) {
+    MediaFileEntry entry;
+    entry.path = json["path"].toString();
+    entry.size = static_cast<qint64>(json["size"].toDouble());
+    entry.modified = static_cast<qint64>(json["modified"].toDouble());
+    entry.hash = json["hash"].toString().toLatin1();
+    for (const QJsonValue& chunk : json["chunks"].toArray()) {
+        entry.chunks.append(chunk.toString().toLatin1());
+    }
+    return entry;
+}
+
+QByteArray MediaManifest::hashOf(const QByteArray& data) {
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+}
+
+MediaManifest MediaManifest::scan(const QString& root, const QStringList& dirs, const MediaManifest* previous) {
+    MediaManifest manifest;
+    QDir rootDir(root);
+
+    for (const QString& dir : dirs) {
+        QDirIterator it(rootDir.filePath(dir), QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            QFileInfo info(it.next());
+            if (info.fileName().startsWith('.')) {
+                continue;   // In-progress downloads and our own bookkeeping
+            }
+
+            MediaFileEntry entry;
+            entry.path = rootDir.relativeFilePath(info.filePath());
+            entry.size = info.size();
+            entry.modified = info.lastModified().toMSecsSinceEpoch();
+
+            if (previous && previous->contains(entry.path)) {
+                MediaFileEntry known = previous->file(entry.path);
+                if (known.size == entry.size && known.modified == entry.modified && !known.hash.isEmpty()) {
+                    manifest.entries.insert(entry.path, known);
+                    continue;
+                }
+            }
+
+            QFile file(info.filePath());
+            if (!file.open(QIODevice::ReadOnly)) {
+                qWarning() << "Media scan: cannot read" << info.filePath();
+                continue;
+            }
+
+            QCryptographicHash whole(QCryptographicHash::Sha256);
+            while (!file.atEnd()) {
+                QByteArray block = file.read(CHUNK_SIZE);
+                whole.addData(block);
+                entry.chunks.append(hashOf(block));
+            }
+            entry.hash = whole.result().toHex();
+            manifest.entries.insert(entry.path, entry);
+        }
+    }
+
+    manifest.index();
+    return manifest;
+}
+
+void MediaManifest::index() {
+    chunkIndex.clear();
+
+    QStringList paths = entries.keys();
+    std::sort(paths.begin(), paths.end());
+
+    QCryptographicHash version(QCryptographicHash::Sha256);
+    for (const QString& path : paths) {
+        const MediaFileEntry& entry = entries[path];
+        version.addData(path.toUtf8());
+        version.addData(entry.hash);
+
+        for (int i = 0; i < entry.chunks.size(); ++i) {
+            if (!chunkIndex.contains(entry.chunks[i])) {
+                chunkIndex.insert(entry.chunks[i], qMakePair(path, i));
+            }
+        }
+    }
+    manifestVersion = version.result().toHex();
+}
+
+QJsonObject MediaManifest::toJson() const {
+    QJsonArray fileArray;
+    for (const MediaFileEntry& entry : entries) {
+        fileArray.append(entry.toJson());
+    }
+
+    QJsonObject json;
+    json["version"] = QString::fromLatin1(manifestVersion);
+    json["chunk_size"] = CHUNK_SIZE;
+    json["files"] = fileArray;
+    return json;
+}
+
+MediaManifest MediaManifest::fromJson(const QJsonObject& json) {
+    MediaManifest manifest;
+    if (json["chunk_size"].toInt(CHUNK_SIZE) != CHUNK_SIZE) {
+        qWarning() << "Media manifest uses chunk size" << json["chunk_size"].toInt() << "- expected" << CHUNK_SIZE;
+        return manifest;
+    }
+
+    for (const QJsonValue& value : json["files"].toArray()) {
+        MediaFileEntry entry = MediaFileEntry::fromJson(value.toObject());
+        if (!entry.path.isEmpty() && !entry.path.contains("..")) {
+            manifest.entries.insert(entry.path, entry);
+        }
+    }
+    manifest.index();
+    return manifest;
+}
+
+bool MediaManifest::load(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    *this = fromJson(QJsonDocument::fromJson(file.readAll()).object());
+    return true;
+}
+
+bool MediaManifest::save(const QString& path) const {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(toJson()).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+bool MediaManifest::locate(const QByteArray& chunkHash, QString* path, int* index) const {
+    auto it = chunkIndex.constFind(chunkHash);
+    if (it == chunkIndex.constEnd()) {
+        return false;
+    }
+    *path = it->first;
+    *index = it->second;
+    return true;
+}
+
+bool MediaManifest::readChunk(const QString& root, const QByteArray& chunkHash, QByteArray* data) const {
+    QString path;
+    int index = 0;
+    if (!locate(chunkHash, &path, &index)) {
+        return false;
+    }
+
+    QFile file(QDir(root).filePath(path));
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(qint64(index) * CHUNK_SIZE)) {
+        return false;
+    }
+
+    *data = file.read(CHUNK_SIZE);
+    return hashOf(*data) == chunkHash;   // File changed since the scan
+}
@@ -0,0 +1,67 @@
+﻿// MediaManifest.h - Content hashes of the lane media tree
+#ifndef MEDIAMANIFEST_H
+#define MEDIAMANIFEST_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QJsonObject>
+#include <QByteArray>
+
+// Every file under the synced media directories, split into fixed-size
+// chunks, each named by its SHA-256. The server publishes its manifest; a
+// lane builds the same for its SD card and fetches only the chunks it has
+// nowhere locally, so a changed advert costs the changed chunks and a file
+// that was only renamed or moved costs nothing.
+//
+//   { "version": "<sha256 of the file list>", "chunk_size": 65536,
+//     "files": [ { "path": "ads/spring.mp4", "size": 1234567, "hash": "...",
+//                  "modified": 1700000000000, "chunks": ["...", ...] } ] }
+struct MediaFileEntry {
+    QString path;               // Relative to the media root, '/' separated
+    qint64 size = 0;
+    qint64 modified = 0;        // ms since epoch - only used to skip rehashing
+    QByteArray hash;            // Hex SHA-256 of the whole file
+    QVector<QByteArray> chunks; // Hex SHA-256 per CHUNK_SIZE block
+
+    QJsonObject toJson() const;
+    static MediaFileEntry fromJson(const QJsonObject& json);
+};
+
+class MediaManifest {
+public:
+    // Hash every file under root/<dir> for each dir. Files whose size and
+    // modification time match an entry in `previous` reuse its hashes.
+    static MediaManifest scan(const QString& root, const QStringList& dirs,
+                              const MediaManifest* previous = nullptr);
+
+    QJsonObject toJson() const;
+    static MediaManifest fromJson(const QJsonObject& json);
+
+    bool load(const QString& path);
+    bool save(const QString& path) const;
+
+    QByteArray version() const { return manifestVersion; }
+    const QHash<QString, MediaFileEntry>& files() const { return entries; }
+    bool contains(const QString& path) const { return entries.contains(path); }
+    MediaFileEntry file(const QString& path) const { return entries.value(path); }
+
+    // Where a chunk can be read from: file path and chunk index
+    bool locate(const QByteArray& chunkHash, QString* path, int* index) const;
+    bool readChunk(const QString& root, const QByteArray& chunkHash, QByteArray* data) const;
+
+    static QByteArray hashOf(const QByteArray& data);
+
+    static constexpr int CHUNK_SIZE = 64 * 1024;   // Small enough not to stall game messages on the shared socket
+
+private:
+    void index();
+
+    QHash<QString, MediaFileEntry> entries;
+    QHash<QByteArray, QPair<QString, int>> chunkIndex;
+    QByteArray manifestVersion;
+};
+
+#endif // MEDIAMANIFEST_H
@@ -0,0 +1,90 @@
+﻿#include "MediaPublisher.h"
+#include "LaneServer.h"
+#include <QJsonArray>
+#include <QDebug>
+
+MediaPublisher::MediaPublisher(LaneServer* server, const QString& root, QObject* parent)
+    : QObject(parent)
+    , server(server)
+    , root(root)
+    , directories({"ads", "effects"})
+    , rescanTimer(new QTimer(this))
+    , maxBytesPerSecond(4 * 1024 * 1024)
+    , windowBytes(0)
+    , servedTotal(0)
+{
+    window.start();
+
+    server->registerRequestHandler("media_manifest", [this](int, const QJsonObject&, QString*) {
+        return serveManifest();
+    });
+    server->registerRequestHandler("media_chunk", [this](int laneId, const QJsonObject& data, QString* error) {
+        return serveChunk(laneId, data, error);
+    });
+
+    connect(rescanTimer, &QTimer::timeout, this, &MediaPublisher::rescan);
+    rescanTimer->start(60000);
+    rescan();
+}
+
+void MediaPublisher::loadSettings(const QJsonObject& settings) {
+    root = settings["Root"].toString(root);
+    maxBytesPerSecond = static_cast<qint64>(settings["MaxBytesPerSecond"].toDouble(double(maxBytesPerSecond)));
+    rescanTimer->start(settings["RescanSeconds"].toInt(60) * 1000);
+
+    if (settings.contains("Directories")) {
+        directories.clear();
+        for (const QJsonValue& dir : settings["Directories"].toArray()) {
+            directories.append(dir.toString());
+        }
+    }
+
+    rescan();
+}
+
+void MediaPublisher::rescan() {
+    QByteArray previous = manifest.version();
+    manifest = MediaManifest::scan(root, directories, &manifest);
+    if (manifest.version() == previous) {
+        return;
+    }
+
+    qDebug() << "Media manifest" << manifest.version().left(12) << "-" << manifest.files().size()
+             << "files under" << root;
+
+    QJsonObject data;
+    data["version"] = QString::fromLatin1(manifest.version());
+    server->broadcast("all", "media_manifest_available", data);
+}
+
+QJsonObject MediaPublisher::serveManifest() {
+    return manifest.toJson();
+}
+
+QJsonObject MediaPublisher::serveChunk(int laneId, const QJsonObject& data, QString* error) {
+    if (window.elapsed() >= 1000) {
+        window.restart();
+        windowBytes = 0;
+    }
+    if (maxBytesPerSecond > 0 && windowBytes >= maxBytesPerSecond) {
+        *error = "busy";
+        return QJsonObject();
+    }
+
+    QByteArray hash = data["hash"].toString().toLatin1();
+    QByteArray bytes;
+    if (!manifest.readChunk(root, hash, &bytes)) {
+        // Edited since the last scan - the lane gets the new manifest shortly
+        qWarning() << "Lane" << laneId << "asked for unknown media chunk" << hash.left(12);
+        *error = "Unknown chunk";
+        return QJsonObject();
+    }
+
+    windowBytes += bytes.size();
+    servedTotal += bytes.size();
+
+    QJsonObject result;
+    result["hash"] = QString::fromLatin1(hash);
+    result["data"] = QString::fromLatin1(bytes.toBase64());
+    return result;
+}
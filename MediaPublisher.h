@@ -0,0 +1,51 @@
+﻿// MediaPublisher.h - Server side of lane media sync
+#ifndef MEDIAPUBLISHER_H
+#define MEDIAPUBLISHER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QStringList>
+#include "MediaManifest.h"
+
+class LaneServer;
+
+// Publishes the media tree under `root` to the lanes (see MediaSync). It
+// answers "media_manifest" and "media_chunk" for every lane connection and,
+// when a rescan finds a new version, broadcasts "media_manifest_available"
+// so each lane pulls the chunks it lacks. All lanes share one byte budget
+// per second; a chunk request over it gets "busy" and the lane retries, so
+// a 40-lane refresh never floods the house network.
+class MediaPublisher : public QObject {
+    Q_OBJECT
+
+public:
+    MediaPublisher(LaneServer* server, const QString& root, QObject* parent = nullptr);
+
+    // Configuration from settings.json "MediaSync"
+    // { "Root": "media", "Directories": ["ads", "effects"], "MaxBytesPerSecond": 4194304, "RescanSeconds": 60 }
+    void loadSettings(const QJsonObject& settings);
+
+    // Re-hash what changed on disk; announces a new version to every lane
+    void rescan();
+
+    QByteArray version() const { return manifest.version(); }
+    qint64 bytesServed() const { return servedTotal; }
+
+private:
+    QJsonObject serveManifest();
+    QJsonObject serveChunk(int laneId, const QJsonObject& data, QString* error);
+
+    LaneServer* server;
+    QString root;
+    QStringList directories;
+    MediaManifest manifest;
+    QTimer* rescanTimer;
+
+    qint64 maxBytesPerSecond;
+    QElapsedTimer window;
+    qint64 windowBytes;
+    qint64 servedTotal;
+};
+
+#endif // MEDIAPUBLISHER_H
@@ -0,0 +1,329 @@
+﻿#include "MediaSync.h"
+#include "TaskScheduler.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QDebug>
+
+MediaSync::MediaSync(const QString& root, Transport transport, QObject* parent)
+    : QObject(parent)
+    , root(root)
+    , transport(std::move(transport))
+    , paceTimer(new QTimer(this))
+    , enabled(true)
+    , directories({"ads", "effects"})
+    , idleBytesPerSecond(1024 * 1024)
+    , gameBytesPerSecond(0)
+    , gameActive(false)
+    , running(false)
+    , syncQueued(false)
+    , applyRounds(0)
+    , chunkRetries(0)
+    , nextMissing(0)
+{
+    paceTimer->setSingleShot(true);
+    connect(paceTimer, &QTimer::timeout, this, &MediaSync::requestNextChunk);
+
+    local.load(stagingPath() + "/manifest.json");
+}
+
+void MediaSync::loadSettings(const QJsonObject& settings) {
+    enabled = settings["Enabled"].toBool(true);
+    idleBytesPerSecond = settings["IdleBytesPerSecond"].toInt(idleBytesPerSecond);
+    gameBytesPerSecond = settings["GameBytesPerSecond"].toInt(gameBytesPerSecond);
+
+    if (settings.contains("Directories")) {
+        directories.clear();
+        for (const QJsonValue& dir : settings["Directories"].toArray()) {
+            directories.append(dir.toString());
+        }
+    }
+
+    qDebug() << "Media sync" << (enabled ? "enabled" : "disabled") << "for" << directories
+             << "- idle" << idleBytesPerSecond << "B/s, in game" << gameBytesPerSecond << "B/s";
+}
+
+QString MediaSync::stagingPath(const QByteArray& hash) const {
+    QString staging = QDir(root).filePath(".media_sync");
+    return hash.isEmpty() ? staging : staging + "/" + QString::fromLatin1(hash);
+}
+
+int MediaSync::currentRate() const {
+    return gameActive ? gameBytesPerSecond : idleBytesPerSecond;
+}
+
+void MediaSync::setGameActive(bool active) {
+    if (gameActive == active) {
+        return;
+    }
+    gameActive = active;
+
+    // A transfer paused for the game picks up where it stopped
+    if (running && !paceTimer->isActive() && currentRate() > 0 && nextMissing < missing.size()) {
+        scheduleNext(0);
+    }
+}
+
+void MediaSync::sync() {
+    if (!enabled) {
+        return;
+    }
+    if (running) {
+        syncQueued = true;
+        return;
+    }
+
+    running = true;
+    syncQueued = false;
+    applyRounds = 0;
+    stats = Stats();
+    clock.start();
+
+    transport("media_manifest", QJsonObject(), [this](const RpcResult& result) { onManifest(result); });
+}
+
+void MediaSync::onManifest(const RpcResult& result) {
+    if (!result.ok) {
+        finish(false, result.timedOut ? "Manifest request timed out" : result.error);
+        return;
+    }
+
+    remote = MediaManifest::fromJson(result.result);
+    if (remote.version() == appliedVersion) {
+        finish(true);
+        return;
+    }
+
+    // Rehash only what changed on the card since the last sync, on a Media
+    // worker - a changed advert can take seconds to hash on the Pi
+    const QString scanRoot = root;
+    const QStringList scanDirectories = directories;
+    const MediaManifest previous = local;
+    TaskScheduler::instance()->run(TaskScheduler::Media, this,
+        [scanRoot, scanDirectories, previous]() { return MediaManifest::scan(scanRoot, scanDirectories, &previous); },
+        [this](const MediaManifest& scanned) {
+            local = scanned;
+            planTransfer();
+        });
+}
+
+void MediaSync::planTransfer() {
+    QDir().mkpath(stagingPath());
+
+    QSet<QByteArray> needed;
+    missing.clear();
+    nextMissing = 0;
+    chunkRetries = 0;
+
+    for (const MediaFileEntry& entry : remote.files()) {
+        if (local.file(entry.path).hash == entry.hash) {
+            continue;
+        }
+        for (const QByteArray& chunk : entry.chunks) {
+            QString path;
+            int index = 0;
+            if (needed.contains(chunk) || local.locate(chunk, &path, &index) ||
+                QFile::exists(stagingPath(chunk))) {
+                continue;
+            }
+            needed.insert(chunk);
+            missing.append(chunk);
+        }
+    }
+
+    qDebug() << "Media sync: manifest" << remote.version().left(12) << "-" << missing.size()
+             << "chunks to fetch";
+
+    if (missing.isEmpty()) {
+        applyChanges();
+    } else {
+        scheduleNext(0);
+    }
+}
+
+void MediaSync::scheduleNext(int delayMs) {
+    if (currentRate() <= 0) {
+        return;     // Paused for the game; setGameActive(false) resumes
+    }
+    paceTimer->start(delayMs);
+}
+
+void MediaSync::requestNextChunk() {
+    if (!running) {
+        return;
+    }
+    if (nextMissing >= missing.size()) {
+        applyChanges();
+        return;
+    }
+    if (currentRate() <= 0) {
+        return;
+    }
+
+    QByteArray hash = missing[nextMissing];
+    QJsonObject data;
+    data["hash"] = QString::fromLatin1(hash);
+    transport("media_chunk", data, [this, hash](const RpcResult& result) { onChunk(hash, result); });
+}
+
+void MediaSync::onChunk(const QByteArray& hash, const RpcResult& result) {
+    if (!running) {
+        return;
+    }
+
+    if (!result.ok) {
+        // The server sheds load when many lanes refresh at once
+        if (result.error == "busy") {
+            scheduleNext(BUSY_RETRY_MS);
+            return;
+        }
+        if (++chunkRetries > MAX_CHUNK_RETRIES) {
+            finish(false, QString("Chunk %1: %2").arg(QString::fromLatin1(hash.left(12)),
+                                                      result.timedOut ? "timed out" : result.error));
+            return;
+        }
+        scheduleNext(BUSY_RETRY_MS);
+        return;
+    }
+
+    QByteArray data = QByteArray::fromBase64(result.result["data"].toString().toLatin1());
+    if (MediaManifest::hashOf(data) != hash) {
+        finish(false, "Chunk failed verification");
+        return;
+    }
+
+    QSaveFile staged(stagingPath(hash));
+    if (!staged.open(QIODevice::WriteOnly) || staged.write(data) != data.size() || !staged.commit()) {
+        finish(false, "Cannot write to " + stagingPath());
+        return;
+    }
+
+    chunkRetries = 0;
+    stats.chunksFetched++;
+    stats.bytesFetched += data.size();
+    nextMissing++;
+    emit progress(nextMissing, missing.size());
+
+    // Pace by bytes, not requests: a full chunk at the current rate
+    int rate = currentRate();
+    scheduleNext(rate > 0 ? int(qint64(data.size()) * 1000 / rate) : 0);
+}
+
+bool MediaSync::assemble(const MediaFileEntry& entry, QVector<QByteArray>* unavailable) {
+    QString target = QDir(root).filePath(entry.path);
+    QDir().mkpath(QFileInfo(target).absolutePath());
+
+    // Written beside the old file and renamed over it on commit
+    QSaveFile file(target);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Media sync: cannot write" << target;
+        return false;
+    }
+
+    QCryptographicHash whole(QCryptographicHash::Sha256);
+    qint64 reused = 0;
+    for (const QByteArray& chunk : entry.chunks) {
+        QByteArray data;
+        QFile staged(stagingPath(chunk));
+        if (staged.open(QIODevice::ReadOnly)) {
+            data = staged.readAll();
+        } else if (local.readChunk(root, chunk, &data)) {
+            reused += data.size();
+        } else {
+            // Its local source was itself replaced earlier in this pass
+            unavailable->append(chunk);
+            file.cancelWriting();
+            return false;
+        }
+        whole.addData(data);
+        file.write(data);
+    }
+
+    if (whole.result().toHex() != entry.hash) {
+        qWarning() << "Media sync:" << entry.path << "failed verification";
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        qWarning() << "Media sync: cannot replace" << target;
+        return false;
+    }
+
+    stats.bytesReused += reused;
+    stats.filesChanged++;
+    return true;
+}
+
+void MediaSync::applyChanges() {
+    QVector<QByteArray> unavailable;
+    bool failed = false;
+
+    for (const MediaFileEntry& entry : remote.files()) {
+        if (local.file(entry.path).hash == entry.hash) {
+            continue;
+        }
+        if (!assemble(entry, &unavailable) && unavailable.isEmpty()) {
+            failed = true;
+        }
+    }
+
+    if (!unavailable.isEmpty()) {
+        if (++applyRounds >= MAX_APPLY_ROUNDS) {
+            finish(false, "Chunks unavailable after replacing files");
+            return;
+        }
+        // Fetch what moved under us, then finish the files still missing
+        local = MediaManifest::scan(root, directories, &local);
+        planTransfer();
+        return;
+    }
+    if (failed) {
+        finish(false, "Could not write every file");
+        return;
+    }
+
+    // Removed from the server - only now, their chunks may have been needed above
+    for (const MediaFileEntry& entry : local.files()) {
+        if (!remote.contains(entry.path) && QFile::remove(QDir(root).filePath(entry.path))) {
+            stats.filesRemoved++;
+        }
+    }
+
+    QDir(stagingPath()).removeRecursively();
+    QDir().mkpath(stagingPath());
+
+    local = MediaManifest::scan(root, directories, &local);
+    local.save(stagingPath() + "/manifest.json");
+    appliedVersion = remote.version();
+
+    finish(true);
+}
+
+void MediaSync::finish(bool ok, const QString& error) {
+    paceTimer->stop();
+    running = false;
+
+    stats.ok = ok;
+    stats.error = error;
+    stats.elapsedMs = clock.elapsed();
+
+    if (ok) {
+        if (stats.filesChanged > 0 || stats.filesRemoved > 0) {
+            qDebug() << "Media sync:" << stats.filesChanged << "files updated," << stats.filesRemoved << "removed -"
+                     << stats.bytesFetched << "bytes fetched," << stats.bytesReused << "reused in"
+                     << stats.elapsedMs << "ms";
+        }
+    } else {
+        qWarning() << "Media sync failed:" << error << "- staged chunks kept for the next attempt";
+    }
+
+    emit syncFinished(stats);
+
+    if (syncQueued) {
+        sync();
+    }
+}
@@ -0,0 +1,102 @@
+﻿// MediaSync.h - Keep the lane's media directories in step with the server
+#ifndef MEDIASYNC_H
+#define MEDIASYNC_H
+
+#include <QObject>
+#include <QTimer>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <functional>
+#include "MediaManifest.h"
+#include "RpcChannel.h"
+
+// Fetches the server's MediaManifest, works out which chunks this lane has
+// nowhere on its card, downloads just those into a staging directory and
+// then rebuilds each changed file beside the old one, verifies it and
+// renames it into place (QSaveFile), so MediaManager never sees a partial
+// file. Files the server no longer lists are removed last.
+//
+// Requests go over the lane connection as RPCs:
+//
+//   "media_manifest" {}                  -> the manifest JSON
+//   "media_chunk"    { "hash": "..." }   -> { "hash": "...", "data": "<base64>" }
+//
+// One chunk is in flight at a time and the next is paced by the byte rate,
+// which drops to GameBytesPerSecond (0 = pause) while a game is on, so a
+// content refresh never competes with game traffic. Staged chunks survive
+// a reboot or disconnect and are not fetched again.
+class MediaSync : public QObject {
+    Q_OBJECT
+
+public:
+    using Transport = std::function<void(const QString& method, const QJsonObject& data, RpcChannel::Callback done)>;
+
+    MediaSync(const QString& root, Transport transport, QObject* parent = nullptr);
+
+    // Configuration from settings.json "MediaSync"
+    void loadSettings(const QJsonObject& settings);
+
+    void sync();
+    void setGameActive(bool active);
+    bool isRunning() const { return running; }
+
+    struct Stats {
+        bool ok = false;
+        QString error;
+        int filesChanged = 0;
+        int filesRemoved = 0;
+        int chunksFetched = 0;
+        qint64 bytesFetched = 0;    // Over the network
+        qint64 bytesReused = 0;     // Copied from chunks already on the card
+        qint64 elapsedMs = 0;
+    };
+
+signals:
+    void progress(int chunksFetched, int chunksTotal);
+    void syncFinished(const MediaSync::Stats& stats);
+
+private:
+    void onManifest(const RpcResult& result);
+    void planTransfer();
+    void requestNextChunk();
+    void onChunk(const QByteArray& hash, const RpcResult& result);
+    void applyChanges();
+    bool assemble(const MediaFileEntry& entry, QVector<QByteArray>* unavailable);
+    void finish(bool ok, const QString& error = QString());
+    void scheduleNext(int delayMs);
+    int currentRate() const;
+    QString stagingPath(const QByteArray& hash = QByteArray()) const;
+
+    QString root;
+    Transport transport;
+    QTimer* paceTimer;
+
+    bool enabled;
+    QStringList directories;
+    int idleBytesPerSecond;
+    int gameBytesPerSecond;
+    bool gameActive;
+
+    bool running;
+    bool syncQueued;            // Requested again while running
+    int applyRounds;
+    int chunkRetries;
+
+    MediaManifest local;
+    MediaManifest remote;
+    QByteArray appliedVersion;
+    QVector<QByteArray> missing;
+    int nextMissing;
+
+    Stats stats;
+    QElapsedTimer clock;
+
+    static constexpr int BUSY_RETRY_MS = 1000;
+    static constexpr int MAX_CHUNK_RETRIES = 3;
+    static constexpr int MAX_APPLY_ROUNDS = 2;
+};
+
+Q_DECLARE_METATYPE(MediaSync::Stats)
+
+#endif // MEDIASYNC_H
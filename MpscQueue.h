@@ -0,0 +1,69 @@
+﻿// MpscQueue.h - Lock-free multi-producer, single-consumer queue
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded linked queue (Vyukov). Any number of threads may push();
+// only the owning thread may pop(). A push is one allocation and one
+// atomic exchange, and never waits on the consumer or other producers.
+//
+// pop() can briefly report empty while a producer is between its
+// exchange and its link store; callers that wake the consumer after
+// pushing (see EventBus) pick that item up on the next drain.
+template<typename T>
+class MpscQueue {
+public:
+    MpscQueue()
+        : head(new Node())
+        , tail(head.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~MpscQueue() {
+        T discard;
+        while (pop(discard)) {}
+        delete tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread
+    void push(T value) {
+        Node* node = new Node(std::move(value));
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer thread only
+    bool pop(T& value) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) return false;
+
+        value = std::move(next->value);
+        delete tail;
+        tail = next;        // next becomes the new stub
+        return true;
+    }
+
+    // Consumer thread only; approximate while producers are active
+    bool isEmpty() const {
+        return tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node {
+        Node() : next(nullptr) {}
+        explicit Node(T&& v) : next(nullptr), value(std::move(v)) {}
+
+        std::atomic<Node*> next;
+        T value;
+    };
+
+    alignas(64) std::atomic<Node*> head;    // Producers
+    alignas(64) Node* tail;                 // Consumer
+};
+
+#endif // MPSCQUEUE_H
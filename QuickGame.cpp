@@ -20,7 +20,7 @@ int Ball::calculateValue(const QVector<int>& pins) {
     
     int total = 0;
     for (int i = 0; i < 5; ++i) {
-        if (pins[i] == 1) { // Pin down
+        if (pins[i] == 0) { // Pin down - MachineInterface reports 0 = down, 1 = standing
             total += QuickGame::PIN_VALUES[i];
         }
     }
@@ -157,6 +157,9 @@ void Bowler::reset() {
 QJsonObject Bowler::toJson() const {
     QJsonObject obj;
     obj["name"] = name;
+    if (!id.isEmpty()) {
+        obj["id"] = id;
+    }
     obj["current_frame"] = currentFrame;
     obj["total_score"] = totalScore;
     
@@ -176,6 +179,9 @@ QJsonObject Bowler::toJson() const {
                 pinsArray.append(pin);
             }
             ballObj["pins"] = pinsArray;
+            if (ball.timing.isValid()) {
+                ballObj["timing"] = ball.timing.toJson();
+            }
             ballsArray.append(ballObj);
         }
         frameObj["balls"] = ballsArray;
@@ -188,6 +194,7 @@ QJsonObject Bowler::toJson() const {
 
 void Bowler::fromJson(const QJsonObject& json) {
     name = json["name"].toString();
+    id = json["id"].toString();
     currentFrame = json["current_frame"].toInt();
     totalScore = json["total_score"].toInt();
     
@@ -214,6 +221,8 @@ void Bowler::fromJson(const QJsonObject& json) {
             }
             
             Ball ball(pins, ballObj["value"].toInt());
+            ball.value = ballObj["value"].toInt();     // As scored - a miss is 0, whatever the pins say
+            ball.timing = BallTiming::fromJson(ballObj["timing"].toObject());
             frame.balls.append(ball);
         }
     }
@@ -221,7 +230,8 @@ void Bowler::fromJson(const QJsonObject& json) {
 
 // QuickGame class implementation
 QuickGame::QuickGame(QObject* parent) 
-    : QObject(parent), currentBowlerIndex(0), gameActive(false), isHeld(false), 
+    : QObject(parent), currentBowlerIndex(0), lastBallBowlerIndex(-1), lastBallFrameIndex(-1),
+      lastBallIndex(-1), ballSequence(0), gameActive(false), isHeld(false), 
       machineEnabled(true), timeLimit(0), gameLimit(0), gamesPlayed(0) {
 
     machine = nullptr;
@@ -244,6 +254,8 @@ void QuickGame::startGame(const QJsonObject& gameData) {
     // Clear existing game state
     bowlers.clear();
     currentBowlerIndex = 0;
+    lastBallBowlerIndex = -1;
+    ballSequence = 0;
     gameActive = false;
     
     // Parse bowlers from server format
@@ -259,6 +271,7 @@ void QuickGame::startGame(const QJsonObject& gameData) {
         
         if (!playerName.isEmpty()) {
             bowlers.append(Bowler(playerName));
+            bowlers.last().id = bowlerObj["id"].toString();
             qDebug() << "Added player:" << playerName;
         }
     }
@@ -320,6 +333,7 @@ void QuickGame::resetGame() {
     }
     
     currentBowlerIndex = 0;
+    lastBallBowlerIndex = -1;
     gamesPlayed = 0;
     
     emit gameUpdated();
@@ -342,11 +356,15 @@ void QuickGame::endGame() {
     results["game_type"] = "ended_by_replacement";
     results["completion_time"] = QDateTime::currentDateTime().toString(Qt::ISODate);
     results["total_time"] = (QDateTime::currentMSecsSinceEpoch() - gameStartTime) / 1000;
+    results["games_played"] = gamesPlayed;
     
     QJsonArray finalScores;
     for (const Bowler& bowler : bowlers) {
         QJsonObject bowlerResult;
         bowlerResult["name"] = bowler.name;
+        if (!bowler.id.isEmpty()) {
+            bowlerResult["id"] = bowler.id;
+        }
         bowlerResult["final_score"] = bowler.totalScore;
         bowlerResult["frames_completed"] = bowler.currentFrame;
         finalScores.append(bowlerResult);
@@ -387,42 +405,28 @@ void QuickGame::removePlayer(const QString& playerName) {
     }
 }
 
-void QuickGame::processBallDetection(const QJsonObject& ballData) {
-    if (!gameActive || isHeld || bowlers.isEmpty()) {
-        qDebug() << "Ball detection ignored - game not active, held, or no bowlers";
-        return;
-    }
-    
-    // Extract pin states from ballData
-    QJsonArray pinsArray = ballData["pins"].toArray();
-    QVector<int> pins;
-    for (const QJsonValue& value : pinsArray) {
-        pins.append(value.toInt());
-    }
-    
-    // Process through existing logic
-    processBall(pins);
-    
-    // Emit the ball processed signal with the provided data
-    emit ballProcessed(ballData);
+void QuickGame::processBall(const QVector<int>& pins, const BallTiming& timing) {
+    processBall(BallEvent::fromPins(pins, timing));
 }
 
-
-void QuickGame::processBall(const QVector<int>& pins) {
+void QuickGame::processBall(BallEvent event) {
     if (!gameActive || isHeld || bowlers.isEmpty()) {
         qDebug() << "Ball ignored - game not active, held, or no bowlers";
         return;
     }
     
-    qDebug() << "Processing ball with pins:" << pins;
-    
     Bowler& currentBowler = bowlers[currentBowlerIndex];
     Frame& currentFrame = currentBowler.getCurrentFrame();
     
     // Create ball object
-    Ball newBall(pins);
+    Ball newBall(event.pinVector(), event.value);
+    newBall.timing = event.timing;
     currentFrame.balls.append(newBall);
     
+    lastBallBowlerIndex = currentBowlerIndex;
+    lastBallFrameIndex = currentBowler.currentFrame;
+    lastBallIndex = currentFrame.balls.size() - 1;
+    
     // Check for special effects
     if (currentFrame.balls.size() == 1 && newBall.value == 15) {
         QJsonObject effectData;
@@ -436,15 +440,16 @@ void QuickGame::processBall(const QVector<int>& pins) {
         emit specialEffect("spare", effectData);
     }
     
-    // Send ball data to server
-    QJsonObject ballData;
-    ballData["bowler"] = currentBowler.name;
-    ballData["frame"] = currentBowler.currentFrame + 1;
-    ballData["ball"] = currentFrame.balls.size();
-    ballData["pins"] = QJsonArray::fromVariantList(QVariantList(pins.begin(), pins.end()));
-    ballData["value"] = newBall.value;
-    ballData["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
-    emit ballProcessed(ballData);
+    // Statistics, 3-6-9 and the server take it from here
+    event.sequence = ++ballSequence;
+    event.bowler = currentBowler.name;
+    event.bowlerId = currentBowler.id;
+    event.bowlerIndex = currentBowlerIndex;
+    event.frame = currentBowler.currentFrame + 1;
+    event.ball = currentFrame.balls.size();
+    event.strike = currentFrame.balls.size() == 1 && newBall.value == 15;
+    event.spare = currentFrame.balls.size() >= 2 && !currentFrame.isStrike() && currentFrame.isSpare();
+    emit ballProcessed(event);
     
     // Update scoring and check completion
     updateScoring();
@@ -453,6 +458,53 @@ void QuickGame::processBall(const QVector<int>& pins) {
     emit gameUpdated();
 }
 
+// Replace the pins of the most recent ball after a late-falling pin
+bool QuickGame::amendLastBall(const QVector<int>& pins) {
+    if (!gameActive || lastBallBowlerIndex < 0 || lastBallBowlerIndex >= bowlers.size()) {
+        return false;
+    }
+    
+    Bowler& bowler = bowlers[lastBallBowlerIndex];
+    if (lastBallFrameIndex < 0 || lastBallFrameIndex >= bowler.frames.size()) {
+        return false;
+    }
+    
+    Frame& frame = bowler.frames[lastBallFrameIndex];
+    if (lastBallIndex < 0 || lastBallIndex >= frame.balls.size()) {
+        return false;
+    }
+    
+    BallEvent event = BallEvent::fromPins(pins, frame.balls[lastBallIndex].timing);
+    Ball amendedBall(pins, event.value);
+    amendedBall.timing = event.timing;
+    qDebug() << "Amending ball" << lastBallIndex + 1 << "of frame" << lastBallFrameIndex + 1
+             << "for" << bowler.name << ":" << frame.balls[lastBallIndex].value << "->" << amendedBall.value;
+    frame.balls[lastBallIndex] = amendedBall;
+    
+    event.sequence = ballSequence;
+    event.bowler = bowler.name;
+    event.bowlerId = bowler.id;
+    event.bowlerIndex = lastBallBowlerIndex;
+    event.frame = lastBallFrameIndex + 1;
+    event.ball = lastBallIndex + 1;
+    event.strike = lastBallIndex == 0 && amendedBall.value == 15;
+    event.spare = lastBallIndex > 0 && frame.isSpare();
+    event.amended = true;
+    emit ballAmended(event);
+    
+    // A late pin can turn the ball into a strike or spare and close the frame
+    bool stillCurrent = (lastBallBowlerIndex == currentBowlerIndex &&
+                         bowler.currentFrame == lastBallFrameIndex && !frame.isComplete);
+    
+    updateScoring();
+    if (stillCurrent) {
+        checkFrameCompletion();
+    }
+    
+    emit gameUpdated();
+    return true;
+}
+
 void QuickGame::holdGame() {
     isHeld = !isHeld;
     
@@ -557,6 +609,7 @@ QJsonObject QuickGame::getGameState() const {
     state["time_limit"] = timeLimit;
     state["game_limit"] = gameLimit;
     state["games_played"] = gamesPlayed;
+    state["ball_sequence"] = qint64(ballSequence);
     state["game_start_time"] = gameStartTime;
     
     QJsonArray bowlersArray;
@@ -575,6 +628,7 @@ void QuickGame::loadGameState(const QJsonObject& state) {
     timeLimit = state["time_limit"].toInt();
     gameLimit = state["game_limit"].toInt();
     gamesPlayed = state["games_played"].toInt();
+    ballSequence = quint32(state["ball_sequence"].toDouble());
     gameStartTime = state["game_start_time"].toVariant().toLongLong();
     
     bowlers.clear();
@@ -836,9 +890,8 @@ bool QuickGame::validateBowlerData(const Bowler& bowler) const {
 
 // Add ball processing integration:
 void QuickGame::onBallDetected(const QVector<int>& pins) {
-    // This method may not be called directly anymore
-    // Instead, main window calls processBallDetection()
-    qDebug() << "Direct ball detection (should use processBallDetection instead):" << pins;
+    // Not connected: the main window hands processBall() a BallEvent
+    qDebug() << "Direct ball detection (main window uses processBall(BallEvent)):" << pins;
     processBall(pins);
 
 }
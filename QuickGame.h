@@ -7,6 +7,8 @@
 #include <QJsonArray>
 #include <QTimer>
 #include <QDebug>
+#include "BallTiming.h"
+#include "BallEvent.h"
 
 // Forward declarations
 class Ball;
@@ -17,10 +19,11 @@ class Bowler;
 // Ball class representing a single throw
 class Ball {
 public:
-    Ball(const QVector<int>& pins = QVector<int>(5, 0), int value = 0);
+    Ball(const QVector<int>& pins = QVector<int>(5, 1), int value = 0);
     
     QVector<int> pins;  // [lTwo, lThree, cFive, rThree, rTwo] - 0=down, 1=up
     int value;          // Total pin value (Canadian 5-pin scoring)
+    BallTiming timing;  // Speed/dwell from the ball sensor, if measured
     
     // Canadian 5-pin pin values: L2=2, L3=3, C5=5, R3=3, R2=2
     static int calculateValue(const QVector<int>& pins);
@@ -59,6 +62,7 @@ public:
     Bowler(const QString& name = "");
     
     QString name;
+    QString id;             // BowlerDirectory member, empty for walk-ins
     QVector<Frame> frames;
     int currentFrame;
     int totalScore;
@@ -101,8 +105,9 @@ public:
     void removePlayer(const QString& playerName);
     
     // Game flow control
-    void processBall(const QVector<int>& pins);
-    void processBallDetection(const QJsonObject& ballData);  // NEW: For main window integration
+    void processBall(BallEvent event);
+    void processBall(const QVector<int>& pins, const BallTiming& timing = BallTiming());
+    bool amendLastBall(const QVector<int>& pins);  // Late-falling pin correction
     void holdGame();
     void skipPlayer();
 
@@ -152,7 +157,8 @@ signals:
     void gameCompleted();
     
     void specialEffect(const QString& effect, const QJsonObject& data = QJsonObject());
-    void ballProcessed(const QJsonObject& ballData);
+    void ballProcessed(const BallEvent& ball);
+    void ballAmended(const BallEvent& ball);
     
     void playerAdded(const QString& playerName);
     void playerRemoved(const QString& playerName);
@@ -197,6 +203,12 @@ private:
     QVector<Bowler> bowlers;
     int currentBowlerIndex;
     
+    // Location of the most recent ball, for late pin corrections
+    int lastBallBowlerIndex;
+    int lastBallFrameIndex;
+    int lastBallIndex;
+    quint32 ballSequence;       // Last BallEvent::sequence handed out this game
+    
     bool gameActive;
     bool isHeld;
     bool machineEnabled;
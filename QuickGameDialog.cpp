@@ -1,6 +1,8 @@
 ﻿#include "QuickGameDialog.h"
 #include <QMessageBox>
 #include <QGroupBox>
+#include <QAbstractItemView>
+#include "BowlerDirectory.h"
 
 QuickGameDialog::QuickGameDialog(QWidget *parent)
     : QDialog(parent)
@@ -52,6 +54,8 @@ void QuickGameDialog::setupUI()
         QLineEdit *nameEdit = new QLineEdit;
         nameEdit->setPlaceholderText("Enter bowler name");
         m_bowlerEdits.append(nameEdit);
+        m_bowlerIds.append(QString());
+        attachCompleter(i);
         bowlersLayout->addWidget(nameEdit, row, 1);
         
         // Shoes checkbox
@@ -129,6 +133,72 @@ void QuickGameDialog::setupUI()
     m_mainLayout->addLayout(buttonLayout);
 }
 
+void QuickGameDialog::attachCompleter(int row)
+{
+    QLineEdit *edit = m_bowlerEdits[row];
+    
+    // The directory does the matching; the completer only shows the result
+    QCompleter *completer = new QCompleter(new QStandardItemModel(this), this);
+    completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    completer->setCompletionRole(NAME_ROLE);
+    completer->setWidget(edit);
+    m_completers.append(completer);
+    
+    connect(edit, &QLineEdit::textEdited, this, [this, row](const QString &text) {
+        m_bowlerIds[row].clear();
+        updateCompletions(row, text);
+    });
+    connect(completer, static_cast<void (QCompleter::*)(const QModelIndex &)>(&QCompleter::activated),
+            this, [this, row](const QModelIndex &index) {
+                m_bowlerEdits[row]->setText(index.data(NAME_ROLE).toString());
+                m_bowlerIds[row] = index.data(ID_ROLE).toString();
+            });
+}
+
+void QuickGameDialog::updateCompletions(int row, const QString &text)
+{
+    QCompleter *completer = m_completers[row];
+    QStandardItemModel *model = static_cast<QStandardItemModel*>(completer->model());
+    model->clear();
+    
+    const BowlerDirectory &directory = BowlerDirectory::instance();
+    const QVector<int> matches = directory.complete(text, MAX_COMPLETIONS);
+    for (int index : matches) {
+        const BowlerRecord &member = directory.member(index);
+        QString label = member.name;
+        if (!member.league.isEmpty()) {
+            label += QString("  -  %1").arg(member.league);
+        }
+        if (member.average > 0) {
+            label += QString("  (%1)").arg(member.average);
+        }
+        
+        QStandardItem *item = new QStandardItem(label);
+        item->setData(member.name, NAME_ROLE);
+        item->setData(member.id, ID_ROLE);
+        item->setEditable(false);
+        model->appendRow(item);
+    }
+    
+    if (matches.isEmpty()) {
+        completer->popup()->hide();
+    } else {
+        completer->complete();
+    }
+}
+
+QString QuickGameDialog::bowlerIdFor(int row) const
+{
+    if (!m_bowlerIds[row].isEmpty()) {
+        return m_bowlerIds[row];
+    }
+    
+    // Typed in full rather than picked - still the same member if the name is unique
+    const BowlerDirectory &directory = BowlerDirectory::instance();
+    int index = directory.findByName(m_bowlerEdits[row]->text());
+    return index >= 0 ? directory.member(index).id : QString();
+}
+
 void QuickGameDialog::onClearClicked()
 {
     clearForm();
@@ -142,6 +212,10 @@ void QuickGameDialog::clearForm()
         edit->clear();
     }
     
+    for (QString &id : m_bowlerIds) {
+        id.clear();
+    }
+    
     for (QCheckBox *check : m_shoesCheckBoxes) {
         check->setChecked(false);
     }
@@ -223,6 +297,10 @@ QJsonObject QuickGameDialog::getGameData() const
         if (!name.isEmpty()) {
             QJsonObject bowler;
             bowler["name"] = name;
+            QString id = bowlerIdFor(i);
+            if (!id.isEmpty()) {
+                bowler["id"] = id;
+            }
             bowler["shoes"] = m_shoesCheckBoxes[i]->isChecked();
             bowler["youth"] = m_youthCheckBoxes[i]->isChecked();
             
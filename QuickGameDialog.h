@@ -13,6 +13,8 @@
 #include <QPushButton>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QCompleter>
+#include <QStandardItemModel>
 
 class QuickGameDialog : public QDialog
 {
@@ -30,6 +32,9 @@ private slots:
 private:
     void setupUI();
     void clearForm();
+    void attachCompleter(int row);
+    void updateCompletions(int row, const QString &text);
+    QString bowlerIdFor(int row) const;
     
     QVBoxLayout *m_mainLayout;
     QLineEdit *m_laneEdit;
@@ -37,12 +42,17 @@ private:
     QList<QCheckBox*> m_shoesCheckBoxes;
     QList<QCheckBox*> m_youthCheckBoxes;
     QList<QCheckBox*> m_prebowlCheckBoxes;
+    QList<QCompleter*> m_completers;
+    QVector<QString> m_bowlerIds;           // Directory member picked for each row
     QSpinBox *m_gamesSpinBox;
     QSpinBox *m_timeSpinBox;
     QSpinBox *m_framesSpinBox;
     QComboBox *m_totalDisplayCombo;
     
     static const int MAX_BOWLERS = 10;
+    static const int MAX_COMPLETIONS = 8;
+    static const int NAME_ROLE = Qt::UserRole;
+    static const int ID_ROLE = Qt::UserRole + 1;
 
 signals:
     void gameStartRequested(const QJsonObject &gameData);
@@ -1,9 +1,13 @@
 ﻿#include "QuickStartDialog.h"
 #include "MainWindow.h"
 #include "QuickGameDialog.h"
+#include "EventLog.h"
+#include "EndOfDayReport.h"
 #include <QMessageBox>
 #include <QApplication>
 #include <QScreen>
+#include <QDate>
+#include <QJsonObject>
 
 QuickStartDialog::QuickStartDialog(MainWindow *mainWindow, QWidget *parent)
     : QDialog(parent)
@@ -226,7 +230,35 @@ void QuickStartDialog::onSetupClicked()
 
 void QuickStartDialog::onEndDayClicked()
 {
-    QMessageBox::information(this, "End Day", "End of day procedures coming soon!");
+    QDate today = QDate::currentDate();
+    
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QJsonObject report;
+    EndOfDayReport::Outcome outcome = EndOfDayReport::generate(EventLog::defaultDirectory(), today,
+                                                               "reports", &report);
+    QApplication::restoreOverrideCursor();
+    
+    if (outcome == EndOfDayReport::Outcome::NoActivity) {
+        QMessageBox::warning(this, "End Day", "No lane activity has been logged today.");
+        return;
+    }
+    if (outcome == EndOfDayReport::Outcome::WriteFailed) {
+        QMessageBox::critical(this, "End Day",
+            "The report could not be saved to the reports folder. Check that it is writable and the disk is not full.");
+        return;
+    }
+    
+    QJsonObject house = report["house"].toObject();
+    QMessageBox::information(this, "End Day",
+        QString("Games played: %1\nMinutes sold: %2\nBowlers: %3 (shoes %4, youth %5)\n"
+                "Machine faults: %6\n\nReport saved to reports/%7.txt")
+            .arg(house["games_played"].toInt())
+            .arg(house["minutes_sold"].toInt())
+            .arg(house["bowlers"].toInt())
+            .arg(house["shoes"].toInt())
+            .arg(house["youth"].toInt())
+            .arg(house["faults"].toInt())
+            .arg(today.toString(Qt::ISODate)));
 }
 
 void QuickStartDialog::onNewGameTypeClicked()
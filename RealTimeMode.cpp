@@ -0,0 +1,110 @@
+﻿#include "RealTimeMode.h"
+#include <QFile>
+#include <QStringList>
+#include <QDebug>
+#include <chrono>
+#include <thread>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+RealTimeSettings RealTimeSettings::fromJson(const QJsonObject& json) {
+    RealTimeSettings settings;
+    settings.enabled = json["Enabled"].toBool(settings.enabled);
+    settings.priority = qBound(1, json["Priority"].toInt(settings.priority), 99);
+    settings.cpu = qMax(0, json["Cpu"].toInt(settings.cpu));
+    settings.lockMemory = json["LockMemory"].toBool(settings.lockMemory);
+    return settings;
+}
+
+qint64 RealTimeMode::monotonicNs() {
+#ifdef Q_OS_LINUX
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec) * 1000000000LL + now.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void RealTimeMode::sleepUntilNs(qint64 deadlineNs) {
+#ifdef Q_OS_LINUX
+    timespec deadline;
+    deadline.tv_sec = deadlineNs / 1000000000LL;
+    deadline.tv_nsec = deadlineNs % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {}
+#else
+    const qint64 remainingNs = deadlineNs - monotonicNs();
+    if (remainingNs > 0) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(remainingNs));
+    }
+#endif
+}
+
+bool RealTimeMode::isIsolated(int cpu) {
+    // e.g. "3" or "2-3,5"
+    QFile file("/sys/devices/system/cpu/isolated");
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    const QString list = QString::fromLatin1(file.readAll()).trimmed();
+    for (const QString& range : list.split(',', Qt::SkipEmptyParts)) {
+        const QStringList bounds = range.split('-');
+        const int first = bounds.value(0).toInt();
+        const int last = bounds.size() > 1 ? bounds.value(1).toInt() : first;
+        if (cpu >= first && cpu <= last) return true;
+    }
+    return false;
+}
+
+bool RealTimeMode::applyToCurrentThread(const RealTimeSettings& settings, QString* error) {
+    QStringList failures;
+
+#ifdef Q_OS_LINUX
+    if (settings.lockMemory) {
+        // Process-wide and idempotent; MCL_FUTURE covers stacks and heap allocated later
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            failures << QString("mlockall: %1").arg(strerror(errno));
+        } else {
+            // Fault in the stack this thread will use before the deadline loop starts
+            volatile char stack[64 * 1024];
+            for (size_t i = 0; i < sizeof(stack); i += 4096) stack[i] = 0;
+        }
+    }
+
+    if (settings.cpu >= 0 && settings.cpu < CPU_SETSIZE) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(settings.cpu, &cpus);
+        const int result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (result != 0) {
+            failures << QString("affinity to CPU %1: %2").arg(settings.cpu).arg(strerror(result));
+        } else if (!isIsolated(settings.cpu)) {
+            qWarning() << "Real-time mode: CPU" << settings.cpu << "is not isolated - add isolcpus="
+                       << settings.cpu << "to the kernel command line to keep other work off it";
+        }
+    }
+
+    sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = settings.priority;
+    const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0) {
+        failures << QString("SCHED_FIFO %1: %2").arg(settings.priority).arg(strerror(result));
+    }
+#else
+    Q_UNUSED(settings)
+    failures << "not supported on this platform";
+#endif
+
+    if (error) {
+        *error = failures.join("; ");
+    }
+    return failures.isEmpty();
+}
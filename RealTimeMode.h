@@ -0,0 +1,44 @@
+﻿// RealTimeMode.h - Optional real-time scheduling for the acquisition thread
+#ifndef REALTIMEMODE_H
+#define REALTIMEMODE_H
+
+#include <QString>
+#include <QJsonObject>
+
+// The 1 ms ball sensor poll normally runs under the default Linux scheduler,
+// so media decoding or a repaint can hold it off for several milliseconds.
+// In real-time mode the acquisition thread alone runs SCHED_FIFO, pinned to
+// a core the kernel keeps free of other work (isolcpus=<cpu> in
+// cmdline.txt), with the process memory locked so a page fault never lands
+// in the poll. It sleeps to absolute 1 ms deadlines instead of msleep(1).
+// Every other thread stays on normal priority.
+//
+// settings.json "BallDetection" -> "RealTime":
+//   { "Enabled": false, "Priority": 80, "Cpu": 3, "LockMemory": true }
+//
+// Needs root (or CAP_SYS_NICE and CAP_IPC_LOCK); without it the thread
+// carries on as before and says so in the log.
+struct RealTimeSettings {
+    bool enabled = false;
+    int priority = 80;          // SCHED_FIFO 1-99; kernel IRQ threads run at 50
+    int cpu = 3;                // Last core of the Pi 3
+    bool lockMemory = true;
+
+    static RealTimeSettings fromJson(const QJsonObject& json);
+};
+
+class RealTimeMode {
+public:
+    // Applies settings to the calling thread. Returns false with the reason
+    // if any part could not be applied; what did succeed stays in effect.
+    static bool applyToCurrentThread(const RealTimeSettings& settings, QString* error = nullptr);
+
+    // Sleep until an absolute CLOCK_MONOTONIC time (ns, as ClockSync/monotonicNs)
+    static void sleepUntilNs(qint64 deadlineNs);
+    static qint64 monotonicNs();
+
+    // Whether the kernel keeps `cpu` out of general scheduling
+    static bool isIsolated(int cpu);
+};
+
+#endif // REALTIMEMODE_H
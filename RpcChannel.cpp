@@ -0,0 +1,154 @@
+﻿#include "RpcChannel.h"
+#include <QDateTime>
+#include <QDebug>
+
+RpcChannel::RpcChannel(Sender sender, TimingWheel* wheel, QObject* parent)
+    : QObject(parent)
+    , send(std::move(sender))
+    , timers(wheel)
+    , nextRequestId(1)
+{
+    clock.start();
+}
+
+RpcChannel::~RpcChannel()
+{
+    // Futures still resolve; callbacks belong to objects that may already
+    // be gone during teardown, and the wheel may be too
+    for (Pending& entry : pending) {
+        if (timers) {
+            timers->cancel(entry.deadline);
+        }
+        RpcResult result;
+        result.error = "Channel closed";
+        entry.future.reportResult(result);
+        entry.future.reportFinished();
+    }
+}
+
+QFuture<RpcResult> RpcChannel::call(const QString& method, const QJsonObject& data,
+                                    int timeoutMs, Callback callback)
+{
+    const qint64 requestId = nextRequestId++;
+
+    Pending entry;
+    entry.method = method;
+    entry.callback = std::move(callback);
+    entry.future.reportStarted();
+    QFuture<RpcResult> future = entry.future.future();
+
+    entry.deadline = timers->arm(timeoutMs, [this, requestId]() {
+        RpcResult result;
+        result.timedOut = true;
+        result.error = "Timed out";
+        complete(requestId, result);
+    });
+
+    QJsonObject message;
+    message["type"] = method;
+    message["data"] = data;
+    message["request_id"] = requestId;
+    message["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+
+    entry.sentNs = clock.nsecsElapsed();
+    pending.insert(requestId, std::move(entry));
+
+    // Nothing waits for the reply - the next call can go out immediately
+    send(message);
+
+    return future;
+}
+
+void RpcChannel::registerHandler(const QString& method, Handler handler)
+{
+    handlers.insert(method, std::move(handler));
+}
+
+bool RpcChannel::handleMessage(const QJsonObject& message)
+{
+    QString type = message["type"].toString();
+    qint64 requestId = requestIdOf(message);
+
+    if (type == "rpc_response") {
+        if (!pending.contains(requestId)) {
+            // Already timed out or failed on disconnect
+            qDebug() << "Late RPC response for request" << requestId;
+            return true;
+        }
+
+        RpcResult result;
+        result.ok = message["ok"].toBool();
+        result.error = message["error"].toString();
+        result.result = message["result"].toObject();
+        complete(requestId, result);
+        return true;
+    }
+
+    if (requestId > 0 && handlers.contains(type)) {
+        handlers.value(type)(requestId, message["data"].toObject());
+        return true;
+    }
+
+    return false;
+}
+
+void RpcChannel::respond(qint64 requestId, const QJsonObject& result)
+{
+    if (requestId <= 0) return;
+
+    QJsonObject message;
+    message["type"] = "rpc_response";
+    message["request_id"] = requestId;
+    message["ok"] = true;
+    message["result"] = result;
+    send(message);
+}
+
+void RpcChannel::respondError(qint64 requestId, const QString& error)
+{
+    if (requestId <= 0) return;
+
+    QJsonObject message;
+    message["type"] = "rpc_response";
+    message["request_id"] = requestId;
+    message["ok"] = false;
+    message["error"] = error;
+    send(message);
+}
+
+void RpcChannel::failAll(const QString& reason)
+{
+    const QList<qint64> ids = pending.keys();
+    for (qint64 requestId : ids) {
+        RpcResult result;
+        result.error = reason;
+        complete(requestId, result);
+    }
+}
+
+void RpcChannel::complete(qint64 requestId, RpcResult result)
+{
+    auto it = pending.find(requestId);
+    if (it == pending.end()) return;
+
+    Pending entry = std::move(it.value());
+    pending.erase(it);
+    if (timers) {
+        timers->cancel(entry.deadline);
+    }
+
+    result.requestId = requestId;
+    result.latencyUs = (clock.nsecsElapsed() - entry.sentNs) / 1000;
+
+    if (!result.ok) {
+        qWarning() << "RPC" << entry.method << "request" << requestId << "failed:" << result.error;
+    }
+
+    entry.future.reportResult(result);
+    entry.future.reportFinished();
+
+    if (entry.callback) {
+        entry.callback(result);
+    }
+    emit callCompleted(result);
+}
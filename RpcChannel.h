@@ -0,0 +1,93 @@
+﻿// RpcChannel.h - Request/response calls over the lane JSON-lines socket
+#ifndef RPCCHANNEL_H
+#define RPCCHANNEL_H
+
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureInterface>
+#include <functional>
+#include "TimingWheel.h"
+
+struct RpcResult {
+    qint64 requestId = 0;
+    bool ok = false;
+    bool timedOut = false;
+    QString error;
+    QJsonObject result;
+    qint64 latencyUs = 0;       // Send to response, as seen by the caller
+};
+
+// One channel per connection, on both ends. A request is an ordinary
+// message with a request_id added, so older peers still act on it:
+//
+//   { "type": "quick_game", "data": {...}, "request_id": 17 }
+//   { "type": "rpc_response", "request_id": 17, "ok": true, "result": {...} }
+//
+// Any number of requests may be in flight; responses are matched by id
+// in whatever order they arrive. Each request has its own deadline on the
+// connection's TimingWheel and completes exactly once - response, error,
+// timeout or disconnect - through a QFuture and/or a callback.
+class RpcChannel : public QObject {
+    Q_OBJECT
+
+public:
+    using Sender = std::function<void(const QJsonObject&)>;
+    using Callback = std::function<void(const RpcResult&)>;
+
+    // A handler answers through respond()/respondError(), now or later
+    using Handler = std::function<void(qint64 requestId, const QJsonObject& data)>;
+
+    RpcChannel(Sender sender, TimingWheel* timers, QObject* parent = nullptr);
+    ~RpcChannel();
+
+    QFuture<RpcResult> call(const QString& method, const QJsonObject& data,
+                            int timeoutMs = DEFAULT_TIMEOUT_MS, Callback callback = Callback());
+
+    void registerHandler(const QString& method, Handler handler);
+
+    // Feed every incoming message through here first. Returns true if it was
+    // an RPC response or a request taken by a registered handler.
+    bool handleMessage(const QJsonObject& message);
+
+    void respond(qint64 requestId, const QJsonObject& result = QJsonObject());
+    void respondError(qint64 requestId, const QString& error);
+
+    // Connection lost - everything in flight fails now instead of at its deadline
+    void failAll(const QString& reason);
+
+    int pendingCount() const { return pending.size(); }
+
+    static qint64 requestIdOf(const QJsonObject& message) {
+        return static_cast<qint64>(message["request_id"].toDouble(0));
+    }
+
+    static constexpr int DEFAULT_TIMEOUT_MS = 5000;
+
+signals:
+    void callCompleted(const RpcResult& result);
+
+private:
+    struct Pending {
+        QString method;
+        qint64 sentNs = 0;
+        TimingWheel::TimerId deadline = 0;
+        QFutureInterface<RpcResult> future;
+        Callback callback;
+    };
+
+    void complete(qint64 requestId, RpcResult result);
+
+    Sender send;
+    QPointer<TimingWheel> timers;
+    QElapsedTimer clock;
+    qint64 nextRequestId;
+
+    QHash<qint64, Pending> pending;
+    QHash<QString, Handler> handlers;
+};
+
+#endif // RPCCHANNEL_H
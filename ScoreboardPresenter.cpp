@@ -0,0 +1,381 @@
+﻿#include "ScoreboardPresenter.h"
+#include "BowlingWidgets.h"
+#include "LaneTheme.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QWindow>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QJsonArray>
+#include <QDebug>
+
+ScoreboardPresenter::ScoreboardPresenter(QObject* parent)
+    : QObject(parent)
+    , currentIndex(-1)
+    , schemeIndex(LaneTheme::DEFAULT_SCHEME)
+    , showingMedia(true)
+{
+}
+
+ScoreboardPresenter::~ScoreboardPresenter() {
+    // Outputs are top-level windows, not children of the presenter
+    qDeleteAll(outputs);
+}
+
+void ScoreboardPresenter::loadSettings(const QJsonObject& settings) {
+    if (!settings["Enabled"].toBool(false)) {
+        qDebug() << "Extra scoreboard displays disabled";
+        return;
+    }
+
+    QString idleImage = settings["IdleImage"].toString();
+    if (!idleImage.isEmpty()) {
+        mediaImage = QImage(idleImage);
+        if (mediaImage.isNull()) {
+            qWarning() << "Could not load display idle image" << idleImage;
+        }
+    }
+
+    const QList<QScreen*> screens = QGuiApplication::screens();
+    for (const QJsonValue& value : settings["Outputs"].toArray()) {
+        QJsonObject output = value.toObject();
+        int screenIndex = output["Screen"].toInt(-1);
+
+        if (screenIndex < 0 || screenIndex >= screens.size()) {
+            qWarning() << "Scoreboard output screen" << screenIndex << "not present -"
+                       << screens.size() << "screens connected";
+            continue;
+        }
+
+        addOutput(screens[screenIndex], layoutFromString(output["Layout"].toString("overhead")));
+    }
+}
+
+ScoreboardPresenter::Layout ScoreboardPresenter::layoutFromString(const QString& name) {
+    if (name.compare("console", Qt::CaseInsensitive) == 0 ||
+        name.compare("compact", Qt::CaseInsensitive) == 0) {
+        return Layout::Console;
+    }
+    return Layout::Overhead;
+}
+
+ScoreboardOutput* ScoreboardPresenter::addOutput(QScreen* screen, Layout layout) {
+    if (!screen) return nullptr;
+
+    ScoreboardOutput* output = new ScoreboardOutput(this, screen, layout);
+    outputs.append(output);
+    output->showFullScreen();
+
+    qDebug() << "Scoreboard output on" << screen->name() << screen->geometry()
+             << (layout == Layout::Console ? "console layout" : "overhead layout");
+    return output;
+}
+
+void ScoreboardPresenter::setBowlers(const QVector<Bowler>& newBowlers, int newCurrentIndex) {
+    bowlers = newBowlers;
+    currentIndex = newCurrentIndex;
+
+    // Current bowler first, then the others in order
+    displayOrder.clear();
+    if (currentIndex >= 0 && currentIndex < bowlers.size()) {
+        displayOrder.append(currentIndex);
+    }
+    for (int i = 0; i < bowlers.size() && displayOrder.size() < MAX_ROWS; ++i) {
+        if (i != currentIndex) {
+            displayOrder.append(i);
+        }
+    }
+
+    render(false);
+}
+
+void ScoreboardPresenter::setScheme(int newSchemeIndex) {
+    if (schemeIndex == newSchemeIndex) return;
+    schemeIndex = newSchemeIndex;
+    render(true);
+}
+
+void ScoreboardPresenter::setMediaImage(const QImage& image) {
+    mediaImage = image;
+    if (showingMedia) {
+        render(true);
+    }
+}
+
+void ScoreboardPresenter::showScoreboard() {
+    if (!showingMedia) return;
+    showingMedia = false;
+    render(true);
+}
+
+void ScoreboardPresenter::showMedia() {
+    if (showingMedia) return;
+    showingMedia = true;
+    render(true);
+}
+
+void ScoreboardPresenter::render(bool full) {
+    if (outputs.isEmpty()) return;
+
+    usedKeys.clear();
+    for (ScoreboardOutput* output : outputs) {
+        compose(output, full);
+    }
+
+    // Drop cells no output is showing any more
+    for (auto it = cellCache.begin(); it != cellCache.end(); ) {
+        if (usedKeys.contains(it.key())) {
+            ++it;
+        } else {
+            it = cellCache.erase(it);
+        }
+    }
+}
+
+QVector<ScoreboardPresenter::Slot> ScoreboardPresenter::layoutSlots(const ScoreboardOutput* output) {
+    QVector<Slot> cellSlots;
+    const QSize size = output->backing.size();
+    if (size.isEmpty() || displayOrder.isEmpty()) return cellSlots;
+
+    int frameCount = 10;
+    int firstFrame = 0;
+    if (output->layout() == Layout::Console) {
+        frameCount = CONSOLE_FRAMES;
+        if (currentIndex >= 0 && currentIndex < bowlers.size()) {
+            firstFrame = qBound(0, bowlers[currentIndex].currentFrame - 1, 10 - CONSOLE_FRAMES);
+        }
+    }
+
+    // Name = 2 frame widths, total = 1.5 frame widths
+    const qreal unit = size.width() / (2.0 + frameCount + 1.5);
+    const int rows = displayOrder.size();
+    const int rowHeight = size.height() / qMax(rows, 4);  // Two bowlers shouldn't fill the screen
+
+    auto columnX = [unit](qreal units) { return qRound(units * unit); };
+
+    for (int row = 0; row < rows; ++row) {
+        const int bowlerIndex = displayOrder[row];
+        const Bowler& bowler = bowlers[bowlerIndex];
+        const bool isCurrent = bowlerIndex == currentIndex;
+        const int y = row * rowHeight;
+
+        Slot name;
+        name.rect = QRect(0, y, columnX(2.0), rowHeight);
+        name.key = nameCellKey(bowler, isCurrent);
+        name.kind = CellKind::Name;
+        name.bowlerIndex = bowlerIndex;
+        name.frameIndex = -1;
+        name.isCurrent = isCurrent;
+        cellSlots.append(name);
+
+        for (int i = 0; i < frameCount; ++i) {
+            Slot frame;
+            frame.rect = QRect(columnX(2.0 + i), y, columnX(3.0 + i) - columnX(2.0 + i), rowHeight);
+            frame.key = frameCellKey(bowler, firstFrame + i, isCurrent);
+            frame.kind = CellKind::Frame;
+            frame.bowlerIndex = bowlerIndex;
+            frame.frameIndex = firstFrame + i;
+            frame.isCurrent = isCurrent;
+            cellSlots.append(frame);
+        }
+
+        Slot total;
+        total.rect = QRect(columnX(2.0 + frameCount), y,
+                           size.width() - columnX(2.0 + frameCount), rowHeight);
+        total.key = totalCellKey(bowler, isCurrent);
+        total.kind = CellKind::Total;
+        total.bowlerIndex = bowlerIndex;
+        total.frameIndex = -1;
+        total.isCurrent = isCurrent;
+        cellSlots.append(total);
+    }
+
+    return cellSlots;
+}
+
+void ScoreboardPresenter::compose(ScoreboardOutput* output, bool full) {
+    if (output->backing.isNull()) return;
+
+    QPainter painter(&output->backing);
+
+    if (showingMedia) {
+        painter.fillRect(output->backing.rect(), Qt::black);
+        if (!mediaImage.isNull()) {
+            QRect target(QPoint(0, 0), mediaImage.size().scaled(output->backing.size(), Qt::KeepAspectRatio));
+            target.moveCenter(output->backing.rect().center());
+            painter.drawImage(target, mediaImage);
+        }
+        painter.end();
+        output->slotKeys.clear();
+        output->update();
+        return;
+    }
+
+    const QVector<Slot> cellSlots = layoutSlots(output);
+    QRegion dirty;
+
+    if (full || cellSlots.size() != output->slotKeys.size()) {
+        const QPalette& area = LaneTheme::instance().palette(LaneTheme::Role::GameArea, schemeIndex);
+        painter.fillRect(output->backing.rect(), area.color(QPalette::Window));
+        output->slotKeys = QVector<QString>(cellSlots.size());
+        dirty = output->backing.rect();
+    }
+
+    // Only slots whose content changed are redrawn and pushed to the screen
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    for (int i = 0; i < cellSlots.size(); ++i) {
+        const Slot& slot = cellSlots[i];
+        usedKeys.insert(slot.key);
+
+        if (output->slotKeys[i] == slot.key) continue;
+
+        painter.drawImage(slot.rect, cell(slot));
+        output->slotKeys[i] = slot.key;
+        dirty += slot.rect;
+    }
+    painter.end();
+
+    if (!dirty.isEmpty()) {
+        output->update(dirty);
+    }
+}
+
+QString ScoreboardPresenter::frameCellKey(const Bowler& bowler, int frameIndex, bool isCurrent) const {
+    QString balls;
+    QString total = "...";
+    if (frameIndex < bowler.frames.size()) {
+        const Frame& frame = bowler.frames[frameIndex];
+        for (int i = 0; i < frame.balls.size(); ++i) {
+            balls += EnhancedBowlerWidget::formatBallResult(frame.balls[i], i, frame) + ",";
+        }
+        if (frame.isComplete) {
+            total = QString::number(frame.totalScore);
+        }
+    }
+    return QString("F|%1|%2|%3|%4|%5").arg(schemeIndex).arg(isCurrent ? 1 : 0).arg(frameIndex).arg(balls, total);
+}
+
+QString ScoreboardPresenter::nameCellKey(const Bowler& bowler, bool isCurrent) const {
+    return QString("N|%1|%2|%3").arg(schemeIndex).arg(isCurrent ? 1 : 0).arg(bowler.name);
+}
+
+QString ScoreboardPresenter::totalCellKey(const Bowler& bowler, bool isCurrent) const {
+    return QString("T|%1|%2|%3").arg(schemeIndex).arg(isCurrent ? 1 : 0).arg(bowler.totalScore);
+}
+
+const QImage& ScoreboardPresenter::cell(const Slot& slot) {
+    auto it = cellCache.find(slot.key);
+    if (it == cellCache.end()) {
+        it = cellCache.insert(slot.key, renderCell(slot));
+    }
+    return it.value();
+}
+
+QImage ScoreboardPresenter::renderCell(const Slot& slot) const {
+    int width = CELL_WIDTH;
+    if (slot.kind == CellKind::Name) {
+        width = CELL_WIDTH * 2;
+    } else if (slot.kind == CellKind::Total) {
+        width = CELL_WIDTH * 3 / 2;
+    }
+
+    const LaneTheme::Role role = slot.isCurrent ? LaneTheme::Role::CurrentPlayer : LaneTheme::Role::OtherPlayer;
+    const QPalette& palette = LaneTheme::instance().palette(role, schemeIndex);
+    const LaneTheme::Border border = LaneTheme::instance().border(role);
+    const QColor textColor = palette.color(QPalette::WindowText);
+
+    QImage image(width, CELL_HEIGHT, QImage::Format_RGB32);
+    image.fill(palette.color(QPalette::Window));
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+
+    if (border.width > 0) {
+        QColor borderColor = border.color.isValid() ? border.color : textColor;
+        painter.setPen(QPen(borderColor, border.width));
+        painter.setBrush(Qt::NoBrush);
+        qreal inset = border.width / 2.0;
+        painter.drawRect(QRectF(image.rect()).adjusted(inset, inset, -inset, -inset));
+    }
+
+    painter.setPen(textColor);
+    const Bowler& bowler = bowlers[slot.bowlerIndex];
+    const QRect area = image.rect().adjusted(4, 4, -4, -4);
+
+    switch (slot.kind) {
+    case CellKind::Name:
+        painter.setFont(QFont("Arial", 18, QFont::Bold));
+        painter.drawText(area, Qt::AlignCenter, bowler.name);
+        break;
+
+    case CellKind::Total:
+        painter.setFont(QFont("Arial", 22, QFont::Bold));
+        painter.drawText(area, Qt::AlignCenter, QString::number(bowler.totalScore));
+        break;
+
+    case CellKind::Frame: {
+        const QRect header(area.left(), area.top(), area.width(), 16);
+        const QRect ballRow(area.left(), header.bottom() + 2, area.width(), 28);
+        const QRect totalRow(area.left(), ballRow.bottom() + 2, area.width(), area.bottom() - ballRow.bottom() - 2);
+
+        painter.setFont(QFont("Arial", 8, QFont::Bold));
+        painter.drawText(header, Qt::AlignCenter, QString("F%1").arg(slot.frameIndex + 1));
+
+        const Frame* frame = slot.frameIndex < bowler.frames.size() ? &bowler.frames[slot.frameIndex] : nullptr;
+
+        painter.setFont(QFont("Arial", 12));
+        const int ballWidth = ballRow.width() / 3;
+        for (int i = 0; i < 3; ++i) {
+            QString text = "-";
+            if (frame && i < frame->balls.size()) {
+                text = EnhancedBowlerWidget::formatBallResult(frame->balls[i], i, *frame);
+            }
+            painter.drawText(QRect(ballRow.left() + i * ballWidth, ballRow.top(), ballWidth, ballRow.height()),
+                             Qt::AlignCenter, text);
+        }
+
+        painter.setFont(QFont("Arial", 16, QFont::Bold));
+        painter.drawText(totalRow, Qt::AlignCenter,
+                         (frame && frame->isComplete) ? QString::number(frame->totalScore) : QString("..."));
+        break;
+    }
+    }
+
+    return image;
+}
+
+// ScoreboardOutput implementation
+ScoreboardOutput::ScoreboardOutput(ScoreboardPresenter* presenter, QScreen* screen,
+                                   ScoreboardPresenter::Layout layout)
+    : QWidget(nullptr, Qt::Window | Qt::FramelessWindowHint)
+    , presenter(presenter)
+    , outputLayout(layout)
+{
+    // Every pixel comes from the backing image
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setAttribute(Qt::WA_NoSystemBackground);
+    setCursor(Qt::BlankCursor);
+
+    create();
+    if (windowHandle()) {
+        windowHandle()->setScreen(screen);
+    }
+    setGeometry(screen->geometry());
+}
+
+void ScoreboardOutput::paintEvent(QPaintEvent* event) {
+    QPainter painter(this);
+    for (const QRect& rect : event->region()) {
+        painter.drawImage(rect, backing, rect);
+    }
+}
+
+void ScoreboardOutput::resizeEvent(QResizeEvent* event) {
+    QWidget::resizeEvent(event);
+
+    if (event->size().isEmpty()) return;
+    backing = QImage(event->size(), QImage::Format_RGB32);
+    slotKeys.clear();
+    presenter->compose(this, true);
+}
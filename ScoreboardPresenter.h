@@ -0,0 +1,118 @@
+﻿// ScoreboardPresenter.h - Render the scoreboard once and present it on extra screens
+#ifndef SCOREBOARDPRESENTER_H
+#define SCOREBOARDPRESENTER_H
+
+#include <QObject>
+#include <QWidget>
+#include <QImage>
+#include <QRegion>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QJsonObject>
+#include "QuickGame.h"
+
+class QScreen;
+class ScoreboardOutput;
+
+// Overhead/console screens get a lightweight output window instead of a
+// second BowlingMainWindow widget tree. Frame, name and total cells are
+// rendered once into a shared cache keyed by their content. Each output
+// composes its own layout from those cells into a backing image,
+// redrawing only the slots whose cell changed, and repaints just those
+// regions on its screen.
+class ScoreboardPresenter : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Layout {
+        Overhead,   // All ten frames
+        Console     // Compact: four frames around the current one
+    };
+
+    explicit ScoreboardPresenter(QObject* parent = nullptr);
+    ~ScoreboardPresenter();
+
+    // Configuration from settings.json "Displays"
+    void loadSettings(const QJsonObject& settings);
+
+    ScoreboardOutput* addOutput(QScreen* screen, Layout layout);
+    int outputCount() const { return outputs.size(); }
+
+    // Scoreboard content
+    void setBowlers(const QVector<Bowler>& bowlers, int currentIndex);
+    void setScheme(int schemeIndex);
+
+    // Between games the outputs show a still instead of the scoreboard
+    void setMediaImage(const QImage& image);
+    void showScoreboard();
+    void showMedia();
+
+    static Layout layoutFromString(const QString& name);
+
+private:
+    friend class ScoreboardOutput;
+
+    enum class CellKind { Name, Frame, Total };
+
+    struct Slot {
+        QRect rect;
+        QString key;            // Content key into cellCache
+        CellKind kind;
+        int bowlerIndex;
+        int frameIndex;
+        bool isCurrent;
+    };
+
+    QVector<Slot> layoutSlots(const ScoreboardOutput* output);
+    void render(bool full);
+    void compose(ScoreboardOutput* output, bool full);
+
+    // Shared cell cache
+    QString frameCellKey(const Bowler& bowler, int frameIndex, bool isCurrent) const;
+    QString nameCellKey(const Bowler& bowler, bool isCurrent) const;
+    QString totalCellKey(const Bowler& bowler, bool isCurrent) const;
+    const QImage& cell(const Slot& slot);
+    QImage renderCell(const Slot& slot) const;
+
+    QVector<ScoreboardOutput*> outputs;
+    QHash<QString, QImage> cellCache;
+    QSet<QString> usedKeys;         // Keys drawn in the last render, for pruning
+
+    QVector<Bowler> bowlers;
+    QVector<int> displayOrder;      // Current bowler first, as on the lane console
+    int currentIndex;
+    int schemeIndex;
+
+    QImage mediaImage;
+    bool showingMedia;
+
+    static const int CELL_WIDTH = 120;      // Frame cell; name and total cells are wider
+    static const int CELL_HEIGHT = 90;
+    static const int MAX_ROWS = 6;
+    static const int CONSOLE_FRAMES = 4;
+};
+
+// Full-screen window on one QScreen, painting from its backing image
+class ScoreboardOutput : public QWidget {
+    Q_OBJECT
+
+public:
+    ScoreboardOutput(ScoreboardPresenter* presenter, QScreen* screen, ScoreboardPresenter::Layout layout);
+
+    ScoreboardPresenter::Layout layout() const { return outputLayout; }
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+
+private:
+    friend class ScoreboardPresenter;
+
+    ScoreboardPresenter* presenter;
+    ScoreboardPresenter::Layout outputLayout;
+    QImage backing;
+    QVector<QString> slotKeys;      // What is currently composed in each slot
+};
+
+#endif // SCOREBOARDPRESENTER_H
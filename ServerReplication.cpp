@@ -0,0 +1,413 @@
+﻿#include "ServerReplication.h"
+#include <QJsonDocument>
+#include <QNetworkInterface>
+#include <QSaveFile>
+#include <QDebug>
+
+namespace {
+const QHostAddress DISCOVERY_GROUP("224.3.29.71");
+}
+
+ServerReplication::ServerReplication(LaneServer *server, QObject *parent)
+    : QObject(parent)
+    , m_server(server)
+    , m_role(Role::Primary)
+    , m_epoch(1)
+    , m_lanePort(DEFAULT_LANE_PORT)
+    , m_replicationPort(DEFAULT_REPLICATION_PORT)
+    , m_epochFile(DEFAULT_EPOCH_FILE)
+    , m_replicationServer(new QTcpServer(this))
+    , m_standby(nullptr)
+    , m_heartbeatTimer(new QTimer(this))
+    , m_primary(new QTcpSocket(this))
+    , m_failoverTimer(new QTimer(this))
+    , m_retryTimer(new QTimer(this))
+    , m_synced(false)
+    , m_discovery(new QUdpSocket(this))
+    , m_announceTimer(new QTimer(this))
+    , m_announcementsLeft(0)
+{
+    m_heartbeatTimer->setInterval(HEARTBEAT_INTERVAL_MS);
+    m_failoverTimer->setSingleShot(true);
+    m_failoverTimer->setInterval(FAILOVER_TIMEOUT_MS);
+    m_retryTimer->setSingleShot(true);
+    m_retryTimer->setInterval(RETRY_INTERVAL_MS);
+    m_announceTimer->setInterval(ANNOUNCE_INTERVAL_MS);
+
+    connect(m_replicationServer, &QTcpServer::newConnection, this, &ServerReplication::onStandbyConnection);
+    connect(m_heartbeatTimer, &QTimer::timeout, this, &ServerReplication::sendHeartbeat);
+
+    connect(m_primary, &QTcpSocket::connected, this, &ServerReplication::onPrimaryConnected);
+    connect(m_primary, &QTcpSocket::readyRead, this, &ServerReplication::onPrimaryData);
+    connect(m_primary, &QTcpSocket::disconnected, this, &ServerReplication::onPrimaryLost);
+    connect(m_primary, &QAbstractSocket::errorOccurred, this, &ServerReplication::onPrimaryLost);
+    connect(m_failoverTimer, &QTimer::timeout, this, &ServerReplication::onPrimaryLost);
+    connect(m_retryTimer, &QTimer::timeout, this, &ServerReplication::connectToPrimary);
+
+    connect(m_discovery, &QUdpSocket::readyRead, this, &ServerReplication::onDiscoveryDatagram);
+    connect(m_announceTimer, &QTimer::timeout, this, &ServerReplication::announce);
+
+    // Everything the lane server changes goes to the standby, if there is one
+    connect(m_server, &LaneServer::replicationEvent, this, &ServerReplication::replicate);
+}
+
+ServerReplication::~ServerReplication()
+{
+    stop();
+}
+
+void ServerReplication::loadSettings(const QJsonObject &settings)
+{
+    quint16 lanePort = settings["LanePort"].toInt(DEFAULT_LANE_PORT);
+    quint16 replicationPort = settings["ReplicationPort"].toInt(DEFAULT_REPLICATION_PORT);
+    m_announceHost = settings["AnnounceHost"].toString();
+    m_epochFile = settings["EpochFile"].toString(DEFAULT_EPOCH_FILE);
+
+    if (settings["Role"].toString() == "standby") {
+        startStandby(settings["PeerHost"].toString(), lanePort, replicationPort);
+    } else {
+        startPrimary(lanePort, replicationPort);
+    }
+}
+
+void ServerReplication::startPrimary(quint16 lanePort, quint16 replicationPort)
+{
+    m_role = Role::Primary;
+    m_lanePort = lanePort;
+    m_replicationPort = replicationPort;
+    m_epoch = qMax<quint32>(1, loadEpoch());
+
+    m_server->start(lanePort);
+    if (!m_replicationServer->listen(QHostAddress::Any, replicationPort)) {
+        qWarning() << "Replication listener failed on port" << replicationPort << ":"
+                   << m_replicationServer->errorString() << "- running without a standby";
+    }
+    openDiscovery();
+
+    // A newer server, if there is one, answers this and we step down
+    announce();
+
+    qDebug() << "Lane server primary, epoch" << m_epoch << "- replication on port" << replicationPort;
+}
+
+void ServerReplication::startStandby(const QString &primaryHost, quint16 lanePort, quint16 replicationPort)
+{
+    m_role = Role::Standby;
+    m_primaryHost = primaryHost;
+    m_lanePort = lanePort;
+    m_replicationPort = replicationPort;
+    m_epoch = loadEpoch();
+    m_synced = false;
+
+    qDebug() << "Lane server standby for" << primaryHost << ":" << replicationPort;
+    connectToPrimary();
+}
+
+void ServerReplication::stop()
+{
+    m_heartbeatTimer->stop();
+    m_failoverTimer->stop();
+    m_retryTimer->stop();
+    m_announceTimer->stop();
+
+    m_replicationServer->close();
+    if (m_standby) {
+        m_standby->abort();
+    }
+    m_primary->disconnect(this);
+    m_primary->abort();
+    m_discovery->close();
+}
+
+void ServerReplication::onStandbyConnection()
+{
+    while (m_replicationServer->hasPendingConnections()) {
+        QTcpSocket *socket = m_replicationServer->nextPendingConnection();
+
+        // One standby at a time; a new one replaces the old
+        if (m_standby) {
+            qWarning() << "Replacing standby" << m_standby->peerAddress().toString();
+            m_standby->disconnect(this);
+            m_standby->abort();
+            m_standby->deleteLater();
+        }
+
+        m_standby = socket;
+        connect(socket, &QTcpSocket::disconnected, this, &ServerReplication::onStandbyDisconnected);
+
+        QJsonObject snapshot;
+        snapshot["type"] = "replica_snapshot";
+        snapshot["epoch"] = static_cast<qint64>(m_epoch);
+        snapshot["state"] = m_server->replicationSnapshot();
+        sendToStandby(snapshot);
+
+        m_heartbeatTimer->start();
+
+        qDebug() << "Standby attached from" << socket->peerAddress().toString();
+        emit standbyAttached(socket->peerAddress().toString());
+    }
+}
+
+void ServerReplication::onStandbyDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket || socket != m_standby) {
+        return;
+    }
+
+    m_standby = nullptr;
+    m_heartbeatTimer->stop();
+    socket->deleteLater();
+
+    qWarning() << "Standby lost - no failover until it reattaches";
+    emit standbyLost();
+}
+
+void ServerReplication::replicate(const QJsonObject &event)
+{
+    if (!m_standby) {
+        return;
+    }
+
+    QJsonObject message;
+    message["type"] = "replica_event";
+    message["event"] = event;
+    sendToStandby(message);
+}
+
+void ServerReplication::sendToStandby(const QJsonObject &message)
+{
+    if (!m_standby || m_standby->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+
+    m_standby->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n");
+}
+
+void ServerReplication::sendHeartbeat()
+{
+    QJsonObject heartbeat;
+    heartbeat["type"] = "replica_heartbeat";
+    heartbeat["epoch"] = static_cast<qint64>(m_epoch);
+    sendToStandby(heartbeat);
+}
+
+void ServerReplication::connectToPrimary()
+{
+    if (m_role != Role::Standby || m_primary->state() != QAbstractSocket::UnconnectedState) {
+        return;
+    }
+
+    m_primary->connectToHost(m_primaryHost, m_replicationPort);
+}
+
+void ServerReplication::onPrimaryConnected()
+{
+    qDebug() << "Standby connected to primary" << m_primaryHost;
+    m_failoverTimer->start();
+}
+
+void ServerReplication::onPrimaryData()
+{
+    while (m_primary->canReadLine()) {
+        QJsonObject message = QJsonDocument::fromJson(m_primary->readLine()).object();
+        QString type = message["type"].toString();
+
+        // Any line proves the primary is alive
+        m_failoverTimer->start();
+
+        // Kept on disk too, so a promotion after a restart still moves past it
+        if (message.contains("epoch")) {
+            quint32 epoch = static_cast<quint32>(message["epoch"].toDouble());
+            if (epoch != m_epoch) {
+                m_epoch = epoch;
+                storeEpoch();
+            }
+        }
+
+        if (type == "replica_event") {
+            m_server->applyReplication(message["event"].toObject());
+        } else if (type == "replica_snapshot") {
+            m_server->applyReplication(message["state"].toObject());
+            m_synced = true;
+            qDebug() << "Standby synced: epoch" << m_epoch << "," << m_server->knownLanes().size()
+                     << "lanes," << m_server->gameMirror()->laneIds().size() << "games";
+        }
+    }
+}
+
+void ServerReplication::onPrimaryLost()
+{
+    if (m_role != Role::Standby) {
+        return;
+    }
+
+    m_failoverTimer->stop();
+    if (m_primary->state() != QAbstractSocket::UnconnectedState) {
+        m_primary->abort();
+    }
+
+    if (m_synced) {
+        promote(m_primary->error() == QAbstractSocket::UnknownSocketError
+                ? QString("primary silent for %1 ms").arg(FAILOVER_TIMEOUT_MS)
+                : m_primary->errorString());
+    } else if (!m_retryTimer->isActive()) {
+        // Never had a copy of the primary's state - keep trying to get one
+        m_retryTimer->start();
+    }
+}
+
+void ServerReplication::promote(const QString &reason)
+{
+    m_role = Role::Promoted;
+
+    // On disk before we serve, so no other server is ever handed this epoch
+    m_epoch = qMax(m_epoch, loadEpoch()) + 1;
+    storeEpoch();
+
+    qWarning() << "Primary lost (" << reason << ") - standby taking over, epoch" << m_epoch;
+
+    m_server->start(m_lanePort);
+    openDiscovery();
+
+    // Lanes are told now rather than finding us through their backoff
+    m_announcementsLeft = ANNOUNCE_COUNT;
+    announce();
+    m_announceTimer->start();
+
+    // The old primary can come back as this server's standby
+    if (!m_replicationServer->listen(QHostAddress::Any, m_replicationPort)) {
+        qWarning() << "Replication listener failed on port" << m_replicationPort << ":"
+                   << m_replicationServer->errorString();
+    }
+
+    emit promoted();
+}
+
+void ServerReplication::openDiscovery()
+{
+    if (m_discovery->state() == QAbstractSocket::BoundState) {
+        return;
+    }
+
+    if (!m_discovery->bind(QHostAddress::AnyIPv4, DISCOVERY_PORT,
+                           QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
+        qWarning() << "Discovery socket bind failed:" << m_discovery->errorString();
+        return;
+    }
+    if (!m_discovery->joinMulticastGroup(DISCOVERY_GROUP)) {
+        qWarning() << "Failed to join discovery group:" << m_discovery->errorString();
+    }
+}
+
+void ServerReplication::onDiscoveryDatagram()
+{
+    while (m_discovery->hasPendingDatagrams()) {
+        QByteArray datagram;
+        datagram.resize(m_discovery->pendingDatagramSize());
+        QHostAddress sender;
+        quint16 senderPort;
+        m_discovery->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+
+        if (datagram.startsWith("LANE_DISCOVERY_REQUEST") && isServing()) {
+            m_discovery->writeDatagram("LANE_DISCOVERY_RESPONSE " + serverInfo(), sender, senderPort);
+        } else if (datagram.startsWith("LANE_SERVER_ANNOUNCE ")) {
+            handleServerInfo(QJsonDocument::fromJson(datagram.mid(21)).object());
+        }
+    }
+}
+
+void ServerReplication::handleServerInfo(const QJsonObject &info)
+{
+    QString host = info["host"].toString();
+    quint16 port = info["port"].toInt();
+    quint32 epoch = static_cast<quint32>(info["epoch"].toDouble());
+
+    // Our own announcement comes back to us from the group
+    if (!isServing() || host.isEmpty() || (host == announceHost() && port == m_lanePort)) {
+        return;
+    }
+
+    if (epoch > m_epoch) {
+        stepDown(host, epoch);
+    } else if (epoch < m_epoch) {
+        qWarning() << "Stale server at" << host << ":" << port << "with epoch" << epoch
+                   << "- announcing epoch" << m_epoch;
+        announce();
+    } else {
+        qWarning() << "Server at" << host << ":" << port << "is serving the same epoch" << epoch;
+    }
+}
+
+void ServerReplication::stepDown(const QString &primaryHost, quint32 epoch)
+{
+    qWarning() << "Server at" << primaryHost << "has epoch" << epoch << "( ours" << m_epoch
+               << ") - no longer serving lanes, becoming its standby";
+
+    m_announceTimer->stop();
+    m_heartbeatTimer->stop();
+    m_replicationServer->close();
+    if (m_standby) {
+        m_standby->disconnect(this);
+        m_standby->abort();
+        m_standby->deleteLater();
+        m_standby = nullptr;
+    }
+    m_server->stop();
+
+    m_epoch = epoch;
+    storeEpoch();
+    startStandby(primaryHost, m_lanePort, m_replicationPort);
+
+    emit steppedDown();
+}
+
+quint32 ServerReplication::loadEpoch() const
+{
+    QFile file(m_epochFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    return file.readAll().trimmed().toUInt();
+}
+
+void ServerReplication::storeEpoch()
+{
+    QSaveFile file(m_epochFile);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QByteArray::number(m_epoch) + "\n") < 0 || !file.commit()) {
+        qWarning() << "Replication: could not save epoch to" << m_epochFile << file.errorString();
+    }
+}
+
+void ServerReplication::announce()
+{
+    if (--m_announcementsLeft <= 0) {
+        m_announceTimer->stop();
+    }
+
+    m_discovery->writeDatagram("LANE_SERVER_ANNOUNCE " + serverInfo(), DISCOVERY_GROUP, DISCOVERY_PORT);
+}
+
+QByteArray ServerReplication::serverInfo() const
+{
+    QJsonObject info;
+    info["host"] = announceHost();
+    info["port"] = m_lanePort;
+    info["epoch"] = static_cast<qint64>(m_epoch);
+    return QJsonDocument(info).toJson(QJsonDocument::Compact);
+}
+
+QString ServerReplication::announceHost() const
+{
+    if (!m_announceHost.isEmpty()) {
+        return m_announceHost;
+    }
+
+    const QHostAddress localhost(QHostAddress::LocalHost);
+    for (const QHostAddress &address : QNetworkInterface::allAddresses()) {
+        if (address.protocol() == QAbstractSocket::IPv4Protocol && address != localhost) {
+            return address.toString();
+        }
+    }
+    return localhost.toString();
+}
@@ -0,0 +1,139 @@
+﻿// ServerReplication.h - Primary/standby lane server pair
+#ifndef SERVERREPLICATION_H
+#define SERVERREPLICATION_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QTimer>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include "LaneServer.h"
+
+// The primary serves lanes and streams its state to one standby over a
+// JSON-lines replication connection:
+//
+//   { "type": "replica_snapshot", "epoch": 3, "state": {...} }     on attach
+//   { "type": "replica_event", "event": { "kind": "mirror", ... } }
+//   { "type": "replica_heartbeat", "epoch": 3 }                    every 200 ms
+//
+// The standby keeps an unstarted LaneServer current with those events. When
+// the stream closes or goes quiet for FAILOVER_TIMEOUT_MS it starts serving
+// lanes, and tells them with a multicast announcement on the discovery group
+// (224.3.29.71:50005) - "LANE_SERVER_ANNOUNCE {host, port, epoch}". Lanes
+// connect to it straight away, without waiting out their reconnect backoff.
+// Whichever server is serving also answers LANE_DISCOVERY_REQUEST.
+//
+// The epoch fences off a primary that comes back after being replaced. It
+// is kept on disk (EpochFile) and raised, and stored, before a standby
+// starts serving. A serving server that hears an announcement with a
+// higher epoch stops serving and becomes that server's standby; one that
+// hears a lower epoch announces itself so the stale server does the same.
+// A primary announces once when it starts, so a restarted old primary
+// finds out straight away. Lanes ignore servers older than the newest
+// epoch they have seen.
+class ServerReplication : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Role {
+        Primary,
+        Standby,
+        Promoted        // Former standby, now serving lanes
+    };
+
+    explicit ServerReplication(LaneServer *server, QObject *parent = nullptr);
+    ~ServerReplication();
+
+    // settings.json "Replication" { "Role": "primary" | "standby", "PeerHost": "...",
+    //   "LanePort": 50005, "ReplicationPort": 50006, "AnnounceHost": "...",
+    //   "EpochFile": "replication.epoch" }
+    void loadSettings(const QJsonObject &settings);
+
+    void startPrimary(quint16 lanePort = DEFAULT_LANE_PORT, quint16 replicationPort = DEFAULT_REPLICATION_PORT);
+    void startStandby(const QString &primaryHost, quint16 lanePort = DEFAULT_LANE_PORT,
+                      quint16 replicationPort = DEFAULT_REPLICATION_PORT);
+    void stop();
+
+    // Address lanes are told to connect to; defaults to the first IPv4 address
+    void setAnnounceHost(const QString &host) { m_announceHost = host; }
+
+    // Where the epoch is kept between runs; set before starting
+    void setEpochFile(const QString &path) { m_epochFile = path; }
+
+    Role role() const { return m_role; }
+    bool isServing() const { return m_role != Role::Standby; }
+    quint32 epoch() const { return m_epoch; }
+
+    // A standby holding a full copy of the primary's state, able to take over
+    bool isSynced() const { return m_synced; }
+
+    static constexpr quint16 DEFAULT_LANE_PORT = 50005;
+    static constexpr quint16 DEFAULT_REPLICATION_PORT = 50006;
+    static constexpr quint16 DISCOVERY_PORT = 50005;
+    static constexpr int HEARTBEAT_INTERVAL_MS = 200;
+    static constexpr int FAILOVER_TIMEOUT_MS = 600;
+    static constexpr const char *DEFAULT_EPOCH_FILE = "replication.epoch";
+
+signals:
+    void standbyAttached(const QString &address);
+    void standbyLost();
+    void promoted();
+    void steppedDown();
+
+private slots:
+    void onStandbyConnection();
+    void onStandbyDisconnected();
+    void onPrimaryConnected();
+    void onPrimaryData();
+    void onPrimaryLost();
+    void onDiscoveryDatagram();
+    void sendHeartbeat();
+    void announce();
+
+private:
+    void replicate(const QJsonObject &event);
+    void sendToStandby(const QJsonObject &message);
+    void connectToPrimary();
+    void promote(const QString &reason);
+    void stepDown(const QString &primaryHost, quint32 epoch);
+    void handleServerInfo(const QJsonObject &info);
+    quint32 loadEpoch() const;
+    void storeEpoch();
+    void openDiscovery();
+    QByteArray serverInfo() const;
+    QString announceHost() const;
+
+    LaneServer *m_server;
+    Role m_role;
+    quint32 m_epoch;
+
+    quint16 m_lanePort;
+    quint16 m_replicationPort;
+    QString m_primaryHost;
+    QString m_announceHost;
+    QString m_epochFile;
+
+    // Primary side
+    QTcpServer *m_replicationServer;
+    QTcpSocket *m_standby;
+    QTimer *m_heartbeatTimer;
+
+    // Standby side
+    QTcpSocket *m_primary;
+    QTimer *m_failoverTimer;
+    QTimer *m_retryTimer;
+    bool m_synced;              // Only a standby that has a copy may take over
+
+    QUdpSocket *m_discovery;
+    QTimer *m_announceTimer;
+    int m_announcementsLeft;
+
+    static constexpr int RETRY_INTERVAL_MS = 1000;
+    static constexpr int ANNOUNCE_INTERVAL_MS = 250;
+    static constexpr int ANNOUNCE_COUNT = 20;   // Five seconds of announcements after a takeover
+};
+
+#endif // SERVERREPLICATION_H
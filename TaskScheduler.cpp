@@ -0,0 +1,346 @@
+﻿#include "TaskScheduler.h"
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStringList>
+#include <QDebug>
+#include <chrono>
+
+namespace {
+
+// Set on each worker thread so a task submitted from a task lands on that
+// worker's own queues
+thread_local TaskScheduler* currentScheduler = nullptr;
+thread_local int currentWorker = -1;
+
+const int DEFAULT_LIMITS[TaskScheduler::PriorityCount] = {
+    1,      // Hardware - one machine at a time
+    2,      // Scoring
+    1,      // UiPrep
+    1,      // Network
+    1,      // Disk
+    1       // Media
+};
+
+bool raiseMax(std::atomic<qint64>& target, qint64 value) {
+    qint64 current = target.load(std::memory_order_relaxed);
+    while (value > current) {
+        if (target.compare_exchange_weak(current, value, std::memory_order_relaxed)) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+TaskScheduler* TaskScheduler::instance() {
+    static TaskScheduler* schedulerInstance = new TaskScheduler(QCoreApplication::instance());
+    return schedulerInstance;
+}
+
+TaskScheduler::TaskScheduler(QObject* parent)
+    : QObject(parent)
+    , backgroundRunning(0)
+    , reservedWorkers(1)
+    , nextWorker(0)
+    , generation(0)
+    , stopping(false)
+{
+    for (int p = 0; p < PriorityCount; ++p) {
+        counters[p].limit = DEFAULT_LIMITS[p];
+    }
+
+    for (int i = 0; i < WORKERS; ++i) {
+        workers[i].thread = QThread::create([this, i]() { workerLoop(i); });
+        workers[i].thread->setObjectName(QString("TaskWorker%1").arg(i));
+        workers[i].thread->start();
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        QMutexLocker locker(&sleepMutex);
+        stopping = true;
+        ++generation;
+        wakeup.wakeAll();
+    }
+
+    for (Worker& worker : workers) {
+        worker.thread->wait();
+        delete worker.thread;
+        worker.thread = nullptr;
+    }
+}
+
+void TaskScheduler::loadSettings(const QJsonObject& settings) {
+    const QJsonObject limits = settings["Limits"].toObject();
+    for (int p = 0; p < PriorityCount; ++p) {
+        const Priority priority = static_cast<Priority>(p);
+        setLimit(priority, limits[nameOf(priority)].toInt(DEFAULT_LIMITS[p]));
+    }
+    setReservedWorkers(settings["ReservedWorkers"].toInt(1));
+
+    QStringList summary;
+    for (int p = 0; p < PriorityCount; ++p) {
+        summary << QString("%1 %2").arg(nameOf(static_cast<Priority>(p))).arg(counters[p].limit.load());
+    }
+    qDebug() << "Task scheduler:" << WORKERS << "workers," << reservedWorkers.load()
+             << "reserved; limits" << summary.join(", ");
+}
+
+void TaskScheduler::setLimit(Priority priority, int maxRunning) {
+    counters[priority].limit = qBound(1, maxRunning, int(WORKERS));
+    wakeWorkers();
+}
+
+void TaskScheduler::setReservedWorkers(int count) {
+    // At least one worker must be left for the background classes
+    reservedWorkers = qBound(0, count, WORKERS - 1);
+    wakeWorkers();
+}
+
+qint64 TaskScheduler::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TaskScheduler::submit(Priority priority, std::function<void()> task) {
+    if (!task) return;
+
+    // From a task: keep it on this worker. Otherwise the shorter queue.
+    int index = currentWorker;
+    if (currentScheduler != this || index < 0) {
+        const int first = nextWorker.fetch_add(1, std::memory_order_relaxed) % WORKERS;
+        index = first;
+        for (int i = 1; i < WORKERS; ++i) {
+            const int other = (first + i) % WORKERS;
+            if (workers[other].queued.load(std::memory_order_relaxed) <
+                workers[index].queued.load(std::memory_order_relaxed)) {
+                index = other;
+            }
+        }
+    }
+
+    Task entry;
+    entry.run = std::move(task);
+    entry.queuedNs = nowNs();
+
+    {
+        QMutexLocker locker(&workers[index].mutex);
+        workers[index].queues[priority].push_back(std::move(entry));
+    }
+    workers[index].queued.fetch_add(1, std::memory_order_relaxed);
+    counters[priority].queued.fetch_add(1, std::memory_order_relaxed);
+    counters[priority].submitted.fetch_add(1, std::memory_order_relaxed);
+
+    wakeWorkers();
+}
+
+void TaskScheduler::saveJson(const QString& path, const QJsonDocument& document) {
+    bool schedule;
+    {
+        QMutexLocker locker(&pendingMutex);
+        schedule = !pendingSaves.contains(path);
+        pendingSaves.insert(path, document);
+    }
+
+    // Already queued: that write picks this document up instead
+    if (schedule) {
+        submit(Disk, [this, path]() { writePending(path); });
+    }
+}
+
+void TaskScheduler::writePending(const QString& path) {
+    QMutexLocker writeLocker(&writeMutex);
+
+    QJsonDocument document;
+    {
+        QMutexLocker locker(&pendingMutex);
+        if (!pendingSaves.contains(path)) return;     // A later write got here first
+        document = pendingSaves.take(path);
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(document.toJson()) < 0 || !file.commit()) {
+        qWarning() << "Task scheduler: could not save" << path << file.errorString();
+    }
+}
+
+void TaskScheduler::wakeWorkers() {
+    QMutexLocker locker(&sleepMutex);
+    ++generation;
+    wakeup.wakeAll();
+}
+
+void TaskScheduler::workerLoop(int index) {
+    currentScheduler = this;
+    currentWorker = index;
+
+    for (;;) {
+        quint64 seen;
+        {
+            QMutexLocker locker(&sleepMutex);
+            seen = generation;
+        }
+
+        Task task;
+        Priority priority;
+        if (takeTask(index, &task, &priority)) {
+            execute(task, priority);
+            continue;
+        }
+
+        // Nothing runnable: queues empty, or every queued class at its limit.
+        // A submit or a finished task bumps the generation.
+        QMutexLocker locker(&sleepMutex);
+        if (stopping) {
+            bool queued = false;
+            for (const Worker& worker : workers) {
+                queued = queued || worker.queued.load(std::memory_order_relaxed) > 0;
+            }
+            if (!queued) return;
+        }
+        while (generation == seen) {
+            wakeup.wait(&sleepMutex);
+        }
+    }
+}
+
+bool TaskScheduler::takeTask(int index, Task* task, Priority* priority) {
+    // Highest class first; within a class our own queue, then the other worker's
+    for (int p = 0; p < PriorityCount; ++p) {
+        const Priority candidate = static_cast<Priority>(p);
+        if (counters[p].queued.load(std::memory_order_relaxed) == 0) continue;
+        if (!admit(candidate)) continue;
+
+        for (int i = 0; i < WORKERS; ++i) {
+            if (popFrom(workers[(index + i) % WORKERS], candidate, task)) {
+                *priority = candidate;
+                return true;
+            }
+        }
+        release(candidate);     // Someone else got there first
+    }
+    return false;
+}
+
+bool TaskScheduler::popFrom(Worker& worker, Priority priority, Task* task) {
+    QMutexLocker locker(&worker.mutex);
+    std::deque<Task>& queue = worker.queues[priority];
+    if (queue.empty()) return false;
+
+    *task = std::move(queue.front());
+    queue.pop_front();
+    worker.queued.fetch_sub(1, std::memory_order_relaxed);
+    counters[priority].queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool TaskScheduler::admit(Priority priority) {
+    ClassCounters& counter = counters[priority];
+    int running = counter.running.load(std::memory_order_acquire);
+    do {
+        if (running >= counter.limit.load(std::memory_order_relaxed)) return false;
+    } while (!counter.running.compare_exchange_weak(running, running + 1, std::memory_order_acq_rel));
+
+    if (!isBackground(priority)) return true;
+
+    const int allowed = WORKERS - reservedWorkers.load(std::memory_order_relaxed);
+    int background = backgroundRunning.load(std::memory_order_acquire);
+    do {
+        if (background >= allowed) {
+            counter.running.fetch_sub(1, std::memory_order_acq_rel);
+            return false;
+        }
+    } while (!backgroundRunning.compare_exchange_weak(background, background + 1, std::memory_order_acq_rel));
+    return true;
+}
+
+void TaskScheduler::release(Priority priority) {
+    counters[priority].running.fetch_sub(1, std::memory_order_acq_rel);
+    if (isBackground(priority)) {
+        backgroundRunning.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void TaskScheduler::execute(Task& task, Priority priority) {
+    ClassCounters& counter = counters[priority];
+    const qint64 startNs = nowNs();
+    const qint64 waitNs = startNs - task.queuedNs;
+    counter.totalWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+    raiseMax(counter.maxWaitNs, waitNs);
+
+    try {
+        task.run();
+    } catch (const std::exception& e) {
+        qWarning() << "Task scheduler:" << nameOf(priority) << "task threw:" << e.what();
+    } catch (...) {
+        qWarning() << "Task scheduler:" << nameOf(priority) << "task threw";
+    }
+    task.run = nullptr;     // Captures go on this thread, before the slot is released
+
+    counter.totalRunNs.fetch_add(nowNs() - startNs, std::memory_order_relaxed);
+    counter.completed.fetch_add(1, std::memory_order_relaxed);
+    release(priority);
+
+    // A freed slot may unblock the other worker
+    wakeWorkers();
+}
+
+TaskScheduler::ClassStats TaskScheduler::stats(Priority priority) const {
+    const ClassCounters& counter = counters[priority];
+
+    ClassStats result;
+    result.submitted = counter.submitted.load(std::memory_order_relaxed);
+    result.completed = counter.completed.load(std::memory_order_relaxed);
+    result.queued = counter.queued.load(std::memory_order_relaxed);
+    result.running = counter.running.load(std::memory_order_relaxed);
+    result.limit = counter.limit.load(std::memory_order_relaxed);
+    if (result.completed > 0) {
+        result.avgWaitUs = counter.totalWaitNs.load(std::memory_order_relaxed) / 1000.0 / result.completed;
+        result.avgRunUs = counter.totalRunNs.load(std::memory_order_relaxed) / 1000.0 / result.completed;
+    }
+    result.maxWaitUs = counter.maxWaitNs.load(std::memory_order_relaxed) / 1000.0;
+    return result;
+}
+
+QJsonObject TaskScheduler::statsJson() const {
+    QJsonObject json;
+    for (int p = 0; p < PriorityCount; ++p) {
+        const Priority priority = static_cast<Priority>(p);
+        const ClassStats s = stats(priority);
+
+        QJsonObject entry;
+        entry["submitted"] = static_cast<qint64>(s.submitted);
+        entry["completed"] = static_cast<qint64>(s.completed);
+        entry["queued"] = s.queued;
+        entry["running"] = s.running;
+        entry["limit"] = s.limit;
+        entry["avg_wait_us"] = qRound64(s.avgWaitUs);
+        entry["max_wait_us"] = qRound64(s.maxWaitUs);
+        entry["avg_run_us"] = qRound64(s.avgRunUs);
+        json[nameOf(priority)] = entry;
+    }
+    return json;
+}
+
+void TaskScheduler::resetStats() {
+    for (ClassCounters& counter : counters) {
+        counter.submitted = counter.queued.load();
+        counter.completed = 0;
+        counter.totalWaitNs = 0;
+        counter.maxWaitNs = 0;
+        counter.totalRunNs = 0;
+    }
+}
+
+QString TaskScheduler::nameOf(Priority priority) {
+    switch (priority) {
+    case Hardware: return "Hardware";
+    case Scoring:  return "Scoring";
+    case UiPrep:   return "UiPrep";
+    case Network:  return "Network";
+    case Disk:     return "Disk";
+    case Media:    return "Media";
+    default:       return "Unknown";
+    }
+}
@@ -0,0 +1,153 @@
+﻿// TaskScheduler.h - Priority classes on the lane's two background workers
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QHash>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+// Replaces the global QThreadPool (capped at 2 for the Pi 3), which ran
+// whatever was queued first. Every task names its class, and a free worker
+// always takes the highest class it is allowed to run:
+//
+//   Hardware > Scoring > UiPrep > Network > Disk > Media
+//
+// Each class has a concurrency limit, and Network/Disk/Media together may
+// never occupy the reserved worker(s), so a journal write or a media rehash
+// can be running but can never be in the way of a hardware task. Each
+// worker has its own queue per class; a worker that runs dry takes from
+// the other one, highest class first.
+//
+//   scheduler->submit(TaskScheduler::Disk, [data]() { write(data); });
+//   scheduler->run(TaskScheduler::Media, this, [] { return scan(); },
+//                  [this](const Manifest& m) { apply(m); });     // apply() on this's thread
+//
+// Per-class queue wait and run times are kept for tuning the limits.
+class TaskScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    enum Priority {
+        Hardware,       // Pin machine cycles, anything a ball result waits on
+        Scoring,
+        UiPrep,
+        Network,
+        Disk,           // Journal and statistics writes
+        Media,          // Media decode and rehash
+        PriorityCount
+    };
+
+    static TaskScheduler* instance();
+
+    explicit TaskScheduler(QObject* parent = nullptr);
+    ~TaskScheduler();       // Runs what is still queued, then joins the workers
+
+    // Configuration from settings.json "Scheduler"
+    void loadSettings(const QJsonObject& settings);
+    void setLimit(Priority priority, int maxRunning);
+    void setReservedWorkers(int count);     // Closed to Network, Disk and Media
+
+    void submit(Priority priority, std::function<void()> task);
+
+    // work() on a worker, then done(result) on context's thread; done is
+    // skipped if context has been destroyed by then
+    template<typename Work, typename Done>
+    void run(Priority priority, QObject* context, Work work, Done done) {
+        QPointer<QObject> guard(context);
+        submit(priority, [guard, work, done]() mutable {
+            auto result = work();
+            QObject* target = guard.data();
+            if (!target) return;
+            QMetaObject::invokeMethod(target, [guard, done, result]() mutable {
+                if (guard) done(result);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    // Replace path with the document on a Disk worker, via QSaveFile.
+    // Saves of one path are coalesced and never reorder: a write that
+    // starts always takes the newest document queued for that path.
+    void saveJson(const QString& path, const QJsonDocument& document);
+
+    struct ClassStats {
+        quint64 submitted = 0;
+        quint64 completed = 0;
+        int queued = 0;
+        int running = 0;
+        int limit = 0;
+        double avgWaitUs = 0.0;     // Submit to start
+        double maxWaitUs = 0.0;
+        double avgRunUs = 0.0;
+    };
+    ClassStats stats(Priority priority) const;
+    QJsonObject statsJson() const;
+    void resetStats();
+
+    static QString nameOf(Priority priority);
+
+    static constexpr int WORKERS = 2;
+
+private:
+    friend struct TaskSchedulerBench;
+
+    struct Task {
+        std::function<void()> run;
+        qint64 queuedNs = 0;
+    };
+
+    struct Worker {
+        QThread* thread = nullptr;
+        QMutex mutex;
+        std::deque<Task> queues[PriorityCount];
+        std::atomic<int> queued{0};
+    };
+
+    struct ClassCounters {
+        std::atomic<int> limit{1};
+        std::atomic<int> running{0};
+        std::atomic<int> queued{0};
+        std::atomic<quint64> submitted{0};
+        std::atomic<quint64> completed{0};
+        std::atomic<qint64> totalWaitNs{0};
+        std::atomic<qint64> maxWaitNs{0};
+        std::atomic<qint64> totalRunNs{0};
+    };
+
+    void workerLoop(int index);
+    bool takeTask(int index, Task* task, Priority* priority);
+    bool popFrom(Worker& worker, Priority priority, Task* task);
+    bool admit(Priority priority);
+    void release(Priority priority);
+    void execute(Task& task, Priority priority);
+    void wakeWorkers();
+    void writePending(const QString& path);
+    static bool isBackground(Priority priority) { return priority >= Network; }
+    static qint64 nowNs();
+
+    Worker workers[WORKERS];
+    ClassCounters counters[PriorityCount];
+    std::atomic<int> backgroundRunning;
+    std::atomic<int> reservedWorkers;
+    std::atomic<int> nextWorker;
+
+    // saveJson: newest document per path, and one file write at a time
+    QMutex pendingMutex;
+    QHash<QString, QJsonDocument> pendingSaves;
+    QMutex writeMutex;
+
+    // Idle workers sleep until something is submitted or finishes
+    QMutex sleepMutex;
+    QWaitCondition wakeup;
+    quint64 generation;
+    bool stopping;
+};
+
+#endif // TASKSCHEDULER_H
@@ -0,0 +1,50 @@
+﻿#ifndef TCPKEEPALIVE_H
+#define TCPKEEPALIVE_H
+
+#include <QAbstractSocket>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+// Kernel-level dead peer detection for the lane connection. A silent link
+// is probed after idleSeconds and dropped after `probes` unanswered probes;
+// data the peer never acknowledges fails the socket after userTimeoutMs.
+// Either way the socket errors out in seconds, without any application
+// message on the wire - the heartbeat only has to cover what TCP cannot see.
+// Call once the socket is connected (it needs a descriptor).
+struct TcpKeepAlive {
+    int idleSeconds = 10;
+    int intervalSeconds = 2;
+    int probes = 3;
+    int userTimeoutMs = 10000;
+
+    int detectSeconds() const { return idleSeconds + intervalSeconds * probes; }
+
+    void apply(QAbstractSocket* socket) const {
+        socket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+#ifdef Q_OS_LINUX
+        const int fd = int(socket->socketDescriptor());
+        if (fd < 0) {
+            return;
+        }
+
+        bool ok = setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idleSeconds, sizeof(idleSeconds)) == 0
+               && setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intervalSeconds, sizeof(intervalSeconds)) == 0
+               && setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes)) == 0;
+#ifdef TCP_USER_TIMEOUT
+        ok = ok && setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &userTimeoutMs, sizeof(userTimeoutMs)) == 0;
+#endif
+        if (!ok) {
+            qWarning() << "Could not tune TCP keepalive - using system defaults";
+        }
+#endif
+    }
+};
+
+#endif // TCPKEEPALIVE_H
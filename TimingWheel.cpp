@@ -0,0 +1,206 @@
+﻿#include "TimingWheel.h"
+
+TimingWheel::TimingWheel(int tick, QObject* parent)
+    : QObject(parent)
+    , tickMs(qMax(1, tick))
+    , driver(new QTimer(this))
+    , currentTick(0)
+    , slotHeads(LEVELS * SLOTS, NIL)
+    , armed(0)
+{
+    driver->setTimerType(Qt::CoarseTimer);
+    driver->setInterval(tickMs);
+    connect(driver, &QTimer::timeout, this, &TimingWheel::onTimer);
+    clock.start();
+}
+
+int TimingWheel::nodeIndex(TimerId id) const {
+    int index = static_cast<int>(id & 0xffffffffu) - 1;
+    if (index < 0 || index >= nodes.size()) return NIL;
+    if (nodes[index].generation != static_cast<quint32>(id >> 32)) return NIL;
+    return index;
+}
+
+TimingWheel::TimerId TimingWheel::makeId(int index) const {
+    return (static_cast<TimerId>(nodes[index].generation) << 32) | static_cast<TimerId>(index + 1);
+}
+
+int TimingWheel::allocateNode() {
+    if (!freeNodes.isEmpty()) {
+        return freeNodes.takeLast();
+    }
+    nodes.append(Node());
+    return nodes.size() - 1;
+}
+
+void TimingWheel::releaseNode(int index) {
+    Node& node = nodes[index];
+    node.generation++;
+    node.state = NodeState::Free;
+    node.callback = Callback();
+    freeNodes.append(index);
+}
+
+void TimingWheel::link(int index) {
+    Node& node = nodes[index];
+
+    // Level by distance; beyond the top level, park at its far end and re-file on cascade
+    const qint64 maxDelta = (qint64(1) << (SLOT_BITS * LEVELS)) - 1;
+    qint64 delta = qBound<qint64>(0, node.expiryTick - currentTick, maxDelta);
+    qint64 target = currentTick + delta;
+
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (qint64(1) << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+    int slot = static_cast<int>((target >> (SLOT_BITS * level)) & (SLOTS - 1));
+    int list = level * SLOTS + slot;
+
+    node.list = list;
+    node.prev = NIL;
+    node.next = slotHeads[list];
+    if (node.next != NIL) {
+        nodes[node.next].prev = index;
+    }
+    slotHeads[list] = index;
+}
+
+void TimingWheel::unlink(int index) {
+    Node& node = nodes[index];
+    if (node.list == NIL) return;
+
+    if (node.prev != NIL) {
+        nodes[node.prev].next = node.next;
+    } else {
+        slotHeads[node.list] = node.next;
+    }
+    if (node.next != NIL) {
+        nodes[node.next].prev = node.prev;
+    }
+    node.prev = node.next = node.list = NIL;
+}
+
+void TimingWheel::ensureRunning() {
+    if (driver->isActive()) return;
+
+    // Nothing was armed while stopped, so the wheel can jump straight to now
+    currentTick = clock.elapsed() / tickMs;
+    driver->start();
+    emit started();
+}
+
+TimingWheel::TimerId TimingWheel::arm(int delayMs, Callback callback) {
+    if (delayMs < 0) return 0;
+
+    ensureRunning();
+
+    int index = allocateNode();
+    Node& node = nodes[index];
+    node.expiryTick = currentTick + qMax<qint64>(1, (delayMs + tickMs - 1) / tickMs);
+    node.state = NodeState::Armed;
+    node.callback = std::move(callback);
+    link(index);
+    armed++;
+
+    return makeId(index);
+}
+
+bool TimingWheel::reset(TimerId id, int delayMs) {
+    int index = nodeIndex(id);
+    if (index == NIL || nodes[index].state == NodeState::Free) return false;
+
+    Node& node = nodes[index];
+    if (node.state == NodeState::Firing) {
+        // Re-armed by a callback in the same tick - it will not fire now
+        node.state = NodeState::Armed;
+        armed++;
+    }
+    unlink(index);
+    node.expiryTick = currentTick + qMax<qint64>(1, (delayMs + tickMs - 1) / tickMs);
+    link(index);
+    return true;
+}
+
+void TimingWheel::cancel(TimerId id) {
+    int index = nodeIndex(id);
+    if (index == NIL || nodes[index].state == NodeState::Free) return;
+
+    if (nodes[index].state == NodeState::Armed) {
+        unlink(index);
+        armed--;
+    }
+    releaseNode(index);
+}
+
+bool TimingWheel::isArmed(TimerId id) const {
+    int index = nodeIndex(id);
+    return index != NIL && nodes[index].state == NodeState::Armed;
+}
+
+int TimingWheel::remainingMs(TimerId id) const {
+    int index = nodeIndex(id);
+    if (index == NIL || nodes[index].state != NodeState::Armed) return -1;
+    return static_cast<int>(qMax<qint64>(0, nodes[index].expiryTick * tickMs - clock.elapsed()));
+}
+
+void TimingWheel::processTick() {
+    currentTick++;
+
+    // Cascade: each higher level whose lower bits just wrapped re-files one slot
+    for (int level = 1; level < LEVELS; ++level) {
+        if (currentTick & ((qint64(1) << (SLOT_BITS * level)) - 1)) break;
+
+        int list = level * SLOTS + static_cast<int>((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+        int index = slotHeads[list];
+        slotHeads[list] = NIL;
+        while (index != NIL) {
+            int next = nodes[index].next;
+            nodes[index].prev = nodes[index].next = nodes[index].list = NIL;
+            link(index);
+            index = next;
+        }
+    }
+
+    // Everything in the due level-0 slot expires now
+    int list = static_cast<int>(currentTick & (SLOTS - 1));
+    int index = slotHeads[list];
+    if (index == NIL) return;
+
+    slotHeads[list] = NIL;
+    firing.clear();
+    while (index != NIL) {
+        Node& node = nodes[index];
+        int next = node.next;
+        node.prev = node.next = node.list = NIL;
+        node.state = NodeState::Firing;
+        armed--;
+        firing.append(index);
+        index = next;
+    }
+
+    for (int i = 0; i < firing.size(); ++i) {
+        int firingIndex = firing[i];
+        if (nodes[firingIndex].state != NodeState::Firing) continue;     // Cancelled or reset meanwhile
+
+        Callback callback = std::move(nodes[firingIndex].callback);
+        releaseNode(firingIndex);
+        if (callback) {
+            callback();
+        }
+    }
+}
+
+void TimingWheel::advanceTo(qint64 tick) {
+    while (currentTick < tick) {
+        processTick();
+    }
+}
+
+void TimingWheel::onTimer() {
+    advanceTo(clock.elapsed() / tickMs);
+
+    if (armed == 0) {
+        driver->stop();
+        emit idle();
+    }
+}
@@ -0,0 +1,94 @@
+﻿// TimingWheel.h - Hierarchical timing wheel for connection timeouts
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <functional>
+
+// Heartbeats, reconnect backoff and command timeouts are many timers that
+// are re-armed far more often than they fire. Each one is a node in a
+// slot list of a four-level wheel (64 slots per level, tickMs per level-0
+// slot), so arm, reset and cancel are a constant-time unlink/link and a
+// tick only touches the slot that is due - the cost does not grow with
+// the number of connections. Nodes live in a slab addressed by TimerId,
+// with a generation so stale ids are harmless.
+//
+// The driving QTimer only runs while something is armed. Callbacks run on
+// the wheel's thread and may arm, reset or cancel timers, including
+// their own.
+class TimingWheel : public QObject {
+    Q_OBJECT
+
+public:
+    using TimerId = quint64;
+    using Callback = std::function<void()>;
+
+    explicit TimingWheel(int tickMs = 100, QObject* parent = nullptr);
+
+    // One-shot; returns 0 if delayMs is negative
+    TimerId arm(int delayMs, Callback callback);
+
+    // Push an armed timer out to delayMs from now, keeping its callback.
+    // Returns false if it already fired or was cancelled.
+    bool reset(TimerId id, int delayMs);
+
+    void cancel(TimerId id);
+    bool isArmed(TimerId id) const;
+    int remainingMs(TimerId id) const;
+
+    int armedCount() const { return armed; }
+    int tickInterval() const { return tickMs; }
+
+signals:
+    void started();
+    void idle();
+
+private slots:
+    void onTimer();
+
+private:
+    friend struct TimingWheelBench;
+
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr int NIL = -1;
+
+    enum class NodeState : quint8 { Free, Armed, Firing };
+
+    struct Node {
+        qint64 expiryTick = 0;
+        int prev = NIL;
+        int next = NIL;
+        int list = NIL;             // Index into slotHeads while armed
+        quint32 generation = 0;
+        NodeState state = NodeState::Free;
+        Callback callback;
+    };
+
+    int nodeIndex(TimerId id) const;
+    TimerId makeId(int index) const;
+    int allocateNode();
+    void releaseNode(int index);
+    void link(int index);
+    void unlink(int index);
+    void advanceTo(qint64 tick);
+    void processTick();
+    void ensureRunning();
+
+    int tickMs;
+    QTimer* driver;
+    QElapsedTimer clock;
+    qint64 currentTick;
+
+    QVector<Node> nodes;
+    QVector<int> freeNodes;
+    QVector<int> slotHeads;         // LEVELS * SLOTS list heads
+    QVector<int> firing;            // Reused between ticks
+    int armed;
+};
+
+#endif // TIMINGWHEEL_H
@@ -0,0 +1,63 @@
+﻿#include "UpdateCoordinator.h"
+
+UpdateCoordinator::UpdateCoordinator(QObject* parent)
+    : QObject(parent)
+    , flushTimer(new QTimer(this))
+    , flushing(false)
+    , marks(0)
+    , flushes(0)
+{
+    // Zero-interval: fires once the current event has been handled
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(0);
+    connect(flushTimer, &QTimer::timeout, this, &UpdateCoordinator::flush);
+}
+
+int UpdateCoordinator::addHandler(Aspects aspects, std::function<void()> handler) {
+    Handler entry;
+    entry.aspects = aspects;
+    entry.run = std::move(handler);
+    handlers.append(entry);
+    return handlers.size() - 1;
+}
+
+void UpdateCoordinator::markDirty(Aspects aspects) {
+    marks++;
+    pending |= aspects;
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void UpdateCoordinator::flush() {
+    if (flushing) {
+        return;
+    }
+    flushTimer->stop();
+    if (!pending) {
+        return;
+    }
+
+    // Handlers that mark more (a rebuild changing button state) go to the next pass
+    flushing = true;
+    const Aspects ran = pending;
+    pending = Aspects();
+    for (Handler& handler : handlers) {
+        if (handler.aspects & ran) {
+            handler.runs++;
+            handler.run();
+        }
+    }
+    flushing = false;
+    flushes++;
+
+    emit flushed(ran);
+}
+
+void UpdateCoordinator::resetCounters() {
+    for (Handler& handler : handlers) {
+        handler.runs = 0;
+    }
+    marks = 0;
+    flushes = 0;
+}
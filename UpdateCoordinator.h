@@ -0,0 +1,69 @@
+﻿// UpdateCoordinator.h - One lane UI refresh per event-loop pass
+#ifndef UPDATECOORDINATOR_H
+#define UPDATECOORDINATOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+// Game signals mark what went stale instead of rebuilding it on the spot.
+// The handlers for everything marked run once, in registration order, when
+// control returns to the event loop - so a ball that makes QuickGame emit
+// gameUpdated three times and currentPlayerChanged once still rebuilds the
+// board once.
+//
+//   updates->addHandler(UpdateCoordinator::Scores | UpdateCoordinator::CurrentPlayer, [this] { rebuildBoard(); });
+//   updates->markDirty(UpdateCoordinator::Scores);
+class UpdateCoordinator : public QObject {
+    Q_OBJECT
+
+public:
+    enum Aspect {
+        Scores        = 0x01,
+        CurrentPlayer = 0x02,
+        Buttons       = 0x04,
+        Status        = 0x08,
+        Recovery      = 0x10,     // Journal and server mirror
+        AllAspects    = 0x1f
+    };
+    Q_DECLARE_FLAGS(Aspects, Aspect)
+
+    explicit UpdateCoordinator(QObject* parent = nullptr);
+
+    // handler runs once per flush if any of `aspects` is dirty; returns its index
+    int addHandler(Aspects aspects, std::function<void()> handler);
+
+    void markDirty(Aspects aspects);
+    Aspects dirty() const { return pending; }
+
+    // Run now instead of on the next pass, e.g. before the window is hidden
+    void flush();
+
+    // Counters for measuring rebuilds per ball
+    int runCount(int handler) const { return handlers.value(handler).runs; }
+    int markCount() const { return marks; }
+    int flushCount() const { return flushes; }
+    void resetCounters();
+
+signals:
+    void flushed(UpdateCoordinator::Aspects ran);
+
+private:
+    struct Handler {
+        Aspects aspects;
+        std::function<void()> run;
+        int runs = 0;
+    };
+
+    QVector<Handler> handlers;
+    Aspects pending;
+    QTimer* flushTimer;
+    bool flushing;
+    int marks;
+    int flushes;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(UpdateCoordinator::Aspects)
+
+#endif // UPDATECOORDINATOR_H
@@ -0,0 +1,94 @@
+﻿#include "Bench.h"
+#include "BallEvent.h"
+#include "ClockSync.h"
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QDebug>
+
+namespace {
+
+// Per-ball CPU of the glue between detection and the server: the old
+// QJsonObject round trips against passing a BallEvent
+struct BallEventResult {
+    int balls = 0;
+    double jsonPipelineUs = 0.0;
+    double typedPipelineUs = 0.0;
+};
+
+BallEventResult runBallEvent(int balls) {
+    BallEventResult result;
+    result.balls = balls;
+
+    const QVector<int> patterns[] = {
+        {0, 0, 0, 0, 0}, {1, 1, 0, 1, 1}, {0, 0, 1, 1, 1}, {1, 0, 0, 0, 1}, {1, 1, 1, 1, 1}
+    };
+    BallTiming timing;
+    timing.speedMps = 7.5;
+    timing.dwellMs = 12.0;
+    const QString bowler = "Bowler 1";
+    volatile int sink = 0;
+
+    // Before: detection -> QJsonObject -> QuickGame parses it back ->
+    // a second QJsonObject for the signal -> main parses the pins again
+    QElapsedTimer timer;
+    timer.start();
+    for (int n = 0; n < balls; ++n) {
+        const QVector<int>& pinStates = patterns[n % 5];
+
+        QJsonObject detected;
+        detected["pins"] = QJsonArray::fromVariantList(QVariantList(pinStates.begin(), pinStates.end()));
+        detected["value"] = BallEvent::valueOf({{quint8(pinStates[0]), quint8(pinStates[1]), quint8(pinStates[2]),
+                                                 quint8(pinStates[3]), quint8(pinStates[4])}});
+        detected["lane_time_us"] = ClockSync::monotonicUs();
+        detected["speed_mps"] = timing.speedMps;
+        detected["dwell_ms"] = timing.dwellMs;
+
+        QVector<int> parsed;
+        for (const QJsonValue& pin : detected["pins"].toArray()) {
+            parsed.append(pin.toInt());
+        }
+        BallTiming parsedTiming = BallTiming::fromJson(detected);
+
+        QJsonObject processed;
+        processed["bowler"] = bowler;
+        processed["frame"] = n % 10 + 1;
+        processed["ball"] = n % 3 + 1;
+        processed["pins"] = QJsonArray::fromVariantList(QVariantList(parsed.begin(), parsed.end()));
+        processed["value"] = detected["value"].toInt();
+        processed["lane_time_us"] = ClockSync::monotonicUs();
+        processed["speed_mps"] = parsedTiming.speedMps;
+        processed["dwell_ms"] = parsedTiming.dwellMs;
+
+        QVector<int> statsPins;
+        for (const QJsonValue& pin : processed["pins"].toArray()) {
+            statsPins.append(pin.toInt());
+        }
+        sink = sink + statsPins.size() + processed["value"].toInt();
+    }
+    result.jsonPipelineUs = timer.nsecsElapsed() / 1e3 / balls;
+
+    // After: one struct by value, JSON once for the wire
+    timer.restart();
+    for (int n = 0; n < balls; ++n) {
+        BallEvent event = BallEvent::fromPins(patterns[n % 5], timing);
+        event.bowler = bowler;
+        event.frame = n % 10 + 1;
+        event.ball = n % 3 + 1;
+
+        BallEvent delivered = event;
+        QJsonObject wire = delivered.toJson();
+        sink = sink + delivered.value + wire.size();
+    }
+    result.typedPipelineUs = timer.nsecsElapsed() / 1e3 / balls;
+
+    qDebug() << "Ball pipeline benchmark:" << balls << "balls -" << result.jsonPipelineUs << "us/ball with JSON round trips,"
+             << result.typedPipelineUs << "us/ball with BallEvent";
+    return result;
+}
+
+} // namespace
+
+bool benchBallEvent() {
+    BallEventResult result = runBallEvent(200000);
+    return result.typedPipelineUs > 0.0;
+}
@@ -0,0 +1,24 @@
+﻿// Bench.h - Benchmarks and self-tests, kept out of the shipped classes
+#ifndef BENCH_H
+#define BENCH_H
+
+// Each case measures one thing against the real classes and reports it
+// with qDebug. It returns false if it could not run or a check failed.
+// lane_bench runs every case, or the ones named on the command line.
+bool benchTimingWheel();
+bool benchBallEvent();
+bool benchUpdateCoordinator();
+bool benchTaskScheduler();
+bool benchMachineBridge();
+bool benchLanePowerManager();
+bool benchHeartbeat();
+bool benchLaneClientLatency();
+bool benchRealTimeJitter();
+bool benchMediaSync();
+bool benchEventBus();
+bool benchBroadcastEngine();
+bool benchFailover();
+bool benchBowlerDirectory();
+bool benchEndOfDayReport();
+
+#endif // BENCH_H
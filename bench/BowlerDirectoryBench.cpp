@@ -0,0 +1,100 @@
+﻿#include "Bench.h"
+#include "BowlerDirectory.h"
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// Lookup latency per keystroke over a large synthetic membership
+struct DirectoryResult {
+    int members = 0;
+    int lookups = 0;
+    double buildMs = 0.0;
+    double averageUs = 0.0;
+    double maxUs = 0.0;
+    double fuzzyAverageUs = 0.0;
+};
+
+DirectoryResult runDirectory(int memberCount) {
+    static const char* firstNames[] = {
+        "Anne", "Benoit", "Carla", "David", "Elena", "Francois", "Grace", "Henry", "Isabelle", "Jacques",
+        "Karen", "Louis", "Marie", "Nathan", "Olivia", "Pierre", "Quinn", "Rachel", "Samuel", "Tanya",
+        "Ursula", "Victor", "Wendy", "Xavier", "Yvonne", "Zachary", "Amelie", "Bruce", "Chloe", "Denis"
+    };
+    static const char* lastNames[] = {
+        "Smith", "Tremblay", "Gagnon", "Roy", "Cote", "Bouchard", "Gauthier", "Morin", "Lavoie", "Fortin",
+        "Gagne", "Ouellet", "Pelletier", "Belanger", "Levesque", "Bergeron", "Leblanc", "Paquette", "Girard",
+        "Simard", "Boucher", "Caron", "Beaulieu", "Cloutier", "Dube", "Poirier", "Fournier", "Lapointe",
+        "Leclerc", "Lefebvre", "Martin", "Brown", "Wilson", "Taylor", "Campbell", "Anderson", "Macdonald"
+    };
+    const int firstCount = int(sizeof(firstNames) / sizeof(firstNames[0]));
+    const int lastCount = int(sizeof(lastNames) / sizeof(lastNames[0]));
+
+    QRandomGenerator random(2024);
+    QVector<BowlerRecord> records;
+    records.reserve(memberCount);
+    for (int i = 0; i < memberCount; ++i) {
+        BowlerRecord record;
+        record.id = QString("B%1").arg(i + 1);
+        record.name = QString("%1 %2%3").arg(firstNames[random.bounded(firstCount)],
+                                              lastNames[random.bounded(lastCount)])
+                                         .arg(random.bounded(1000));
+        records.append(record);
+    }
+
+    DirectoryResult result;
+    result.members = memberCount;
+
+    BowlerDirectory directory;
+    QElapsedTimer timer;
+    timer.start();
+    directory.setMembers(records);
+    result.buildMs = timer.nsecsElapsed() / 1e6;
+
+    // Every keystroke of 1000 names as typed at the desk
+    double totalUs = 0.0;
+    for (int n = 0; n < 1000; ++n) {
+        const QString name = records[random.bounded(memberCount)].name;
+        for (int length = 1; length <= name.size(); ++length) {
+            timer.restart();
+            QVector<int> matches = directory.complete(name.left(length));
+            double us = timer.nsecsElapsed() / 1e3;
+            totalUs += us;
+            result.maxUs = std::max(result.maxUs, us);
+            result.lookups++;
+            Q_UNUSED(matches)
+        }
+    }
+    result.averageUs = result.lookups > 0 ? totalUs / result.lookups : 0.0;
+
+    // Surnames with a transposed letter: no exact prefix, found by the fuzzy pass
+    double fuzzyUs = 0.0;
+    int fuzzyLookups = 0;
+    for (int n = 0; n < 1000; ++n) {
+        QString surname = QString::fromLatin1(lastNames[random.bounded(lastCount)]);
+        if (surname.size() < 4) continue;
+        const QChar second = surname[1];
+        surname[1] = surname[2];
+        surname[2] = second;
+        timer.restart();
+        QVector<int> matches = directory.complete(surname);
+        fuzzyUs += timer.nsecsElapsed() / 1e3;
+        fuzzyLookups++;
+        Q_UNUSED(matches)
+    }
+    result.fuzzyAverageUs = fuzzyLookups > 0 ? fuzzyUs / fuzzyLookups : 0.0;
+
+    qDebug() << "Bowler directory benchmark:" << result.members << "members built in" << result.buildMs << "ms -"
+             << result.lookups << "keystrokes, average" << result.averageUs << "us, worst" << result.maxUs
+             << "us, typo lookups" << result.fuzzyAverageUs << "us";
+    return result;
+}
+
+} // namespace
+
+bool benchBowlerDirectory() {
+    DirectoryResult result = runDirectory(50000);
+    return result.lookups > 0;
+}
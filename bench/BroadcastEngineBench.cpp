@@ -0,0 +1,145 @@
+﻿#include "Bench.h"
+#include "BroadcastEngine.h"
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QDebug>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// 64 lanes on local sockets that ack every message: encode-once fan-out
+// against serialising per lane, and time to the last ack
+struct BroadcastResult {
+    int lanes = 0;
+    int messages = 0;
+    double perLaneEncodeUs = 0.0;   // Old path: one toJson() per socket
+    double sharedEncodeUs = 0.0;    // Encode once + write pass
+    double averageCompleteMs = 0.0;
+    int incomplete = -1;            // Broadcasts that timed out; -1 if the lanes never connected
+};
+
+BroadcastResult runBroadcast(int laneCount, int messages) {
+    BroadcastResult result;
+    result.lanes = laneCount;
+    result.messages = messages;
+
+    QTcpServer server;
+    if (!server.listen(QHostAddress::LocalHost, 0)) {
+        qWarning() << "Broadcast benchmark: cannot listen:" << server.errorString();
+        return result;
+    }
+
+    TimingWheel wheel(10);
+    BroadcastEngine engine(&wheel);
+
+    // Simulated lanes: ack every broadcast, like LaneClient does
+    std::vector<std::unique_ptr<QTcpSocket>> lanes;
+    for (int i = 1; i <= laneCount; ++i) {
+        auto lane = std::make_unique<QTcpSocket>();
+        QTcpSocket* socket = lane.get();
+        QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket, i]() {
+            while (socket->canReadLine()) {
+                QJsonObject message = QJsonDocument::fromJson(socket->readLine()).object();
+                if (!message.contains("broadcast_id")) continue;
+
+                QJsonObject ack;
+                ack["type"] = "broadcast_ack";
+                ack["broadcast_id"] = message["broadcast_id"];
+                ack["lane_id"] = i;
+                ack["ok"] = true;
+                socket->write(QJsonDocument(ack).toJson(QJsonDocument::Compact) + "\n");
+            }
+        });
+        socket->connectToHost(QHostAddress::LocalHost, server.serverPort());
+        lanes.push_back(std::move(lane));
+    }
+
+    // Server ends of the connections, reading acks
+    QMap<int, QTcpSocket*> sockets;
+    QEventLoop loop;
+    QTimer guard;
+    guard.setSingleShot(true);
+    QObject::connect(&guard, &QTimer::timeout, &loop, &QEventLoop::quit);
+
+    QObject::connect(&server, &QTcpServer::newConnection, &server, [&]() {
+        while (server.hasPendingConnections()) {
+            QTcpSocket* socket = server.nextPendingConnection();
+            sockets.insert(sockets.size() + 1, socket);
+            QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket, &engine]() {
+                while (socket->canReadLine()) {
+                    QJsonObject message = QJsonDocument::fromJson(socket->readLine()).object();
+                    engine.handleAck(message["lane_id"].toInt(), message);
+                }
+            });
+        }
+        if (sockets.size() == laneCount) loop.quit();
+    });
+
+    guard.start(5000);
+    if (sockets.size() < laneCount) loop.exec();
+    if (sockets.size() < laneCount) {
+        qWarning() << "Broadcast benchmark: only" << sockets.size() << "of" << laneCount << "lanes connected";
+        return result;
+    }
+    result.incomplete = 0;
+
+    QJsonObject data;
+    data["message"] = "League night starts in 15 minutes - please check in at the front desk";
+    data["speed"] = 50;
+
+    // Old path: a fresh toJson() for every socket
+    QElapsedTimer timer;
+    qint64 perLaneNs = 0;
+    for (int m = 0; m < messages; ++m) {
+        timer.start();
+        for (QTcpSocket* socket : sockets) {
+            QJsonObject message;
+            message["type"] = "scroll_message";
+            message["data"] = data;
+            message["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+            socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + "\n");
+        }
+        perLaneNs += timer.nsecsElapsed();
+    }
+
+    // Encode once, one write pass, wait for every ack
+    qint64 sharedUs = 0;
+    qint64 completeMs = 0;
+    for (int m = 0; m < messages; ++m) {
+        bool finished = false;
+        engine.broadcast(sockets, "all", "scroll_message", data, BroadcastEngine::DEFAULT_ACK_TIMEOUT_MS,
+                         [&](const BroadcastReport& report) {
+            sharedUs += report.encodeUs + report.writeUs;
+            completeMs += report.completeMs;
+            if (report.timedOut) result.incomplete++;
+            finished = true;
+            loop.quit();
+        });
+        guard.start(BroadcastEngine::DEFAULT_ACK_TIMEOUT_MS * 2);
+        if (!finished) loop.exec();
+    }
+
+    result.perLaneEncodeUs = messages > 0 ? perLaneNs / 1000.0 / messages : 0.0;
+    result.sharedEncodeUs = messages > 0 ? double(sharedUs) / messages : 0.0;
+    result.averageCompleteMs = messages > 0 ? double(completeMs) / messages : 0.0;
+
+    qDebug() << "Broadcast benchmark:" << laneCount << "lanes," << messages << "messages -"
+             << result.perLaneEncodeUs << "us per-lane encode vs" << result.sharedEncodeUs
+             << "us encode-once," << result.averageCompleteMs << "ms to last ack,"
+             << result.incomplete << "incomplete";
+
+    return result;
+}
+
+} // namespace
+
+bool benchBroadcastEngine() {
+    BroadcastResult result = runBroadcast(64, 200);
+    return result.incomplete == 0;
+}
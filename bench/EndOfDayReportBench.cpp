@@ -0,0 +1,100 @@
+﻿#include "Bench.h"
+#include "EndOfDayReport.h"
+#include "EventLog.h"
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QDebug>
+
+namespace {
+
+// A synthetic day for a full house, aggregated on one thread and on all
+// cores; the two must agree
+struct EndOfDayResult {
+    int lanes = 0;
+    qint64 lines = 0;
+    qint64 bytes = 0;
+    int workers = 0;
+    double singleMs = 0.0;
+    double parallelMs = 0.0;
+    bool consistent = false;
+};
+
+EndOfDayResult runEndOfDay(int lanes, int sessionsPerLane) {
+    EndOfDayResult result;
+    result.lanes = lanes;
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        return result;
+    }
+
+    // Lanes interleaved as they would be in a real day
+    {
+        EventLog log(nullptr, dir.path());
+        qint64 timeUs = 0;
+        for (int session = 0; session < sessionsPerLane; ++session) {
+            for (int lane = 1; lane <= lanes; ++lane) {
+                QJsonArray bowlers;
+                QJsonArray finalScores;
+                const int bowlerCount = 2 + (lane + session) % 4;
+                for (int b = 0; b < bowlerCount; ++b) {
+                    QString name = QString("Bowler %1-%2").arg(lane).arg(b);
+                    bowlers.append(QJsonObject{{"name", name}, {"shoes", (b + session) % 3 == 0},
+                                               {"youth", (b + lane) % 5 == 0}});
+                    finalScores.append(QJsonObject{{"name", name},
+                                                   {"final_score", (lane * 37 + session * 11 + b * 53) % 451}});
+
+                    for (int ball = 0; ball < 30; ++ball) {
+                        QJsonObject ballMessage{{"bowler", name}, {"frame", ball / 3 + 1}, {"ball", ball % 3 + 1},
+                                                {"pins", QJsonArray{1, 0, 1, 1, 0}}, {"value", 10}};
+                        log.append(lane, "ball", ++timeUs, ballMessage);
+                    }
+                }
+                if ((lane + session) % 17 == 0) {
+                    log.append(lane, "machine_fault", ++timeUs, QJsonObject{{"error", "Pinsetter jam"}});
+                }
+
+                QJsonObject setup{{"bowlers", bowlers}};
+                setup["games"] = session % 2 ? QJsonValue(2) : QJsonValue();
+                setup["time"] = session % 2 ? QJsonValue() : QJsonValue(60);
+                QJsonObject data{{"games_played", 2}, {"total_time", 3000}, {"final_scores", finalScores},
+                                 {"setup", setup}};
+                log.append(lane, "game_complete", ++timeUs, QJsonObject{{"data", data}});
+            }
+        }
+    }
+
+    QString logPath = EventLog::pathFor(dir.path(), QDate::currentDate());
+    result.bytes = QFileInfo(logPath).size();
+    result.workers = qMax(1, QThread::idealThreadCount());
+
+    QElapsedTimer timer;
+    timer.start();
+    EndOfDayReport::Totals single = EndOfDayReport::aggregate(logPath, 1);
+    result.singleMs = timer.nsecsElapsed() / 1e6;
+
+    timer.restart();
+    EndOfDayReport::Totals parallel = EndOfDayReport::aggregate(logPath, result.workers);
+    result.parallelMs = timer.nsecsElapsed() / 1e6;
+
+    result.lines = parallel.lines;
+    QJsonObject a = EndOfDayReport::toJson(single, QDate::currentDate());
+    QJsonObject b = EndOfDayReport::toJson(parallel, QDate::currentDate());
+    result.consistent = a["lanes"] == b["lanes"] && a["high_scores"] == b["high_scores"] &&
+                        a["events"] == b["events"] && single.malformed == 0 && parallel.malformed == 0;
+
+    qDebug() << "End of day benchmark:" << result.lines << "events," << result.bytes / 1024 << "KiB -"
+             << result.singleMs << "ms on 1 thread," << result.parallelMs << "ms on" << result.workers
+             << (result.consistent ? "(consistent)" : "(MISMATCH)");
+    return result;
+}
+
+} // namespace
+
+bool benchEndOfDayReport() {
+    EndOfDayResult result = runEndOfDay(40, 40);
+    return result.consistent;
+}
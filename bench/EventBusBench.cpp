@@ -0,0 +1,130 @@
+﻿#include "Bench.h"
+#include "EventBus.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDebug>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct BenchmarkEvent {
+    int laneId;
+    quint64 sequence;
+    QByteArray payload;     // Moved through the bus, never copied
+};
+
+// Publish throughput with many subscribers, on the publishing thread and
+// from several producer threads into one consumer thread
+struct EventBusResult {
+    int subscribers = 0;
+    int producerThreads = 0;
+    int events = 0;
+    double directEventsPerSecond = 0.0;
+    double directCallsPerSecond = 0.0;
+    double queuedEventsPerSecond = 0.0;
+    double queuedCallsPerSecond = 0.0;
+    bool delivered = false;
+};
+
+EventBusResult runEventBus(int subscribers, int events, int producerThreads) {
+    EventBusResult result;
+    result.subscribers = subscribers;
+    result.producerThreads = qMax(1, producerThreads);
+    result.events = events;
+
+    const QByteArray frame(256, 'x');   // About one frame_update message
+
+    // Same thread: direct calls only
+    {
+        EventBus bus;
+        QObject receiver;
+        std::atomic<quint64> calls{0};
+        for (int i = 0; i < subscribers; ++i) {
+            bus.subscribe<BenchmarkEvent>(&receiver, [&calls](const BenchmarkEvent&) {
+                calls.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < events; ++i) {
+            bus.publish(BenchmarkEvent{i % 40, quint64(i), frame});
+        }
+        double seconds = qMax(timer.nsecsElapsed() / 1e9, 1e-9);
+
+        result.directEventsPerSecond = events / seconds;
+        result.directCallsPerSecond = calls.load() / seconds;
+    }
+
+    // Several producer threads into one consumer thread
+    {
+        QThread consumer;
+        consumer.start();
+        std::unique_ptr<EventBus> bus(new EventBus());
+
+        QObject* receiver = new QObject();
+        receiver->moveToThread(&consumer);
+
+        std::atomic<quint64> calls{0};
+        for (int i = 0; i < subscribers; ++i) {
+            bus->subscribe<BenchmarkEvent>(receiver, [&calls](const BenchmarkEvent&) {
+                calls.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+
+        const quint64 perProducer = events / result.producerThreads;
+        const quint64 expected = perProducer * result.producerThreads * subscribers;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < result.producerThreads; ++p) {
+            producers.emplace_back([&bus, &frame, perProducer, p]() {
+                for (quint64 i = 0; i < perProducer; ++i) {
+                    bus->publish(BenchmarkEvent{p, i, frame});
+                }
+            });
+        }
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+
+        while (calls.load() < expected && timer.elapsed() < 60000) {
+            QThread::usleep(100);
+        }
+        double seconds = qMax(timer.nsecsElapsed() / 1e9, 1e-9);
+
+        result.delivered = calls.load() == expected;
+        if (!result.delivered) {
+            qWarning() << "EventBus benchmark: consumer delivered" << calls.load() << "of" << expected;
+        }
+
+        result.queuedEventsPerSecond = (perProducer * result.producerThreads) / seconds;
+        result.queuedCallsPerSecond = calls.load() / seconds;
+
+        // The bus goes first so its mailbox is deleted while the consumer still runs
+        bus.reset();
+        QMetaObject::invokeMethod(receiver, [receiver]() { delete receiver; }, Qt::BlockingQueuedConnection);
+        consumer.quit();
+        consumer.wait();
+    }
+
+    qDebug() << "EventBus benchmark:" << subscribers << "subscribers," << events << "events -"
+             << qRound64(result.directEventsPerSecond) << "events/s direct,"
+             << qRound64(result.queuedEventsPerSecond) << "events/s from"
+             << result.producerThreads << "threads ("
+             << qRound64(result.queuedCallsPerSecond) << "handler calls/s)";
+
+    return result;
+}
+
+} // namespace
+
+bool benchEventBus() {
+    EventBusResult result = runEventBus(200, 100000, 4);
+    return result.delivered;
+}
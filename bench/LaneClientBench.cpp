@@ -0,0 +1,491 @@
+﻿#include "Bench.h"
+#include "LaneClient.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+const int FRAME_MS = 16;            // UI frame timer of the stress test
+const int SYNC_WAIT_MS = 30000;     // Registration and clock sync
+
+// Stand-in lane server: registers lanes, answers heartbeats, acks and
+// counts balls as LaneServer does, and pushes house display traffic at a
+// steady rate, with a command to acknowledge every so often
+class StressServer : public QObject
+{
+public:
+    StressServer()
+        : m_listener(new QTcpServer(this))
+        , m_pushTimer(new QTimer(this))
+        , m_pushes(0)
+        , m_balls(0)
+        , m_liveness(0)
+    {
+        QJsonArray lanes;
+        for (int lane = 1; lane <= PUSH_LANES; ++lane) {
+            QJsonObject row;
+            row["lane"] = lane;
+            row["bowler"] = QString("Bowler %1").arg(lane);
+            row["frames"] = QJsonArray({15, 27, 42, 50, 65, 80, 92, 107, 120, 135});
+            lanes.append(row);
+        }
+        QJsonObject push;
+        push["type"] = "house_display";
+        push["lanes"] = lanes;
+        m_pushLine = QJsonDocument(push).toJson(QJsonDocument::Compact) + "\n";
+
+        connect(m_listener, &QTcpServer::newConnection, this, [this]() { onConnection(); });
+        connect(m_pushTimer, &QTimer::timeout, this, [this]() { push(); });
+    }
+
+    // Without house traffic the lane hears nothing it did not ask for
+    quint16 listen(bool houseTraffic = true)
+    {
+        m_listener->listen(QHostAddress::LocalHost, 0);
+        if (houseTraffic) {
+            m_pushTimer->start(PUSH_INTERVAL_MS);
+        }
+        return m_listener->serverPort();
+    }
+
+    int balls() const { return m_balls.load(); }
+    void resetBalls() { m_balls.store(0); }
+
+    // Heartbeats and pings received plus heartbeat responses sent
+    int livenessMessages() const { return m_liveness.load(); }
+    void resetLiveness() { m_liveness.store(0); }
+
+private:
+    void onConnection()
+    {
+        while (QTcpSocket *socket = m_listener->nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                while (socket->canReadLine()) {
+                    onLine(socket, socket->readLine());
+                }
+            });
+            connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                m_lanes.removeAll(socket);
+                socket->deleteLater();
+            });
+        }
+    }
+
+    void onLine(QTcpSocket *socket, const QByteArray &line)
+    {
+        QJsonObject message = QJsonDocument::fromJson(line).object();
+        QString type = message["type"].toString();
+
+        QJsonObject reply;
+        if (type == "registration") {
+            reply["type"] = "registration_response";
+            reply["status"] = "success";
+            m_lanes.append(socket);
+        } else if (type == "heartbeat") {
+            m_liveness.fetch_add(2);
+            reply["type"] = "heartbeat_response";
+            reply["t0_us"] = message["t0_us"];
+            reply["t1_us"] = ClockSync::wallUs();
+            reply["t2_us"] = ClockSync::wallUs();
+        } else if (type == "ping") {
+            m_liveness.fetch_add(1);
+        } else if (type == "ball") {
+            m_balls.fetch_add(1);
+            reply["type"] = "ball_ack";
+            reply["game"] = message["game"];
+            reply["seq"] = message["seq"];
+        }
+
+        if (!reply.isEmpty()) {
+            socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact) + "\n");
+        }
+    }
+
+    void push()
+    {
+        ++m_pushes;
+        for (QTcpSocket *lane : m_lanes) {
+            lane->write(m_pushLine);
+
+            if (m_pushes % COMMAND_EVERY == 0) {
+                QJsonObject command;
+                command["type"] = "scroll_message";
+                command["data"] = QJsonObject{{"message", "Stress"}};
+                command["request_id"] = m_pushes;
+                lane->write(QJsonDocument(command).toJson(QJsonDocument::Compact) + "\n");
+            }
+        }
+    }
+
+    QTcpServer *m_listener;
+    QTimer *m_pushTimer;
+    QList<QTcpSocket *> m_lanes;
+    QByteArray m_pushLine;
+    int m_pushes;
+    std::atomic<int> m_balls;
+    std::atomic<int> m_liveness;
+
+    static constexpr int PUSH_LANES = 24;           // About 4 KB per push
+    static constexpr int PUSH_INTERVAL_MS = 5;
+    static constexpr int COMMAND_EVERY = 100;
+};
+
+// Forwards lane <-> server bytes after a fixed latency, and holds
+// everything for STALL_MS out of every STALL_EVERY_MS the way a flapping
+// switch port does; what queued up meanwhile then arrives in one burst
+class LatencyProxy : public QObject
+{
+public:
+    LatencyProxy(quint16 upstreamPort, int latencyMs)
+        : m_listener(new QTcpServer(this))
+        , m_pumpTimer(new QTimer(this))
+        , m_upstreamPort(upstreamPort)
+        , m_latencyUs(latencyMs * 1000LL)
+    {
+        m_pumpTimer->setTimerType(Qt::PreciseTimer);
+        connect(m_listener, &QTcpServer::newConnection, this, [this]() { onConnection(); });
+        connect(m_pumpTimer, &QTimer::timeout, this, [this]() { pump(); });
+    }
+
+    ~LatencyProxy()
+    {
+        qDeleteAll(m_routes);
+    }
+
+    quint16 listen()
+    {
+        m_listener->listen(QHostAddress::LocalHost, 0);
+        m_pumpTimer->start(PUMP_MS);
+        return m_listener->serverPort();
+    }
+
+private:
+    struct Chunk {
+        qint64 dueUs;
+        QByteArray data;
+    };
+
+    struct Route {
+        QTcpSocket *lane;
+        QTcpSocket *server;
+        QList<Chunk> toServer;
+        QList<Chunk> toLane;
+    };
+
+    qint64 dueTime() const
+    {
+        qint64 due = ClockSync::monotonicUs() + m_latencyUs;
+        qint64 phase = due % (STALL_EVERY_MS * 1000LL);
+        if (phase < STALL_MS * 1000LL) {
+            due += STALL_MS * 1000LL - phase;
+        }
+        return due;
+    }
+
+    void onConnection()
+    {
+        while (QTcpSocket *lane = m_listener->nextPendingConnection()) {
+            Route *route = new Route{lane, new QTcpSocket(this), {}, {}};
+            m_routes.append(route);
+
+            connect(lane, &QTcpSocket::readyRead, this, [this, route]() {
+                route->toServer.append({dueTime(), route->lane->readAll()});
+            });
+            connect(route->server, &QTcpSocket::readyRead, this, [this, route]() {
+                route->toLane.append({dueTime(), route->server->readAll()});
+            });
+            connect(lane, &QTcpSocket::disconnected, this, [this, route]() { close(route); });
+            connect(route->server, &QTcpSocket::disconnected, this, [this, route]() { close(route); });
+
+            route->server->connectToHost(QHostAddress::LocalHost, m_upstreamPort);
+        }
+    }
+
+    void close(Route *route)
+    {
+        if (!m_routes.removeOne(route)) {
+            return;
+        }
+        route->lane->abort();
+        route->server->abort();
+        route->lane->deleteLater();
+        route->server->deleteLater();
+        delete route;
+    }
+
+    void pump()
+    {
+        const qint64 now = ClockSync::monotonicUs();
+        for (Route *route : m_routes) {
+            deliver(route->toServer, route->server, now);
+            deliver(route->toLane, route->lane, now);
+        }
+    }
+
+    static void deliver(QList<Chunk> &queue, QTcpSocket *to, qint64 now)
+    {
+        if (to->state() != QAbstractSocket::ConnectedState) {
+            return;
+        }
+        while (!queue.isEmpty() && queue.first().dueUs <= now) {
+            to->write(queue.takeFirst().data);
+        }
+    }
+
+    QTcpServer *m_listener;
+    QTimer *m_pumpTimer;
+    quint16 m_upstreamPort;
+    qint64 m_latencyUs;
+    QList<Route *> m_routes;
+
+    static constexpr int PUMP_MS = 2;
+    static constexpr int STALL_EVERY_MS = 2000;
+    static constexpr int STALL_MS = 700;
+};
+
+// UI frame intervals while a lane bowls through a local proxy that adds
+// latency and stalls the link now and then (the queued traffic then
+// arrives in a burst): no client, the client on the UI thread, and the
+// client on its I/O thread
+struct StressResult {
+    struct Frames {
+        int frames = 0;
+        double p50Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+    };
+    Frames baseline;
+    Frames inlineClient;
+    Frames ioThread;
+    int ballsSent = 0;          // Per client run
+    int ballsArrived = 0;       // At the server, I/O thread run
+};
+
+StressResult::Frames summarizeFrames(QVector<qint64> intervalsUs)
+{
+    StressResult::Frames frames;
+    if (intervalsUs.isEmpty()) {
+        return frames;
+    }
+
+    std::sort(intervalsUs.begin(), intervalsUs.end());
+    const int count = intervalsUs.size();
+    frames.frames = count;
+    frames.p50Ms = intervalsUs[count / 2] / 1000.0;
+    frames.p99Ms = intervalsUs[std::min(count - 1, count * 99 / 100)] / 1000.0;
+    frames.maxMs = intervalsUs.last() / 1000.0;
+    return frames;
+}
+
+// Liveness messages per lane per hour (both directions) as they cross the
+// wire: a real LaneClient registered with the stand-in server, counted
+// once its clock has settled, first in attract mode and then bowling
+// ballsPerHour balls with a mirror update each. Against the old fixed
+// ping + heartbeat + heartbeat_response every 10 s.
+struct HeartbeatResult {
+    double legacyPerHour = 0.0;
+    double idlePerHour = -1.0;
+    double activePerHour = -1.0;
+};
+
+HeartbeatResult runHeartbeat(int ballsPerHour, int windowSeconds)
+{
+    HeartbeatResult result;
+    result.legacyPerHour = 3.0 * 3600 / 10;
+
+    QThread network;
+    network.setObjectName("heartbeat-network");
+    StressServer *server = new StressServer();
+    server->moveToThread(&network);
+    network.start();
+
+    quint16 serverPort = 0;
+    QMetaObject::invokeMethod(server, [&]() { serverPort = server->listen(false); },
+                              Qt::BlockingQueuedConnection);
+
+    QEventLoop loop;
+    auto wait = [&](int ms) {
+        QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+        loop.exec();
+    };
+    auto perHour = [&]() {
+        return double(server->livenessMessages()) * 3600 / windowSeconds;
+    };
+
+    LaneClient *client = new LaneClient(1);
+    client->setServerAddress("127.0.0.1", serverPort);
+    client->start();
+
+    // Quick exchanges until the clock estimate settles; those are not counted
+    for (int waited = 0; waited < SYNC_WAIT_MS && !(client->isConnected() && client->clock().isSynced());
+         waited += 100) {
+        wait(100);
+    }
+
+    if (client->isConnected() && client->clock().isSynced()) {
+        // Let the beat already scheduled at the sync rate go out first
+        wait(2000);
+        server->resetLiveness();
+        wait(windowSeconds * 1000);
+        result.idlePerHour = perHour();
+
+        // The lane tells the server its new interval straight away; count from the next one
+        client->setGameActive(true);
+        wait(1000);
+        server->resetLiveness();
+
+        int balls = 0;
+        QTimer bowl;
+        QObject::connect(&bowl, &QTimer::timeout, [&]() {
+            BallEvent ball = BallEvent::fromPins(QVector<int>{0, 1, 0, 1, 1});
+            ball.laneTimeUs = ClockSync::monotonicUs();
+            ball.sequence = ++balls;
+            ball.gameNumber = 1;
+            client->sendBall(ball);
+
+            QJsonObject state;
+            state["balls"] = balls;
+            client->publishGameState(1, "quick_game", state);
+        });
+        bowl.start(3600 * 1000 / qMax(1, ballsPerHour));
+        wait(windowSeconds * 1000);
+        bowl.stop();
+        result.activePerHour = perHour();
+    } else {
+        qWarning() << "Heartbeat benchmark: lane did not register and sync its clock";
+    }
+
+    delete client;
+    QMetaObject::invokeMethod(server, [server]() { delete server; }, Qt::BlockingQueuedConnection);
+    network.quit();
+    network.wait();
+
+    qDebug() << "Heartbeat benchmark (liveness messages per lane per hour, over" << windowSeconds
+             << "s windows): idle" << result.legacyPerHour << "->" << result.idlePerHour << ", in game at"
+             << ballsPerHour << "balls/h" << result.legacyPerHour << "->" << result.activePerHour;
+    return result;
+}
+
+StressResult runLatencyStress(int latencyMs, int seconds)
+{
+    StressResult result;
+
+    // Server and proxy get their own thread so only the client's work lands on this one
+    QThread network;
+    network.setObjectName("stress-network");
+    StressServer *server = new StressServer();
+    LatencyProxy *proxy = nullptr;
+    server->moveToThread(&network);
+    network.start();
+
+    quint16 serverPort = 0;
+    quint16 proxyPort = 0;
+    QMetaObject::invokeMethod(server, [&]() { serverPort = server->listen(); }, Qt::BlockingQueuedConnection);
+    proxy = new LatencyProxy(serverPort, latencyMs);
+    proxy->moveToThread(&network);
+    QMetaObject::invokeMethod(proxy, [&]() { proxyPort = proxy->listen(); }, Qt::BlockingQueuedConnection);
+
+    // A busy lane: a ball and a mirror update every few frames
+    const int ballEveryFrames = 6;
+
+    auto runPhase = [&](LaneClient *client) {
+        QVector<qint64> intervals;
+        QElapsedTimer clock;
+        qint64 lastUs = -1;
+        int frame = 0;
+        int balls = 0;
+
+        QTimer frameTimer;
+        frameTimer.setTimerType(Qt::PreciseTimer);
+        QObject::connect(&frameTimer, &QTimer::timeout, [&]() {
+            qint64 nowUs = clock.nsecsElapsed() / 1000;
+            if (lastUs >= 0) {
+                intervals.append(nowUs - lastUs);
+            }
+            lastUs = nowUs;
+
+            if (client && ++frame % ballEveryFrames == 0) {
+                BallEvent ball = BallEvent::fromPins(QVector<int>{0, 1, 0, 1, 1});
+                ball.laneTimeUs = ClockSync::monotonicUs();
+                ball.sequence = ++balls;
+                client->sendBall(ball);
+
+                QJsonObject state;
+                state["balls"] = balls;
+                client->publishGameState(1, "quick_game", state);
+            }
+        });
+
+        if (client) {
+            client->setServerAddress("127.0.0.1", proxyPort);
+            client->setGameActive(true);
+            client->start();
+        }
+
+        QEventLoop loop;
+        QTimer::singleShot(seconds * 1000, &loop, &QEventLoop::quit);
+        clock.start();
+        frameTimer.start(FRAME_MS);
+        loop.exec();
+        frameTimer.stop();
+
+        if (client) {
+            result.ballsSent = balls;
+        }
+        return summarizeFrames(intervals);
+    };
+
+    result.baseline = runPhase(nullptr);
+
+    LaneClient *inlineClient = new LaneClient(99, nullptr, LaneClient::Threading::Inline);
+    result.inlineClient = runPhase(inlineClient);
+    delete inlineClient;
+
+    server->resetBalls();
+    LaneClient *threadedClient = new LaneClient(99, nullptr, LaneClient::Threading::IoThread);
+    result.ioThread = runPhase(threadedClient);
+    result.ballsArrived = server->balls();
+    delete threadedClient;
+
+    QMetaObject::invokeMethod(proxy, [proxy]() { delete proxy; }, Qt::BlockingQueuedConnection);
+    QMetaObject::invokeMethod(server, [server]() { delete server; }, Qt::BlockingQueuedConnection);
+    network.quit();
+    network.wait();
+
+    auto report = [](const char *name, const StressResult::Frames &frames) {
+        qDebug().nospace() << "  " << name << ": " << frames.frames << " frames, p50 " << frames.p50Ms
+                           << " ms, p99 " << frames.p99Ms << " ms, max " << frames.maxMs << " ms";
+    };
+    qDebug() << "LaneClient stress test:" << latencyMs << "ms latency with stalls," << seconds
+             << "s per run," << FRAME_MS << "ms frames";
+    report("no client", result.baseline);
+    report("client on UI thread", result.inlineClient);
+    report("client on I/O thread", result.ioThread);
+    qDebug() << "  balls sent" << result.ballsSent << "per run, arrived" << result.ballsArrived
+             << "(I/O thread run; the rest were still in the proxy)";
+    return result;
+}
+
+} // namespace
+
+bool benchHeartbeat()
+{
+    HeartbeatResult result = runHeartbeat(180, 120);
+    return result.idlePerHour > 0 && result.idlePerHour < result.legacyPerHour &&
+           result.activePerHour > 0 && result.activePerHour < result.legacyPerHour;
+}
+
+bool benchLaneClientLatency()
+{
+    StressResult result = runLatencyStress(150, 5);
+    return result.ioThread.frames > 0 && result.ballsArrived > 0;
+}
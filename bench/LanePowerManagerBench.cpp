@@ -0,0 +1,127 @@
+﻿#include "Bench.h"
+#include "LanePowerManager.h"
+#include <QEventLoop>
+#include <QMetaObject>
+#include <QTimer>
+#include <QDebug>
+#include <algorithm>
+#include <thread>
+
+// Idles the lane on demand and injects sensor edges the way the GPIO path does
+struct LanePowerManagerBench {
+    static void holdIdleTimeout(LanePowerManager& manager) { manager.idleTimeoutMs = 3600000; }
+    static void enterIdle(LanePowerManager& manager) { manager.enterIdle(); }
+    static void sensorEdge(LanePowerManager& manager, qint64 edgeNs) { manager.onSensorActivity(edgeNs); }
+    static qint64 budgetUs() { return LanePowerManager::WAKE_LATENCY_BUDGET_US; }
+};
+
+namespace {
+
+// Idle the lane, then wake it the two ways a real lane is woken: a ball
+// sensor edge posted from another thread (as the GPIO ISR does) and a
+// lane command handed over from the network thread. Latency runs from
+// the injected edge/command to the woken lane, against the 100 ms budget.
+struct WakeResult {
+    struct Source {
+        int wakes = 0;
+        qint64 p50Us = 0;
+        qint64 maxUs = 0;
+        int overBudget = 0;
+    };
+    Source sensor;
+    Source command;
+    qint64 budgetUs = 0;
+};
+
+WakeResult runWake(int wakesPerSource) {
+    WakeResult result;
+    result.budgetUs = LanePowerManagerBench::budgetUs();
+
+    LanePowerManager manager;
+    LanePowerManagerBench::holdIdleTimeout(manager);    // Only the benchmark idles the lane
+
+    // What an idle lane has to bring back: a frame timer that stops and a
+    // flash timer that is coarsened
+    QTimer frameTimer;
+    QTimer flashTimer;
+    frameTimer.start(16);
+    flashTimer.start(500);
+    manager.manageTimer(&frameTimer);
+    manager.manageTimer(&flashTimer, 2000);
+
+    qint64 wokeLatencyUs = -1;
+    QEventLoop loop;
+    QObject::connect(&manager, &LanePowerManager::wokeUp, &loop, [&](const QString&, qint64 latencyUs) {
+        wokeLatencyUs = latencyUs;
+        loop.quit();
+    });
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+
+    auto measure = [&](bool sensor) {
+        QVector<qint64> samples;
+        for (int i = 0; i < wakesPerSource; ++i) {
+            LanePowerManagerBench::enterIdle(manager);
+
+            // Let the lane settle into idle before the trigger
+            QTimer::singleShot(20, &loop, &QEventLoop::quit);
+            loop.exec();
+
+            wokeLatencyUs = -1;
+            std::thread trigger([&manager, sensor]() {
+                qint64 triggerNs = LanePowerManager::nowNs();
+                if (sensor) {
+                    QMetaObject::invokeMethod(&manager, [&manager, triggerNs]() {
+                        LanePowerManagerBench::sensorEdge(manager, triggerNs);
+                    }, Qt::QueuedConnection);
+                } else {
+                    QMetaObject::invokeMethod(&manager, [&manager, triggerNs]() {
+                        manager.wake("lane command", triggerNs);
+                    }, Qt::QueuedConnection);
+                }
+            });
+            trigger.join();
+
+            timeout.start(1000);
+            loop.exec();
+            timeout.stop();
+            if (wokeLatencyUs < 0) {
+                qWarning() << "Wake benchmark: lane did not wake within 1 s";
+                continue;
+            }
+            samples.append(wokeLatencyUs);
+        }
+
+        WakeResult::Source source;
+        if (samples.isEmpty()) return source;
+        std::sort(samples.begin(), samples.end());
+        source.wakes = samples.size();
+        source.p50Us = samples[samples.size() / 2];
+        source.maxUs = samples.last();
+        source.overBudget = int(samples.end() - std::upper_bound(samples.begin(), samples.end(), result.budgetUs));
+        return source;
+    };
+
+    result.sensor = measure(true);
+    result.command = measure(false);
+
+    auto report = [&](const char* name, const WakeResult::Source& source) {
+        qDebug().nospace() << "  " << name << ": " << source.wakes << " wakes, p50 " << source.p50Us
+                           << " us, max " << source.maxUs << " us, " << source.overBudget
+                           << " over the " << result.budgetUs / 1000 << " ms budget";
+    };
+    qDebug() << "Lane wake benchmark:";
+    report("ball sensor edge", result.sensor);
+    report("lane command", result.command);
+    return result;
+}
+
+} // namespace
+
+bool benchLanePowerManager() {
+    const int wakes = 50;
+    WakeResult result = runWake(wakes);
+    return result.sensor.wakes == wakes && result.command.wakes == wakes &&
+           result.sensor.overBudget == 0 && result.command.overBudget == 0;
+}
@@ -0,0 +1,91 @@
+﻿#include "Bench.h"
+#include "MachineBridge.h"
+#include <QEventLoop>
+#include <QTimer>
+#include <QVector>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// Ping/pong round trips against the Python bridge, one after another,
+// over stdio and then shared memory. A transport that could not be
+// started reports no samples.
+struct RoundTripResult {
+    struct Percentiles {
+        int samples = 0;
+        qint64 p50Us = 0;
+        qint64 p99Us = 0;
+        qint64 maxUs = 0;
+    };
+    Percentiles stdio;
+    Percentiles sharedMemory;
+};
+
+RoundTripResult runRoundTrip(const QString& scriptPath, int pings, const QString& pythonPath) {
+    RoundTripResult result;
+
+    const int warmup = 10;
+    auto measure = [&](MachineBridge::Transport transport) {
+        RoundTripResult::Percentiles percentiles;
+        MachineBridge bridge;
+        if (!bridge.start(transport, scriptPath, pythonPath) || bridge.transport() != transport) {
+            return percentiles;
+        }
+
+        QVector<qint64> samples;
+        QEventLoop loop;
+        QObject::connect(&bridge, &MachineBridge::pongReceived, &loop, [&](qint64 roundTripUs) {
+            samples.append(roundTripUs);
+            loop.quit();
+        });
+        QTimer timeout;
+        timeout.setSingleShot(true);
+        QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+
+        // One ping in flight at a time; the first few also wait out interpreter startup
+        for (int i = 0; i < warmup + pings && bridge.isRunning(); ++i) {
+            int before = samples.size();
+            bridge.ping();
+            timeout.start(i < warmup ? 5000 : 1000);
+            loop.exec();
+            if (samples.size() == before) {
+                qWarning() << "Machine bridge benchmark: ping" << i << "timed out";
+            }
+        }
+        bridge.stop();
+
+        if (samples.size() > warmup) {
+            samples.remove(0, warmup);
+            std::sort(samples.begin(), samples.end());
+            percentiles.samples = samples.size();
+            percentiles.p50Us = samples[samples.size() / 2];
+            percentiles.p99Us = samples[qMin(samples.size() - 1, samples.size() * 99 / 100)];
+            percentiles.maxUs = samples.last();
+        }
+        return percentiles;
+    };
+
+    result.stdio = measure(MachineBridge::Transport::Stdio);
+    result.sharedMemory = measure(MachineBridge::Transport::SharedMemory);
+
+    auto report = [](const char* name, const RoundTripResult::Percentiles& p) {
+        if (p.samples == 0) {
+            qDebug().nospace() << "  " << name << ": not available";
+            return;
+        }
+        qDebug().nospace() << "  " << name << ": " << p.samples << " round trips, p50 " << p.p50Us
+                           << " us, p99 " << p.p99Us << " us, max " << p.maxUs << " us";
+    };
+    qDebug() << "Machine bridge round trip:" << scriptPath;
+    report("stdio", result.stdio);
+    report("shared memory", result.sharedMemory);
+    return result;
+}
+
+} // namespace
+
+bool benchMachineBridge() {
+    RoundTripResult result = runRoundTrip("machine_interface.py", 1000, "python3");
+    return result.stdio.samples > 0 || result.sharedMemory.samples > 0;
+}
@@ -0,0 +1,113 @@
+﻿#include "Bench.h"
+#include "MediaSync.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QRandomGenerator>
+#include <QEventLoop>
+#include <QTimer>
+#include <QDebug>
+
+// Lane and fake server in temporary directories: an edited file, a
+// renamed file, a new file and a stale one. Checks the result is
+// byte-identical and only the changed chunks were transferred.
+bool benchMediaSync() {
+    QTemporaryDir serverDir;
+    QTemporaryDir laneDir;
+    if (!serverDir.isValid() || !laneDir.isValid()) {
+        return false;
+    }
+
+    auto randomBytes = [](int size) {
+        QByteArray data(size, Qt::Uninitialized);
+        for (int i = 0; i < size; ++i) {
+            data[i] = char(QRandomGenerator::global()->bounded(256));
+        }
+        return data;
+    };
+    auto writeFile = [](const QString& dir, const QString& path, const QByteArray& data) {
+        QDir().mkpath(QFileInfo(dir + "/" + path).absolutePath());
+        QFile file(dir + "/" + path);
+        file.open(QIODevice::WriteOnly);
+        file.write(data);
+    };
+    auto readFile = [](const QString& path) {
+        QFile file(path);
+        file.open(QIODevice::ReadOnly);
+        return file.readAll();
+    };
+
+    const int chunk = MediaManifest::CHUNK_SIZE;
+    QByteArray advert = randomBytes(5 * chunk + 1000);
+    QByteArray promo = randomBytes(2 * chunk);
+    QByteArray strike = randomBytes(chunk / 2);
+
+    // Lane: an older advert (one chunk differs), the promo under another name, a stale file
+    QByteArray oldAdvert = advert;
+    oldAdvert.replace(2 * chunk, chunk, randomBytes(chunk));
+    writeFile(laneDir.path(), "ads/advert.bin", oldAdvert);
+    writeFile(laneDir.path(), "ads/promo-old-name.bin", promo);
+    writeFile(laneDir.path(), "ads/stale.bin", randomBytes(1000));
+
+    writeFile(serverDir.path(), "ads/advert.bin", advert);
+    writeFile(serverDir.path(), "ads/promo.bin", promo);
+    writeFile(serverDir.path(), "effects/strike.bin", strike);
+
+    // Fake server: the same two RPCs the lane server answers, asynchronously
+    const QString serverRoot = serverDir.path();
+    MediaManifest serverManifest = MediaManifest::scan(serverRoot, {"ads", "effects"});
+    int requests = 0;
+    MediaSync::Transport fakeServer = [&](const QString& method, const QJsonObject& data, RpcChannel::Callback done) {
+        requests++;
+        QTimer::singleShot(0, [&, method, data, done]() {
+            RpcResult result;
+            if (method == "media_manifest") {
+                result.ok = true;
+                result.result = serverManifest.toJson();
+            } else if (method == "media_chunk") {
+                QByteArray bytes;
+                QByteArray hash = data["hash"].toString().toLatin1();
+                result.ok = serverManifest.readChunk(serverRoot, hash, &bytes);
+                result.result["hash"] = QString::fromLatin1(hash);
+                result.result["data"] = QString::fromLatin1(bytes.toBase64());
+                if (!result.ok) result.error = "Unknown chunk";
+            }
+            done(result);
+        });
+    };
+
+    MediaSync lane(laneDir.path(), fakeServer);
+    lane.loadSettings(QJsonObject{{"IdleBytesPerSecond", 64 * 1024 * 1024}});
+
+    QEventLoop loop;
+    MediaSync::Stats stats;
+    QObject::connect(&lane, &MediaSync::syncFinished, &loop, [&](const MediaSync::Stats& result) {
+        stats = result;
+        loop.quit();
+    });
+    QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+    lane.sync();
+    loop.exec();
+
+    const QString laneRoot = laneDir.path();
+    bool identical = readFile(laneRoot + "/ads/advert.bin") == advert &&
+                     readFile(laneRoot + "/ads/promo.bin") == promo &&
+                     readFile(laneRoot + "/effects/strike.bin") == strike;
+    bool cleaned = !QFile::exists(laneRoot + "/ads/stale.bin") &&
+                   !QFile::exists(laneRoot + "/ads/promo-old-name.bin");
+    qint64 expectedBytes = chunk + strike.size();   // The changed advert chunk and the new effect
+    bool minimal = stats.bytesFetched == expectedBytes;
+
+    // A second sync with nothing changed fetches nothing at all
+    int requestsBefore = requests;
+    lane.sync();
+    loop.exec();
+    bool idempotent = stats.ok && requests - requestsBefore == 1;
+
+    bool passed = stats.ok && identical && cleaned && minimal && idempotent;
+    qDebug() << "Media sync self-test:" << (passed ? "PASS" : "FAIL") << "- fetched" << expectedBytes
+             << "bytes expected," << "identical" << identical << "cleaned" << cleaned
+             << "minimal" << minimal << "idempotent" << idempotent;
+    return passed;
+}
@@ -0,0 +1,192 @@
+﻿#include "Bench.h"
+#include "RealTimeMode.h"
+#include <QImage>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Wakeup latency (actual - intended wakeup) of a cyclictest-style loop
+struct Latency {
+    quint64 samples = 0;
+    qint64 minUs = 0;
+    qint64 maxUs = 0;
+    double avgUs = 0.0;
+    qint64 p99Us = 0;
+    qint64 p999Us = 0;
+    int ballsSimulated = 0;
+    int ballsMissed = 0;        // Fewer than the detection threshold of polls under the ball
+};
+
+struct JitterConfig {
+    int loops = 30000;          // 30 s at 1 ms
+    int intervalUs = 1000;      // The acquisition poll
+    int loadThreads = 0;        // Image scaling threads; 0 = one per core
+    double ballDiameterMm = 127.0;
+    double ballSpeedMps = 8.0;  // A fast 5-pin ball
+    int requiredSamples = 10;   // MachineInterface detectionThreshold
+};
+
+struct JitterResult {
+    Latency normal;
+    Latency realTime;
+    bool realTimeApplied = false;
+    QString realTimeError;
+};
+
+// Wakeup times and lateness of one run of the poll loop
+struct JitterRun {
+    std::vector<qint64> wakeNs;
+    std::vector<qint64> latencyNs;
+};
+
+JitterRun runPollLoop(bool realTime, const RealTimeSettings& settings, const JitterConfig& config,
+                      bool* applied, QString* error) {
+    JitterRun run;
+    run.wakeNs.reserve(config.loops);
+    run.latencyNs.reserve(config.loops);
+
+    // A thread of its own, so scheduling changes stay with it
+    std::thread poller([&]() {
+        if (realTime) {
+            RealTimeSettings forced = settings;
+            forced.enabled = true;
+            *applied = RealTimeMode::applyToCurrentThread(forced, error);
+        }
+
+        const qint64 intervalNs = config.intervalUs * 1000LL;
+        qint64 next = RealTimeMode::monotonicNs() + intervalNs;
+        for (int i = 0; i < config.loops; ++i) {
+            qint64 intended;
+            if (realTime) {
+                // Real-time mode: absolute deadlines, no drift
+                intended = next;
+                RealTimeMode::sleepUntilNs(next);
+                next += intervalNs;
+            } else {
+                // As the acquisition loop does without it: msleep(1) after the work
+                intended = RealTimeMode::monotonicNs() + intervalNs;
+                QThread::usleep(config.intervalUs);
+            }
+            const qint64 now = RealTimeMode::monotonicNs();
+            run.wakeNs.push_back(now);
+            run.latencyNs.push_back(std::max<qint64>(0, now - intended));
+        }
+    });
+    poller.join();
+    return run;
+}
+
+Latency summarize(const JitterRun& run, const JitterConfig& config) {
+    Latency latency;
+    if (run.latencyNs.empty()) return latency;
+
+    std::vector<qint64> sorted;
+    sorted.reserve(run.latencyNs.size());
+    qint64 total = 0;
+    for (qint64 latencyNs : run.latencyNs) {
+        const qint64 us = latencyNs / 1000;
+        sorted.push_back(us);
+        total += us;
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    const size_t count = sorted.size();
+    latency.samples = count;
+    latency.minUs = sorted.front();
+    latency.maxUs = sorted.back();
+    latency.avgUs = double(total) / count;
+    latency.p99Us = sorted[std::min(count - 1, count * 99 / 100)];
+    latency.p999Us = sorted[std::min(count - 1, count * 999 / 1000)];
+
+    // Balls every 37 ms (so they land at every phase of the poll): the
+    // detector needs requiredSamples polls while the ball is on the sensor
+    const qint64 dwellNs = qint64(config.ballDiameterMm / config.ballSpeedMps * 1000000.0);
+    const qint64 spacingNs = 37 * 1000000LL + 300000;
+    for (qint64 start = run.wakeNs.front(); start + dwellNs <= run.wakeNs.back(); start += spacingNs) {
+        auto first = std::lower_bound(run.wakeNs.begin(), run.wakeNs.end(), start);
+        auto last = std::lower_bound(first, run.wakeNs.end(), start + dwellNs);
+        latency.ballsSimulated++;
+        if (last - first < config.requiredSamples) {
+            latency.ballsMissed++;
+        }
+    }
+    return latency;
+}
+
+// The same loop twice under the same load, first as the acquisition
+// thread runs normally and then in real-time mode. Balls are replayed over
+// the recorded wakeup times: one is missed if its time on the sensor
+// holds fewer than requiredSamples polls. Memory locked for the
+// real-time run is unlocked again unless settings enable real-time mode.
+JitterResult runJitter(const RealTimeSettings& settings, const JitterConfig& config) {
+    JitterResult result;
+
+    // Media decode and repaint stand-in: smooth-scale a 720p frame over and over
+    const int loadThreads = config.loadThreads > 0 ? config.loadThreads : QThread::idealThreadCount();
+    std::atomic<bool> loadRunning(true);
+    std::vector<std::thread> load;
+    for (int i = 0; i < loadThreads; ++i) {
+        load.emplace_back([&loadRunning, i]() {
+            QImage frame(1280, 720, QImage::Format_RGB32);
+            frame.fill(QColor::fromHsv((i * 60) % 360, 200, 200));
+            while (loadRunning.load(std::memory_order_relaxed)) {
+                QImage scaled = frame.scaled(960, 540, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+                frame.setPixel(i, i, scaled.pixel(i, i));
+            }
+        });
+    }
+
+    bool applied = false;
+    QString error;
+    JitterRun normal = runPollLoop(false, settings, config, &applied, &error);
+    JitterRun realTime = runPollLoop(true, settings, config, &applied, &error);
+
+#ifdef Q_OS_LINUX
+    // mlockall() is process-wide; only a lane running real-time mode keeps it
+    if (settings.lockMemory && !settings.enabled) {
+        munlockall();
+    }
+#endif
+
+    loadRunning = false;
+    for (std::thread& thread : load) {
+        thread.join();
+    }
+
+    result.normal = summarize(normal, config);
+    result.realTime = summarize(realTime, config);
+    result.realTimeApplied = applied;
+    result.realTimeError = error;
+
+    auto report = [](const char* name, const Latency& h) {
+        qDebug().nospace() << "  " << name << ": min " << h.minUs << " avg " << qRound64(h.avgUs)
+                           << " p99 " << h.p99Us << " p99.9 " << h.p999Us << " max " << h.maxUs
+                           << " us; balls missed " << h.ballsMissed << " of " << h.ballsSimulated;
+    };
+    qDebug() << "Acquisition jitter test:" << config.loops << "wakeups at" << config.intervalUs << "us,"
+             << loadThreads << "load threads";
+    report("normal", result.normal);
+    report(applied ? "real-time" : "real-time (NOT APPLIED)", result.realTime);
+    if (!applied) {
+        qWarning() << "Real-time mode could not be fully applied:" << error;
+    }
+    return result;
+}
+
+} // namespace
+
+bool benchRealTimeJitter() {
+    JitterResult result = runJitter(RealTimeSettings(), JitterConfig());
+
+    // Without root the comparison is still reported, but real-time mode was not tested
+    return result.realTimeApplied && result.realTime.ballsMissed == 0;
+}
@@ -0,0 +1,197 @@
+﻿#include "Bench.h"
+#include "ServerReplication.h"
+#include "LaneClient.h"
+#include "GameMirror.h"
+#include <QJsonArray>
+#include <QTemporaryDir>
+#include <QSet>
+#include <QEventLoop>
+#include <QDebug>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Both servers and a set of lanes in this process: balls flowing, then
+// the primary is killed. Reports detection and reattach times, and
+// checks every ball by sequence number: each must reach the standby,
+// through the primary's stream or resent by its lane, and the standby's
+// mirror must be current.
+struct FailoverResult {
+    int lanes = 0;
+    int ballsSent = 0;
+    int ballsCounted = 0;       // Balls the standby ended up with
+    int ballsLost = 0;          // Sent but never reached the standby
+    bool mirrorCurrent = false;
+    qint64 detectMs = -1;       // Kill to standby serving
+    qint64 reattachMs = -1;     // Kill to every lane registered again
+    bool passed = false;
+};
+
+FailoverResult runFailover(int laneCount, int ballIntervalMs)
+{
+    FailoverResult result;
+    result.lanes = laneCount;
+
+    const quint16 primaryPort = 52005;
+    const quint16 standbyPort = 52015;
+    const quint16 replicationPort = 52006;
+
+    QEventLoop loop;
+    QTimer poll;
+    poll.setInterval(5);
+    QObject::connect(&poll, &QTimer::timeout, &loop, &QEventLoop::quit);
+    poll.start();
+
+    QElapsedTimer clock;
+    auto waitFor = [&](int timeoutMs, const std::function<bool()> &done) {
+        clock.start();
+        while (!done() && clock.elapsed() < timeoutMs) {
+            loop.exec();
+        }
+        return done();
+    };
+
+    // Each server keeps its own epoch, away from a real one in the working directory
+    QTemporaryDir epochDir;
+
+    auto primaryServer = std::make_unique<LaneServer>(nullptr);
+    auto primary = std::make_unique<ServerReplication>(primaryServer.get());
+    primary->setAnnounceHost("127.0.0.1");
+    primary->setEpochFile(epochDir.filePath("primary.epoch"));
+    primary->startPrimary(primaryPort, replicationPort);
+
+    LaneServer standbyServer(nullptr);
+    ServerReplication standby(&standbyServer);
+    standby.setAnnounceHost("127.0.0.1");
+    standby.setEpochFile(epochDir.filePath("standby.epoch"));
+    standby.startStandby("127.0.0.1", standbyPort, replicationPort);
+
+    // Balls the standby counted itself once serving, by sequence number
+    QVector<QSet<quint32>> standbyCounted(laneCount);
+    QObject::connect(&standbyServer, &LaneServer::replicationEvent, [&](const QJsonObject &event) {
+        int lane = event["lane_id"].toInt() - 1;
+        quint32 seq = static_cast<quint32>(event["seq"].toDouble());
+        if (event["kind"].toString() == "ball" && seq > 0 && lane >= 0 && lane < laneCount) {
+            standbyCounted[lane].insert(seq);
+        }
+    });
+
+    // Lanes bowl continuously: a numbered ball, and the count in the game state
+    std::vector<std::unique_ptr<LaneClient>> lanes;
+    QVector<int> balls(laneCount, 0);
+    for (int i = 0; i < laneCount; ++i) {
+        auto lane = std::make_unique<LaneClient>(i + 1);
+        lane->setServerAddress("127.0.0.1", primaryPort);
+        lane->start();
+        lanes.push_back(std::move(lane));
+    }
+
+    auto allRegistered = [&]() {
+        for (const auto &lane : lanes) {
+            if (!lane->isConnected()) return false;
+        }
+        return true;
+    };
+
+    if (!waitFor(5000, allRegistered) || !waitFor(2000, [&]() { return standby.isSynced(); })) {
+        qWarning() << "Failover test: setup failed - lanes or standby did not attach";
+        return result;
+    }
+
+    QTimer bowl;
+    bowl.setInterval(ballIntervalMs);
+    QObject::connect(&bowl, &QTimer::timeout, [&]() {
+        for (int i = 0; i < laneCount; ++i) {
+            BallEvent ball;
+            ball.sequence = ++balls[i];
+            ball.gameNumber = 1;
+            ball.bowler = QString("Lane %1 Bowler").arg(i + 1);
+            lanes[i]->sendBall(ball);
+
+            QJsonObject bowler;
+            bowler["name"] = ball.bowler;
+            bowler["balls"] = balls[i];
+
+            QJsonObject state;
+            state["game_active"] = true;
+            state["current_bowler_index"] = 0;
+            state["bowlers"] = QJsonArray{bowler};
+            lanes[i]->publishGameState(1, "quick_game", state);
+            result.ballsSent++;
+        }
+    });
+    bowl.start();
+
+    // Load, then kill the primary mid-stream
+    waitFor(1000, []() { return false; });
+
+    // What the primary's stream had delivered at takeover: the last ball per
+    // lane, and so every ball before it (the stream is in order)
+    QElapsedTimer sinceKill;
+    bool promotedSeen = false;
+    QVector<quint32> replicatedUpTo(laneCount, 0);
+    QObject::connect(&standby, &ServerReplication::promoted, [&]() {
+        result.detectMs = sinceKill.elapsed();
+        promotedSeen = true;
+        QJsonObject marks = standbyServer.replicationSnapshot()["balls"].toObject();
+        for (int i = 0; i < laneCount; ++i) {
+            replicatedUpTo[i] = static_cast<quint32>(marks[QString::number(i + 1)].toObject()["seq"].toDouble());
+        }
+    });
+
+    qDebug() << "Failover test: killing primary after" << result.ballsSent << "balls";
+    sinceKill.start();
+    primary.reset();
+    primaryServer.reset();
+
+    waitFor(3000, [&]() { return promotedSeen; });
+    if (waitFor(5000, allRegistered)) {
+        result.reattachMs = sinceKill.elapsed();
+    }
+
+    // Keep bowling against the new server, then let the last balls and resends land
+    waitFor(1000, []() { return false; });
+    bowl.stop();
+    waitFor(500, []() { return false; });
+
+    // A ball in flight at the kill is resent by its lane; the standby either
+    // had it from the primary's stream or counts it itself
+    GameMirror *mirror = standbyServer.gameMirror();
+    result.mirrorCurrent = true;
+    for (int i = 0; i < laneCount; ++i) {
+        for (quint32 seq = 1; seq <= quint32(balls[i]); ++seq) {
+            if (seq <= replicatedUpTo[i] || standbyCounted[i].contains(seq)) {
+                result.ballsCounted++;
+            } else {
+                result.ballsLost++;
+            }
+        }
+
+        QJsonArray bowlers = mirror->gameState(i + 1)["bowlers"].toArray();
+        if (bowlers.isEmpty() || bowlers[0].toObject()["balls"].toInt() != balls[i]) {
+            result.mirrorCurrent = false;
+        }
+    }
+
+    result.passed = promotedSeen && result.detectMs >= 0 && result.detectMs < 1000 &&
+                    result.reattachMs >= 0 && result.ballsLost == 0 && result.mirrorCurrent;
+
+    qDebug() << "Failover test:" << laneCount << "lanes," << result.ballsSent << "balls sent,"
+             << result.ballsCounted << "counted," << result.ballsLost << "lost, mirror"
+             << (result.mirrorCurrent ? "current" : "behind") << "- takeover in" << result.detectMs
+             << "ms, lanes back in" << result.reattachMs << "ms -" << (result.passed ? "PASS" : "FAIL");
+
+    for (auto &lane : lanes) {
+        lane->stop();
+    }
+    return result;
+}
+
+} // namespace
+
+bool benchFailover()
+{
+    return runFailover(8, 20).passed;
+}
@@ -0,0 +1,115 @@
+﻿#include "Bench.h"
+#include "TaskScheduler.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+// The backlog is dropped once the ball tasks are measured, rather than run
+// by the destructor
+struct TaskSchedulerBench {
+    static void dropQueued(TaskScheduler& scheduler) {
+        for (int p = 0; p < TaskScheduler::PriorityCount; ++p) {
+            for (TaskScheduler::Worker& worker : scheduler.workers) {
+                QMutexLocker queueLocker(&worker.mutex);
+                const int dropped = int(worker.queues[p].size());
+                worker.queues[p].clear();
+                worker.queued.fetch_sub(dropped);
+                scheduler.counters[p].queued.fetch_sub(dropped);
+            }
+        }
+    }
+};
+
+namespace {
+
+// Ball-result tasks every 10 ms against a disk and media backlog larger
+// than both workers can clear: one FIFO queue (the old pool) against
+// the priority classes. Wait is submit to start of the ball task.
+struct SchedulerResult {
+    int hardwareTasks = 0;
+    double fifoAvgWaitUs = 0.0;
+    double fifoMaxWaitUs = 0.0;
+    double scheduledAvgWaitUs = 0.0;
+    double scheduledMaxWaitUs = 0.0;
+};
+
+SchedulerResult runScheduler(int hardwareTasks) {
+    SchedulerResult result;
+    result.hardwareTasks = hardwareTasks;
+
+    // Disk writes of ~15 ms and media rehashes of ~30 ms every other tick:
+    // 30 ms of background work per 10 ms tick, more than two workers clear
+    auto scenario = [hardwareTasks](bool prioritized, double* avgWaitUs, double* maxWaitUs) {
+        TaskScheduler scheduler;
+        if (!prioritized) {
+            // The old pool: two threads, one FIFO, no limits
+            scheduler.setReservedWorkers(0);
+            for (int p = 0; p < TaskScheduler::PriorityCount; ++p) {
+                scheduler.setLimit(static_cast<TaskScheduler::Priority>(p), TaskScheduler::WORKERS);
+            }
+        }
+        const TaskScheduler::Priority ball = prioritized ? TaskScheduler::Hardware : TaskScheduler::Disk;
+        const TaskScheduler::Priority disk = TaskScheduler::Disk;
+        const TaskScheduler::Priority media = prioritized ? TaskScheduler::Media : TaskScheduler::Disk;
+
+        QElapsedTimer clock;
+        clock.start();
+        QMutex waitsMutex;
+        std::vector<qint64> waits;
+        waits.reserve(hardwareTasks);
+
+        for (int i = 0; i < hardwareTasks; ++i) {
+            scheduler.submit(disk, []() { QThread::usleep(15000); });
+            if (i % 2 == 0) {
+                scheduler.submit(media, []() { QThread::usleep(30000); });
+            }
+
+            const qint64 submittedNs = clock.nsecsElapsed();
+            scheduler.submit(ball, [submittedNs, &clock, &waitsMutex, &waits]() {
+                const qint64 waitNs = clock.nsecsElapsed() - submittedNs;
+                QThread::usleep(200);       // Settle and deliver a ball result
+                QMutexLocker locker(&waitsMutex);
+                waits.push_back(waitNs);
+            });
+
+            QThread::msleep(10);
+        }
+
+        // Until every ball task has run
+        for (;;) {
+            {
+                QMutexLocker locker(&waitsMutex);
+                if (int(waits.size()) >= hardwareTasks) break;
+            }
+            QThread::msleep(5);
+        }
+        TaskSchedulerBench::dropQueued(scheduler);
+
+        qint64 total = 0;
+        qint64 worst = 0;
+        for (qint64 wait : waits) {
+            total += wait;
+            worst = std::max(worst, wait);
+        }
+        *avgWaitUs = waits.empty() ? 0.0 : total / 1000.0 / waits.size();
+        *maxWaitUs = worst / 1000.0;
+    };
+
+    scenario(false, &result.fifoAvgWaitUs, &result.fifoMaxWaitUs);
+    scenario(true, &result.scheduledAvgWaitUs, &result.scheduledMaxWaitUs);
+
+    qDebug() << "Task scheduler benchmark:" << hardwareTasks << "ball tasks under a disk/media backlog;"
+             << "wait avg/max: FIFO pool" << qRound(result.fifoAvgWaitUs) << "/" << qRound(result.fifoMaxWaitUs)
+             << "us, priority classes" << qRound(result.scheduledAvgWaitUs) << "/"
+             << qRound(result.scheduledMaxWaitUs) << "us";
+    return result;
+}
+
+} // namespace
+
+bool benchTaskScheduler() {
+    SchedulerResult result = runScheduler(100);
+    return result.scheduledAvgWaitUs < result.fifoAvgWaitUs;
+}
@@ -0,0 +1,127 @@
+﻿#include "Bench.h"
+#include "TimingWheel.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+#include <QDebug>
+
+// Ticks are driven by hand so only the wheel's own work is timed
+struct TimingWheelBench {
+    static void stopDriver(TimingWheel& wheel) { wheel.driver->stop(); }
+    static void tick(TimingWheel& wheel) { wheel.processTick(); }
+};
+
+namespace {
+
+// Per-tick cost with many armed connections, most of them re-armed
+// every few ticks the way heartbeats are, at each connection count.
+// Against it, the old LaneServer::checkConnections() scan of every
+// connection's lastSeen, per pass and amortized over the ticks between
+// passes (it ran every 10 s).
+struct TimingWheelResult {
+    int connections = 0;
+    int ticks = 0;
+    double nsPerTick = 0.0;
+    double nsPerReset = 0.0;
+    int expired = 0;
+    double scanNsPerPass = 0.0;
+    double scanNsPerTick = 0.0;
+};
+
+TimingWheelResult runTimingWheel(int connections, int ticks) {
+    // LaneServer shape: 30 s liveness timeout, heartbeat every 10 s, 1% of lanes silent
+    const int tick = 100;
+    const int timeoutMs = 30000;
+    const int heartbeatTicks = 10000 / tick;
+    const int scanTicks = (timeoutMs / 3) / tick;
+
+    TimingWheelResult result;
+    result.connections = connections;
+    result.ticks = ticks;
+
+    TimingWheel wheel(tick);
+
+    int expired = 0;
+    QVector<TimingWheel::TimerId> ids(connections);
+    for (int i = 0; i < connections; ++i) {
+        ids[i] = wheel.arm(timeoutMs, [&expired]() { expired++; });
+    }
+    TimingWheelBench::stopDriver(wheel);
+
+    QElapsedTimer timer;
+    qint64 tickNs = 0;
+    qint64 resetNs = 0;
+    qint64 resets = 0;
+
+    for (int t = 0; t < ticks; ++t) {
+        // The lanes whose heartbeat lands on this tick
+        timer.start();
+        for (int i = t % heartbeatTicks; i < connections; i += heartbeatTicks) {
+            if (i % 100 == 0) continue;
+            if (!wheel.reset(ids[i], timeoutMs)) {
+                ids[i] = wheel.arm(timeoutMs, [&expired]() { expired++; });
+            }
+            resets++;
+        }
+        resetNs += timer.nsecsElapsed();
+
+        timer.start();
+        TimingWheelBench::tick(wheel);
+        tickNs += timer.nsecsElapsed();
+    }
+
+    result.nsPerTick = ticks > 0 ? double(tickNs) / ticks : 0.0;
+    result.nsPerReset = resets > 0 ? double(resetNs) / resets : 0.0;
+    result.expired = expired;
+
+    // The old scan: every connection's lastSeen against now, collecting the expired
+    struct LegacyConnection {
+        int laneId = 0;
+        QDateTime lastSeen;
+    };
+    QHash<quintptr, LegacyConnection> legacy;
+    QDateTime start = QDateTime::currentDateTime();
+    for (int i = 0; i < connections; ++i) {
+        LegacyConnection connection;
+        connection.laneId = i + 1;
+        connection.lastSeen = start.addMSecs(-(i % heartbeatTicks) * tick);
+        legacy.insert(quintptr(i + 1) * 64, connection);
+    }
+
+    const int passes = qMax(1, ticks / scanTicks);
+    timer.start();
+    for (int pass = 0; pass < passes; ++pass) {
+        QDateTime now = QDateTime::currentDateTime();
+        QList<quintptr> stale;
+        for (auto it = legacy.constBegin(); it != legacy.constEnd(); ++it) {
+            if (it.value().lastSeen.msecsTo(now) > timeoutMs) {
+                stale.append(it.key());
+            }
+        }
+    }
+    result.scanNsPerPass = double(timer.nsecsElapsed()) / passes;
+    result.scanNsPerTick = result.scanNsPerPass / scanTicks;
+
+    qDebug() << "TimingWheel benchmark:" << connections << "connections," << ticks << "ticks -"
+             << qRound(result.nsPerTick) << "ns/tick," << qRound(result.nsPerReset) << "ns/reset,"
+             << expired << "expired; map scan" << qRound(result.scanNsPerPass) << "ns/pass,"
+             << qRound(result.scanNsPerTick) << "ns/tick amortized";
+    return result;
+}
+
+} // namespace
+
+bool benchTimingWheel() {
+    const int ticks = 2000;
+    for (int connections : {100, 1000, 10000}) {
+        TimingWheelResult result = runTimingWheel(connections, ticks);
+
+        // Only the silent 1% may expire
+        if (result.expired > (connections + 99) / 100) {
+            qWarning() << "TimingWheel benchmark:" << result.expired << "timers expired that were reset";
+            return false;
+        }
+    }
+    return true;
+}
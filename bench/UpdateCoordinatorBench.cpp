@@ -0,0 +1,164 @@
+﻿#include "Bench.h"
+#include "UpdateCoordinator.h"
+#include "QuickGame.h"
+#include "BowlingWidgets.h"
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QVBoxLayout>
+#include <QWidget>
+#include <QDebug>
+
+namespace {
+
+// A real QuickGame bowled ball by ball, its signals wired to the board the
+// way BowlingMainWindow wires them, and the board rebuilt as
+// updateGameDisplay() does: once on every signal that touches it, against
+// marking the coordinator and letting the event loop flush
+struct CoordinatorResult {
+    int balls = 0;
+    double immediateRebuildsPerBall = 0.0;
+    double coalescedRebuildsPerBall = 0.0;
+    double immediateUsPerBall = 0.0;
+    double coalescedUsPerBall = 0.0;
+};
+
+QtMessageHandler previousHandler = nullptr;
+
+// QuickGame narrates every ball; only warnings get through while it bowls
+void dropDebug(QtMsgType type, const QMessageLogContext& context, const QString& message) {
+    if (type != QtDebugMsg && previousHandler) {
+        previousHandler(type, context, message);
+    }
+}
+
+// Current bowler first, then the rest, as updateGameDisplay() lays them out
+void rebuildBoard(QVBoxLayout* layout, const QuickGame& game) {
+    QLayoutItem* item;
+    while ((item = layout->takeAt(0)) != nullptr) {
+        delete item->widget();
+        delete item;
+    }
+
+    const QVector<Bowler>& bowlers = game.getBowlers();
+    const int current = game.getCurrentBowlerIndex();
+    if (current >= 0 && current < bowlers.size()) {
+        layout->addWidget(new EnhancedBowlerWidget(bowlers[current], true));
+    }
+    for (int i = 0; i < bowlers.size(); ++i) {
+        if (i != current) {
+            layout->addWidget(new EnhancedBowlerWidget(bowlers[i], false));
+        }
+    }
+    layout->addStretch();
+}
+
+// Bowl `balls` balls, starting a new game whenever one completes; settle
+// runs after every ball and every restart. Returns the time spent in the
+// balls themselves, restarts excluded.
+qint64 bowl(QuickGame& game, int balls, const std::function<void()>& settle) {
+    QJsonObject setup;
+    setup["bowlers"] = QJsonArray{QJsonObject{{"name", "Bowler 1"}}, QJsonObject{{"name", "Bowler 2"}}};
+
+    const QVector<int> patterns[] = {
+        {0, 0, 0, 0, 0}, {1, 1, 0, 1, 1}, {0, 0, 1, 1, 1}, {1, 0, 0, 0, 1}, {1, 1, 1, 1, 1}
+    };
+
+    QElapsedTimer timer;
+    qint64 elapsedNs = 0;
+    for (int n = 0; n < balls; ++n) {
+        if (!game.isGameActive() || game.isGameComplete()) {
+            game.startGame(setup);
+            settle();
+        }
+
+        timer.start();
+        game.processBall(BallEvent::fromPins(patterns[n % 5]));
+        settle();
+        elapsedNs += timer.nsecsElapsed();
+    }
+    return elapsedNs;
+}
+
+CoordinatorResult runCoordinator(int balls) {
+    CoordinatorResult result;
+    result.balls = balls;
+
+    QWidget board;
+    QVBoxLayout* layout = new QVBoxLayout(&board);
+
+    previousHandler = qInstallMessageHandler(dropDebug);
+
+    // Before: every gameUpdated / currentPlayerChanged rebuilt the board there and then
+    {
+        QuickGame game;
+        int rebuilds = 0;
+        bool restarting = false;
+        auto rebuild = [&]() {
+            rebuildBoard(layout, game);
+            if (!restarting) rebuilds++;
+        };
+        QObject::connect(&game, &QuickGame::gameUpdated, rebuild);
+        QObject::connect(&game, &QuickGame::currentPlayerChanged, rebuild);
+        QObject::connect(&game, &QuickGame::gameStarted, [&]() { restarting = true; });
+
+        qint64 ns = bowl(game, balls, [&]() { restarting = false; });
+        result.immediateRebuildsPerBall = double(rebuilds) / balls;
+        result.immediateUsPerBall = ns / 1e3 / balls;
+    }
+
+    // After: the same signals mark the coordinator, the board rebuilds once per pass
+    {
+        QuickGame game;
+        UpdateCoordinator coordinator;
+        int boardHandler = coordinator.addHandler(UpdateCoordinator::Scores | UpdateCoordinator::CurrentPlayer,
+                                                  [&]() { rebuildBoard(layout, game); });
+        QObject::connect(&game, &QuickGame::gameUpdated, [&]() {
+            coordinator.markDirty(UpdateCoordinator::Scores | UpdateCoordinator::Status |
+                                  UpdateCoordinator::Buttons | UpdateCoordinator::Recovery);
+        });
+        QObject::connect(&game, &QuickGame::currentPlayerChanged, [&]() {
+            coordinator.markDirty(UpdateCoordinator::CurrentPlayer | UpdateCoordinator::Status);
+        });
+        QObject::connect(&game, &QuickGame::ballProcessed, [&]() {
+            coordinator.markDirty(UpdateCoordinator::Status | UpdateCoordinator::Buttons);
+        });
+
+        int rebuilds = 0;
+        bool restarting = false;
+        QObject::connect(&game, &QuickGame::gameStarted, [&]() { restarting = true; });
+        qint64 ns = bowl(game, balls, [&]() {
+            const int before = coordinator.runCount(boardHandler);
+            QCoreApplication::processEvents(QEventLoop::AllEvents);
+            if (!restarting) {
+                rebuilds += coordinator.runCount(boardHandler) - before;
+            }
+            restarting = false;
+        });
+        result.coalescedRebuildsPerBall = double(rebuilds) / balls;
+        result.coalescedUsPerBall = ns / 1e3 / balls;
+    }
+
+    qInstallMessageHandler(previousHandler);
+
+    qDebug() << "Update coalescing:" << balls << "balls -" << result.immediateRebuildsPerBall
+             << "board rebuilds per ball immediate," << result.coalescedRebuildsPerBall << "coalesced;"
+             << qRound(result.immediateUsPerBall) << "us per ball immediate,"
+             << qRound(result.coalescedUsPerBall) << "us coalesced";
+    return result;
+}
+
+} // namespace
+
+bool benchUpdateCoordinator() {
+    CoordinatorResult result = runCoordinator(500);
+
+    // Every ball rebuilds the board once, however many signals it raised
+    if (result.coalescedRebuildsPerBall != 1.0) {
+        qWarning() << "Update coalescing: expected one board rebuild per ball, got"
+                   << result.coalescedRebuildsPerBall;
+        return false;
+    }
+    return true;
+}
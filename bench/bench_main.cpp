@@ -0,0 +1,71 @@
+﻿#include "Bench.h"
+#include <QApplication>
+#include <QStringList>
+#include <QDebug>
+
+namespace {
+
+struct BenchCase {
+    const char* name;
+    bool (*run)();
+};
+
+const BenchCase CASES[] = {
+    {"timing_wheel", benchTimingWheel},
+    {"ball_event", benchBallEvent},
+    {"update_coordinator", benchUpdateCoordinator},
+    {"task_scheduler", benchTaskScheduler},
+    {"machine_bridge", benchMachineBridge},
+    {"power_manager", benchLanePowerManager},
+    {"heartbeat", benchHeartbeat},
+    {"lane_client_latency", benchLaneClientLatency},
+    {"realtime_jitter", benchRealTimeJitter},
+    {"media_sync", benchMediaSync},
+    {"event_bus", benchEventBus},
+    {"broadcast", benchBroadcastEngine},
+    {"failover", benchFailover},
+    {"bowler_directory", benchBowlerDirectory},
+    {"end_of_day", benchEndOfDayReport}
+};
+
+} // namespace
+
+// lane_bench [--list] [case ...]
+// Widgets are needed for the board rebuilds; run headless with QT_QPA_PLATFORM=offscreen
+int main(int argc, char* argv[]) {
+    QApplication app(argc, argv);
+
+    QStringList selected = app.arguments().mid(1);
+    if (selected.contains("--list")) {
+        for (const BenchCase& benchCase : CASES) {
+            qInfo().noquote() << benchCase.name;
+        }
+        return 0;
+    }
+
+    QStringList unknown = selected;
+    for (const BenchCase& benchCase : CASES) {
+        unknown.removeAll(QString::fromLatin1(benchCase.name));
+    }
+    if (!unknown.isEmpty()) {
+        qWarning() << "Unknown benchmark:" << unknown.join(", ") << "- see --list";
+        return 2;
+    }
+
+    QStringList failed;
+    for (const BenchCase& benchCase : CASES) {
+        const QString name = QString::fromLatin1(benchCase.name);
+        if (!selected.isEmpty() && !selected.contains(name)) continue;
+
+        qInfo().noquote() << "==" << name;
+        if (!benchCase.run()) {
+            failed << name;
+        }
+    }
+
+    if (!failed.isEmpty()) {
+        qWarning() << "Failed:" << failed.join(", ");
+        return 1;
+    }
+    return 0;
+}
@@ -3,6 +3,10 @@
 Machine Interface Bridge
 Connects C++ Qt client to MachineFunctions.py ball detector
 Outputs JSON messages to stdout for C++ to read
+
+With --shm the bridge instead exchanges fixed-layout records with the
+C++ MachineBridge through a POSIX shared-memory ring pair, using the
+inherited eventfds for wakeups. See MachineBridge.h for the layout.
 """
 
 import sys
@@ -13,6 +17,13 @@ import logging
 from queue import Queue, Empty
 import signal
 import os
+import mmap
+import select
+import struct
+import argparse
+import ctypes
+import ctypes.util
+from datetime import datetime
 from logging.handlers import RotatingFileHandler
 
 def setup_logging(log_file_path='log.txt', max_log_size=10*1024*1024, backup_count=5):
@@ -73,13 +84,175 @@ except ImportError as e:
     print(json.dumps({"type": "error", "message": f"Failed to import machine modules: {e}"}))
     sys.exit(1)
 
+# Shared memory layout - must match BridgeSharedLayout in MachineBridge.h
+SHM_MAGIC = 0x424C4E31
+SHM_HEADER = struct.Struct('<IIII')
+SHM_INDEX = struct.Struct('<II')
+SHM_RECORD = struct.Struct('<II5i5iiid')
+SHM_TO_HOST_INDEX = 64
+SHM_TO_BRIDGE_INDEX = 128
+SHM_RECORDS = 192
+
+# Record types (BridgeMessage / BridgeCommand in MachineBridge.h)
+MESSAGE_TYPES = {
+    "ball_detected": 1,
+    "machine_ready": 2,
+    "detection_started": 3,
+    "detection_stopped": 4,
+    "error": 5,
+    "fatal_error": 5,
+    "pong": 6,
+    "heartbeat": 7,
+    "status": 8,
+    "machine_reset_complete": 9,
+    "pin_set_complete": 9,
+    "pin_restore_complete": 9,
+    "hold_set": 9,
+    "shutdown": 10,
+}
+PIN_NAMES = ["lTwo", "lThree", "cFive", "rThree", "rTwo"]
+
+# GCC memory orders, as taken by libatomic's __atomic_*_4
+ATOMIC_ACQUIRE = 2
+ATOMIC_RELEASE = 3
+
+class RingIndexAtomics:
+    """Acquire loads and release stores of the ring indices, matching the
+    std::atomic<uint32_t> accesses on the C++ side. A plain pack_into has no
+    barrier, so on ARM the C++ reader could see a new tail before the record
+    bytes behind it."""
+    def __init__(self, shm):
+        self.base = ctypes.addressof(ctypes.c_char.from_buffer(shm))
+        self.load_fn = None
+        self.store_fn = None
+        
+        path = ctypes.util.find_library('atomic')
+        if path:
+            try:
+                lib = ctypes.CDLL(path)
+                self.load_fn = lib.__atomic_load_4
+                self.load_fn.argtypes = [ctypes.c_void_p, ctypes.c_int]
+                self.load_fn.restype = ctypes.c_uint32
+                self.store_fn = lib.__atomic_store_4
+                self.store_fn.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_int]
+                self.store_fn.restype = None
+            except (OSError, AttributeError):
+                self.load_fn = self.store_fn = None
+    
+    @property
+    def available(self):
+        return self.store_fn is not None
+    
+    def load_acquire(self, offset):
+        return self.load_fn(self.base + offset, ATOMIC_ACQUIRE)
+    
+    def store_release(self, offset, value):
+        self.store_fn(self.base + offset, value & 0xFFFFFFFF, ATOMIC_RELEASE)
+
+class SharedMemoryTransport:
+    """SPSC ring pair shared with the C++ MachineBridge"""
+    def __init__(self, shm_name, event_fd, command_fd):
+        self.event_fd = event_fd
+        self.command_fd = command_fd
+        self.sequence = 0
+        self.lock = threading.Lock()
+        
+        fd = os.open('/dev/shm/' + shm_name.lstrip('/'), os.O_RDWR)
+        try:
+            self.shm = mmap.mmap(fd, 0, mmap.MAP_SHARED, mmap.PROT_READ | mmap.PROT_WRITE)
+        finally:
+            os.close(fd)
+        
+        magic, version, capacity, record_size = SHM_HEADER.unpack_from(self.shm, 0)
+        if magic != SHM_MAGIC or record_size != SHM_RECORD.size:
+            raise Exception(f"Shared memory layout mismatch (magic {magic:#x}, record {record_size})")
+        self.capacity = capacity
+        self.to_bridge_records = SHM_RECORDS + capacity * SHM_RECORD.size
+        
+        # Without libatomic the tail is published behind an extra eventfd
+        # write instead: the syscall orders the record before the tail
+        self.atomics = RingIndexAtomics(self.shm)
+        if not self.atomics.available:
+            logging.getLogger(__name__).warning("libatomic not found - ordering ring publishes through eventfd writes")
+    
+    def write_record(self, msg_type, pins=None, raw_result=None, value=0, arg=0):
+        """Push one record to the C++ side; returns False if the ring is full"""
+        with self.lock:
+            head, tail = SHM_INDEX.unpack_from(self.shm, SHM_TO_HOST_INDEX)
+            if (tail - head) & 0xFFFFFFFF >= self.capacity:
+                return False
+            
+            self.sequence = (self.sequence + 1) & 0xFFFFFFFF
+            offset = SHM_RECORDS + (tail % self.capacity) * SHM_RECORD.size
+            SHM_RECORD.pack_into(self.shm, offset, msg_type, self.sequence,
+                                 *(pins or [1, 1, 1, 1, 1]), *(raw_result or [0, 0, 0, 0, 0]),
+                                 value, arg, time.time())
+            # Publish the tail only after the record is written
+            if self.atomics.available:
+                self.atomics.store_release(SHM_TO_HOST_INDEX + 4, tail + 1)
+            else:
+                os.write(self.event_fd, struct.pack('<Q', 1))
+                struct.pack_into('<I', self.shm, SHM_TO_HOST_INDEX + 4, (tail + 1) & 0xFFFFFFFF)
+        
+        os.write(self.event_fd, struct.pack('<Q', 1))
+        return True
+    
+    def read_records(self, timeout=1.0):
+        """Wait for the command eventfd and drain the command ring"""
+        ready, _, _ = select.select([self.command_fd], [], [], timeout)
+        if ready:
+            try:
+                os.read(self.command_fd, 8)
+            except BlockingIOError:
+                pass
+        
+        records = []
+        head, tail = SHM_INDEX.unpack_from(self.shm, SHM_TO_BRIDGE_INDEX)
+        if self.atomics.available:
+            tail = self.atomics.load_acquire(SHM_TO_BRIDGE_INDEX + 4)
+        while head != tail:
+            offset = self.to_bridge_records + (head % self.capacity) * SHM_RECORD.size
+            records.append(SHM_RECORD.unpack_from(self.shm, offset))
+            head = (head + 1) & 0xFFFFFFFF
+            if self.atomics.available:
+                self.atomics.store_release(SHM_TO_BRIDGE_INDEX, head)
+            else:
+                struct.pack_into('<I', self.shm, SHM_TO_BRIDGE_INDEX, head)
+        return records
+    
+    @staticmethod
+    def record_to_command(record):
+        """Translate a BridgeCommand record into the JSON command format"""
+        cmd_type, sequence = record[0], record[1]
+        pins = list(record[2:7])
+        arg = record[13]
+        
+        if cmd_type == 1:
+            return {"type": "start_detection"}
+        if cmd_type == 2:
+            return {"type": "stop_detection"}
+        if cmd_type == 3:
+            return {"type": "machine_reset", "data": {"immediate": arg != 0}}
+        if cmd_type == 4:
+            return {"type": "hold", "data": {"held": arg != 0}}
+        if cmd_type == 5:
+            return {"type": "status"}
+        if cmd_type == 6:
+            return {"type": "ping", "data": {"sequence": arg}}
+        if cmd_type in (7, 8):
+            name = "pin_set" if cmd_type == 7 else "pin_restore"
+            return {"type": name, "data": {"pins": dict(zip(PIN_NAMES, pins))}}
+        return {"type": f"unknown_{cmd_type}"}
+
 class MachineInterfaceBridge:
-    def __init__(self):
+    def __init__(self, transport=None):
         self.running = True
+        self.transport = transport
         self.machine = None
         self.ball_detector = None
         self.command_queue = Queue()
         self.output_queue = Queue()
+        self.output_lock = threading.Lock()   # Pongs are sent from the reader thread
         
         # Setup logging to file (not stdout to avoid interfering with JSON output)
         logging.basicConfig(
@@ -210,7 +383,7 @@ class MachineInterfaceBridge:
                 self.send_status()
                 
             elif cmd_type == "ping":
-                self.send_output({"type": "pong", "timestamp": time.time()})
+                self.send_output({"type": "pong", "sequence": data.get("sequence", 0), "timestamp": time.time()})
                 
             else:
                 self.send_output({"type": "error", "message": f"Unknown command: {cmd_type}"})
@@ -312,14 +485,56 @@ class MachineInterfaceBridge:
     
     def send_output(self, data):
         """Send JSON output to stdout for C++ to read"""
+        if self.transport:
+            self.send_record(data)
+            return
+        
         try:
             json_str = json.dumps(data, separators=(',', ':'))
-            print(json_str, flush=True)
+            with self.output_lock:
+                print(json_str, flush=True)
         except Exception as e:
             # Last resort error output
             error_obj = {"type": "error", "message": f"JSON output failed: {e}"}
             print(json.dumps(error_obj), flush=True)
     
+    def send_record(self, data):
+        """Send output as a shared memory record instead of JSON"""
+        try:
+            msg_type = MESSAGE_TYPES.get(data.get("type", ""), 0)
+            if msg_type == 0:
+                return
+            
+            if msg_type == 5:
+                self.logger.error(data.get("message", ""))
+            
+            if not self.transport.write_record(msg_type,
+                                               pins=data.get("pins"),
+                                               raw_result=data.get("raw_result"),
+                                               value=data.get("value", 0),
+                                               arg=data.get("sequence", 0)):
+                self.logger.warning(f"Shared memory ring full, dropped {data.get('type')}")
+        except Exception as e:
+            self.logger.error(f"Shared memory output failed: {e}")
+    
+    def dispatch_command(self, command):
+        """Answer pings from the reader thread so their round trip measures
+        the transport, not the main loop's 100 ms poll; queue the rest"""
+        if command.get("type") == "ping":
+            self.send_output({"type": "pong", "sequence": command.get("data", {}).get("sequence", 0),
+                              "timestamp": time.time()})
+        else:
+            self.command_queue.put(command)
+    
+    def shm_reader_thread(self):
+        """Thread to read command records from shared memory"""
+        try:
+            while self.running:
+                for record in self.transport.read_records(timeout=1.0):
+                    self.dispatch_command(SharedMemoryTransport.record_to_command(record))
+        except Exception as e:
+            self.logger.error(f"Shared memory reader thread failed: {e}")
+    
     def input_reader_thread(self):
         """Thread to read commands from stdin"""
         try:
@@ -335,7 +550,7 @@ class MachineInterfaceBridge:
                         
                     try:
                         command = json.loads(line)
-                        self.command_queue.put(command)
+                        self.dispatch_command(command)
                     except json.JSONDecodeError as e:
                         self.send_output({"type": "error", "message": f"Invalid JSON: {e}"})
                         
@@ -349,7 +564,8 @@ class MachineInterfaceBridge:
     def main_loop(self):
         """Main processing loop"""
         # Start input reader thread
-        input_thread = threading.Thread(target=self.input_reader_thread, daemon=True)
+        reader = self.shm_reader_thread if self.transport else self.input_reader_thread
+        input_thread = threading.Thread(target=reader, daemon=True)
         input_thread.start()
         
         # Send startup message
@@ -411,8 +627,18 @@ class MachineInterfaceBridge:
 
 def main():
     """Main entry point"""
+    parser = argparse.ArgumentParser(description="Machine interface bridge")
+    parser.add_argument("--shm", help="Shared memory region created by the C++ client")
+    parser.add_argument("--event-fd", type=int, help="eventfd to signal the C++ client")
+    parser.add_argument("--command-fd", type=int, help="eventfd signalled for new commands")
+    args = parser.parse_args()
+    
     try:
-        bridge = MachineInterfaceBridge()
+        transport = None
+        if args.shm:
+            transport = SharedMemoryTransport(args.shm, args.event_fd, args.command_fd)
+        
+        bridge = MachineInterfaceBridge(transport)
         bridge.main_loop()
     except Exception as e:
         error_output = {"type": "fatal_error", "message": f"Bridge startup failed: {e}"}
@@ -7,7 +7,6 @@
 #include <QPushButton>
 #include <QFrame>
 #include <QScrollArea>
-#include <QThreadPool>
 #include <QPixmapCache>
 #include <QTimer>
 #include <QStackedWidget>
@@ -27,6 +26,8 @@
 #include <QRandomGenerator>
 #include <QDebug>
 #include <QProcess>
+#include <QElapsedTimer>
+#include <QStyleFactory>
 #include "LaneClient.h"
 #include "QuickGame.h"
 #include "QuickGameDialog.h"
@@ -36,6 +37,14 @@
 #include "ThreeSixNineTracker.h"
 #include "GameStatistics.h"
 #include "GameRecoveryManager.h"
+#include "LanePowerManager.h"
+#include "LaneTheme.h"
+#include "AnimationClock.h"
+#include "ScoreboardPresenter.h"
+#include "LaneThumbnailer.h"
+#include "MediaSync.h"
+#include "UpdateCoordinator.h"
+#include "TaskScheduler.h"
 #include "MachineInterface.h"  // Add this include
 
 // Main bowling window class
@@ -43,23 +52,20 @@ class BowlingMainWindow : public QMainWindow {
     Q_OBJECT
     
 public:
-    BowlingMainWindow(QWidget* parent = nullptr) : QMainWindow(parent), 
+    BowlingMainWindow(const QJsonObject& settings, QWidget* parent = nullptr) : QMainWindow(parent), 
         gameActive(false), currentGameNumber(1), gameOver(false), isCallMode(false),
-        framesSinceFirstBall(0), flashing(false), machineInterface(nullptr),
+        framesSinceFirstBall(0), flashing(false), machineInterface(nullptr), powerManager(nullptr),
+        callFlashId(0), scoreboardPresenter(nullptr), thumbnailer(nullptr), mediaSync(nullptr), lastBallSequence(0),
         // Initialize button pointers to nullptr
-        holdButton(nullptr), skipButton(nullptr), resetButton(nullptr) {
+        holdButton(nullptr), skipButton(nullptr), resetButton(nullptr), recoveryResolved(false),
+        displayDiagnostics(settings["LoggingSettings"].toObject()["DebugMode"].toBool()) {
     
         // Initialize systems first (but don't connect signals yet)
         gameRecovery = new GameRecoveryManager(this);
         gameStatistics = new GameStatistics(this);
         gameStatus = new GameStatusWidget(this);
         threeSixNine = new ThreeSixNineTracker(this);
-    
-        // Initialize call timer
-        callTimer = new QTimer(this);
-        callTimer->setSingleShot(false);
-        callTimer->setInterval(500);
-        connect(callTimer, &QTimer::timeout, this, &BowlingMainWindow::onCallFlash);
+        setupUpdates();
     
         // CREATE UI FIRST - this initializes the button pointers
         setupUI();
@@ -69,6 +75,10 @@ public:
         // THEN setup game and connections
         setupGame();
         setupClient();
+        setupPowerManagement(settings["PowerSettings"].toObject());
+        setupDisplays(settings["Displays"].toObject());
+        setupThumbnails(settings["Thumbnail"].toObject());
+        setupMediaSync(settings["MediaSync"].toObject());
     
         // Connect recovery system AFTER everything is set up
         connect(gameRecovery, &GameRecoveryManager::recoveryRequested, 
@@ -90,23 +100,33 @@ public:
     
         qDebug() << "=== CONSTRUCTOR COMPLETE ===";
     
-        // Check for game recovery on startup (with delay to ensure everything is ready)
-        QTimer::singleShot(1000, this, [this]() {
-            gameRecovery->checkForRecovery(this);
+        // Game recovery on startup: the server's mirror resumes the game as soon
+        // as the lane registers; the local journal and its dialog are the
+        // fallback when the server has nothing or cannot be reached in time
+        connect(client, &LaneClient::restoreStateReceived, this, &BowlingMainWindow::onServerRestore);
+        QTimer::singleShot(SERVER_RESTORE_WAIT_MS, this, [this]() {
+            if (!recoveryResolved) {
+                qDebug() << "No game state from server - checking local recovery journal";
+                recoveryResolved = true;
+                gameRecovery->checkForRecovery(this);
+            }
         });
     }
 
 private slots:
 
     void onGameUpdated() {
-        updateGameDisplay();
-        updateGameStatus();
-        updateButtonStates();
-        
+        // QuickGame emits this several times per ball; the work happens once, on the next pass
+        updates->markDirty(UpdateCoordinator::Scores | UpdateCoordinator::Status |
+                           UpdateCoordinator::Buttons | UpdateCoordinator::Recovery);
+    }
+    
+    void saveGameState() {
         // Save game state for recovery
         if (gameActive && game && !gameOver) {
             QJsonObject gameState = game->getGameState();
             gameRecovery->markGameActive(currentGameNumber, gameState);
+            client->publishGameState(currentGameNumber, currentGameType, gameState);
         }
     }
     
@@ -127,10 +147,15 @@ private slots:
         gameOver = false;
         isCallMode = false;
         framesSinceFirstBall = 0;
+        lastBallSequence = 0;
         
         showGameInterface();
         applyGameColors();
-        updateButtonStates();
+        updates->markDirty(UpdateCoordinator::Buttons);
+        
+        powerManager->setGameActive(true);
+        client->setGameActive(true);
+        mediaSync->setGameActive(true);
         
         // Start machine interface ball detection
         if (machineInterface) {
@@ -145,9 +170,10 @@ private slots:
             }
         }
         
-        // Mark game as active for recovery
+        // Mark game as active for recovery, locally and on the server
         QJsonObject gameState = game->getGameState();
         gameRecovery->markGameActive(currentGameNumber, gameState);
+        client->publishGameState(currentGameNumber, currentGameType, gameState);
     }
     
     void onGameEnded(const QJsonObject& results) {
@@ -165,14 +191,31 @@ private slots:
         
         // Clear recovery state
         gameRecovery->markGameInactive();
+        client->endGameState();
+        
+        // Closes the session in the server's day log (see EndOfDayReport)
+        QJsonObject summary = results;
+        summary["game_number"] = currentGameNumber;
+        summary["game_type"] = currentGameType;
+        summary["setup"] = currentGameData;
+        client->sendGameComplete(summary);
+        
+        // Queue waits per class over the game, for tuning the scheduler limits
+        qDebug() << "Task scheduler:" << QJsonDocument(TaskScheduler::instance()->statsJson()).toJson(QJsonDocument::Compact);
+        TaskScheduler::instance()->resetStats();
+        
+        // Idle countdown starts once the game is over
+        powerManager->setGameActive(false);
+        client->setGameActive(false);
+        mediaSync->setGameActive(false);
         
         gameActive = false;
         gameOver = true;
         isCallMode = false;
-        callTimer->stop();
+        stopCallFlash();
         currentGameNumber++;
         
-        updateButtonStates();
+        updates->markDirty(UpdateCoordinator::Buttons);
         
         // Show completion message
         QString completionMsg = QString("Game %1 Complete! Thank you for playing.").arg(currentGameNumber - 1);
@@ -189,50 +232,52 @@ private slots:
         });
     }
     
-    void onBallProcessed(const QJsonObject& ballData) {
-        QString bowlerName = ballData["bowler"].toString();
-        int frame = ballData["frame"].toInt();
-        int ballValue = ballData["value"].toInt();
-        bool isStrike = (ballValue == 15);
-        bool isSpare = ballData.contains("is_spare") ? ballData["is_spare"].toBool() : false;
+    void onBallProcessed(const BallEvent& event) {
+        // Each ball is counted once, however often it is reported
+        if (event.sequence != 0 && event.sequence <= lastBallSequence) {
+            qDebug() << "Ball" << event.sequence << "already processed - ignoring repeat";
+            return;
+        }
+        lastBallSequence = event.sequence;
         
         // Count frames since first ball for button state management
         framesSinceFirstBall++;
         
         // Record for statistics
         if (game) {
-            QJsonArray pinsArray = ballData["pins"].toArray();
-            QVector<int> pins;
-            for (const QJsonValue& val : pinsArray) {
-                pins.append(val.toInt());
-            }
-            Ball ball(pins, ballValue);
-            gameStatistics->recordBallThrown(bowlerName, frame, ball, isStrike, isSpare);
+            Ball ball(event.pinVector(), event.value);
+            ball.timing = event.timing;
+            gameStatistics->recordBallThrown(event.bowler, event.frame, ball, event.strike, event.spare,
+                                             event.bowlerId);
         }
         
         // Update 3-6-9 tracking
         if (threeSixNine->isActive()) {
-            threeSixNine->recordFrameResult(bowlerName, currentGameNumber, frame, isStrike);
+            threeSixNine->recordFrameResult(event.bowler, currentGameNumber, event.frame, event.strike);
         }
         
         // Send to server
-        client->sendMessage(ballData);
+        BallEvent sent = event;
+        sent.gameNumber = currentGameNumber;
+        client->sendBall(sent);
 
-        updateGameStatus();
-        updateButtonStates();
+        updates->markDirty(UpdateCoordinator::Status | UpdateCoordinator::Buttons);
+        
+        // Board rebuilds per ball - 1.0 when every ball coalesces into one pass
+        if (displayDiagnostics && event.sequence % REBUILD_REPORT_BALLS == 0) {
+            qDebug() << "Board rebuilds per ball:" << double(updates->runCount(boardHandler)) / REBUILD_REPORT_BALLS
+                     << "over the last" << REBUILD_REPORT_BALLS << "balls";
+            updates->resetCounters();
+        }
     }
     
     void onCallFlash() {
         if (isCallMode) {
             flashing = !flashing;
             QString laneText = QString("Lane %1").arg(client->getLaneId());
-            if (flashing) {
-                laneStatusLabel->setText(laneText);
-                laneStatusLabel->setStyleSheet("QLabel { color: red; font-size: 18px; font-weight: bold; background-color: yellow; }");
-            } else {
-                laneStatusLabel->setText(laneText);
-                laneStatusLabel->setStyleSheet("QLabel { color: white; font-size: 18px; font-weight: bold; background-color: black; }");
-            }
+            laneStatusLabel->setText(laneText);
+            LaneTheme::instance().apply(laneStatusLabel,
+                flashing ? LaneTheme::Role::LaneCall : LaneTheme::Role::LaneLabel);
         }
     }
     
@@ -246,6 +291,24 @@ private slots:
         }
     }
     
+    void onServerRestore(const QJsonObject& mirror) {
+        if (recoveryResolved || gameActive) {
+            return;
+        }
+        recoveryResolved = true;
+        
+        if (mirror.isEmpty() || !game) {
+            gameRecovery->checkForRecovery(this);
+            return;
+        }
+        
+        qDebug() << "Resuming game" << mirror["game_number"].toInt() << "from server mirror";
+        currentGameNumber = mirror["game_number"].toInt(currentGameNumber);
+        currentGameType = mirror["game_type"].toString();
+        game->loadGameState(mirror["game_state"].toObject());
+        onGameStarted();
+    }
+    
     void onGameRecoveryDeclined() {
         qDebug() << "Game recovery declined";
         // Continue with normal startup
@@ -273,19 +336,22 @@ private slots:
         QString message = QString("3-6-9 WINNER! Congratulations %1!").arg(bowlerName);
         messageScrollArea->setText(message);
         messageScrollArea->startScrolling();
-        updateGameDisplay(); // Refresh to show winner status
+        updates->markDirty(UpdateCoordinator::Scores); // Refresh to show winner status
     }
     
     void onThreeSixNineAlmostWin(const QString& bowlerName) {
         QString message = QString("6 of 7! Great job %1!").arg(bowlerName);
         messageScrollArea->setText(message);
         messageScrollArea->startScrolling();
-        updateGameDisplay(); // Refresh to show status
+        updates->markDirty(UpdateCoordinator::Scores); // Refresh to show status
     }
     
     void onGameCommand(const QString& type, const QJsonObject& data) {
         qDebug() << "=== RECEIVED GAME COMMAND ===" << type;
         
+        // Wake before handling so restored timers see the new state
+        powerManager->wake("lane command");
+        
         // Store current game data for reference
         currentGameData = data;
         
@@ -323,6 +389,7 @@ private slots:
         } else {
             // Handle other commands...
             qDebug() << "Unhandled game command:" << type;
+            client->rejectCommand(QString("Unhandled command: %1").arg(type));
         }
     }
 
@@ -331,18 +398,18 @@ private slots:
             // Game over - CALL mode
             isCallMode = !isCallMode;
             if (isCallMode) {
-                callTimer->start();
+                startCallFlash();
                 // Send hold command to server (same as regular hold)
                 if (game) game->holdGame();
             } else {
-                callTimer->stop();
-                laneStatusLabel->setStyleSheet("QLabel { color: white; font-size: 18px; font-weight: bold; background-color: black; }");
+                stopCallFlash();
+                LaneTheme::instance().apply(laneStatusLabel, LaneTheme::Role::LaneLabel);
             }
         } else {
             // Normal game - hold/resume
             if (game) game->holdGame();
         }
-        updateButtonStates();
+        updates->markDirty(UpdateCoordinator::Buttons);
     }
 
     void onSkipClicked() {
@@ -365,8 +432,7 @@ private slots:
     }
 
     void onCurrentPlayerChanged(const QString& playerName, int index) {
-        updateGameDisplay();
-        updateGameStatus();
+        updates->markDirty(UpdateCoordinator::CurrentPlayer | UpdateCoordinator::Status);
     }
 
 
@@ -403,17 +469,20 @@ private:
         
             qDebug() << "Current button state - gameActive:" << gameActive << "gameOver:" << gameOver;
         
+            LaneTheme& theme = LaneTheme::instance();
+        
             if (!gameActive || gameOver) {
                 // Game is not active or finished: show CALL mode on hold button, others disabled
                 holdButton->setText("CALL");
                 holdButton->setEnabled(true);
-                holdButton->setStyleSheet("QPushButton { background-color: orange; color: black; font-size: 14px; font-weight: bold; }");
+                theme.apply(holdButton, LaneTheme::Role::ButtonCall);
 
+                // Disabled palette group greys these out
                 skipButton->setEnabled(false);
-                skipButton->setStyleSheet("QPushButton { background-color: #666666; color: #999999; font-size: 14px; }");
+                theme.apply(skipButton, LaneTheme::Role::ButtonSkip);
 
                 resetButton->setEnabled(false);
-                resetButton->setStyleSheet("QPushButton { background-color: #666666; color: #999999; font-size: 14px; }");
+                theme.apply(resetButton, LaneTheme::Role::ButtonReset);
 
                 qDebug() << "Updated buttons for inactive game state";
                 return;
@@ -422,13 +491,13 @@ private:
             // Game is active and not over
             if (isCallMode) {
                 holdButton->setText("CALL");
-                holdButton->setStyleSheet("QPushButton { background-color: red; color: white; font-size: 14px; font-weight: bold; }");
+                theme.apply(holdButton, LaneTheme::Role::ButtonCallActive);
             } else if (game && game->isGameHeld()) {
                 holdButton->setText("RESUME");
-                holdButton->setStyleSheet("QPushButton { background-color: green; color: white; font-size: 14px; font-weight: bold; }");
+                theme.apply(holdButton, LaneTheme::Role::ButtonResume);
             } else {
                 holdButton->setText("HOLD");
-                holdButton->setStyleSheet("QPushButton { background-color: blue; color: white; font-size: 14px; font-weight: bold; }");
+                theme.apply(holdButton, LaneTheme::Role::ButtonHold);
             }
 
             // Reset button text and enablement depending on frames since first ball
@@ -438,10 +507,10 @@ private:
                 resetButton->setText("SET");
             }
             resetButton->setEnabled(true);
-            resetButton->setStyleSheet("QPushButton { background-color: darkred; color: white; font-size: 14px; font-weight: bold; }");
+            theme.apply(resetButton, LaneTheme::Role::ButtonReset);
 
             skipButton->setEnabled(true);
-            skipButton->setStyleSheet("QPushButton { background-color: orange; color: black; font-size: 14px; font-weight: bold; }");
+            theme.apply(skipButton, LaneTheme::Role::ButtonSkip);
 
             qDebug() << "Updated buttons for active game state";
 
@@ -471,12 +540,12 @@ private:
         
         gameOver = false;
         isCallMode = false;
-        callTimer->stop();
+        stopCallFlash();
         hideGameInterface();
         mediaDisplay->showMediaRotation();
         
         if (laneStatusLabel) {
-            laneStatusLabel->setStyleSheet("QLabel { color: white; font-size: 18px; font-weight: bold; background-color: black; }");
+            LaneTheme::instance().apply(laneStatusLabel, LaneTheme::Role::LaneLabel);
         }
     }
     
@@ -509,6 +578,9 @@ private:
             return;
         }
         
+        QElapsedTimer rebuildTimer;
+        rebuildTimer.start();
+        
         // Clear existing bowler widgets
         QLayoutItem* item;
         while ((item = gameWidgetLayout->takeAt(0)) != nullptr) {
@@ -536,7 +608,9 @@ private:
             }
             
             EnhancedBowlerWidget* currentWidget = new EnhancedBowlerWidget(bowlers[currentIdx], true, displayOptions);
-            currentWidget->setStyleSheet("QFrame { border: 3px solid red; background-color: black; color: red; }");
+            if (isThreeSixNineWinner(bowlers[currentIdx].name)) {
+                LaneTheme::instance().apply(currentWidget, LaneTheme::Role::Winner);
+            }
             widgetOrder.append(currentWidget);
         }
         
@@ -555,7 +629,9 @@ private:
                 }
                 
                 EnhancedBowlerWidget* otherWidget = new EnhancedBowlerWidget(bowlers[i], false, displayOptions);
-                otherWidget->setStyleSheet("QFrame { border: 1px solid lightblue; background-color: black; color: lightblue; }");
+                if (isThreeSixNineWinner(bowlers[i].name)) {
+                    LaneTheme::instance().apply(otherWidget, LaneTheme::Role::Winner);
+                }
                 widgetOrder.append(otherWidget);
             }
         }
@@ -566,52 +642,52 @@ private:
         }
         
         gameWidgetLayout->addStretch();
-
+        
+        // Overhead/console screens reuse their cached cells and repaint only what changed
+        if (scoreboardPresenter) {
+            scoreboardPresenter->setBowlers(bowlers, currentIdx);
+        }
+        
+        if (displayDiagnostics) {
+            qDebug() << "Game display rebuilt in" << rebuildTimer.nsecsElapsed() / 1000 << "us";
+        }
+    }
+    
+    bool isThreeSixNineWinner(const QString& bowlerName) const {
+        return threeSixNine->isActive() &&
+               threeSixNine->getBowlerStatus(bowlerName).currentStatus == "Winner";
     }
 
     // Machine interface slot implementations
-    void onBallDetected(const QVector<int>& pinStates) {
+    void onBallDetected(const QVector<int>& pinStates, const BallTiming& timing) {
         if (!gameActive || !game || gameOver) {
             qDebug() << "Ball detected but game not active, ignoring";
             return;
         }
     
-        // Calculate Canadian 5-pin value
-        QVector<int> pinValues = {2, 3, 5, 3, 2};
-        int totalValue = 0;
-        for (int i = 0; i < 5 && i < pinStates.size(); ++i) {
-            if (pinStates[i] == 0) { // Pin is down
-                totalValue += pinValues[i];
-            }
-        }
-    
-        // Convert to the format expected by your game logic
-        QJsonObject ballData;
-        ballData["pins"] = QJsonArray::fromVariantList(QVariantList(pinStates.begin(), pinStates.end()));
-        ballData["value"] = totalValue;
-        ballData["timestamp"] = QDateTime::currentSecsSinceEpoch();
+        // Typed from here to the server; LaneClient::sendBall makes the JSON
+        BallEvent event = BallEvent::fromPins(pinStates, timing);
+        gameStatus->updateBallSpeed(timing);
     
-        // Determine if strike or spare
-        bool isStrike = (totalValue == 15);
-        if (isStrike) {
-            ballData["is_strike"] = true;
+        if (event.allDown()) {
             onSpecialEffect("strike");
         }
     
-        // Process the ball through your game logic
-        // You may need to modify QuickGame to accept this format
-        if (game) {
-            if (game) {
-                game->processBallDetection(ballData);
-            }
-        } else {
-            // Fallback - process through existing method
-            onBallProcessed(ballData);
+        // Display, status and buttons follow from the game's own signals
+        game->processBall(event);
+    }
+
+    void onLateChange(const QVector<int>& reportedStates, const QVector<int>& settledStates) {
+        if (!gameActive || !game || gameOver) {
+            return;
         }
     
-        // Update display
-        updateGameDisplay();
-        updateButtonStates();
+        qDebug() << "Late pin change:" << reportedStates << "->" << settledStates;
+    
+        // QuickGame rescores and emits gameUpdated, which refreshes the display
+        if (!game->amendLastBall(settledStates)) {
+            qWarning() << "Late pin change could not be applied to the last ball";
+        }
     }
 
     void onMachineReady() {
@@ -626,6 +702,11 @@ private:
     void onMachineError(const QString& error) {
         qWarning() << "Machine error:" << error;
         
+        QJsonObject fault;
+        fault["type"] = "machine_fault";
+        fault["error"] = error;
+        client->sendMessage(fault);
+        
         // Show error message
         if (messageScrollArea) {
             messageScrollArea->setText("Machine Error: " + error);
@@ -650,9 +731,14 @@ private:
         connect(game, &QuickGame::gameStarted, this, &BowlingMainWindow::onGameStarted);
         connect(game, &QuickGame::gameEnded, this, &BowlingMainWindow::onGameEnded);
         connect(game, &QuickGame::ballProcessed, this, &BowlingMainWindow::onBallProcessed);
+        connect(game, &QuickGame::ballAmended, this, [this](const BallEvent& ball) {
+            BallEvent sent = ball;
+            sent.gameNumber = currentGameNumber;
+            client->sendBall(sent);
+        });
         connect(game, &QuickGame::gameHeld, this, [this](bool held) {
             qDebug() << "Game hold state changed to:" << held;
-            updateButtonStates();
+            updates->markDirty(UpdateCoordinator::Buttons);
         });
 
         // Initialize machine interface instead of Python process
@@ -667,6 +753,8 @@ private:
                 this, &BowlingMainWindow::onMachineError);
         connect(machineInterface, &MachineInterface::pinStatesChanged,
                 this, &BowlingMainWindow::onPinStatesChanged);
+        connect(machineInterface, &MachineInterface::lateChange,
+                this, &BowlingMainWindow::onLateChange);
     
         // Initialize machine interface
         if (!machineInterface->initialize()) {
@@ -683,7 +771,7 @@ private:
         int frameStart = data["frame_start"].toInt();
         
         currentGameData["display_options"] = data;
-        updateGameDisplay();
+        updates->markDirty(UpdateCoordinator::Scores);
         
         qDebug() << "Display mode changed to:" << frameMode << "starting at frame" << frameStart;
     }
@@ -723,13 +811,16 @@ private:
     }
     
     void handleThreeSixNineToggle(const QJsonObject& data) {
-        if (!threeSixNine->canToggleParticipation()) return;
+        if (!threeSixNine->canToggleParticipation()) {
+            client->rejectCommand("3-6-9 participation is fixed for this game");
+            return;
+        }
         
         QString bowlerName = data["bowler"].toString();
         bool participating = data["participating"].toBool();
         
         threeSixNine->setBowlerParticipation(bowlerName, participating);
-        updateGameDisplay();
+        updates->markDirty(UpdateCoordinator::Scores);
     }
 
     void setupUI() {
@@ -767,7 +858,7 @@ private:
         // MAIN GAME AREA
         gameDisplayArea = new QScrollArea(this);
         gameDisplayArea->setWidgetResizable(true);
-        gameDisplayArea->setStyleSheet("QScrollArea { border: none; background-color: #2b2b2b; }");
+        LaneTheme::instance().apply(gameDisplayArea, LaneTheme::Role::Window);
 
         gameWidget = new QWidget();
         gameWidgetLayout = new QVBoxLayout(gameWidget);
@@ -782,7 +873,7 @@ private:
         // Create bottom bar container FIRST - this will be the parent for buttons
         QWidget* bottomBarContainer = new QWidget(gameInterfaceWidget);
         bottomBarContainer->setFixedHeight(50);
-        bottomBarContainer->setStyleSheet("QWidget { background-color: black; }");
+        LaneTheme::instance().apply(bottomBarContainer, LaneTheme::Role::BottomBar);
 
         // Control Buttons - CREATE THEM WITH PROPER PARENT
         qDebug() << "Creating control buttons...";
@@ -804,6 +895,14 @@ private:
         skipButton->setFixedSize(100, 40);
         resetButton->setFixedSize(100, 40);
 
+        // Fonts are set once here; updateButtonStates only swaps palettes
+        QFont buttonFont = holdButton->font();
+        buttonFont.setPixelSize(14);
+        buttonFont.setBold(true);
+        holdButton->setFont(buttonFont);
+        skipButton->setFont(buttonFont);
+        resetButton->setFont(buttonFont);
+
         // CONNECT SIGNALS AFTER CREATION
         connect(holdButton, &QPushButton::clicked, this, &BowlingMainWindow::onHoldClicked);
         connect(skipButton, &QPushButton::clicked, this, &BowlingMainWindow::onSkipClicked);
@@ -818,13 +917,16 @@ private:
         messageScrollArea = new ScrollTextWidget(bottomBarContainer);
         messageScrollArea->setText("Welcome to Canadian 5-Pin Bowling");
         messageScrollArea->setFixedHeight(40);
-        messageScrollArea->setStyleSheet("QLabel { background-color: black; color: yellow; font-size: 14px; border: 1px solid #555555; }");
 
         // Lane Status for call mode
         laneStatusLabel = new QLabel(QString("Lane %1").arg(1), bottomBarContainer);
         laneStatusLabel->setFixedSize(80, 40);
         laneStatusLabel->setAlignment(Qt::AlignCenter);
-        laneStatusLabel->setStyleSheet("QLabel { color: white; font-size: 18px; font-weight: bold; background-color: black; }");
+        QFont laneFont = laneStatusLabel->font();
+        laneFont.setPixelSize(18);
+        laneFont.setBold(true);
+        laneStatusLabel->setFont(laneFont);
+        LaneTheme::instance().apply(laneStatusLabel, LaneTheme::Role::LaneLabel);
 
         bottomBarLayout->addWidget(messageScrollArea, 1);
         bottomBarLayout->addSpacing(10);
@@ -845,6 +947,10 @@ private:
         
         mediaDisplay->hide();
         gameInterfaceWidget->show();
+        
+        if (scoreboardPresenter) {
+            scoreboardPresenter->showScoreboard();
+        }
         gameInterfaceWidget->setParent(centralWidget());
         
         QVBoxLayout* mainLayout = static_cast<QVBoxLayout*>(centralWidget()->layout());
@@ -858,10 +964,90 @@ private:
         mediaDisplay->show();
         gameInterfaceWidget->hide();
         
+        if (scoreboardPresenter) {
+            scoreboardPresenter->showMedia();
+        }
+        
         QVBoxLayout* mainLayout = static_cast<QVBoxLayout*>(centralWidget()->layout());
         mainLayout->setContentsMargins(5, 5, 5, 5);
     }
     
+    void setupPowerManagement(const QJsonObject& powerSettings) {
+        powerManager = new LanePowerManager(this);
+        powerManager->manageScrollText(messageScrollArea);
+        powerManager->manageMachine(machineInterface);
+        powerManager->loadSettings(powerSettings);
+        
+        // Call flash keeps going while idle, just slower
+        connect(powerManager, &LanePowerManager::enteredIdle, this, [this]() {
+            AnimationClock::instance()->setPeriod(callFlashId, CALL_FLASH_IDLE_MS);
+        });
+        connect(powerManager, &LanePowerManager::wokeUp, this, [this]() {
+            AnimationClock::instance()->setPeriod(callFlashId, CALL_FLASH_MS);
+        });
+    }
+    
+    void setupDisplays(const QJsonObject& displaySettings) {
+        scoreboardPresenter = new ScoreboardPresenter(this);
+        scoreboardPresenter->loadSettings(displaySettings);
+        
+        if (scoreboardPresenter->outputCount() == 0) {
+            delete scoreboardPresenter;
+            scoreboardPresenter = nullptr;
+        }
+    }
+    
+    void setupThumbnails(const QJsonObject& thumbnailSettings) {
+        // Front desk live view; starts streaming once the client connects
+        thumbnailer = new LaneThumbnailer(centralWidget(), client, this);
+        thumbnailer->loadSettings(thumbnailSettings);
+    }
+    
+    void setupUpdates() {
+        // Board first: button state and status read what it shows
+        updates = new UpdateCoordinator(this);
+        boardHandler = updates->addHandler(UpdateCoordinator::Scores | UpdateCoordinator::CurrentPlayer,
+                                           [this]() { updateGameDisplay(); });
+        updates->addHandler(UpdateCoordinator::Status, [this]() { updateGameStatus(); });
+        updates->addHandler(UpdateCoordinator::Buttons, [this]() { updateButtonStates(); });
+        updates->addHandler(UpdateCoordinator::Recovery, [this]() { saveGameState(); });
+    }
+    
+    void setupMediaSync(const QJsonObject& syncSettings) {
+        // Adverts and effects follow the server's media tree, fetching only changed chunks
+        MediaSync::Transport transport = [this](const QString& method, const QJsonObject& data,
+                                                RpcChannel::Callback done) {
+            client->call(method, data, RpcChannel::DEFAULT_TIMEOUT_MS, done);
+        };
+        mediaSync = new MediaSync(syncSettings["Root"].toString("media"), transport, this);
+        mediaSync->loadSettings(syncSettings);
+        
+        connect(client, &LaneClient::connected, mediaSync, &MediaSync::sync);
+        connect(client, &LaneClient::serverMessageReceived, this, [this](const QJsonObject& message) {
+            if (message["type"].toString() == "media_manifest_available") {
+                mediaSync->sync();
+            }
+        });
+        connect(mediaSync, &MediaSync::syncFinished, this, [this](const MediaSync::Stats& stats) {
+            if (stats.ok && (stats.filesChanged > 0 || stats.filesRemoved > 0) && !gameActive) {
+                mediaDisplay->showMediaRotation();
+            }
+        });
+    }
+    
+    void startCallFlash() {
+        // Shares the UI animation clock instead of waking the event loop on its own timer
+        AnimationClock* clock = AnimationClock::instance();
+        clock->stop(callFlashId);
+        int period = (powerManager && powerManager->isIdle()) ? CALL_FLASH_IDLE_MS : CALL_FLASH_MS;
+        callFlashId = clock->every(this, period, [this]() { onCallFlash(); });
+    }
+    
+    void stopCallFlash() {
+        AnimationClock::instance()->stop(callFlashId);
+        callFlashId = 0;
+    }
+    
     void setupClient() {
         QSettings settings("settings.ini", QSettings::IniFormat);
         int laneId = settings.value("Lane/id", 1).toInt();
@@ -884,49 +1070,10 @@ private:
     }
     
     void applyDarkTheme() {
-        QString darkStyle = R"(
-            QMainWindow {
-                background-color: #2b2b2b;
-                color: #ffffff;
-            }
-            QWidget {
-                background-color: #2b2b2b;
-                color: #ffffff;
-            }
-            QFrame {
-                background-color: #3c3c3c;
-                border: 1px solid #555555;
-            }
-            QLabel {
-                background-color: transparent;
-                color: #ffffff;
-            }
-            QScrollArea {
-                background-color: #2b2b2b;
-                border: 1px solid #555555;
-            }
-            QPushButton {
-                background-color: #4a4a4a;
-                border: 2px solid #666666;
-                padding: 5px;
-                color: #ffffff;
-                font-weight: bold;
-            }
-            QPushButton:hover {
-                background-color: #5a5a5a;
-                border-color: #777777;
-            }
-            QPushButton:pressed {
-                background-color: #3a3a3a;
-            }
-            QPushButton:disabled {
-                background-color: #666666;
-                color: #999999;
-                border-color: #555555;
-            }
-        )";
-        
-        setStyleSheet(darkStyle);
+        // Application palette covers dialogs; lane widgets get their roles as they are built
+        const QPalette& dark = LaneTheme::instance().palette(LaneTheme::Role::Window);
+        QApplication::setPalette(dark);
+        LaneTheme::instance().apply(this, LaneTheme::Role::Window);
     }
     
     void loadGameColors() {
@@ -934,6 +1081,7 @@ private:
         settings.beginGroup("GameColors");
         
         gameColors.clear();
+        QVector<QPair<QColor, QColor>> themeSchemes;
         for (int i = 1; i <= 6; ++i) {
             QString bgKey = QString("Game%1_Background").arg(i);
             QString fgKey = QString("Game%1_Foreground").arg(i);
@@ -942,38 +1090,33 @@ private:
             scheme.background = settings.value(bgKey, "blue").toString();
             scheme.foreground = settings.value(fgKey, "white").toString();
             gameColors.append(scheme);
+            themeSchemes.append(qMakePair(QColor(scheme.background), QColor(scheme.foreground)));
         }
         settings.endGroup();
+        
+        // Palettes for every scheme are built here, not on each game switch
+        LaneTheme::instance().setGameSchemes(themeSchemes);
     }
     
     void applyGameColors() {
         if (gameColors.isEmpty()) return;
     
+        QElapsedTimer applyTimer;
+        applyTimer.start();
+        
+        // Palettes are prebuilt per scheme, so a game switch is just a palette swap
         int colorIndex = (currentGameNumber - 1) % gameColors.size();
-        const ColorScheme& scheme = gameColors[colorIndex];
-    
-        QString gameStyle = QString(R"(
-            #gameInterfaceWidget {
-                background-color: %1;
-                color: %2;
-            }
-            #gameInterfaceWidget QLabel {
-                background-color: transparent;
-                color: %2;
-            }
-            #gameInterfaceWidget QFrame {
-                background-color: %1;
-                color: %2;
-                border: 2px solid %2;
-            }
-        )").arg(scheme.background, scheme.foreground);
-    
-        gameInterfaceWidget->setObjectName("gameInterfaceWidget");
-        gameInterfaceWidget->setStyleSheet(gameStyle);
+        LaneTheme::instance().apply(gameInterfaceWidget, LaneTheme::Role::GameArea, colorIndex);
     
         if (gameStatus) {
-            gameStatus->setGameStyleSheet(scheme.background, scheme.foreground);
+            gameStatus->setGameScheme(colorIndex);
+        }
+        
+        if (scoreboardPresenter) {
+            scoreboardPresenter->setScheme(colorIndex);
         }
+        
+        qDebug() << "Game colours" << colorIndex + 1 << "applied in" << applyTimer.nsecsElapsed() / 1000 << "us";
     }
 
     void sendGameStatus() {
@@ -1049,6 +1192,13 @@ private:
     QuickGame* game;
     
     MachineInterface* machineInterface;
+    LanePowerManager* powerManager;
+    ScoreboardPresenter* scoreboardPresenter;
+    LaneThumbnailer* thumbnailer;
+    MediaSync* mediaSync;
+    UpdateCoordinator* updates;
+    int boardHandler;
+    quint32 lastBallSequence;       // Last BallEvent handled, so repeats are dropped
     
     // Game state
     bool gameActive;
@@ -1060,16 +1210,36 @@ private:
     int framesSinceFirstBall;
     QVector<ColorScheme> gameColors;
     
-    // Timers
-    QTimer* callTimer;
+    // Call flash (AnimationClock entry, 0 when not flashing)
+    int callFlashId;
+    static constexpr int CALL_FLASH_MS = 500;
+    static constexpr int CALL_FLASH_IDLE_MS = 1500;
+    static constexpr int REBUILD_REPORT_BALLS = 20;
+    
+    // Startup recovery: server mirror first, local journal if it has not answered by then
+    bool recoveryResolved;
+    static constexpr int SERVER_RESTORE_WAIT_MS = 3000;
+    
+    // LoggingSettings.DebugMode: rebuild timings and rebuilds-per-ball reports
+    bool displayDiagnostics;
 };
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
     
-    // Raspberry Pi 3 threading limits
-    QThreadPool::globalInstance()->setMaxThreadCount(2);
+    // Lane widgets are themed by palette; LaneStyle draws their frames and buttons
+    app.setStyle(new LaneStyle(QStyleFactory::create("Fusion")));
+    
+    // Read once; each subsystem gets its own section
+    QJsonObject settings;
+    QFile settingsFile("settings.json");
+    if (settingsFile.open(QIODevice::ReadOnly)) {
+        settings = QJsonDocument::fromJson(settingsFile.readAll()).object();
+    }
+    
+    // Raspberry Pi 3: two background workers, run by priority class (see TaskScheduler)
+    TaskScheduler::instance()->loadSettings(settings["Scheduler"].toObject());
     
     // Reduce Qt's internal threading
     app.setAttribute(Qt::AA_DisableWindowContextHelpButton);
@@ -1087,7 +1257,7 @@ int main(int argc, char *argv[])
     app.setApplicationVersion("1.0");
     app.setOrganizationName("BowlingCenter");
     
-    BowlingMainWindow window;
+    BowlingMainWindow window(settings);
     window.show();
     
     return app.exec();